@@ -0,0 +1,45 @@
+/*
+ * CRC32 using the ARMv8 CRC32 instructions
+ *
+ * These implement the same polynomial (0x04c11db7, bit-reflected) as
+ * lib/crc32.c, so they can be used directly for crc32_no_comp(). They are
+ * optional in ARMv8.0, so crc32_armv8_available() checks the ID register
+ * before lib/crc32.c selects them.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <asm/system.h>
+#include <u-boot/crc.h>
+
+int crc32_armv8_available(void)
+{
+	return ID_AA64ISAR0_FIELD(read_id_aa64isar0(), CRC32) != 0;
+}
+
+uint32_t crc32_armv8(uint32_t crc, const unsigned char *buf, uint len)
+{
+	while (len && ((ulong)buf & 7)) {
+		asm("crc32b %w0, %w0, %w1" : "+r" (crc) : "r" (*buf));
+		buf++;
+		len--;
+	}
+	for (; len >= 32; len -= 32, buf += 32) {
+		asm("crc32x %w0, %w0, %x1\n"
+		    "crc32x %w0, %w0, %x2\n"
+		    "crc32x %w0, %w0, %x3\n"
+		    "crc32x %w0, %w0, %x4"
+		    : "+r" (crc)
+		    : "r" (((const u64 *)buf)[0]), "r" (((const u64 *)buf)[1]),
+		      "r" (((const u64 *)buf)[2]), "r" (((const u64 *)buf)[3]));
+	}
+	for (; len >= 8; len -= 8, buf += 8)
+		asm("crc32x %w0, %w0, %x1" : "+r" (crc) : "r" (*(const u64 *)buf));
+	while (len--) {
+		asm("crc32b %w0, %w0, %w1" : "+r" (crc) : "r" (*buf));
+		buf++;
+	}
+
+	return crc;
+}
@@ -0,0 +1,14 @@
+/*
+ * SHA-1 using the ARMv8 Crypto Extensions, see sha1_ce_core.S
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <asm/system.h>
+#include <u-boot/sha1.h>
+
+int sha1_armv8_ce_available(void)
+{
+	return ID_AA64ISAR0_FIELD(read_id_aa64isar0(), SHA1) != 0;
+}
@@ -3,6 +3,8 @@
  * SPDX-License-Identifier:	GPL-2.0+
  */
 
+#define _GNU_SOURCE	/* for O_DIRECT */
+
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
@@ -50,6 +52,64 @@ ssize_t os_write(int fd, const void *buf, size_t count)
 	return write(fd, buf, count);
 }
 
+ssize_t os_pread(int fd, void *buf, size_t count, off_t offset)
+{
+	size_t done = 0;
+	ssize_t ret;
+
+	while (done < count) {
+		ret = pread(fd, (char *)buf + done, count - done,
+			    offset + done);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (!ret)
+			break;
+		done += ret;
+	}
+
+	return done;
+}
+
+ssize_t os_pwrite(int fd, const void *buf, size_t count, off_t offset)
+{
+	size_t done = 0;
+	ssize_t ret;
+
+	while (done < count) {
+		ret = pwrite(fd, (const char *)buf + done, count - done,
+			     offset + done);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (!ret)
+			break;
+		done += ret;
+	}
+
+	return done;
+}
+
+void *os_map_file(int fd, size_t size)
+{
+	void *ptr;
+
+	ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED)
+		return NULL;
+
+	return ptr;
+}
+
+int os_unmap_file(void *ptr, size_t size)
+{
+	return munmap(ptr, size);
+}
+
 off_t os_lseek(int fd, off_t offset, int whence)
 {
 	if (whence == OS_SEEK_SET)
@@ -84,10 +144,17 @@ int os_open(const char *pathname, int os_flags)
 
 	if (os_flags & OS_O_CREAT)
 		flags |= O_CREAT;
+	if (os_flags & OS_O_DIRECT)
+		flags |= O_DIRECT;
 
 	return open(pathname, flags, 0777);
 }
 
+int os_mkstemp(char *template)
+{
+	return mkstemp(template);
+}
+
 int os_close(int fd)
 {
 	return close(fd);
@@ -0,0 +1,179 @@
+/*
+ * SHA-1 and SHA-256 block functions using the x86 SHA extensions
+ *
+ * These allow the accelerated paths in lib/sha1.c and lib/sha256.c to be
+ * tested on sandbox. This file is built in the system environment, since
+ * it needs the compiler's intrinsics headers.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <stdint.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+
+#define SHA_NI_TARGET	__attribute__((target("sha,sse4.1")))
+
+int sha_ni_available(void)
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1))
+		return 0;
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+		return 0;
+
+	return (ebx & bit_SHA) != 0;
+}
+
+static const uint32_t sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+SHA_NI_TARGET
+void sha256_ni_process(uint32_t state[8], const uint8_t *data,
+		       unsigned int blocks)
+{
+	const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+					    0x0405060700010203ULL);
+	__m128i abef, cdgh, abef_save, cdgh_save, msg[4], wk, tmp;
+	__m128i next = _mm_setzero_si128();
+	int i;
+
+	/* The instructions want the state as ABEF and CDGH */
+	tmp = _mm_shuffle_epi32(_mm_loadu_si128((__m128i *)&state[0]), 0xb1);
+	cdgh = _mm_shuffle_epi32(_mm_loadu_si128((__m128i *)&state[4]), 0x1b);
+	abef = _mm_alignr_epi8(tmp, cdgh, 8);
+	cdgh = _mm_blend_epi16(cdgh, tmp, 0xf0);
+
+	for (; blocks; blocks--, data += 64) {
+		abef_save = abef;
+		cdgh_save = cdgh;
+		for (i = 0; i < 4; i++)
+			msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(
+					(const __m128i *)(data + i * 16)), mask);
+
+		/* Four rounds at a time, extending the schedule as we go */
+		for (i = 0; i < 16; i++) {
+			wk = _mm_add_epi32(msg[0], _mm_loadu_si128(
+					(const __m128i *)&sha256_k[i * 4]));
+			cdgh = _mm_sha256rnds2_epu32(cdgh, abef, wk);
+			abef = _mm_sha256rnds2_epu32(abef, cdgh,
+						     _mm_shuffle_epi32(wk, 0x0e));
+			if (i < 12) {
+				next = _mm_sha256msg1_epu32(msg[0], msg[1]);
+				next = _mm_add_epi32(next, _mm_alignr_epi8(
+						msg[3], msg[2], 4));
+				next = _mm_sha256msg2_epu32(next, msg[3]);
+			}
+			msg[0] = msg[1];
+			msg[1] = msg[2];
+			msg[2] = msg[3];
+			msg[3] = next;
+		}
+		abef = _mm_add_epi32(abef, abef_save);
+		cdgh = _mm_add_epi32(cdgh, cdgh_save);
+	}
+
+	tmp = _mm_shuffle_epi32(abef, 0x1b);
+	cdgh = _mm_shuffle_epi32(cdgh, 0xb1);
+	_mm_storeu_si128((__m128i *)&state[0], _mm_blend_epi16(tmp, cdgh, 0xf0));
+	_mm_storeu_si128((__m128i *)&state[4], _mm_alignr_epi8(cdgh, tmp, 8));
+}
+
+SHA_NI_TARGET
+void sha1_ni_process(unsigned long state[5], const unsigned char *data,
+		     unsigned int blocks)
+{
+	const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL,
+					    0x08090a0b0c0d0e0fULL);
+	__m128i abcd, e0, e1, abcd_save, e_save, msg[4];
+	__m128i next = _mm_setzero_si128();
+	uint32_t words[4];
+	int i;
+
+	abcd = _mm_set_epi32(state[0], state[1], state[2], state[3]);
+	e0 = _mm_set_epi32(state[4], 0, 0, 0);
+
+	for (; blocks; blocks--, data += 64) {
+		abcd_save = abcd;
+		e_save = e0;
+		for (i = 0; i < 4; i++)
+			msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(
+					(const __m128i *)(data + i * 16)), mask);
+
+		/* Four rounds at a time, extending the schedule as we go */
+		e0 = _mm_add_epi32(e0, msg[0]);
+		for (i = 0; i < 20; i++) {
+			if (i)
+				e0 = _mm_sha1nexte_epu32(e1, msg[0]);
+			e1 = abcd;
+			/* The round function must be an immediate */
+			switch (i / 5) {
+			case 0:
+				abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+				break;
+			case 1:
+				abcd = _mm_sha1rnds4_epu32(abcd, e0, 1);
+				break;
+			case 2:
+				abcd = _mm_sha1rnds4_epu32(abcd, e0, 2);
+				break;
+			default:
+				abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+				break;
+			}
+			if (i < 16) {
+				next = _mm_sha1msg1_epu32(msg[0], msg[1]);
+				next = _mm_xor_si128(next, msg[2]);
+				next = _mm_sha1msg2_epu32(next, msg[3]);
+			}
+			msg[0] = msg[1];
+			msg[1] = msg[2];
+			msg[2] = msg[3];
+			msg[3] = next;
+		}
+		e0 = _mm_sha1nexte_epu32(e1, e_save);
+		abcd = _mm_add_epi32(abcd, abcd_save);
+	}
+
+	_mm_storeu_si128((__m128i *)words, _mm_shuffle_epi32(abcd, 0x1b));
+	for (i = 0; i < 4; i++)
+		state[i] = words[i];
+	state[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+}
+#else
+int sha_ni_available(void)
+{
+	return 0;
+}
+
+void sha256_ni_process(uint32_t state[8], const uint8_t *data,
+		       unsigned int blocks)
+{
+}
+
+void sha1_ni_process(unsigned long state[5], const unsigned char *data,
+		     unsigned int blocks)
+{
+}
+#endif
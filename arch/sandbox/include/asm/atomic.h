@@ -0,0 +1,124 @@
+/*
+ * Atomic operations for sandbox
+ *
+ * Sandbox runs U-Boot in a single thread with no interrupts, so these are
+ * plain reads and writes.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef __ASM_SANDBOX_ATOMIC_H
+#define __ASM_SANDBOX_ATOMIC_H
+
+#include <asm/types.h>
+
+typedef struct { int counter; } atomic_t;
+typedef struct { long long counter; } atomic64_t;
+
+#define ATOMIC_INIT(i)		{ (i) }
+#define ATOMIC64_INIT(i)	{ (i) }
+
+#define atomic_read(v)		((v)->counter)
+#define atomic_set(v, i)	(((v)->counter) = (i))
+#define atomic64_read(v)	((v)->counter)
+#define atomic64_set(v, i)	(((v)->counter) = (i))
+
+static inline int atomic_add_return(int i, atomic_t *v)
+{
+	v->counter += i;
+
+	return v->counter;
+}
+
+static inline long long atomic64_add_return(long long i, atomic64_t *v)
+{
+	v->counter += i;
+
+	return v->counter;
+}
+
+static inline int atomic_cmpxchg(atomic_t *v, int old, int new)
+{
+	int prev = v->counter;
+
+	if (prev == old)
+		v->counter = new;
+
+	return prev;
+}
+
+static inline long long atomic64_cmpxchg(atomic64_t *v, long long old,
+					 long long new)
+{
+	long long prev = v->counter;
+
+	if (prev == old)
+		v->counter = new;
+
+	return prev;
+}
+
+static inline int atomic_xchg(atomic_t *v, int new)
+{
+	int prev = v->counter;
+
+	v->counter = new;
+
+	return prev;
+}
+
+static inline long long atomic64_xchg(atomic64_t *v, long long new)
+{
+	long long prev = v->counter;
+
+	v->counter = new;
+
+	return prev;
+}
+
+static inline int atomic_add_unless(atomic_t *v, int a, int u)
+{
+	if (v->counter == u)
+		return 0;
+	v->counter += a;
+
+	return 1;
+}
+
+static inline int atomic64_add_unless(atomic64_t *v, long long a,
+				      long long u)
+{
+	if (v->counter == u)
+		return 0;
+	v->counter += a;
+
+	return 1;
+}
+
+#define atomic_add(i, v)		((void)atomic_add_return(i, v))
+#define atomic_sub(i, v)		((void)atomic_add_return(-(i), v))
+#define atomic_inc(v)			atomic_add(1, v)
+#define atomic_dec(v)			atomic_sub(1, v)
+#define atomic_sub_return(i, v)		atomic_add_return(-(i), v)
+#define atomic_inc_return(v)		atomic_add_return(1, v)
+#define atomic_dec_return(v)		atomic_add_return(-1, v)
+#define atomic_sub_and_test(i, v)	(atomic_sub_return(i, v) == 0)
+#define atomic_inc_and_test(v)		(atomic_inc_return(v) == 0)
+#define atomic_dec_and_test(v)		(atomic_dec_return(v) == 0)
+#define atomic_add_negative(i, v)	(atomic_add_return(i, v) < 0)
+#define atomic_inc_not_zero(v)		atomic_add_unless(v, 1, 0)
+
+#define atomic64_add(i, v)		((void)atomic64_add_return(i, v))
+#define atomic64_sub(i, v)		((void)atomic64_add_return(-(i), v))
+#define atomic64_inc(v)			atomic64_add(1, v)
+#define atomic64_dec(v)			atomic64_sub(1, v)
+#define atomic64_sub_return(i, v)	atomic64_add_return(-(i), v)
+#define atomic64_inc_return(v)		atomic64_add_return(1, v)
+#define atomic64_dec_return(v)		atomic64_add_return(-1, v)
+#define atomic64_sub_and_test(i, v)	(atomic64_sub_return(i, v) == 0)
+#define atomic64_inc_and_test(v)	(atomic64_inc_return(v) == 0)
+#define atomic64_dec_and_test(v)	(atomic64_dec_return(v) == 0)
+#define atomic64_add_negative(i, v)	(atomic64_add_return(i, v) < 0)
+#define atomic64_inc_not_zero(v)	atomic64_add_unless(v, 1, 0)
+
+#endif
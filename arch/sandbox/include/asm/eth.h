@@ -14,4 +14,34 @@ void sandbox_eth_disable_response(int index, bool disable);
 
 void sandbox_eth_skip_timeout(void);
 
+/**
+ * struct sandbox_eth_tftp - mock TFTP server run by the sandbox driver
+ *
+ * The server answers any read request with a file of @file_size bytes
+ * whose content is given by sandbox_eth_tftp_byte().
+ *
+ * @file_size:	Size of the file served
+ * @max_window:	Largest windowsize granted, 0 to ignore the option
+ * @reorder:	Swap each pair of blocks within a window
+ * @drop_block:	Block number to drop the first time it is sent, 0 for none
+ * @data_sent:	Number of data packets sent
+ * @acks:	Number of acknowledgements received
+ */
+struct sandbox_eth_tftp {
+	ulong file_size;
+	int max_window;
+	bool reorder;
+	ulong drop_block;
+	ulong data_sent;
+	ulong acks;
+};
+
+void sandbox_eth_set_tftp(struct sandbox_eth_tftp *tftp);
+
+/* Content of the file served by the mock TFTP server at @offset */
+static inline u8 sandbox_eth_tftp_byte(ulong offset)
+{
+	return (offset ^ (offset >> 9) ^ (offset >> 17)) & 0xff;
+}
+
 #endif /* __ETH_H */
@@ -88,4 +88,119 @@ long sandbox_i2c_rtc_get_set_base_time(struct udevice *dev, long base_time);
 
 int sandbox_usb_keyb_add_string(struct udevice *dev, const char *str);
 
+/**
+ * sandbox_mmc_set_card_type() - set the emulated eMMC's EXT_CSD card type
+ *
+ * This controls which bus modes the device supports. It takes effect the
+ * next time the device is initialised.
+ *
+ * @dev:	MMC device
+ * @card_type:	EXT_CSD_CARD_TYPE_... flags
+ */
+void sandbox_mmc_set_card_type(struct udevice *dev, u8 card_type);
+
+/**
+ * sandbox_mmc_set_tuning_window() - set the phases which work at HS200
+ *
+ * At HS200 the emulated eMMC can only be read if the host samples data at a
+ * phase from @start to @end inclusive. Use @start > @end for none.
+ *
+ * @dev:	MMC device
+ * @start:	First good phase (0-15)
+ * @end:	Last good phase (0-15)
+ */
+void sandbox_mmc_set_tuning_window(struct udevice *dev, int start, int end);
+
+/**
+ * sandbox_mmc_get_phase() - get the sampling phase chosen by tuning
+ *
+ * @dev:	MMC device
+ * @return current sampling phase of the emulated host
+ */
+int sandbox_mmc_get_phase(struct udevice *dev);
+
+/**
+ * sandbox_sf_get_erase_count() - get the number of erase commands received
+ *
+ * @dev:	SPI flash emulator device
+ * @return number of erase commands since the emulator was probed
+ */
+uint sandbox_sf_get_erase_count(struct udevice *dev);
+
+struct mtd_info;
+
+/**
+ * struct sandbox_nand_stats - operations carried out by a sandbox NAND chip
+ *
+ * @reads:	page reads (array to page register)
+ * @programs:	page programs
+ * @erases:	block erases
+ * @bytes_out:	bytes transferred out of the chip
+ * @bytes_in:	bytes transferred into the chip
+ * @corrected:	bitflips reported as corrected
+ * @failed:	page reads with too many bitflips to correct
+ * @busy_ns:	time a real chip would have taken, in nanoseconds
+ * @host_ns:	time spent accessing the backing file, in nanoseconds
+ */
+struct sandbox_nand_stats {
+	ulong reads;
+	ulong programs;
+	ulong erases;
+	u64 bytes_out;
+	u64 bytes_in;
+	ulong corrected;
+	ulong failed;
+	u64 busy_ns;
+	u64 host_ns;
+};
+
+/**
+ * sandbox_nand_set_bitflips() - inject bitflips into a NAND page
+ *
+ * Each read of the page reports this many bitflips until the block is
+ * erased. If there are more than the ECC strength the data is corrupted.
+ *
+ * @mtd:	sandbox NAND device
+ * @page:	page number
+ * @bits:	number of bitflips, or 0 to remove them
+ * @return 0 if OK, -ENOSPC if too many pages have bitflips, -ENODEV if
+ * @mtd is not a sandbox NAND device
+ */
+int sandbox_nand_set_bitflips(struct mtd_info *mtd, int page, int bits);
+
+/**
+ * sandbox_nand_set_failing() - make erasing and programming a block fail
+ *
+ * @mtd:	sandbox NAND device
+ * @block:	block number
+ * @fail:	true to make the block fail, false to make it work again
+ * @return 0 if OK, -EINVAL if the block does not exist, -ENODEV if @mtd
+ * is not a sandbox NAND device
+ */
+int sandbox_nand_set_failing(struct mtd_info *mtd, int block, bool fail);
+
+/**
+ * sandbox_nand_reset() - return a NAND chip to its state at start-up
+ *
+ * This erases every block, removes injected bitflips and failures, forgets
+ * blocks marked bad since start-up and clears the statistics, so that a test
+ * does not depend on what earlier tests did.
+ *
+ * @mtd:	sandbox NAND device
+ * @return 0 if OK, -EIO if the backing file could not be written, -ENODEV
+ * if @mtd is not a sandbox NAND device
+ */
+int sandbox_nand_reset(struct mtd_info *mtd);
+
+/**
+ * sandbox_nand_get_stats() - get the operation statistics of a NAND chip
+ *
+ * The caller may clear the statistics by zeroing the structure.
+ *
+ * @mtd:	sandbox NAND device
+ * @return pointer to the statistics, or NULL if @mtd is not a sandbox NAND
+ * device
+ */
+struct sandbox_nand_stats *sandbox_nand_get_stats(struct mtd_info *mtd);
+
 #endif
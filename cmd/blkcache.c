@@ -14,30 +14,43 @@ static int blkc_show(cmd_tbl_t *cmdtp, int flag,
 		     int argc, char * const argv[])
 {
 	struct block_cache_stats stats;
+	struct block_cache_dev_stats dstats;
+	int i;
+
 	blkcache_stats(&stats);
 
 	printf("    hits: %u\n"
 	       "    misses: %u\n"
+	       "    evictions: %u\n"
+	       "    read-aheads: %u\n"
 	       "    entries: %u\n"
-	       "    max blocks/entry: %u\n"
-	       "    max cache entries: %u\n",
-	       stats.hits, stats.misses, stats.entries,
-	       stats.max_blocks_per_entry, stats.max_entries);
+	       "    max cache entries: %u\n"
+	       "    size: %u MiB, %u-way, read-ahead %u KiB\n",
+	       stats.hits, stats.misses, stats.evictions, stats.readaheads,
+	       stats.entries, stats.max_entries, stats.size_mb, stats.ways,
+	       stats.readahead_kb);
+
+	for (i = 0; !blkcache_dev_stats(i, &dstats); i++) {
+		printf("    if_type %d dev %d: hits %u misses %u evictions %u read-aheads %u\n",
+		       dstats.iftype, dstats.devnum, dstats.hits,
+		       dstats.misses, dstats.evictions, dstats.readaheads);
+	}
 	return 0;
 }
 
 static int blkc_configure(cmd_tbl_t *cmdtp, int flag,
 			  int argc, char * const argv[])
 {
-	unsigned blocks_per_entry, max_entries;
-	if (argc != 3)
+	unsigned megabytes, readahead_kb;
+	if (argc != 2 && argc != 3)
 		return CMD_RET_USAGE;
 
-	blocks_per_entry = simple_strtoul(argv[1], 0, 0);
-	max_entries = simple_strtoul(argv[2], 0, 0);
-	blkcache_configure(blocks_per_entry, max_entries);
-	printf("changed to max of %u entries of %u blocks each\n",
-	       max_entries, blocks_per_entry);
+	megabytes = simple_strtoul(argv[1], 0, 0);
+	readahead_kb = argc > 2 ? simple_strtoul(argv[2], 0, 0) :
+				  CONFIG_BLOCK_CACHE_READAHEAD;
+	blkcache_configure(megabytes, readahead_kb);
+	printf("changed to %u MiB with up to %u KiB read-ahead\n",
+	       megabytes, readahead_kb);
 	return 0;
 }
 
@@ -85,5 +98,5 @@ U_BOOT_CMD(
 	blkcache, 4, 0, do_blkcache,
 	"block cache diagnostics and control",
 	"show - show and reset statistics\n"
-	"blkcache configure blocks entries\n"
+	"blkcache configure megabytes [readahead_kb]\n"
 );
@@ -0,0 +1,70 @@
+/*
+ * Load an image from a FIT on a filesystem, in one pass
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <fs.h>
+#include <image.h>
+#include <mapmem.h>
+
+#ifndef CONFIG_SYS_BOOTM_LEN
+/* use the same default limit as bootm */
+#define CONFIG_SYS_BOOTM_LEN	0x800000
+#endif
+
+static long fitload_read(struct fit_stream_src *src, ulong offset, ulong size,
+			 void *buf)
+{
+	const char *filename = src->priv;
+	loff_t actread;
+
+	if (fs_read_at(filename, map_to_sysmem(buf), offset, size, &actread))
+		return -EIO;
+
+	return actread;
+}
+
+static int do_fitload(cmd_tbl_t *cmdtp, int flag, int argc,
+		      char * const argv[])
+{
+	struct fit_stream_src src;
+	ulong load = FIT_STREAM_LOAD_DEFAULT;
+	ulong size;
+	int ret;
+
+	if (argc < 5)
+		return CMD_RET_USAGE;
+	if (strcmp(argv[3], "-"))
+		load = simple_strtoul(argv[3], NULL, 16);
+
+	/* Keep the filesystem open while the FIT is read */
+	if (fs_set_blk_dev(argv[1], argv[2], FS_TYPE_ANY))
+		return CMD_RET_FAILURE;
+	memset(&src, '\0', sizeof(src));
+	src.read = fitload_read;
+	src.priv = argv[4];
+	ret = fit_stream_load(&src, argc > 5 ? argv[5] : NULL, &load,
+			      CONFIG_SYS_BOOTM_LEN, &size);
+	fs_close();
+	if (ret)
+		return CMD_RET_FAILURE;
+
+	printf("%lu bytes loaded to %08lx\n", size, load);
+	setenv_hex("fileaddr", load);
+	setenv_hex("filesize", size);
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD(
+	fitload,	6,	0,	do_fitload,
+	"load an image from a FIT file, decompressing it as it is read",
+	"<interface> <dev[:part]> <addr> <filename> [image]\n"
+	"    - Load 'image' (default: the kernel of the default configuration)\n"
+	"      from FIT file 'filename' on 'dev' of 'interface', checking its\n"
+	"      hashes and decompressing it. 'addr' may be - to use the load\n"
+	"      address from the FIT. Sets fileaddr and filesize."
+);
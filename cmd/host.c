@@ -9,6 +9,7 @@
 #include <fs.h>
 #include <part.h>
 #include <sandboxblockdev.h>
+#include <div64.h>
 #include <asm/errno.h>
 
 static int host_curr_device = -1;
@@ -31,9 +32,26 @@ static int do_host_save(cmd_tbl_t *cmdtp, int flag, int argc,
 	return do_save(cmdtp, flag, argc, argv, FS_TYPE_SANDBOX);
 }
 
+static const char *const host_mode_name[] = {
+	[HOST_BLOCK_PREAD]	= "pread",
+	[HOST_BLOCK_DIRECT]	= "direct",
+	[HOST_BLOCK_MMAP]	= "mmap",
+};
+
 static int do_host_bind(cmd_tbl_t *cmdtp, int flag, int argc,
 			   char * const argv[])
 {
+	enum host_block_mode mode = HOST_BLOCK_PREAD;
+
+	if (argc > 1 && !strcmp(argv[1], "-d")) {
+		mode = HOST_BLOCK_DIRECT;
+		argc--;
+		argv++;
+	} else if (argc > 1 && !strcmp(argv[1], "-m")) {
+		mode = HOST_BLOCK_MMAP;
+		argc--;
+		argv++;
+	}
 	if (argc < 2 || argc > 3)
 		return CMD_RET_USAGE;
 	char *ep;
@@ -44,7 +62,16 @@ static int do_host_bind(cmd_tbl_t *cmdtp, int flag, int argc,
 		printf("** Bad device specification %s **\n", dev_str);
 		return CMD_RET_USAGE;
 	}
-	return host_dev_bind(dev, file);
+	return host_dev_bind_mode(dev, file, mode);
+}
+
+static struct host_block_dev *host_get_host_dev(struct blk_desc *blk_dev)
+{
+#ifdef CONFIG_BLK
+	return dev_get_priv(blk_dev->bdev);
+#else
+	return blk_dev->priv;
+#endif
 }
 
 static int do_host_info(cmd_tbl_t *cmdtp, int flag, int argc,
@@ -66,7 +93,7 @@ static int do_host_info(cmd_tbl_t *cmdtp, int flag, int argc,
 		max_dev = dev;
 	}
 	int dev;
-	printf("%3s %12s %s\n", "dev", "blocks", "path");
+	printf("%3s %12s %-6s %s\n", "dev", "blocks", "mode", "path");
 	for (dev = min_dev; dev <= max_dev; dev++) {
 		struct blk_desc *blk_dev;
 		int ret;
@@ -81,16 +108,73 @@ static int do_host_info(cmd_tbl_t *cmdtp, int flag, int argc,
 
 			continue;
 		}
+		struct host_block_dev *host_dev = host_get_host_dev(blk_dev);
+
+		printf("%12lu %-6s %s\n", (unsigned long)blk_dev->lba,
+		       host_mode_name[host_dev->mode], host_dev->filename);
+	}
+	return 0;
+}
+
+static void host_show_rate(const char *name, ulong count, u64 blocks,
+			   ulong blksz, u64 nsec)
+{
+	u64 bytes = blocks * blksz;
+	ulong usec = lldiv(nsec, 1000);
+
+	printf("    %-6s %10lu requests %12llu bytes %10lu us", name, count,
+	       bytes, usec);
+	if (usec)
+		printf(" %8llu KiB/s", lldiv((bytes >> 10) * 1000000, usec));
+	putc('\n');
+}
+
+static int do_host_stats(cmd_tbl_t *cmdtp, int flag, int argc,
+			 char * const argv[])
+{
+	int min_dev = 0;
+	int max_dev = CONFIG_HOST_MAX_DEVICES - 1;
+	bool reset = false;
+	int dev;
+
+	if (argc > 1 && !strcmp(argv[1], "-r")) {
+		reset = true;
+		argc--;
+		argv++;
+	}
+	if (argc > 2)
+		return CMD_RET_USAGE;
+	if (argc == 2) {
+		char *ep;
+
+		min_dev = simple_strtoul(argv[1], &ep, 16);
+		if (*ep) {
+			printf("** Bad device specification %s **\n", argv[1]);
+			return CMD_RET_USAGE;
+		}
+		max_dev = min_dev;
+	}
+	for (dev = min_dev; dev <= max_dev; dev++) {
 		struct host_block_dev *host_dev;
+		struct host_block_stats *stats;
+		struct blk_desc *blk_dev;
 
-#ifdef CONFIG_BLK
-		host_dev = dev_get_priv(blk_dev->bdev);
-#else
-		host_dev = blk_dev->priv;
-#endif
-		printf("%12lu %s\n", (unsigned long)blk_dev->lba,
-		       host_dev->filename);
+		if (host_get_dev_err(dev, &blk_dev))
+			continue;
+		host_dev = host_get_host_dev(blk_dev);
+		stats = &host_dev->stats;
+		if (reset) {
+			memset(stats, '\0', sizeof(*stats));
+			continue;
+		}
+		printf("host %d (%s): %lu errors\n", dev,
+		       host_mode_name[host_dev->mode], stats->errors);
+		host_show_rate("read", stats->reads, stats->read_blocks,
+			       blk_dev->blksz, stats->read_nsec);
+		host_show_rate("write", stats->writes, stats->write_blocks,
+			       blk_dev->blksz, stats->write_nsec);
 	}
+
 	return 0;
 }
 
@@ -138,8 +222,9 @@ static cmd_tbl_t cmd_host_sub[] = {
 	U_BOOT_CMD_MKENT(load, 7, 0, do_host_load, "", ""),
 	U_BOOT_CMD_MKENT(ls, 3, 0, do_host_ls, "", ""),
 	U_BOOT_CMD_MKENT(save, 6, 0, do_host_save, "", ""),
-	U_BOOT_CMD_MKENT(bind, 3, 0, do_host_bind, "", ""),
+	U_BOOT_CMD_MKENT(bind, 4, 0, do_host_bind, "", ""),
 	U_BOOT_CMD_MKENT(info, 3, 0, do_host_info, "", ""),
+	U_BOOT_CMD_MKENT(stats, 3, 0, do_host_stats, "", ""),
 	U_BOOT_CMD_MKENT(dev, 0, 1, do_host_dev, "", ""),
 };
 
@@ -174,8 +259,10 @@ U_BOOT_CMD(
 	"host ls hostfs - <filename>                    - list files on host\n"
 	"host save hostfs - <addr> <filename> <bytes> [<offset>] - "
 		"save a file to host\n"
-	"host bind <dev> [<filename>] - bind \"host\" device to file\n"
+	"host bind [-d | -m] <dev> [<filename>] - bind \"host\" device to file\n"
+	"    -d: use O_DIRECT, -m: map the file into memory\n"
 	"host info [<dev>]            - show device binding & info\n"
+	"host stats [-r] [<dev>]      - show (or reset) device I/O statistics\n"
 	"host dev [<dev>] - Set or retrieve the current host device\n"
 	"host commands use the \"hostfs\" device. The \"host\" device is used\n"
 	"with standard IO commands such as fatls or ext2load"
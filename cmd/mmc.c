@@ -8,6 +8,7 @@
 #include <common.h>
 #include <command.h>
 #include <console.h>
+#include <mapmem.h>
 #include <mmc.h>
 
 static int curr_device = -1;
@@ -99,6 +100,7 @@ static void print_mmcinfo(struct mmc *mmc)
 
 	printf("Bus Width: %d-bit%s\n", mmc->bus_width,
 			mmc->ddr_mode ? " DDR" : "");
+	printf("Mode: %s\n", mmc_mode_name(mmc->selected_mode));
 
 	puts("Erase Group Size: ");
 	print_size(((u64)mmc->erase_grp_size) << 9, "\n");
@@ -199,7 +201,7 @@ static int do_mmcrpmb_key(cmd_tbl_t *cmdtp, int flag,
 	if (argc != 2)
 		return CMD_RET_USAGE;
 
-	key_addr = (void *)simple_strtoul(argv[1], NULL, 16);
+	key_addr = map_sysmem(simple_strtoul(argv[1], NULL, 16), 0);
 	if (!confirm_key_prog())
 		return CMD_RET_FAILURE;
 	if (mmc_rpmb_set_key(mmc, key_addr)) {
@@ -220,12 +222,12 @@ static int do_mmcrpmb_read(cmd_tbl_t *cmdtp, int flag,
 	if (argc < 4)
 		return CMD_RET_USAGE;
 
-	addr = (void *)simple_strtoul(argv[1], NULL, 16);
+	addr = map_sysmem(simple_strtoul(argv[1], NULL, 16), 0);
 	blk = simple_strtoul(argv[2], NULL, 16);
 	cnt = simple_strtoul(argv[3], NULL, 16);
 
 	if (argc == 5)
-		key_addr = (void *)simple_strtoul(argv[4], NULL, 16);
+		key_addr = map_sysmem(simple_strtoul(argv[4], NULL, 16), 0);
 
 	printf("\nMMC RPMB read: dev # %d, block # %d, count %d ... ",
 	       curr_device, blk, cnt);
@@ -248,10 +250,10 @@ static int do_mmcrpmb_write(cmd_tbl_t *cmdtp, int flag,
 	if (argc != 5)
 		return CMD_RET_USAGE;
 
-	addr = (void *)simple_strtoul(argv[1], NULL, 16);
+	addr = map_sysmem(simple_strtoul(argv[1], NULL, 16), 0);
 	blk = simple_strtoul(argv[2], NULL, 16);
 	cnt = simple_strtoul(argv[3], NULL, 16);
-	key_addr = (void *)simple_strtoul(argv[4], NULL, 16);
+	key_addr = map_sysmem(simple_strtoul(argv[4], NULL, 16), 0);
 
 	printf("\nMMC RPMB write: dev # %d, block # %d, count %d ... ",
 	       curr_device, blk, cnt);
@@ -335,7 +337,7 @@ static int do_mmc_read(cmd_tbl_t *cmdtp, int flag,
 	if (argc != 4)
 		return CMD_RET_USAGE;
 
-	addr = (void *)simple_strtoul(argv[1], NULL, 16);
+	addr = map_sysmem(simple_strtoul(argv[1], NULL, 16), 0);
 	blk = simple_strtoul(argv[2], NULL, 16);
 	cnt = simple_strtoul(argv[3], NULL, 16);
 
@@ -363,7 +365,7 @@ static int do_mmc_write(cmd_tbl_t *cmdtp, int flag,
 	if (argc != 4)
 		return CMD_RET_USAGE;
 
-	addr = (void *)simple_strtoul(argv[1], NULL, 16);
+	addr = map_sysmem(simple_strtoul(argv[1], NULL, 16), 0);
 	blk = simple_strtoul(argv[2], NULL, 16);
 	cnt = simple_strtoul(argv[3], NULL, 16);
 
@@ -787,6 +789,51 @@ static int do_mmc_setdsr(cmd_tbl_t *cmdtp, int flag,
 	return ret;
 }
 
+static const struct {
+	const char *name;
+	enum bus_mode mode;
+} mmc_mode_args[] = {
+	{ "legacy", MMC_LEGACY },
+	{ "hs", MMC_HS },
+	{ "hs52", MMC_HS_52 },
+	{ "ddr52", MMC_DDR_52 },
+	{ "hs200", MMC_HS_200 },
+	{ "auto", MMC_MODES_END },
+};
+
+static int do_mmc_mode(cmd_tbl_t *cmdtp, int flag,
+		       int argc, char * const argv[])
+{
+	struct mmc *mmc;
+	int i;
+
+	if (argc == 2) {
+		for (i = 0; i < ARRAY_SIZE(mmc_mode_args); i++) {
+			if (!strcmp(argv[1], mmc_mode_args[i].name))
+				break;
+		}
+		if (i == ARRAY_SIZE(mmc_mode_args))
+			return CMD_RET_USAGE;
+
+		mmc = find_mmc_device(curr_device);
+		if (!mmc) {
+			printf("no mmc device at slot %x\n", curr_device);
+			return CMD_RET_FAILURE;
+		}
+		mmc_set_max_mode(mmc, mmc_mode_args[i].mode);
+	} else if (argc != 1) {
+		return CMD_RET_USAGE;
+	}
+
+	/* Start again so that a new limit takes effect */
+	mmc = init_mmc_device(curr_device, argc == 2);
+	if (!mmc)
+		return CMD_RET_FAILURE;
+	printf("%s\n", mmc_mode_name(mmc->selected_mode));
+
+	return CMD_RET_SUCCESS;
+}
+
 static cmd_tbl_t cmd_mmc[] = {
 	U_BOOT_CMD_MKENT(info, 1, 0, do_mmcinfo, "", ""),
 	U_BOOT_CMD_MKENT(read, 4, 1, do_mmc_read, "", ""),
@@ -807,6 +854,7 @@ static cmd_tbl_t cmd_mmc[] = {
 	U_BOOT_CMD_MKENT(rpmb, CONFIG_SYS_MAXARGS, 1, do_mmcrpmb, "", ""),
 #endif
 	U_BOOT_CMD_MKENT(setdsr, 2, 0, do_mmc_setdsr, "", ""),
+	U_BOOT_CMD_MKENT(mode, 2, 0, do_mmc_mode, "", ""),
 };
 
 static int do_mmcops(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
@@ -871,6 +919,8 @@ U_BOOT_CMD(
 	"mmc rpmb counter - read the value of the write counter\n"
 #endif
 	"mmc setdsr <value> - set DSR register value\n"
+	"mmc mode [legacy|hs|hs52|ddr52|hs200|auto]\n"
+	" - show the bus mode, or set the fastest one to use and reinit\n"
 	);
 
 /* Old command kept for compatibility. Same as 'mmc info' */
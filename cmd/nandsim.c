@@ -0,0 +1,134 @@
+/*
+ * Control the sandbox NAND simulator and show its statistics
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <div64.h>
+#include <nand.h>
+#include <asm/test.h>
+
+static struct mtd_info *nandsim_get_mtd(void)
+{
+	if (nand_curr_device < 0 ||
+	    !sandbox_nand_get_stats(&nand_info[nand_curr_device])) {
+		puts("No sandbox NAND device\n");
+		return NULL;
+	}
+
+	return &nand_info[nand_curr_device];
+}
+
+static int do_nandsim_stats(cmd_tbl_t *cmdtp, int flag, int argc,
+			    char * const argv[])
+{
+	struct sandbox_nand_stats *stats;
+	struct mtd_info *mtd;
+
+	mtd = nandsim_get_mtd();
+	if (!mtd)
+		return CMD_RET_FAILURE;
+	stats = sandbox_nand_get_stats(mtd);
+	if (argc > 1) {
+		if (strcmp(argv[1], "-r"))
+			return CMD_RET_USAGE;
+		memset(stats, '\0', sizeof(*stats));
+		return 0;
+	}
+
+	printf("reads:     %10lu (%llu bytes out)\n", stats->reads,
+	       stats->bytes_out);
+	printf("programs:  %10lu (%llu bytes in)\n", stats->programs,
+	       stats->bytes_in);
+	printf("erases:    %10lu\n", stats->erases);
+	printf("bitflips:  %10lu corrected, %lu uncorrectable reads\n",
+	       stats->corrected, stats->failed);
+	printf("chip time: %10llu us\n", lldiv(stats->busy_ns, 1000));
+	printf("host time: %10llu us\n", lldiv(stats->host_ns, 1000));
+
+	return 0;
+}
+
+static int do_nandsim_bitflip(cmd_tbl_t *cmdtp, int flag, int argc,
+			      char * const argv[])
+{
+	struct mtd_info *mtd;
+	int ret;
+
+	if (argc != 3)
+		return CMD_RET_USAGE;
+	mtd = nandsim_get_mtd();
+	if (!mtd)
+		return CMD_RET_FAILURE;
+	ret = sandbox_nand_set_bitflips(mtd, simple_strtoul(argv[1], NULL, 16),
+					simple_strtoul(argv[2], NULL, 10));
+	if (ret) {
+		printf("Cannot inject bitflips (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	return 0;
+}
+
+static int do_nandsim_fail(cmd_tbl_t *cmdtp, int flag, int argc,
+			   char * const argv[])
+{
+	struct mtd_info *mtd;
+	bool fail = true;
+	int ret;
+
+	if (argc < 2 || argc > 3)
+		return CMD_RET_USAGE;
+	if (argc == 3)
+		fail = simple_strtoul(argv[2], NULL, 10);
+	mtd = nandsim_get_mtd();
+	if (!mtd)
+		return CMD_RET_FAILURE;
+	ret = sandbox_nand_set_failing(mtd, simple_strtoul(argv[1], NULL, 16),
+				       fail);
+	if (ret) {
+		printf("Cannot set block state (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	return 0;
+}
+
+static cmd_tbl_t cmd_nandsim_sub[] = {
+	U_BOOT_CMD_MKENT(stats, 2, 0, do_nandsim_stats, "", ""),
+	U_BOOT_CMD_MKENT(bitflip, 3, 0, do_nandsim_bitflip, "", ""),
+	U_BOOT_CMD_MKENT(fail, 3, 0, do_nandsim_fail, "", ""),
+};
+
+static int do_nandsim(cmd_tbl_t *cmdtp, int flag, int argc,
+		      char * const argv[])
+{
+	cmd_tbl_t *c;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	/* Skip past 'nandsim' */
+	argc--;
+	argv++;
+
+	c = find_cmd_tbl(argv[0], cmd_nandsim_sub,
+			 ARRAY_SIZE(cmd_nandsim_sub));
+	if (c)
+		return c->cmd(cmdtp, flag, argc, argv);
+	else
+		return CMD_RET_USAGE;
+}
+
+U_BOOT_CMD(
+	nandsim, 4, 1, do_nandsim,
+	"sandbox NAND simulator",
+	"stats [-r]             - show (or reset) operation statistics\n"
+	"nandsim bitflip <page> <n> - report n bitflips on each read of a page\n"
+	"nandsim fail <block> [0|1] - make erase/program of a block fail\n"
+	"nandsim commands act on the current NAND device. Page and block\n"
+	"numbers are in hex. The chip time is what a real chip would take\n"
+	"(see the timing properties of the \"sandbox,nand\" node)"
+);
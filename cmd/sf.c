@@ -152,106 +152,58 @@ static int do_spi_flash_probe(int argc, char * const argv[])
 	return 0;
 }
 
-/**
- * Write a block of data to SPI flash, first checking if it is different from
- * what is already there.
- *
- * If the data being written is the same, then *skipped is incremented by len.
- *
- * @param flash		flash context pointer
- * @param offset	flash offset to write
- * @param len		number of bytes to write
- * @param buf		buffer to write from
- * @param cmp_buf	read buffer to use to compare data
- * @param skipped	Count of skipped data (incremented by this function)
- * @return NULL if OK, else a string containing the stage which failed
- */
-static const char *spi_flash_update_block(struct spi_flash *flash, u32 offset,
-		size_t len, const char *buf, char *cmp_buf, size_t *skipped)
-{
-	char *ptr = (char *)buf;
-
-	debug("offset=%#x, sector_size=%#x, len=%#zx\n",
-	      offset, flash->sector_size, len);
-	/* Read the entire sector so to allow for rewriting */
-	if (spi_flash_read(flash, offset, flash->sector_size, cmp_buf))
-		return "read";
-	/* Compare only what is meaningful (len) */
-	if (memcmp(cmp_buf, buf, len) == 0) {
-		debug("Skip region %x size %zx: no change\n",
-		      offset, len);
-		*skipped += len;
-		return NULL;
-	}
-	/* Erase the entire sector */
-	if (spi_flash_erase(flash, offset, flash->sector_size))
-		return "erase";
-	/* If it's a partial sector, copy the data into the temp-buffer */
-	if (len != flash->sector_size) {
-		memcpy(cmp_buf, buf, len);
-		ptr = cmp_buf;
-	}
-	/* Write one complete sector */
-	if (spi_flash_write(flash, offset, flash->sector_size, ptr))
-		return "write";
-
-	return NULL;
-}
-
 /**
  * Update an area of SPI flash by erasing and writing any blocks which need
  * to change. Existing blocks with the correct data are left unchanged.
  *
+ * This is done in chunks so that progress can be shown.
+ *
  * @param flash		flash context pointer
  * @param offset	flash offset to write
  * @param len		number of bytes to write
  * @param buf		buffer to write from
+ * @param flags		SPI_FLASH_UPDATE_... flags
  * @return 0 if ok, 1 on error
  */
-static int spi_flash_update(struct spi_flash *flash, u32 offset,
-		size_t len, const char *buf)
+static int sf_update(struct spi_flash *flash, u32 offset, size_t len,
+		     const char *buf, uint flags)
 {
-	const char *err_oper = NULL;
-	char *cmp_buf;
-	const char *end = buf + len;
-	size_t todo;		/* number of bytes to do in this pass */
-	size_t skipped = 0;	/* statistics */
+	struct spi_flash_update_stats stats, total;
 	const ulong start_time = get_timer(0);
-	size_t scale = 1;
-	const char *start_buf = buf;
+	ulong last_update = start_time;
+	const u32 chunk = flash->erase_size * 64;
+	const u32 end = offset + len;
+	size_t todo;		/* number of bytes to do in this pass */
 	ulong delta;
+	u32 pos;
+	int ret;
 
-	if (end - buf >= 200)
-		scale = (end - buf) / 100;
-	cmp_buf = memalign(ARCH_DMA_MINALIGN, flash->sector_size);
-	if (cmp_buf) {
-		ulong last_update = get_timer(0);
-
-		for (; buf < end && !err_oper; buf += todo, offset += todo) {
-			todo = min_t(size_t, end - buf, flash->sector_size);
-			if (get_timer(last_update) > 100) {
-				printf("   \rUpdating, %zu%% %lu B/s",
-				       100 - (end - buf) / scale,
-					bytes_per_second(buf - start_buf,
-							 start_time));
-				last_update = get_timer(0);
-			}
-			err_oper = spi_flash_update_block(flash, offset, todo,
-					buf, cmp_buf, &skipped);
+	memset(&total, '\0', sizeof(total));
+	for (pos = offset; pos < end; pos += todo) {
+		todo = min(end, roundup(pos + 1, chunk)) - pos;
+		if (get_timer(last_update) > 100) {
+			printf("   \rUpdating, %u%% %lu B/s",
+			       (uint)((u64)(pos - offset) * 100 / len),
+			       bytes_per_second(pos - offset, start_time));
+			last_update = get_timer(0);
 		}
-	} else {
-		err_oper = "malloc";
+		ret = spi_flash_update(flash, pos, todo, buf + pos - offset,
+				       flags, &stats);
+		if (ret) {
+			printf("\rSPI flash update failed at %#x (err=%d)\n",
+			       pos, ret);
+			return 1;
+		}
+		total.skipped += stats.skipped;
+		total.erased += stats.erased;
+		total.programmed += stats.programmed;
 	}
-	free(cmp_buf);
 	putc('\r');
-	if (err_oper) {
-		printf("SPI flash failed in %s step\n", err_oper);
-		return 1;
-	}
 
 	delta = get_timer(start_time);
-	printf("%zu bytes written, %zu bytes skipped", len - skipped,
-	       skipped);
+	printf("%zu bytes written, %u bytes skipped", len - total.skipped,
+	       total.skipped);
+	printf(" (%u erased, %u programmed)", total.erased, total.programmed);
 	printf(" in %ld.%lds, speed %ld B/s\n",
 	       delta / 1000, delta % 1000, bytes_per_second(len, start_time));
 
@@ -266,7 +218,15 @@ static int do_spi_flash_read_write(int argc, char * const argv[])
 	int ret = 1;
 	int dev = 0;
 	loff_t offset, len, maxsize;
-
+	const char *cmd = argv[0];
+	bool update = strcmp(cmd, "update") == 0;
+	uint flags = 0;
+
+	if (update && argc > 1 && strcmp(argv[1], "-n") == 0) {
+		flags |= SPI_FLASH_UPDATE_NO_ERASE;
+		argc--;
+		argv++;
+	}
 	if (argc < 3)
 		return -1;
 
@@ -281,7 +241,7 @@ static int do_spi_flash_read_write(int argc, char * const argv[])
 	/* Consistency checking */
 	if (offset + len > flash->size) {
 		printf("ERROR: attempting %s past flash size (%#x)\n",
-		       argv[0], flash->size);
+		       cmd, flash->size);
 		return 1;
 	}
 
@@ -291,13 +251,13 @@ static int do_spi_flash_read_write(int argc, char * const argv[])
 		return 1;
 	}
 
-	if (strcmp(argv[0], "update") == 0) {
-		ret = spi_flash_update(flash, offset, len, buf);
-	} else if (strncmp(argv[0], "read", 4) == 0 ||
-			strncmp(argv[0], "write", 5) == 0) {
+	if (update) {
+		ret = sf_update(flash, offset, len, buf, flags);
+	} else if (strncmp(cmd, "read", 4) == 0 ||
+			strncmp(cmd, "write", 5) == 0) {
 		int read;
 
-		read = strncmp(argv[0], "read", 4) == 0;
+		read = strncmp(cmd, "read", 4) == 0;
 		if (read)
 			ret = spi_flash_read(flash, offset, len, buf);
 		else
@@ -596,7 +556,7 @@ usage:
 #endif
 
 U_BOOT_CMD(
-	sf,	5,	1,	do_spi_flash,
+	sf,	6,	1,	do_spi_flash,
 	"SPI flash sub-system",
 	"probe [[bus:]cs] [hz] [mode]	- init flash device on given SPI bus\n"
 	"				  and chip select\n"
@@ -609,9 +569,11 @@ U_BOOT_CMD(
 	"sf erase offset|partition [+]len	- erase `len' bytes from `offset'\n"
 	"					  or from start of mtd `partition'\n"
 	"					 `+len' round up `len' to block size\n"
-	"sf update addr offset|partition len	- erase and write `len' bytes from memory\n"
+	"sf update [-n] addr offset|partition len	- erase and write `len' bytes from memory\n"
 	"					  at `addr' to flash at `offset'\n"
 	"					  or to start of mtd `partition'\n"
+	"					 `-n' do not erase blocks which only\n"
+	"					  need bits cleared\n"
 	"sf protect lock/unlock sector len	- protect/unprotect 'len' bytes starting\n"
 	"					  at address 'sector'\n"
 	SF_TEST_HELP
@@ -14,6 +14,7 @@
 #include <common.h>
 #include <command.h>
 #include <exports.h>
+#include <mapmem.h>
 #include <memalign.h>
 #include <nand.h>
 #include <onenand_uboot.h>
@@ -85,6 +86,16 @@ static void display_ubi_info(struct ubi_device *ubi)
 	ubi_msg("number of PEBs reserved for bad PEB handling: %d",
 			ubi->beb_rsvd_pebs);
 	ubi_msg("max/mean erase counter: %d/%d", ubi->max_ec, ubi->mean_ec);
+	ubi_msg("attach time:                %lu us",
+		ubi->attach_stats.total_us);
+	ubi_msg("  scan (%d header reads):  %lu us, %lu us reading",
+		ubi->attach_stats.hdr_reads, ubi->attach_stats.scan_us,
+		ubi->attach_stats.read_us);
+	ubi_msg("  volume table:             %lu us",
+		ubi->attach_stats.vtbl_us);
+	ubi_msg("  wear-leveling:            %lu us", ubi->attach_stats.wl_us);
+	ubi_msg("  EBA:                      %lu us",
+		ubi->attach_stats.eba_us);
 }
 
 static int ubi_info(int layout)
@@ -613,15 +624,17 @@ static int do_ubi(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 		    strncmp(argv[1] + 5, ".part", 5) == 0) {
 			if (argc < 6) {
 				ret = ubi_volume_continue_write(argv[3],
-						(void *)addr, size);
+						map_sysmem(addr, size), size);
 			} else {
 				size_t full_size;
 				full_size = simple_strtoul(argv[5], NULL, 16);
 				ret = ubi_volume_begin_write(argv[3],
-						(void *)addr, size, full_size);
+						map_sysmem(addr, size), size,
+						full_size);
 			}
 		} else {
-			ret = ubi_volume_write(argv[3], (void *)addr, size);
+			ret = ubi_volume_write(argv[3], map_sysmem(addr, size),
+					       size);
 		}
 		if (!ret) {
 			printf("%lld bytes written to volume %s\n", size,
@@ -650,7 +663,8 @@ static int do_ubi(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 			printf("Read %lld bytes from volume %s to %lx\n", size,
 			       argv[3], addr);
 
-			return ubi_volume_read(argv[3], (char *)addr, size);
+			return ubi_volume_read(argv[3], map_sysmem(addr, size),
+					       size);
 		}
 	}
 
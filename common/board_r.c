@@ -287,8 +287,8 @@ static int initr_malloc(void)
 	ulong malloc_start;
 
 #ifdef CONFIG_SYS_MALLOC_F_LEN
-	debug("Pre-reloc malloc() used %#lx bytes (%ld KB)\n", gd->malloc_ptr,
-	      gd->malloc_ptr / 1024);
+	debug("Pre-reloc malloc() used %#zx bytes (%zd KB)\n",
+	      malloc_simple_peak(), malloc_simple_peak() / 1024);
 #endif
 	/* The malloc area is immediately below the monitor copy in DRAM */
 	malloc_start = gd->relocaddr - TOTAL_MALLOC_LEN;
@@ -322,10 +322,14 @@ static int initr_dm(void)
 	/* Save the pre-reloc driver model and start a new one */
 	gd->dm_root_f = gd->dm_root;
 	gd->dm_root = NULL;
+	/* The index may be in pre-relocation memory, so build a new one */
+	gd->compat_index = NULL;
 #ifdef CONFIG_TIMER
 	gd->timer = NULL;
 #endif
+	bootstage_start(BOOTSTAGE_ID_ACCUM_DM_R, "dm_r");
 	ret = dm_init_and_scan(false);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_DM_R);
 	if (ret)
 		return ret;
 #ifdef CONFIG_TIMER_EARLY
@@ -15,10 +15,12 @@
 #include <malloc.h>
 #include <mapmem.h>
 #include <asm/io.h>
+#include <asm/unaligned.h>
 #include <linux/lzo.h>
 #include <lzma/LzmaTypes.h>
 #include <lzma/LzmaDec.h>
 #include <lzma/LzmaTools.h>
+#include <u-boot/zstd.h>
 #if defined(CONFIG_CMD_USB)
 #include <usb.h>
 #endif
@@ -398,6 +400,15 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 		break;
 	}
 #endif /* CONFIG_LZ4 */
+#ifdef CONFIG_ZSTD
+	case IH_COMP_ZSTD: {
+		size_t size = unc_len;
+
+		ret = zstd_decompress(image_buf, image_len, load_buf, &size);
+		image_len = size;
+		break;
+	}
+#endif /* CONFIG_ZSTD */
 	default:
 		printf("Unimplemented compression type %d\n", comp);
 		return BOOTM_ERR_UNIMPLEMENTED;
@@ -413,6 +424,42 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 }
 
 #ifndef USE_HOSTCC
+/**
+ * bootm_decomp_size() - Find the decompressed size of an image, if known
+ *
+ * @comp:	Compression type (IH_COMP_...)
+ * @image_buf:	Image data
+ * @image_len:	Size of image data in bytes
+ * @return decompressed size in bytes, or 0 if it cannot be found without
+ * decompressing
+ */
+static ulong bootm_decomp_size(int comp, const void *image_buf,
+			       ulong image_len)
+{
+	switch (comp) {
+	case IH_COMP_NONE:
+		return image_len;
+#ifdef CONFIG_GZIP
+	case IH_COMP_GZIP:
+		/* the trailer holds the size modulo 2^32 */
+		if (image_len < 18)
+			return 0;
+		return get_unaligned_le32(image_buf + image_len - 4);
+#endif
+#ifdef CONFIG_ZSTD
+	case IH_COMP_ZSTD: {
+		u64 size;
+
+		if (zstd_get_content_size(image_buf, image_len, &size))
+			return 0;
+		return size;
+	}
+#endif
+	default:
+		return 0;
+	}
+}
+
 static int bootm_load_os(bootm_headers_t *images, unsigned long *load_end,
 			 int boot_progress)
 {
@@ -424,10 +471,26 @@ static int bootm_load_os(bootm_headers_t *images, unsigned long *load_end,
 	ulong image_len = os.image_len;
 	bool no_overlap;
 	void *load_buf, *image_buf;
+	ulong size;
 	int err;
 
 	load_buf = map_sysmem(load, 0);
 	image_buf = map_sysmem(os.image_start, image_len);
+	no_overlap = (os.comp == IH_COMP_NONE && load == image_start);
+
+	/*
+	 * A new format image must stay intact since other images are loaded
+	 * from it later, so check before writing anything if we can
+	 */
+	size = bootm_decomp_size(os.comp, image_buf, image_len);
+	if (!no_overlap && !images->legacy_hdr_valid && size &&
+	    load < blob_end && load + size > blob_start) {
+		printf("ERROR: loading image to %08lx-%08lx would overwrite the FIT at %08lx-%08lx\n",
+		       load, load + size, blob_start, blob_end);
+		bootstage_error(BOOTSTAGE_ID_OVERWRITTEN);
+		return BOOTM_ERR_OVERWRITE;
+	}
+
 	err = bootm_decomp_image(os.comp, load, os.image_start, os.type,
 				 load_buf, image_buf, image_len,
 				 CONFIG_SYS_BOOTM_LEN, load_end);
@@ -440,8 +503,6 @@ static int bootm_load_os(bootm_headers_t *images, unsigned long *load_end,
 	debug("   kernel loaded at 0x%08lx, end = 0x%08lx\n", load, *load_end);
 	bootstage_mark(BOOTSTAGE_ID_KERNEL_LOADED);
 
-	no_overlap = (os.comp == IH_COMP_NONE && load == image_start);
-
 	if (!no_overlap && (load < blob_end) && (*load_end > blob_start)) {
 		debug("images.os.start = 0x%lX, images.os.end = 0x%lx\n",
 		      blob_start, blob_end);
@@ -12,8 +12,11 @@
 #include <common.h>
 #include <command.h>
 #include <console.h>
+#include <malloc.h>
 #include <linux/ctype.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 /*
  * Use puts() instead of printf() to avoid printf buffer overflow
  * for long help messages
@@ -82,12 +85,78 @@ int _do_help(cmd_tbl_t *cmd_start, int cmd_items, cmd_tbl_t *cmdtp, int flag,
 	return rcode;
 }
 
+#ifdef CONFIG_CMDLINE
+/*
+ * Pointers to the entries of the command linker list sorted by name, so
+ * that commands can be found by binary search. The linker list is sorted
+ * by symbol name, which is not always the command name (e.g. '?'), so the
+ * index is built with qsort() on first use.
+ */
+static cmd_tbl_t **cmd_index;
+
+static int cmd_index_compar(const void *p1, const void *p2)
+{
+	const cmd_tbl_t *c1 = *(const cmd_tbl_t **)p1;
+	const cmd_tbl_t *c2 = *(const cmd_tbl_t **)p2;
+
+	return strcmp(c1->name, c2->name);
+}
+
+static cmd_tbl_t **get_cmd_index(void)
+{
+	cmd_tbl_t *start = ll_entry_start(cmd_tbl_t, cmd);
+	const int count = ll_entry_count(cmd_tbl_t, cmd);
+	int i;
+
+	/* Static data is not writable before relocation */
+	if (cmd_index || !(gd->flags & GD_FLG_RELOC))
+		return cmd_index;
+
+	cmd_index = malloc(count * sizeof(*cmd_index));
+	if (!cmd_index)
+		return NULL;
+	for (i = 0; i < count; i++)
+		cmd_index[i] = start + i;
+	qsort(cmd_index, count, sizeof(*cmd_index), cmd_index_compar);
+
+	return cmd_index;
+}
+
+/*
+ * Find a command in the sorted index. All names starting with the first
+ * len characters of cmd are adjacent, and a full match comes first.
+ */
+static cmd_tbl_t *find_cmd_index(const char *cmd, int len,
+				 cmd_tbl_t **index, int count)
+{
+	int lo = 0, hi = count, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (strncmp(index[mid]->name, cmd, len) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo == count || strncmp(index[lo]->name, cmd, len))
+		return NULL;			/* not found */
+	if (!index[lo]->name[len])
+		return index[lo];		/* full match */
+	if (lo + 1 < count && !strncmp(index[lo + 1]->name, cmd, len))
+		return NULL;			/* ambiguous abbreviation */
+
+	return index[lo];			/* abbreviated command */
+}
+#endif /* CONFIG_CMDLINE */
+
 /* find command table entry for a command */
 cmd_tbl_t *find_cmd_tbl(const char *cmd, cmd_tbl_t *table, int table_len)
 {
 #ifdef CONFIG_CMDLINE
 	cmd_tbl_t *cmdtp;
 	cmd_tbl_t *cmdtp_temp = table;	/* Init value */
+	cmd_tbl_t **index;
 	const char *p;
 	int len;
 	int n_found = 0;
@@ -100,6 +169,14 @@ cmd_tbl_t *find_cmd_tbl(const char *cmd, cmd_tbl_t *table, int table_len)
 	 */
 	len = ((p = strchr(cmd, '.')) == NULL) ? strlen (cmd) : (p - cmd);
 
+	/* Sub-command tables are small and not indexed */
+	if (table == ll_entry_start(cmd_tbl_t, cmd) &&
+	    table_len == ll_entry_count(cmd_tbl_t, cmd)) {
+		index = get_cmd_index();
+		if (index)
+			return find_cmd_index(cmd, len, index, table_len);
+	}
+
 	for (cmdtp = table; cmdtp != table + table_len; cmdtp++) {
 		if (strncmp(cmd, cmdtp->name, len) == 0) {
 			if (len == strlen(cmdtp->name))
@@ -439,8 +516,6 @@ int cmd_get_data_size(char* arg, int default_size)
 #endif
 
 #if defined(CONFIG_NEEDS_MANUAL_RELOC)
-DECLARE_GLOBAL_DATA_PTR;
-
 void fixup_cmdtable(cmd_tbl_t *cmdtp, int size)
 {
 	int	i;
@@ -2452,9 +2452,16 @@ void fREe(mem) Void_t* mem;
   int       islr;      /* track whether merging with last_remainder */
 
 #ifdef CONFIG_SYS_MALLOC_F_LEN
-	/* free() is a no-op - all the memory will be freed on relocation */
-	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+	/*
+	 * Without the pool, free() is a no-op - all the memory will be freed
+	 * on relocation
+	 */
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT)) {
+#ifdef CONFIG_SYS_MALLOC_F_POOL
+		free_simple(mem);
+#endif
 		return;
+	}
 #endif
 
   if (mem == NULL)                              /* free(0) has no effect */
@@ -2816,6 +2823,11 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
 
   if ((long)bytes < 0) return NULL;
 
+#ifdef CONFIG_SYS_MALLOC_F_LEN
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return memalign_simple(alignment, bytes);
+#endif
+
   /* If need less alignment than we give anyway, just relay to malloc */
 
   if (alignment <= MALLOC_ALIGNMENT) return mALLOc(bytes);
@@ -2986,7 +2998,8 @@ Void_t* cALLOc(n, elem_size) size_t n; size_t elem_size;
   {
 #ifdef CONFIG_SYS_MALLOC_F_LEN
 	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT)) {
-		MALLOC_ZERO(mem, sz);
+		/* MALLOC_ZERO() may clear past the end of small blocks */
+		memset(mem, '\0', sz);
 		return mem;
 	}
 #endif
@@ -15,6 +15,7 @@
 #include <search.h>
 #include <errno.h>
 #include <malloc.h>
+#include <memalign.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -27,6 +28,13 @@ struct hsearch_data env_htab = {
 	.change_ok = env_flags_validate,
 };
 
+/*
+ * Copy of the environment image last imported or exported. While
+ * env_htab.dirty is clear it matches the hash table, so env_export() can
+ * reuse it.
+ */
+static env_t *env_last;
+
 __weak uchar env_get_char_spec(int index)
 {
 	return *((uchar *)(gd->env_addr + index));
@@ -204,6 +212,13 @@ int env_import(const char *buf, int check)
 		}
 	}
 
+#ifndef CONFIG_SPL_BUILD
+	if (!env_last)
+		env_last = malloc(sizeof(*env_last));
+	if (env_last)
+		memcpy(env_last, ep, sizeof(*env_last));
+#endif
+
 	/* Decrypt the env if desired. */
 	ret = env_aes_cbc_crypt(ep, 0);
 	if (ret) {
@@ -215,6 +230,7 @@ int env_import(const char *buf, int check)
 	if (himport_r(&env_htab, (char *)ep->data, ENV_SIZE, '\0', 0, 0,
 			0, NULL)) {
 		gd->flags |= GD_FLG_ENV_READY;
+		env_htab.dirty = !env_last;
 		return 1;
 	}
 
@@ -232,6 +248,12 @@ int env_export(env_t *env_out)
 	ssize_t	len;
 	int ret;
 
+	/* Nothing has changed since the environment was last saved/loaded */
+	if (env_last && !env_htab.dirty) {
+		memcpy(env_out, env_last, sizeof(*env_out));
+		return 0;
+	}
+
 	res = (char *)env_out->data;
 	len = hexport_r(&env_htab, '\0', 0, &res, ENV_SIZE, 0, NULL);
 	if (len < 0) {
@@ -246,9 +268,64 @@ int env_export(env_t *env_out)
 
 	env_out->crc = crc32(0, env_out->data, ENV_SIZE);
 
+#ifndef CONFIG_SPL_BUILD
+	if (!env_last)
+		env_last = malloc(sizeof(*env_last));
+	if (env_last) {
+		memcpy(env_last, env_out, sizeof(*env_last));
+		env_htab.dirty = 0;
+	}
+#endif
+
 	return 0;
 }
 
+int env_write_changed(struct env_storage *stor, const env_t *env)
+{
+	const char *buf = (const char *)env;
+	ulong pos, len, start = 0, run = 0, written = 0;
+	char *cur;
+	int ret = 0;
+
+	/*
+	 * Compare with what the storage holds now rather than what was last
+	 * saved, since it may have been erased or written since. If it cannot
+	 * be read, write everything.
+	 */
+	cur = memalign(ARCH_DMA_MINALIGN, CONFIG_ENV_SIZE);
+	if (cur && stor->read(stor, 0, CONFIG_ENV_SIZE, cur)) {
+		free(cur);
+		cur = NULL;
+	}
+
+	for (pos = 0; pos < CONFIG_ENV_SIZE; pos += len) {
+		len = min_t(ulong, stor->unit, CONFIG_ENV_SIZE - pos);
+		if (!cur || memcmp(buf + pos, cur + pos, len)) {
+			if (!run)
+				start = pos;
+			run += len;
+			continue;
+		}
+		if (run) {
+			ret = stor->write(stor, start, run, buf + start);
+			if (ret)
+				goto out;
+			written += run;
+			run = 0;
+		}
+	}
+	if (run) {
+		ret = stor->write(stor, start, run, buf + start);
+		written += run;
+	}
+out:
+	free(cur);
+	if (ret)
+		return ret < 0 ? ret : -EIO;
+
+	return written;
+}
+
 void env_relocate(void)
 {
 #if defined(CONFIG_NEEDS_MANUAL_RELOC)
@@ -123,6 +123,20 @@ static void fini_mmc_for_env(struct mmc *mmc)
 #endif
 }
 
+static inline int read_env(struct mmc *mmc, unsigned long size,
+			   unsigned long offset, const void *buffer)
+{
+	uint blk_start, blk_cnt, n;
+
+	blk_start	= ALIGN(offset, mmc->read_bl_len) / mmc->read_bl_len;
+	blk_cnt		= ALIGN(size, mmc->read_bl_len) / mmc->read_bl_len;
+
+	n = mmc->block_dev.block_read(&mmc->block_dev, blk_start, blk_cnt,
+				      (uchar *)buffer);
+
+	return (n == blk_cnt) ? 0 : -1;
+}
+
 #ifdef CONFIG_CMD_SAVEENV
 static inline int write_env(struct mmc *mmc, unsigned long size,
 			    unsigned long offset, const void *buffer)
@@ -140,6 +154,18 @@ static inline int write_env(struct mmc *mmc, unsigned long size,
 
 #ifdef CONFIG_ENV_OFFSET_REDUND
 static unsigned char env_flags;
+#else
+static int env_mmc_read(struct env_storage *stor, ulong offset, ulong size,
+			void *buf)
+{
+	return read_env(stor->priv, size, stor->offset + offset, buf);
+}
+
+static int env_mmc_write(struct env_storage *stor, ulong offset, ulong size,
+			 const void *buf)
+{
+	return write_env(stor->priv, size, stor->offset + offset, buf);
+}
 #endif
 
 int saveenv(void)
@@ -147,6 +173,12 @@ int saveenv(void)
 	ALLOC_CACHE_ALIGN_BUFFER(env_t, env_new, 1);
 	int dev = mmc_get_env_dev();
 	struct mmc *mmc = find_mmc_device(dev);
+#ifndef CONFIG_ENV_OFFSET_REDUND
+	struct env_storage stor = {
+		.read	= env_mmc_read,
+		.write	= env_mmc_write,
+	};
+#endif
 	u32	offset;
 	int	ret, copy = 0;
 	const char *errmsg;
@@ -174,7 +206,22 @@ int saveenv(void)
 	}
 
 	printf("Writing to %sMMC(%d)... ", copy ? "redundant " : "", dev);
-	if (write_env(mmc, CONFIG_ENV_SIZE, offset, (u_char *)env_new)) {
+#ifdef CONFIG_ENV_OFFSET_REDUND
+	ret = write_env(mmc, CONFIG_ENV_SIZE, offset, (u_char *)env_new);
+#else
+	/* Only write the blocks which have changed */
+	stor.offset = offset;
+	stor.unit = mmc->write_bl_len;
+	stor.priv = mmc;
+	ret = env_write_changed(&stor, env_new);
+	if (!ret) {
+		puts("unchanged\n");
+		goto fini;
+	}
+	if (ret > 0)
+		ret = 0;
+#endif
+	if (ret) {
 		puts("failed\n");
 		ret = 1;
 		goto fini;
@@ -193,20 +240,6 @@ fini:
 }
 #endif /* CONFIG_CMD_SAVEENV */
 
-static inline int read_env(struct mmc *mmc, unsigned long size,
-			   unsigned long offset, const void *buffer)
-{
-	uint blk_start, blk_cnt, n;
-
-	blk_start	= ALIGN(offset, mmc->read_bl_len) / mmc->read_bl_len;
-	blk_cnt		= ALIGN(size, mmc->read_bl_len) / mmc->read_bl_len;
-
-	n = mmc->block_dev.block_read(&mmc->block_dev, blk_start, blk_cnt,
-				      (uchar *)buffer);
-
-	return (n == blk_cnt) ? 0 : -1;
-}
-
 #ifdef CONFIG_ENV_OFFSET_REDUND
 void env_relocate_spec(void)
 {
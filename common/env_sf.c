@@ -236,9 +236,34 @@ out:
 	free(tmp_env2);
 }
 #else
+static int env_sf_read(struct env_storage *stor, ulong offset, ulong size,
+		       void *buf)
+{
+	return spi_flash_read(env_flash, stor->offset + offset, size, buf);
+}
+
+static int env_sf_write(struct env_storage *stor, ulong offset, ulong size,
+			const void *buf)
+{
+	int ret;
+
+	ret = spi_flash_erase(env_flash, stor->offset + offset,
+			      roundup(size, CONFIG_ENV_SECT_SIZE));
+	if (ret)
+		return ret;
+
+	return spi_flash_write(env_flash, stor->offset + offset, size, buf);
+}
+
 int saveenv(void)
 {
-	u32	saved_size, saved_offset, sector = 1;
+	struct env_storage stor = {
+		.offset	= CONFIG_ENV_OFFSET,
+		.unit	= CONFIG_ENV_SECT_SIZE,
+		.read	= env_sf_read,
+		.write	= env_sf_write,
+	};
+	u32	saved_size, saved_offset;
 	char	*saved_buffer = NULL;
 	int	ret = 1;
 	env_t	env_new;
@@ -267,13 +292,19 @@ int saveenv(void)
 	}
 #endif
 
+	ret = env_export(&env_new);
+	if (ret)
+		goto done;
+
 	/* Is the sector larger than the env (i.e. embedded) */
 	if (CONFIG_ENV_SECT_SIZE > CONFIG_ENV_SIZE) {
 		saved_size = CONFIG_ENV_SECT_SIZE - CONFIG_ENV_SIZE;
 		saved_offset = CONFIG_ENV_OFFSET + CONFIG_ENV_SIZE;
 		saved_buffer = malloc(saved_size);
-		if (!saved_buffer)
+		if (!saved_buffer) {
+			ret = 1;
 			goto done;
+		}
 
 		ret = spi_flash_read(env_flash, saved_offset,
 			saved_size, saved_buffer);
@@ -281,27 +312,15 @@ int saveenv(void)
 			goto done;
 	}
 
-	if (CONFIG_ENV_SIZE > CONFIG_ENV_SECT_SIZE) {
-		sector = CONFIG_ENV_SIZE / CONFIG_ENV_SECT_SIZE;
-		if (CONFIG_ENV_SIZE % CONFIG_ENV_SECT_SIZE)
-			sector++;
-	}
-
-	ret = env_export(&env_new);
-	if (ret)
-		goto done;
-
-	puts("Erasing SPI flash...");
-	ret = spi_flash_erase(env_flash, CONFIG_ENV_OFFSET,
-		sector * CONFIG_ENV_SECT_SIZE);
-	if (ret)
-		goto done;
-
+	/* Only erase and write the sectors which have changed */
 	puts("Writing to SPI flash...");
-	ret = spi_flash_write(env_flash, CONFIG_ENV_OFFSET,
-		CONFIG_ENV_SIZE, &env_new);
-	if (ret)
+	ret = env_write_changed(&stor, &env_new);
+	if (ret < 0)
+		goto done;
+	if (!ret) {
+		puts("unchanged\n");
 		goto done;
+	}
 
 	if (CONFIG_ENV_SECT_SIZE > CONFIG_ENV_SIZE) {
 		ret = spi_flash_write(env_flash, saved_offset,
@@ -163,6 +163,50 @@ void fb_mmc_flash_write(const char *cmd, unsigned int session_id,
 	fastboot_okay(response_str, "");
 }
 
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+static struct fb_mmc_sparse stream_priv;
+
+int fb_mmc_stream_open(const char *cmd, struct sparse_storage *storage,
+		       void **priv, char *response)
+{
+	struct blk_desc *dev_desc;
+	disk_partition_t info;
+
+	/* initialize the response buffer */
+	response_str = response;
+
+	dev_desc = blk_get_dev("mmc", CONFIG_FASTBOOT_FLASH_MMC_DEV);
+	if (!dev_desc || dev_desc->type == DEV_TYPE_UNKNOWN) {
+		error("invalid mmc device\n");
+		fastboot_fail(response_str, "invalid mmc device");
+		return -ENODEV;
+	}
+
+	/* The GPT is checked as a whole before it is written */
+	if (strcmp(cmd, CONFIG_FASTBOOT_GPT_NAME) == 0) {
+		fastboot_fail(response_str, "cannot stream GPT");
+		return -EINVAL;
+	}
+	if (part_get_info_efi_by_name_or_alias(dev_desc, cmd, &info)) {
+		error("cannot find partition: '%s'\n", cmd);
+		fastboot_fail(response_str, "cannot find partition");
+		return -ENOENT;
+	}
+
+	stream_priv.dev_desc = dev_desc;
+	storage->block_sz = info.blksz;
+	storage->start = info.start;
+	storage->size = info.size;
+	storage->name = cmd;
+	storage->write = fb_mmc_sparse_write;
+	*priv = &stream_priv;
+
+	fastboot_okay(response_str, "");
+
+	return 0;
+}
+#endif
+
 void fb_mmc_erase(const char *cmd, char *response)
 {
 	int ret;
@@ -0,0 +1,597 @@
+/*
+ * Load FIT subimages in one pass from storage
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <console.h>
+#include <errno.h>
+#include <hash.h>
+#include <image.h>
+#include <libfdt.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <watchdog.h>
+#include <u-boot/zlib.h>
+#include <u-boot/zstd.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Number of bytes read from the source at a time, unless it asks otherwise */
+#define FIT_STREAM_CHUNK	(64 << 10)
+
+/* Most hash nodes we will check on one image */
+#define FIT_STREAM_MAX_HASHES	4
+
+struct fit_stream_hash {
+	struct hash_algo *algo;
+	void *ctx;
+	const char *name;
+	const u8 *value;
+	int value_len;
+};
+
+/**
+ * struct fit_stream - State for loading one subimage
+ *
+ * @src:	Where the FIT comes from
+ * @fit:	Copy of the FIT's device tree
+ * @data:	Image data within @fit, if it is not external
+ * @offset:	Offset of the image data in the FIT, if it is external
+ * @size:	Size of the (compressed) image data in bytes
+ * @comp:	Compression type (IH_COMP_...)
+ * @hash:	Hashes to check as the data is read
+ * @hash_count:	Number of entries in @hash
+ * @buf:	Buffer for compressed data
+ * @buf_size:	Size of @buf in bytes
+ * @zs:		zstd decoder
+ * @zstrm:	zlib decoder
+ * @zstrm_valid: true if @zstrm has been initialised
+ */
+struct fit_stream {
+	struct fit_stream_src *src;
+	void *fit;
+	const void *data;
+	ulong offset;
+	ulong size;
+	u8 comp;
+	struct fit_stream_hash hash[FIT_STREAM_MAX_HASHES];
+	int hash_count;
+	u8 *buf;
+	ulong buf_size;
+#ifdef CONFIG_ZSTD
+	struct zstd_stream *zs;
+#endif
+#ifdef CONFIG_GZIP
+	z_stream zstrm;
+	bool zstrm_valid;
+#endif
+};
+
+static bool regions_overlap(ulong start1, ulong size1, ulong start2,
+			    ulong size2)
+{
+	return start1 < start2 + size2 && start2 < start1 + size1;
+}
+
+/* Read exactly @size bytes from @offset in the FIT */
+static int fit_stream_read(struct fit_stream_src *src, ulong offset,
+			   ulong size, void *buf)
+{
+	long ret;
+
+	ret = src->read(src, offset, size, buf);
+	if (ret < 0)
+		return ret;
+
+	return ret == size ? 0 : -EIO;
+}
+
+/* Read @size bytes of image data starting at @pos */
+static int fit_stream_read_data(struct fit_stream *st, ulong pos, ulong size,
+				void *buf)
+{
+	if (st->data) {
+		memmove(buf, st->data + pos, size);
+		return 0;
+	}
+
+	return fit_stream_read(st->src, st->offset + pos, size, buf);
+}
+
+static int fit_stream_read_fit(struct fit_stream *st)
+{
+	struct fdt_header *hdr;
+	ulong size;
+	int ret;
+
+	/* sources may need a memory address to read to, so not the stack */
+	hdr = malloc(sizeof(*hdr));
+	if (!hdr)
+		return -ENOMEM;
+	ret = fit_stream_read(st->src, 0, sizeof(*hdr), hdr);
+	if (!ret && fdt_check_header(hdr)) {
+		puts("Bad FIT header\n");
+		ret = -EINVAL;
+	}
+	size = fdt_totalsize(hdr);
+	free(hdr);
+	if (ret)
+		return ret;
+	st->fit = malloc(size);
+	if (!st->fit)
+		return -ENOMEM;
+	ret = fit_stream_read(st->src, 0, size, st->fit);
+	if (ret)
+		return ret;
+	if (!fit_check_format(st->fit)) {
+		puts("Bad FIT image format\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/* Find the image to load, and the configuration it came from (or -1) */
+static int fit_stream_find_image(struct fit_stream *st, const char *uname,
+				 int *confp)
+{
+	int conf;
+
+	*confp = -1;
+	if (uname)
+		return fit_image_get_node(st->fit, uname);
+
+	conf = fit_conf_get_node(st->fit, NULL);
+	if (conf < 0)
+		return conf;
+	*confp = conf;
+
+	return fit_conf_get_prop_node(st->fit, conf, FIT_KERNEL_PROP);
+}
+
+/* Set up a progressive hash for each hash node of the image */
+static int fit_stream_setup_hashes(struct fit_stream *st, int image_noffset)
+{
+	struct fit_stream_hash *hash;
+	int noffset;
+	char *algo;
+
+	fdt_for_each_subnode(st->fit, noffset, image_noffset) {
+		const char *name = fit_get_name(st->fit, noffset, NULL);
+
+		if (strncmp(name, FIT_HASH_NODENAME,
+			    strlen(FIT_HASH_NODENAME)))
+			continue;
+		if (IMAGE_ENABLE_IGNORE &&
+		    fdt_getprop(st->fit, noffset, FIT_IGNORE_PROP, NULL))
+			continue;
+		if (st->hash_count == FIT_STREAM_MAX_HASHES)
+			return -E2BIG;
+		hash = &st->hash[st->hash_count];
+		hash->name = name;
+		if (fit_image_hash_get_algo(st->fit, noffset, &algo) ||
+		    fit_image_hash_get_value(st->fit, noffset,
+					     (u8 **)&hash->value,
+					     &hash->value_len))
+			return -EINVAL;
+		if (hash_progressive_lookup_algo(algo, &hash->algo)) {
+			printf("Unsupported hash algorithm '%s'\n", algo);
+			return -EPROTONOSUPPORT;
+		}
+		if (hash->algo->hash_init(hash->algo, &hash->ctx))
+			return -ENOMEM;
+		st->hash_count++;
+	}
+
+	return 0;
+}
+
+static int fit_stream_update_hashes(struct fit_stream *st, const void *buf,
+				    ulong size)
+{
+	struct fit_stream_hash *hash;
+	int i;
+
+	for (i = 0, hash = st->hash; i < st->hash_count; i++, hash++) {
+		if (hash->algo->hash_update(hash->algo, hash->ctx, buf, size,
+					    0)) {
+			/* hash_update() frees the context on error */
+			hash->ctx = NULL;
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+static int fit_stream_check_hashes(struct fit_stream *st)
+{
+	u8 value[FIT_MAX_HASH_LEN];
+	struct fit_stream_hash *hash;
+	int i, ret;
+
+	for (i = 0, hash = st->hash; i < st->hash_count; i++, hash++) {
+		ret = hash->algo->hash_finish(hash->algo, hash->ctx, value,
+					      sizeof(value));
+		hash->ctx = NULL;
+		if (ret)
+			return -EIO;
+		/* the FIT records crc32 big-endian, as calculate_hash() does */
+		if (!strcmp(hash->algo->name, "crc32"))
+			*(u32 *)value = cpu_to_uimage(*(u32 *)value);
+		printf("%s", hash->algo->name);
+		if (hash->value_len != hash->algo->digest_size ||
+		    memcmp(value, hash->value, hash->value_len)) {
+			printf(" error!\nBad hash value for '%s' hash node\n",
+			       hash->name);
+			return -EBADMSG;
+		}
+		puts("+ ");
+	}
+
+	return 0;
+}
+
+/*
+ * Check the signatures that the control FDT requires. A configuration
+ * signature covers the image hashes, which are checked as the data is
+ * read, so it can be verified here. An image signature covers the data
+ * as stored, which is not kept when decompressing, so refuse to stream a
+ * compressed image if one is required. Uncompressed images are checked
+ * once loaded.
+ */
+static int fit_stream_check_sigs(struct fit_stream *st, int conf)
+{
+	const void *blob = gd_fdt_blob();
+	int sig_node, noffset;
+	bool need_conf = false;
+
+	if (!IMAGE_ENABLE_VERIFY || !blob)
+		return 0;
+	sig_node = fdt_subnode_offset(blob, 0, FIT_SIG_NODENAME);
+	if (sig_node < 0)
+		return 0;
+	fdt_for_each_subnode(blob, noffset, sig_node) {
+		const char *required;
+
+		required = fdt_getprop(blob, noffset, "required", NULL);
+		if (!required)
+			continue;
+		if (!strcmp(required, "conf")) {
+			need_conf = true;
+		} else if (st->comp != IH_COMP_NONE) {
+			puts("\nSigned images cannot be streamed; use bootm\n");
+			return -EPERM;
+		}
+	}
+	if (!need_conf)
+		return 0;
+	if (conf < 0 || !st->hash_count) {
+		puts("\nA signed configuration is required\n");
+		return -EPERM;
+	}
+	if (fit_config_verify(st->fit, conf)) {
+		puts("\nBad configuration signature\n");
+		return -EACCES;
+	}
+
+	return 0;
+}
+
+/*
+ * Start the decompressor, given the first piece of input. Returns the
+ * number of bytes of header skipped, or -ve error.
+ */
+static int fit_stream_decomp_start(struct fit_stream *st, const void *in,
+				   ulong in_size)
+{
+	switch (st->comp) {
+#ifdef CONFIG_ZSTD
+	case IH_COMP_ZSTD:
+		st->zs = zstd_stream_create(0);
+		return st->zs ? 0 : -ENOMEM;
+#endif
+#ifdef CONFIG_GZIP
+	case IH_COMP_GZIP: {
+		int hdr;
+
+		hdr = gzip_parse_header(in, in_size);
+		if (hdr < 0)
+			return -EINVAL;
+		memset(&st->zstrm, '\0', sizeof(st->zstrm));
+		st->zstrm.zalloc = gzalloc;
+		st->zstrm.zfree = gzfree;
+		if (inflateInit2(&st->zstrm, -MAX_WBITS) != Z_OK)
+			return -ENOMEM;
+		st->zstrm_valid = true;
+
+		return hdr;
+	}
+#endif
+	default:
+		printf("Cannot stream compression type '%s'; use bootm\n",
+		       genimg_get_comp_name(st->comp));
+		return -EPROTONOSUPPORT;
+	}
+}
+
+/*
+ * Decompress as much as possible, updating @in_pos and @out_pos. Returns 1
+ * at the end of the compressed stream, 0 if more input or output space is
+ * needed, or -ve error.
+ */
+static int fit_stream_decomp(struct fit_stream *st, const u8 *in,
+			     ulong in_size, ulong *in_pos, u8 *out,
+			     ulong out_size, ulong *out_pos)
+{
+	switch (st->comp) {
+#ifdef CONFIG_ZSTD
+	case IH_COMP_ZSTD: {
+		struct zstd_in zin = { in, in_size, *in_pos };
+		struct zstd_out zout = { out, out_size, *out_pos };
+		int ret;
+
+		ret = zstd_stream_decompress(st->zs, &zin, &zout);
+		*in_pos = zin.pos;
+		*out_pos = zout.pos;
+
+		return ret;
+	}
+#endif
+#ifdef CONFIG_GZIP
+	case IH_COMP_GZIP: {
+		z_stream *s = &st->zstrm;
+		int ret;
+
+		s->next_in = (u8 *)in + *in_pos;
+		s->avail_in = in_size - *in_pos;
+		s->next_out = out + *out_pos;
+		s->avail_out = out_size - *out_pos;
+		ret = inflate(s, Z_SYNC_FLUSH);
+		*in_pos = in_size - s->avail_in;
+		*out_pos = out_size - s->avail_out;
+		if (ret == Z_STREAM_END)
+			return 1;
+		if (ret == Z_BUF_ERROR || ret == Z_OK)
+			return 0;
+
+		return ret == Z_MEM_ERROR ? -ENOMEM : -EINVAL;
+	}
+#endif
+	default:
+		return -EPROTONOSUPPORT;
+	}
+}
+
+static void fit_stream_decomp_end(struct fit_stream *st)
+{
+#ifdef CONFIG_ZSTD
+	zstd_stream_free(st->zs);
+#endif
+#ifdef CONFIG_GZIP
+	if (st->zstrm_valid)
+		inflateEnd(&st->zstrm);
+#endif
+}
+
+/* Read uncompressed data straight to the load address, hashing it there */
+static int fit_stream_copy(struct fit_stream *st, u8 *out, ulong max_size,
+			   ulong *lenp)
+{
+	ulong pos, size;
+	int ret;
+
+	if (st->size > max_size)
+		return -ENOBUFS;
+	ret = fit_stream_read_data(st, 0, st->size, out);
+	if (ret)
+		return ret;
+	for (pos = 0; pos < st->size; pos += size) {
+		size = min(st->size - pos, st->buf_size);
+		ret = fit_stream_update_hashes(st, out + pos, size);
+		if (ret)
+			return ret;
+		WATCHDOG_RESET();
+	}
+	*lenp = st->size;
+
+	return 0;
+}
+
+/*
+ * Read and decompress the image a chunk at a time. If the FIT is in memory
+ * and the output overlaps the image data, output is held back so that it
+ * never reaches data which has not been read yet. If that stops progress,
+ * we fail before anything is overwritten.
+ */
+static int fit_stream_decompress(struct fit_stream *st, ulong load, u8 *out,
+				 ulong max_size, ulong *lenp)
+{
+	ulong in_read = 0, in_pos = 0, in_size = 0, out_pos = 0;
+	ulong out_limit, prev_in, prev_out, data_addr = 0;
+	bool guard = false, done = false;
+	int ret;
+
+	if (st->src->size) {
+		data_addr = st->src->addr + st->offset;
+		guard = !st->data &&
+			regions_overlap(load, max_size, data_addr, st->size) &&
+			load < data_addr + st->size;
+	}
+
+	while (!done) {
+		if (in_pos == in_size && in_read < st->size) {
+			in_size = min(st->size - in_read, st->buf_size);
+			in_pos = 0;
+			ret = fit_stream_read_data(st, in_read, in_size,
+						   st->buf);
+			if (!ret)
+				ret = fit_stream_update_hashes(st, st->buf,
+							       in_size);
+			if (!ret && !in_read)
+				ret = fit_stream_decomp_start(st, st->buf,
+							      in_size);
+			if (ret < 0)
+				return ret;
+			in_pos = ret;
+			in_read += in_size;
+			if (ctrlc()) {
+				puts("abort\n");
+				return -EINTR;
+			}
+			WATCHDOG_RESET();
+		}
+
+		/* don't write over image data we have not read yet */
+		out_limit = max_size;
+		if (guard && in_read < st->size) {
+			ulong unread = data_addr + in_read;
+
+			out_limit = unread > load ?
+				min(unread - load, max_size) : 0;
+		}
+
+		prev_in = in_pos;
+		prev_out = out_pos;
+		ret = fit_stream_decomp(st, st->buf, in_size, &in_pos, out,
+					max(out_limit, out_pos), &out_pos);
+		if (ret < 0)
+			return ret;
+		if (ret == 1 && (st->comp == IH_COMP_GZIP ||
+				 (in_pos == in_size && in_read == st->size)))
+			done = true;
+		else if (in_pos == prev_in && out_pos == prev_out &&
+			 (in_pos < in_size || in_read == st->size)) {
+			if (out_pos < max_size && out_limit < max_size) {
+				printf("\nLoading to %08lx would overwrite the image before it is read\n",
+				       load);
+				return -EFAULT;
+			}
+			if (in_read == st->size && in_pos == in_size &&
+			    out_pos < max_size)
+				return -EINVAL;
+			return -ENOBUFS;
+		}
+	}
+	*lenp = out_pos;
+
+	return 0;
+}
+
+int fit_stream_load(struct fit_stream_src *src, const char *uname,
+		    ulong *loadp, ulong max_size, ulong *lenp)
+{
+	struct fit_stream st;
+	const void *prop;
+	ulong load = *loadp;
+	size_t size;
+	int noffset, conf, ret;
+	u8 *out;
+
+	memset(&st, '\0', sizeof(st));
+	st.src = src;
+	ret = fit_stream_read_fit(&st);
+	if (ret)
+		goto out;
+
+	noffset = fit_stream_find_image(&st, uname, &conf);
+	if (noffset < 0) {
+		printf("Cannot find image '%s'\n", uname ? uname : "(default)");
+		ret = -ENOENT;
+		goto out;
+	}
+	printf("   Loading '%s' ", fit_get_name(st.fit, noffset, NULL));
+	if (fit_image_get_comp(st.fit, noffset, &st.comp) ||
+	    (load == FIT_STREAM_LOAD_DEFAULT &&
+	     fit_image_get_load(st.fit, noffset, &load))) {
+		puts("\nCannot get image compression or load address\n");
+		ret = -EINVAL;
+		goto out;
+	}
+
+	/* Image data is after the FIT ('mkimage -E') or inside it */
+	prop = fdt_getprop(st.fit, noffset, "data-offset", NULL);
+	if (prop) {
+		st.offset = ALIGN(fdt_totalsize(st.fit), 4) +
+			fdt32_to_cpu(*(fdt32_t *)prop);
+		prop = fdt_getprop(st.fit, noffset, "data-size", NULL);
+		if (!prop) {
+			ret = -EINVAL;
+			goto out;
+		}
+		st.size = fdt32_to_cpu(*(fdt32_t *)prop);
+	} else {
+		if (fit_image_get_data(st.fit, noffset, &st.data, &size)) {
+			ret = -EINVAL;
+			goto out;
+		}
+		st.size = size;
+	}
+	ret = fit_stream_setup_hashes(&st, noffset);
+	if (!ret)
+		ret = fit_stream_check_sigs(&st, conf);
+	if (ret)
+		goto out;
+
+	st.buf_size = src->chunk_size ? src->chunk_size : FIT_STREAM_CHUNK;
+	st.buf = malloc(st.buf_size);
+	if (!st.buf) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	out = map_sysmem(load, max_size);
+	if (regions_overlap((ulong)out, max_size, (ulong)st.fit,
+			    fdt_totalsize(st.fit)) ||
+	    regions_overlap((ulong)out, max_size, (ulong)st.buf,
+			    st.buf_size)) {
+		printf("\nLoad address %08lx overlaps a loader buffer\n", load);
+		ret = -EFAULT;
+		goto out_unmap;
+	}
+
+	if (st.comp == IH_COMP_NONE)
+		ret = fit_stream_copy(&st, out, max_size, lenp);
+	else
+		ret = fit_stream_decompress(&st, load, out, max_size, lenp);
+	if (!ret)
+		ret = fit_stream_check_hashes(&st);
+	if (!ret && IMAGE_ENABLE_VERIFY && st.comp == IH_COMP_NONE) {
+		int verify_all;
+
+		if (fit_image_verify_required_sigs(st.fit, noffset,
+						   (const char *)out, *lenp,
+						   gd_fdt_blob(), &verify_all))
+			ret = -EPERM;
+	}
+	if (!ret) {
+		flush_cache(load, *lenp);
+		*loadp = load;
+		puts("OK\n");
+	} else {
+		if (ret == -ENOBUFS)
+			printf("\nImage too large for %#lx bytes", max_size);
+		printf(" error %d\n", ret);
+	}
+
+out_unmap:
+	unmap_sysmem(out);
+out:
+	fit_stream_decomp_end(&st);
+	while (st.hash_count--) {
+		struct fit_stream_hash *hash = &st.hash[st.hash_count];
+
+		/* hash_finish() is the only way to free the context */
+		if (hash->ctx) {
+			u8 value[FIT_MAX_HASH_LEN];
+
+			hash->algo->hash_finish(hash->algo, hash->ctx, value,
+						sizeof(value));
+		}
+	}
+	free(st.buf);
+	free(st.fit);
+
+	return ret;
+}
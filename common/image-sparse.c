@@ -391,3 +391,354 @@ int store_sparse_image(sparse_storage_t *storage, void *storage_priv,
 
 	return 0;
 }
+
+enum {
+	SS_HEADER,		/* collecting the sparse header */
+	SS_CHUNK_HDR,		/* collecting a chunk header */
+	SS_RAW,			/* writing the data of a raw chunk */
+	SS_FILL,		/* collecting the value of a fill chunk */
+	SS_IMAGE,		/* writing an image which is not sparse */
+	SS_DONE,		/* all chunks seen */
+	SS_ERROR,
+};
+
+int sparse_stream_start(struct sparse_stream *ss, sparse_storage_t *storage,
+			void *priv)
+{
+	memset(ss, '\0', sizeof(*ss));
+	ss->buf = memalign(ARCH_DMA_MINALIGN,
+			   ROUNDUP(SPARSE_STREAM_BUF_BLKS * storage->block_sz,
+				   ARCH_DMA_MINALIGN));
+	if (!ss->buf)
+		return -ENOMEM;
+	ss->storage = storage;
+	ss->priv = priv;
+	ss->state = SS_HEADER;
+	ss->blk = storage->start;
+
+	return 0;
+}
+
+/* Blocks of storage covered by @blocks blocks of the sparse image */
+static u64 sparse_stream_blocks(struct sparse_stream *ss, unsigned int blocks)
+{
+	return (u64)blocks * (ss->header.blk_sz / ss->storage->block_sz);
+}
+
+/* Check that @blkcnt blocks from the current position are in the partition */
+static int sparse_stream_check(struct sparse_stream *ss, u64 blkcnt)
+{
+	sparse_storage_t *storage = ss->storage;
+
+	if (ss->blk < storage->start ||
+	    ss->blk + blkcnt > (u64)storage->start + storage->size) {
+		printf("%s: Request would exceed partition size!\n", __func__);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int sparse_stream_put(struct sparse_stream *ss, const char *data,
+			     unsigned int blkcnt)
+{
+	sparse_storage_t *storage = ss->storage;
+	int ret;
+
+	ret = sparse_stream_check(ss, blkcnt);
+	if (ret)
+		return ret;
+
+	ret = storage->write(storage, ss->priv, ss->blk, blkcnt,
+			     (char *)data);
+	if (ret != blkcnt) {
+		printf("%s: Write failed %d\n", __func__, ret);
+		return ret < 0 ? ret : -EIO;
+	}
+	ss->blk += blkcnt;
+	ss->written += blkcnt;
+
+	return 0;
+}
+
+static void sparse_stream_next_chunk(struct sparse_stream *ss)
+{
+	ss->hdr_len = 0;
+	if (ss->chunks == ss->header.total_chunks)
+		ss->state = SS_DONE;
+	else
+		ss->state = SS_CHUNK_HDR;
+}
+
+/* Write data of a raw chunk or image, returning the number of bytes used */
+static int sparse_stream_raw(struct sparse_stream *ss, const char *data,
+			     unsigned int len)
+{
+	unsigned int blk_sz = ss->storage->block_sz;
+	unsigned int used, n, blkcnt;
+	int ret;
+
+	if (ss->state == SS_RAW && len > ss->remain)
+		len = ss->remain;
+	used = len;
+
+	/* Complete a block started by the previous piece */
+	if (ss->buf_len) {
+		n = min(len, blk_sz - ss->buf_len);
+		memcpy(ss->buf + ss->buf_len, data, n);
+		ss->buf_len += n;
+		data += n;
+		len -= n;
+		if (ss->buf_len < blk_sz)
+			goto out;
+		ret = sparse_stream_put(ss, ss->buf, 1);
+		if (ret)
+			return ret;
+		ss->buf_len = 0;
+	}
+
+	blkcnt = len / blk_sz;
+	if (blkcnt) {
+		ret = sparse_stream_put(ss, data, blkcnt);
+		if (ret)
+			return ret;
+		data += blkcnt * blk_sz;
+		len -= blkcnt * blk_sz;
+	}
+	if (len) {
+		memcpy(ss->buf, data, len);
+		ss->buf_len = len;
+	}
+out:
+	if (ss->state == SS_RAW) {
+		ss->remain -= used;
+		if (!ss->remain)
+			sparse_stream_next_chunk(ss);
+	}
+
+	return used;
+}
+
+static int sparse_stream_header(struct sparse_stream *ss)
+{
+	sparse_header_t *sparse = &ss->header;
+	sparse_storage_t *storage = ss->storage;
+	int ret;
+
+	if (!is_sparse_image(sparse)) {
+		printf("Flashing raw image on partition %s at offset 0x%x\n",
+		       storage->name, storage->start * storage->block_sz);
+		/* What looked like a header is the start of the image */
+		ss->state = SS_IMAGE;
+		ret = sparse_stream_raw(ss, (char *)sparse, ss->hdr_len);
+
+		return ret < 0 ? ret : 0;
+	}
+
+	if (sparse->file_hdr_sz < sizeof(sparse_header_t) ||
+	    sparse->chunk_hdr_sz < sizeof(chunk_header_t) ||
+	    !sparse->blk_sz || sparse->blk_sz % storage->block_sz) {
+		printf("%s: Sparse image header issue\n", __func__);
+		return -EINVAL;
+	}
+	printf("Flashing sparse image on partition %s at offset 0x%x\n",
+	       storage->name, storage->start * storage->block_sz);
+
+	ss->skip = sparse->file_hdr_sz - sizeof(sparse_header_t);
+	sparse_stream_next_chunk(ss);
+
+	return 0;
+}
+
+static int sparse_stream_chunk(struct sparse_stream *ss)
+{
+	sparse_header_t *sparse = &ss->header;
+	chunk_header_t *chunk = &ss->chunk;
+	unsigned int data_sz;
+	u64 blkcnt;
+
+	debug("chunk_type: 0x%x chunk_sz: 0x%x total_sz: 0x%x\n",
+	      chunk->chunk_type, chunk->chunk_sz, chunk->total_sz);
+	if (chunk->total_sz < sparse->chunk_hdr_sz)
+		return -EINVAL;
+	data_sz = sparse_get_chunk_data_size(sparse, chunk);
+	ss->skip = sparse->chunk_hdr_sz - sizeof(chunk_header_t);
+	ss->chunks++;
+	ss->hdr_len = 0;
+
+	switch (chunk->chunk_type) {
+	case CHUNK_TYPE_RAW:
+		if (sparse_parse_raw_chunk(sparse, chunk))
+			return -EINVAL;
+		ss->remain = data_sz;
+		ss->state = SS_RAW;
+		if (!data_sz)
+			sparse_stream_next_chunk(ss);
+		break;
+
+	case CHUNK_TYPE_FILL:
+		if (sparse_parse_fill_chunk(sparse, chunk))
+			return -EINVAL;
+		ss->state = SS_FILL;
+		break;
+
+	case CHUNK_TYPE_DONT_CARE:
+		blkcnt = sparse_stream_blocks(ss, chunk->chunk_sz);
+		if (sparse_stream_check(ss, blkcnt))
+			return -EINVAL;
+		ss->blk += blkcnt;
+		ss->skipped += blkcnt;
+		/* fall through */
+	case CHUNK_TYPE_CRC32:
+		ss->skip += data_sz;
+		sparse_stream_next_chunk(ss);
+		break;
+
+	default:
+		printf("%s: Unknown chunk type: %x\n", __func__,
+		       chunk->chunk_type);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int sparse_stream_fill(struct sparse_stream *ss)
+{
+	u64 blkcnt = sparse_stream_blocks(ss, ss->chunk.chunk_sz);
+	unsigned int words = SPARSE_STREAM_BUF_BLKS * ss->storage->block_sz /
+			     sizeof(uint32_t);
+	unsigned int i, n;
+	int ret;
+
+	ret = sparse_stream_check(ss, blkcnt);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < words; i++)
+		((uint32_t *)ss->buf)[i] = ss->fill;
+
+	while (blkcnt) {
+		n = min_t(u64, blkcnt, SPARSE_STREAM_BUF_BLKS);
+		ret = sparse_stream_put(ss, ss->buf, n);
+		if (ret)
+			return ret;
+		blkcnt -= n;
+	}
+	sparse_stream_next_chunk(ss);
+
+	return 0;
+}
+
+/* Collect part of a header, returning the number of bytes used */
+static unsigned int sparse_stream_collect(struct sparse_stream *ss, void *hdr,
+					  unsigned int size, const char *data,
+					  unsigned int len)
+{
+	unsigned int n = min(len, size - ss->hdr_len);
+
+	memcpy(hdr + ss->hdr_len, data, n);
+	ss->hdr_len += n;
+
+	return n;
+}
+
+int sparse_stream_write(struct sparse_stream *ss, const void *data,
+			unsigned int len)
+{
+	const char *p = data;
+	int n, ret = 0;
+
+	while (len && !ret) {
+		if (ss->skip) {
+			n = min(len, ss->skip);
+			ss->skip -= n;
+			p += n;
+			len -= n;
+			continue;
+		}
+
+		switch (ss->state) {
+		case SS_HEADER:
+			n = sparse_stream_collect(ss, &ss->header,
+						  sizeof(ss->header), p, len);
+			if (ss->hdr_len == sizeof(ss->header))
+				ret = sparse_stream_header(ss);
+			break;
+		case SS_CHUNK_HDR:
+			n = sparse_stream_collect(ss, &ss->chunk,
+						  sizeof(ss->chunk), p, len);
+			if (ss->hdr_len == sizeof(ss->chunk))
+				ret = sparse_stream_chunk(ss);
+			break;
+		case SS_FILL:
+			n = sparse_stream_collect(ss, &ss->fill,
+						  sizeof(ss->fill), p, len);
+			if (ss->hdr_len == sizeof(ss->fill))
+				ret = sparse_stream_fill(ss);
+			break;
+		case SS_RAW:
+		case SS_IMAGE:
+			n = sparse_stream_raw(ss, p, len);
+			if (n < 0)
+				ret = n;
+			break;
+		case SS_DONE:
+			/* Ignore anything after the last chunk */
+			return 0;
+		default:
+			return -EIO;
+		}
+		p += n;
+		len -= n;
+	}
+	if (ret)
+		ss->state = SS_ERROR;
+
+	return ret;
+}
+
+int sparse_stream_finish(struct sparse_stream *ss)
+{
+	sparse_storage_t *storage = ss->storage;
+	int ret = 0;
+
+	/* An image shorter than a sparse header cannot be sparse */
+	if (ss->state == SS_HEADER && ss->hdr_len) {
+		memcpy(ss->buf, &ss->header, ss->hdr_len);
+		ss->buf_len = ss->hdr_len;
+		ss->state = SS_IMAGE;
+	}
+
+	switch (ss->state) {
+	case SS_IMAGE:
+		if (ss->buf_len) {
+			memset(ss->buf + ss->buf_len, '\0',
+			       storage->block_sz - ss->buf_len);
+			ret = sparse_stream_put(ss, ss->buf, 1);
+		}
+		break;
+	case SS_DONE:
+		if ((u64)ss->written + ss->skipped !=
+		    sparse_stream_blocks(ss, ss->header.total_blks)) {
+			printf("sparse image write failure\n");
+			ret = -EIO;
+		}
+		break;
+	case SS_ERROR:
+		ret = -EIO;
+		break;
+	default:
+		printf("sparse image is incomplete\n");
+		ret = -EIO;
+		break;
+	}
+	if (!ret)
+		printf("........ wrote %u blocks to '%s'\n", ss->written,
+		       storage->name);
+
+	free(ss->buf);
+	ss->buf = NULL;
+
+	return ret;
+}
@@ -13,6 +13,148 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
+#ifdef CONFIG_SYS_MALLOC_F_POOL
+/*
+ * Small blocks are rounded up to one of a few sizes (16, 32, 64, 128 and 256
+ * bytes) and kept on a free list for that size when freed, so that they can
+ * be used again. Larger blocks come straight from the bump allocator and are
+ * only given back when they are the last one allocated, as is any block
+ * freed from the top of the area.
+ *
+ * Each block is preceded by a header giving its size. The free lists live
+ * at the start of the malloc() area, so they are set up again whenever the
+ * area is moved (e.g. to SDRAM in SPL) simply by resetting gd->malloc_ptr.
+ */
+#define POOL_MIN_SHIFT		4
+#define POOL_CLASSES		5
+
+struct pool_hdr {
+	ulong size;		/* usable size of the block */
+};
+
+struct pool {
+	ulong peak;		/* highest value of gd->malloc_ptr */
+	void *free[POOL_CLASSES];	/* free blocks of each size */
+};
+
+static int pool_class(size_t bytes)
+{
+	int cls;
+
+	for (cls = 0; cls < POOL_CLASSES; cls++) {
+		if (bytes <= 1UL << (POOL_MIN_SHIFT + cls))
+			return cls;
+	}
+
+	return -1;
+}
+
+static struct pool *pool_get(void)
+{
+	struct pool *pool = map_sysmem(gd->malloc_base, sizeof(*pool));
+
+	if (!gd->malloc_ptr) {
+		if (sizeof(*pool) > gd->malloc_limit)
+			return NULL;
+		memset(pool, '\0', sizeof(*pool));
+		gd->malloc_ptr = sizeof(*pool);
+		pool->peak = gd->malloc_ptr;
+	}
+
+	return pool;
+}
+
+static void *pool_bump(struct pool *pool, size_t align, size_t bytes)
+{
+	struct pool_hdr *hdr;
+	ulong addr, new_ptr;
+	void *ptr;
+
+	addr = ALIGN(gd->malloc_base + gd->malloc_ptr + sizeof(*hdr), align);
+	new_ptr = addr + bytes - gd->malloc_base;
+	debug("%s: size=%zx, ptr=%lx, limit=%lx: ", __func__, bytes, new_ptr,
+	      gd->malloc_limit);
+	if (new_ptr > gd->malloc_limit) {
+		debug("space exhausted\n");
+		return NULL;
+	}
+	ptr = map_sysmem(addr, bytes);
+	hdr = (struct pool_hdr *)ptr - 1;
+	hdr->size = bytes;
+	gd->malloc_ptr = ALIGN(new_ptr, sizeof(new_ptr));
+	if (gd->malloc_ptr > pool->peak)
+		pool->peak = gd->malloc_ptr;
+	debug("%lx\n", (ulong)ptr);
+
+	return ptr;
+}
+
+static void *pool_alloc(size_t align, size_t bytes)
+{
+	struct pool *pool;
+	int cls;
+
+	pool = pool_get();
+	if (!pool)
+		return NULL;
+	cls = pool_class(bytes);
+	if (cls >= 0) {
+		void *ptr = pool->free[cls];
+
+		bytes = 1UL << (POOL_MIN_SHIFT + cls);
+		if (ptr && !((ulong)ptr & (align - 1))) {
+			pool->free[cls] = *(void **)ptr;
+			return ptr;
+		}
+	}
+
+	return pool_bump(pool, align, bytes);
+}
+
+void *malloc_simple(size_t bytes)
+{
+	return pool_alloc(sizeof(ulong), bytes);
+}
+
+void *memalign_simple(size_t align, size_t bytes)
+{
+	return pool_alloc(max_t(size_t, align, sizeof(ulong)), bytes);
+}
+
+void free_simple(void *ptr)
+{
+	struct pool *pool;
+	struct pool_hdr *hdr;
+	ulong offset;
+	int cls;
+
+	if (!ptr)
+		return;
+	pool = map_sysmem(gd->malloc_base, sizeof(*pool));
+	hdr = (struct pool_hdr *)ptr - 1;
+	offset = map_to_sysmem(ptr) - gd->malloc_base;
+	debug("%s: ptr=%lx, size=%lx\n", __func__, offset, hdr->size);
+
+	/* The last block can go straight back to the bump allocator */
+	if (ALIGN(offset + hdr->size, sizeof(offset)) == gd->malloc_ptr) {
+		gd->malloc_ptr = offset - sizeof(*hdr);
+		return;
+	}
+
+	cls = pool_class(hdr->size);
+	if (cls >= 0 && hdr->size == 1UL << (POOL_MIN_SHIFT + cls)) {
+		*(void **)ptr = pool->free[cls];
+		pool->free[cls] = ptr;
+	}
+}
+
+size_t malloc_simple_peak(void)
+{
+	struct pool *pool = map_sysmem(gd->malloc_base, sizeof(*pool));
+
+	return gd->malloc_ptr ? pool->peak : 0;
+}
+#else
 void *malloc_simple(size_t bytes)
 {
 	ulong new_ptr;
@@ -47,6 +189,13 @@ void *memalign_simple(size_t align, size_t bytes)
 	return ptr;
 }
 
+size_t malloc_simple_peak(void)
+{
+	/* Nothing is ever freed, so the current position is the peak */
+	return gd->malloc_ptr;
+}
+#endif
+
 #if CONFIG_IS_ENABLED(SYS_MALLOC_SIMPLE)
 void *calloc(size_t nmemb, size_t elem_size)
 {
@@ -395,8 +395,8 @@ void board_init_r(gd_t *dummy1, ulong dummy2)
 		debug("Unsupported OS image.. Jumping nevertheless..\n");
 	}
 #if defined(CONFIG_SYS_MALLOC_F_LEN) && !defined(CONFIG_SYS_SPL_MALLOC_SIZE)
-	debug("SPL malloc() used %#lx bytes (%ld KB)\n", gd->malloc_ptr,
-	      gd->malloc_ptr / 1024);
+	debug("SPL malloc() used %#zx bytes (%zd KB)\n", malloc_simple_peak(),
+	      malloc_simple_peak() / 1024);
 #endif
 
 	debug("loaded - jumping to U-Boot...");
@@ -10,6 +10,7 @@
 #include <image.h>
 #include <libfdt.h>
 #include <spl.h>
+#include <u-boot/zstd.h>
 
 static ulong fdt_getprop_u32(const void *fdt, int node, const char *prop)
 {
@@ -82,6 +83,33 @@ static int spl_fit_select_fdt(const void *fdt, int images, int *fdt_offsetp)
 	return -ENOENT;
 }
 
+#ifdef CONFIG_SPL_ZSTD
+/*
+ * Decompress a zstd image which has been read to @src, writing it to @dst.
+ * Returns the decompressed size, or -ve error.
+ */
+static int spl_fit_unzstd(const void *src, int src_size, void *dst)
+{
+	size_t size;
+	u64 content_size;
+	int ret;
+
+	ret = zstd_get_content_size(src, src_size, &content_size);
+	if (ret) {
+		debug("%s: Cannot get image size: %d\n", __func__, ret);
+		return ret;
+	}
+	size = content_size;
+	ret = zstd_decompress(src, src_size, dst, &size);
+	if (ret) {
+		debug("%s: Decompression failed: %d\n", __func__, ret);
+		return ret;
+	}
+
+	return size;
+}
+#endif
+
 int spl_load_simple_fit(struct spl_load_info *info, ulong sector, void *fit)
 {
 	int sectors;
@@ -93,6 +121,7 @@ int spl_load_simple_fit(struct spl_load_info *info, ulong sector, void *fit)
 	int data_offset, data_size;
 	int base_offset;
 	int src_sector;
+	bool zstd = false;
 	void *dst;
 
 	/*
@@ -145,6 +174,13 @@ int spl_load_simple_fit(struct spl_load_info *info, ulong sector, void *fit)
 	spl_image.load_addr = load;
 	spl_image.entry_point = load;
 	spl_image.os = IH_OS_U_BOOT;
+#ifdef CONFIG_SPL_ZSTD
+	{
+		const char *comp = fdt_getprop(fit, node, FIT_COMP_PROP, NULL);
+
+		zstd = comp && !strcmp(comp, "zstd");
+	}
+#endif
 
 	/*
 	 * Work out where to place the image. We read it so that the first
@@ -157,6 +193,13 @@ int spl_load_simple_fit(struct spl_load_info *info, ulong sector, void *fit)
 	debug("U-Boot size %x, data %p\n", data_size, load_ptr);
 	dst = load_ptr - (data_offset % info->bl_len);
 
+	/*
+	 * A compressed image is read to just below the FIT instead, and then
+	 * decompressed to 'load'.
+	 */
+	if (zstd)
+		dst = fit - (sectors + 1) * info->bl_len;
+
 	/* Read the image */
 	src_sector = sector + data_offset / info->bl_len;
 	debug("image: data_offset=%x, dst=%p, src_sector=%x, sectors=%x\n",
@@ -164,6 +207,15 @@ int spl_load_simple_fit(struct spl_load_info *info, ulong sector, void *fit)
 	count = info->read(info, src_sector, sectors, dst);
 	if (count != sectors)
 		return -EIO;
+#ifdef CONFIG_SPL_ZSTD
+	if (zstd) {
+		data_size = spl_fit_unzstd(dst + data_offset % info->bl_len,
+					   data_size, load_ptr);
+		if (data_size < 0)
+			return data_size;
+		debug("U-Boot uncompressed size %x\n", data_size);
+	}
+#endif
 
 	/* Figure out which device tree the board wants to use */
 	fdt_len = spl_fit_select_fdt(fit, images, &fdt_offset);
@@ -176,6 +228,8 @@ int spl_load_simple_fit(struct spl_load_info *info, ulong sector, void *fit)
 	 */
 	dst = load_ptr + data_size;
 	fdt_offset += base_offset;
+	sectors = (fdt_offset % info->bl_len + fdt_len + info->bl_len - 1) /
+		info->bl_len;
 	count = info->read(info, sector + fdt_offset / info->bl_len, sectors,
 			   dst);
 	debug("fit read %x sectors to %x, dst %p, data_offset %x\n",
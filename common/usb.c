@@ -915,6 +915,15 @@ __weak int usb_alloc_device(struct usb_device *udev)
 {
 	return 0;
 }
+
+/*
+ * Host controllers which can do large bulk transfers override this, so that
+ * USB storage does not fall back to its conservative default.
+ */
+__weak int usb_get_max_xfer_size(struct usb_device *udev, size_t *size)
+{
+	return -ENOSYS;
+}
 #endif /* !CONFIG_DM_USB */
 
 static int usb_hub_port_reset(struct usb_device *dev, struct usb_device *hub)
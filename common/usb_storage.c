@@ -38,10 +38,12 @@
 #include <dm.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <div64.h>
 #include <mapmem.h>
 #include <memalign.h>
 #include <asm/byteorder.h>
 #include <asm/processor.h>
+#include <asm/unaligned.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 
@@ -58,7 +60,7 @@
 static const unsigned char us_direction[256/8] = {
 	0x28, 0x81, 0x14, 0x14, 0x20, 0x01, 0x90, 0x77,
 	0x0C, 0x20, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x01,
+	0x00, 0x01, 0x00, 0x40, 0x00, 0x01, 0x00, 0x01,
 	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
 };
 #define US_DIRECTION(x) ((us_direction[x>>3] >> (x & 7)) & 1)
@@ -98,18 +100,21 @@ struct us_data {
 	ccb		*srb;			/* current srb */
 	trans_reset	transport_reset;	/* reset routine */
 	trans_cmnd	transport;		/* transport routine */
+	size_t		max_xfer_size;		/* 0 if not known */
+	u64		read_bytes;		/* bytes read so far */
+	u64		read_us;		/* time spent reading */
+	u64		write_bytes;		/* bytes written so far */
+	u64		write_us;		/* time spent writing */
 };
 
-#ifdef CONFIG_USB_EHCI
 /*
- * The U-Boot EHCI driver can handle any transfer length as long as there is
- * enough free heap space left, but the SCSI READ(10) and WRITE(10) commands are
- * limited to 65535 blocks.
+ * Each READ/WRITE command transfers as many blocks as the host controller
+ * can handle in one bulk transfer (see usb_get_max_xfer_size()), up to the
+ * 65535-block limit of READ(10) and WRITE(10). Controllers which do not
+ * report a limit get a conservative 20 blocks.
  */
 #define USB_MAX_XFER_BLK	65535
-#else
-#define USB_MAX_XFER_BLK	20
-#endif
+#define USB_DEFAULT_XFER_BLK	20
 
 #ifndef CONFIG_BLK
 static struct us_data usb_stor[USB_MAX_STOR_DEV];
@@ -158,6 +163,30 @@ static void usb_show_progress(void)
 	debug(".");
 }
 
+static void usb_stor_show_rate(const char *name, u64 bytes, u64 us)
+{
+	ulong rate;
+
+	if (!bytes)
+		return;
+	printf("            %s: ", name);
+	print_size(bytes, "");
+
+	/* Scale down so that the divisor fits in 32 bits */
+	while (us >> 32) {
+		bytes >>= 1;
+		us >>= 1;
+	}
+	rate = lldiv(bytes * 10, us ? us : 1);
+	printf(" at %lu.%lu MB/s\n", rate / 10, rate % 10);
+}
+
+static void usb_stor_show_stats(struct us_data *ss)
+{
+	usb_stor_show_rate("Read", ss->read_bytes, ss->read_us);
+	usb_stor_show_rate("Write", ss->write_bytes, ss->write_us);
+}
+
 /*******************************************************************************
  * show info on storage devices; 'usb start/init' must be invoked earlier
  * as we only retrieve structures populated during devices initialization
@@ -175,6 +204,7 @@ int usb_stor_info(void)
 
 		printf("  Device %d: ", desc->devnum);
 		dev_print(desc);
+		usb_stor_show_stats(dev_get_platdata(dev_get_parent(dev)));
 		count++;
 	}
 #else
@@ -182,8 +212,11 @@ int usb_stor_info(void)
 
 	if (usb_max_devs > 0) {
 		for (i = 0; i < usb_max_devs; i++) {
+			struct usb_device *udev = usb_dev_desc[i].priv;
+
 			printf("  Device %d: ", i);
 			dev_print(&usb_dev_desc[i]);
+			usb_stor_show_stats(udev->privptr);
 		}
 		return 0;
 	}
@@ -1066,6 +1099,25 @@ static int usb_read_capacity(ccb *srb, struct us_data *ss)
 	return -1;
 }
 
+static int usb_read_capacity_16(ccb *srb, struct us_data *ss)
+{
+	int retry;
+
+	retry = 3;
+	do {
+		memset(&srb->cmd[0], 0, 16);
+		srb->cmd[0] = SCSI_RD_CAPAC16;
+		srb->cmd[1] = 0x10;	/* service action: READ CAPACITY(16) */
+		srb->cmd[13] = 32;	/* allocation length */
+		srb->datalen = 32;
+		srb->cmdlen = 16;
+		if (ss->transport(srb, ss) == USB_STOR_TRANSPORT_GOOD)
+			return 0;
+	} while (retry--);
+
+	return -1;
+}
+
 static int usb_read_10(ccb *srb, struct us_data *ss, unsigned long start,
 		       unsigned short blocks)
 {
@@ -1100,6 +1152,46 @@ static int usb_write_10(ccb *srb, struct us_data *ss, unsigned long start,
 	return ss->transport(srb, ss);
 }
 
+/*
+ * READ(16) and WRITE(16) are only used for blocks beyond the 32-bit address
+ * range of READ(10) and WRITE(10), since some devices do not support them.
+ */
+static int usb_read_16(ccb *srb, struct us_data *ss, lbaint_t start,
+		       unsigned short blocks)
+{
+	memset(&srb->cmd[0], 0, 16);
+	srb->cmd[0] = SCSI_READ16;
+	put_unaligned_be64(start, &srb->cmd[2]);
+	put_unaligned_be32(blocks, &srb->cmd[10]);
+	srb->cmdlen = 16;
+	debug("read16: start " LBAF " blocks %x\n", start, blocks);
+	return ss->transport(srb, ss);
+}
+
+static int usb_write_16(ccb *srb, struct us_data *ss, lbaint_t start,
+			unsigned short blocks)
+{
+	memset(&srb->cmd[0], 0, 16);
+	srb->cmd[0] = SCSI_WRITE16;
+	put_unaligned_be64(start, &srb->cmd[2]);
+	put_unaligned_be32(blocks, &srb->cmd[10]);
+	srb->cmdlen = 16;
+	debug("write16: start " LBAF " blocks %x\n", start, blocks);
+	return ss->transport(srb, ss);
+}
+
+static unsigned short usb_stor_max_xfer_blk(struct us_data *ss,
+					    struct blk_desc *block_dev)
+{
+	size_t blks;
+
+	if (!ss->max_xfer_size)
+		return USB_DEFAULT_XFER_BLK;
+	blks = ss->max_xfer_size / block_dev->blksz;
+
+	return clamp_t(size_t, blks, 1, USB_MAX_XFER_BLK);
+}
+
 
 #ifdef CONFIG_USB_BIN_FIXUP
 /*
@@ -1134,10 +1226,11 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 {
 	lbaint_t start, blks;
 	uintptr_t buf_addr;
-	unsigned short smallblks;
+	unsigned short smallblks, max_blks;
 	struct usb_device *udev;
 	struct us_data *ss;
-	int retry;
+	ulong start_us;
+	int retry, ret;
 	ccb *srb = &usb_ccb;
 #ifdef CONFIG_BLK
 	struct blk_desc *block_dev;
@@ -1166,6 +1259,9 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 	start = blknr;
 	blks = blkcnt;
 
+	max_blks = usb_stor_max_xfer_blk(ss, block_dev);
+	start_us = timer_get_us();
+
 	debug("\nusb_read: dev %d startblk " LBAF ", blccnt " LBAF " buffer %"
 	      PRIxPTR "\n", block_dev->devnum, start, blks, buf_addr);
 
@@ -1173,16 +1269,20 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 		/* XXX need some comment here */
 		retry = 2;
 		srb->pdata = (unsigned char *)buf_addr;
-		if (blks > USB_MAX_XFER_BLK)
-			smallblks = USB_MAX_XFER_BLK;
+		if (blks > max_blks)
+			smallblks = max_blks;
 		else
 			smallblks = (unsigned short) blks;
 retry_it:
-		if (smallblks == USB_MAX_XFER_BLK)
+		if (smallblks == max_blks)
 			usb_show_progress();
 		srb->datalen = block_dev->blksz * smallblks;
 		srb->pdata = (unsigned char *)buf_addr;
-		if (usb_read_10(srb, ss, start, smallblks)) {
+		if ((u64)start >> 32)
+			ret = usb_read_16(srb, ss, start, smallblks);
+		else
+			ret = usb_read_10(srb, ss, start, smallblks);
+		if (ret) {
 			debug("Read ERROR\n");
 			usb_request_sense(srb, ss);
 			if (retry--)
@@ -1200,8 +1300,11 @@ retry_it:
 	      ", blccnt %x buffer %" PRIxPTR "\n",
 	      start, smallblks, buf_addr);
 
+	ss->read_bytes += (u64)blkcnt * block_dev->blksz;
+	ss->read_us += timer_get_us() - start_us;
+
 	usb_disable_asynch(0); /* asynch transfer allowed */
-	if (blkcnt >= USB_MAX_XFER_BLK)
+	if (blkcnt >= max_blks)
 		debug("\n");
 	return blkcnt;
 }
@@ -1216,10 +1319,11 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 {
 	lbaint_t start, blks;
 	uintptr_t buf_addr;
-	unsigned short smallblks;
+	unsigned short smallblks, max_blks;
 	struct usb_device *udev;
 	struct us_data *ss;
-	int retry;
+	ulong start_us;
+	int retry, ret;
 	ccb *srb = &usb_ccb;
 #ifdef CONFIG_BLK
 	struct blk_desc *block_dev;
@@ -1250,6 +1354,9 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 	start = blknr;
 	blks = blkcnt;
 
+	max_blks = usb_stor_max_xfer_blk(ss, block_dev);
+	start_us = timer_get_us();
+
 	debug("\nusb_write: dev %d startblk " LBAF ", blccnt " LBAF " buffer %"
 	      PRIxPTR "\n", block_dev->devnum, start, blks, buf_addr);
 
@@ -1259,16 +1366,20 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 		 */
 		retry = 2;
 		srb->pdata = (unsigned char *)buf_addr;
-		if (blks > USB_MAX_XFER_BLK)
-			smallblks = USB_MAX_XFER_BLK;
+		if (blks > max_blks)
+			smallblks = max_blks;
 		else
 			smallblks = (unsigned short) blks;
 retry_it:
-		if (smallblks == USB_MAX_XFER_BLK)
+		if (smallblks == max_blks)
 			usb_show_progress();
 		srb->datalen = block_dev->blksz * smallblks;
 		srb->pdata = (unsigned char *)buf_addr;
-		if (usb_write_10(srb, ss, start, smallblks)) {
+		if ((u64)start >> 32)
+			ret = usb_write_16(srb, ss, start, smallblks);
+		else
+			ret = usb_write_10(srb, ss, start, smallblks);
+		if (ret) {
 			debug("Write ERROR\n");
 			usb_request_sense(srb, ss);
 			if (retry--)
@@ -1285,8 +1396,11 @@ retry_it:
 	debug("usb_write: end startblk " LBAF ", blccnt %x buffer %"
 	      PRIxPTR "\n", start, smallblks, buf_addr);
 
+	ss->write_bytes += (u64)blkcnt * block_dev->blksz;
+	ss->write_us += timer_get_us() - start_us;
+
 	usb_disable_asynch(0); /* asynch transfer allowed */
-	if (blkcnt >= USB_MAX_XFER_BLK)
+	if (blkcnt >= max_blks)
 		debug("\n");
 	return blkcnt;
 
@@ -1407,6 +1521,8 @@ int usb_storage_probe(struct usb_device *dev, unsigned int ifnum,
 		ss->irqmaxp = usb_maxpacket(dev, ss->irqpipe);
 		dev->irq_handle = usb_stor_irq;
 	}
+	if (usb_get_max_xfer_size(dev, &ss->max_xfer_size))
+		ss->max_xfer_size = 0;
 	dev->privptr = (void *)ss;
 	return 1;
 }
@@ -1415,9 +1531,10 @@ int usb_stor_get_info(struct usb_device *dev, struct us_data *ss,
 		      struct blk_desc *dev_desc)
 {
 	unsigned char perq, modi;
-	ALLOC_CACHE_ALIGN_BUFFER(u32, cap, 2);
+	ALLOC_CACHE_ALIGN_BUFFER(u32, cap, 8);
 	ALLOC_CACHE_ALIGN_BUFFER(u8, usb_stor_buf, 36);
-	u32 capacity, blksz;
+	u64 capacity;
+	u32 blksz;
 	ccb *pccb = &usb_ccb;
 
 	pccb->pdata = usb_stor_buf;
@@ -1486,10 +1603,26 @@ int usb_stor_get_info(struct usb_device *dev, struct us_data *ss,
 	cap[1] = cpu_to_be32(cap[1]);
 #endif
 
-	capacity = be32_to_cpu(cap[0]) + 1;
+	capacity = (u64)be32_to_cpu(cap[0]) + 1;
 	blksz = be32_to_cpu(cap[1]);
 
-	debug("Capacity = 0x%08x, blocksz = 0x%08x\n", capacity, blksz);
+	/* Devices with more than 2^32 blocks need READ CAPACITY(16) */
+	if (capacity == 0x100000000ULL) {
+		memset(pccb->pdata, 0, 32);
+		if (usb_read_capacity_16(pccb, ss) == 0) {
+			capacity = get_unaligned_be64(cap) + 1;
+			blksz = be32_to_cpu(cap[2]);
+		}
+		ss->flags &= ~USB_READY;
+	}
+	if (capacity > (lbaint_t)-1) {
+		printf("Warning: only the first " LBAFU
+		       " blocks can be used without CONFIG_SYS_64BIT_LBA\n",
+		       (lbaint_t)-1);
+		capacity = (lbaint_t)-1;
+	}
+
+	debug("Capacity = 0x%llx, blocksz = 0x%08x\n", capacity, blksz);
 	dev_desc->lba = capacity;
 	dev_desc->blksz = blksz;
 	dev_desc->log2blksz = LOG2(dev_desc->blksz);
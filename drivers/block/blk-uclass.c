@@ -88,6 +88,9 @@ unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	if (blkcache_read(block_dev->if_type, block_dev->devnum,
 			  start, blkcnt, block_dev->blksz, buffer))
 		return blkcnt;
+	blks_read = blkcache_readahead(block_dev, start, blkcnt, buffer);
+	if (blks_read)
+		return blks_read;
 	blks_read = ops->read(dev, start, blkcnt, buffer);
 	if (blks_read == blkcnt)
 		blkcache_fill(block_dev->if_type, block_dev->devnum,
@@ -179,8 +182,19 @@ int blk_unbind_all(int if_type)
 	return 0;
 }
 
+/* A new device may be bound with the same number, so drop what is cached */
+static int blk_pre_remove(struct udevice *dev)
+{
+	struct blk_desc *desc = dev_get_uclass_platdata(dev);
+
+	blkcache_invalidate(desc->if_type, desc->devnum);
+
+	return 0;
+}
+
 UCLASS_DRIVER(blk) = {
 	.id		= UCLASS_BLK,
 	.name		= "blk",
+	.pre_remove	= blk_pre_remove,
 	.per_device_platdata_auto_alloc_size = sizeof(struct blk_desc),
 };
@@ -7,162 +7,421 @@
  */
 #include <config.h>
 #include <common.h>
+#include <blk.h>
+#include <dm.h>
 #include <malloc.h>
 #include <part.h>
 #include <linux/ctype.h>
 #include <linux/list.h>
+#include <linux/log2.h>
 
-struct block_cache_node {
-	struct list_head lh;
+/*
+ * The cache is a set-associative array of fixed-size lines. Each line
+ * holds BLKCACHE_LINE_SIZE bytes of a device, aligned to that size, and
+ * keeps a bitmap of which of its blocks are valid so that single-sector
+ * metadata reads can be cached as well as whole lines. A line is found by
+ * hashing (iftype, devnum, line number) to a set and then comparing the
+ * BLKCACHE_WAYS lines of that set, with LRU replacement within the set.
+ */
+#define BLKCACHE_LINE_SIZE	4096
+#define BLKCACHE_WAYS		4
+/* blocks per line is tracked in a 32-bit valid mask */
+#define BLKCACHE_MIN_BLKSZ	(BLKCACHE_LINE_SIZE / 32)
+/* number of back-to-back sequential reads before read-ahead starts */
+#define BLKCACHE_SEQ_THRESHOLD	2
+
+struct block_cache_line {
 	int iftype;
 	int devnum;
-	lbaint_t start;
-	lbaint_t blkcnt;
+	lbaint_t line;		/* line number, i.e. LBA / blocks per line */
 	unsigned long blksz;
-	char *cache;
+	u32 valid;		/* bit n set: block n of the line is cached */
+	u32 stamp;		/* LRU timestamp, 0 if the line is free */
+	char *data;
+};
+
+/* per-device statistics and sequential stream detection */
+struct block_cache_dev {
+	struct list_head lh;
+	struct block_cache_dev_stats stats;
+	lbaint_t next;		/* block following the previous read */
+	unsigned seq;		/* number of consecutive sequential reads */
+	unsigned ra_bytes;	/* current read-ahead window */
 };
 
-static LIST_HEAD(block_cache);
+static LIST_HEAD(block_cache_devs);
+
+static struct block_cache_line *lines;
+static char *line_data;
+static char *ra_buf;
+static unsigned num_sets;
+static unsigned set_bits;	/* log2(num_sets) */
+static u32 lru_clock;
 
 static struct block_cache_stats _stats = {
-	.max_blocks_per_entry = 2,
-	.max_entries = 32
+	.size_mb = CONFIG_BLOCK_CACHE_SIZE,
+	.readahead_kb = CONFIG_BLOCK_CACHE_READAHEAD,
+	.ways = BLKCACHE_WAYS,
 };
 
-static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
-					   unsigned long blksz)
-{
-	struct block_cache_node *node;
-
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum) &&
-		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
-			if (block_cache.next != &node->lh) {
-				/* maintain MRU ordering */
-				list_del(&node->lh);
-				list_add(&node->lh, &block_cache);
-			}
-			return node;
+static void cache_free(void)
+{
+	free(lines);
+	free(line_data);
+	free(ra_buf);
+	lines = NULL;
+	line_data = NULL;
+	ra_buf = NULL;
+	num_sets = 0;
+	_stats.entries = 0;
+	_stats.max_entries = 0;
+}
+
+/* allocate the cache on first use, returns 0 if the cache is disabled */
+static int cache_init(void)
+{
+	unsigned long nlines;
+	unsigned i;
+
+	if (lines)
+		return 1;
+	if (!_stats.size_mb)
+		return 0;
+
+	nlines = (_stats.size_mb << 20) / BLKCACHE_LINE_SIZE;
+	num_sets = rounddown_pow_of_two(nlines / BLKCACHE_WAYS);
+	set_bits = ilog2(num_sets);
+	nlines = num_sets * BLKCACHE_WAYS;
+
+	lines = calloc(nlines, sizeof(*lines));
+	line_data = malloc(nlines * BLKCACHE_LINE_SIZE);
+	if (_stats.readahead_kb)
+		ra_buf = memalign(ARCH_DMA_MINALIGN,
+				  _stats.readahead_kb << 10);
+	if (!lines || !line_data || (_stats.readahead_kb && !ra_buf)) {
+		debug("%s: out of memory, cache disabled\n", __func__);
+		cache_free();
+		_stats.size_mb = 0;
+		return 0;
+	}
+
+	for (i = 0; i < nlines; i++)
+		lines[i].data = line_data + i * BLKCACHE_LINE_SIZE;
+	_stats.max_entries = nlines;
+
+	return 1;
+}
+
+static struct block_cache_dev *cache_dev(int iftype, int devnum)
+{
+	struct block_cache_dev *bcd;
+
+	list_for_each_entry(bcd, &block_cache_devs, lh)
+		if (bcd->stats.iftype == iftype && bcd->stats.devnum == devnum)
+			return bcd;
+
+	bcd = calloc(1, sizeof(*bcd));
+	if (!bcd)
+		return NULL;
+	bcd->stats.iftype = iftype;
+	bcd->stats.devnum = devnum;
+	list_add_tail(&bcd->lh, &block_cache_devs);
+
+	return bcd;
+}
+
+static inline unsigned blocks_per_line(unsigned long blksz)
+{
+	return BLKCACHE_LINE_SIZE / blksz;
+}
+
+static inline int cacheable_blksz(unsigned long blksz)
+{
+	return blksz >= BLKCACHE_MIN_BLKSZ && blksz <= BLKCACHE_LINE_SIZE &&
+	       is_power_of_2(blksz);
+}
+
+static struct block_cache_line *cache_set(int iftype, int devnum,
+					  lbaint_t line)
+{
+	u32 hash;
+
+	hash = (u32)line ^ (u32)((u64)line >> 32);
+	hash ^= ((u32)devnum << 8) ^ ((u32)iftype << 16);
+	hash *= 0x9e3779b1;	/* golden ratio multiplicative hash */
+
+	/* the top bits of a multiplicative hash are the well-mixed ones */
+	return &lines[(set_bits ? hash >> (32 - set_bits) : 0) * BLKCACHE_WAYS];
+}
+
+static struct block_cache_line *cache_find(int iftype, int devnum,
+					   lbaint_t line, unsigned long blksz)
+{
+	struct block_cache_line *set;
+	unsigned way;
+
+	set = cache_set(iftype, devnum, line);
+	for (way = 0; way < BLKCACHE_WAYS; way++) {
+		struct block_cache_line *cl = &set[way];
+
+		if (cl->stamp && cl->line == line && cl->devnum == devnum &&
+		    cl->iftype == iftype && cl->blksz == blksz)
+			return cl;
+	}
+
+	return NULL;
+}
+
+/* find a line to hold @line, evicting the least recently used if needed */
+static struct block_cache_line *cache_alloc(int iftype, int devnum,
+					    lbaint_t line, unsigned long blksz)
+{
+	struct block_cache_line *set, *victim = NULL;
+	struct block_cache_dev *owner;
+	unsigned way;
+
+	set = cache_set(iftype, devnum, line);
+	for (way = 0; way < BLKCACHE_WAYS; way++) {
+		struct block_cache_line *cl = &set[way];
+
+		if (!cl->stamp) {
+			victim = cl;
+			break;
 		}
-	return 0;
+		if (!victim || (s32)(cl->stamp - victim->stamp) < 0)
+			victim = cl;
+	}
+
+	if (victim->stamp) {
+		debug("evict: line " LBAF "\n", victim->line);
+		owner = cache_dev(victim->iftype, victim->devnum);
+		if (owner)
+			owner->stats.evictions++;
+		_stats.evictions++;
+	} else {
+		_stats.entries++;
+	}
+
+	victim->iftype = iftype;
+	victim->devnum = devnum;
+	victim->line = line;
+	victim->blksz = blksz;
+	victim->valid = 0;
+
+	return victim;
+}
+
+static inline void cache_touch(struct block_cache_line *cl)
+{
+	if (!++lru_clock)
+		lru_clock = 1;
+	cl->stamp = lru_clock;
+}
+
+/*
+ * Walk [start, start + blkcnt) one cache line at a time, setting @line to
+ * the line number, @first to the first block within the line and @n to the
+ * number of blocks of the range that fall into that line.
+ */
+#define for_each_line_span(start, blkcnt, bpl, line, first, n, done)	\
+	for (done = 0;							\
+	     done < (blkcnt) &&						\
+	     ((line) = ((start) + done) / (bpl),			\
+	      (first) = ((start) + done) % (bpl),			\
+	      (n) = min((lbaint_t)((bpl) - (first)), (blkcnt) - done),	\
+	      1);							\
+	     done += (n))
+
+static inline u32 span_mask(unsigned first, unsigned n)
+{
+	return (n >= 32 ? ~0U : ((1U << n) - 1)) << first;
 }
 
 int blkcache_read(int iftype, int devnum,
 		  lbaint_t start, lbaint_t blkcnt,
 		  unsigned long blksz, void *buffer)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
-	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
-		debug("hit: start " LBAF ", count " LBAFU "\n",
-		      start, blkcnt);
-		++_stats.hits;
-		return 1;
+	struct block_cache_dev *bcd;
+	struct block_cache_line *cl;
+	lbaint_t line, done, n;
+	unsigned bpl, first;
+	char *dst = buffer;
+
+	if (!cacheable_blksz(blksz) || !cache_init())
+		return 0;
+
+	bcd = cache_dev(iftype, devnum);
+	if (bcd) {
+		if (start == bcd->next) {
+			bcd->seq++;
+		} else {
+			bcd->seq = 0;
+			bcd->ra_bytes = 0;
+		}
+		bcd->next = start + blkcnt;
+	}
+
+	bpl = blocks_per_line(blksz);
+	for_each_line_span(start, blkcnt, bpl, line, first, n, done) {
+		u32 mask = span_mask(first, n);
+
+		cl = cache_find(iftype, devnum, line, blksz);
+		if (!cl || (cl->valid & mask) != mask) {
+			debug("miss: start " LBAF ", count " LBAFU "\n",
+			      start, blkcnt);
+			++_stats.misses;
+			if (bcd)
+				bcd->stats.misses++;
+			return 0;
+		}
+		memcpy(dst, cl->data + first * blksz, n * blksz);
+		dst += n * blksz;
+		cache_touch(cl);
 	}
 
-	debug("miss: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
-	++_stats.misses;
-	return 0;
+	debug("hit: start " LBAF ", count " LBAFU "\n", start, blkcnt);
+	++_stats.hits;
+	if (bcd)
+		bcd->stats.hits++;
+	return 1;
 }
 
 void blkcache_fill(int iftype, int devnum,
 		   lbaint_t start, lbaint_t blkcnt,
 		   unsigned long blksz, void const *buffer)
 {
-	lbaint_t bytes;
-	struct block_cache_node *node;
+	struct block_cache_line *cl;
+	lbaint_t line, done, n;
+	unsigned bpl, first;
+	const char *src = buffer;
 
-	/* don't cache big stuff */
-	if (blkcnt > _stats.max_blocks_per_entry)
+	if (!cacheable_blksz(blksz) || !cache_init())
 		return;
 
-	if (_stats.max_entries == 0)
+	/* bulk transfers larger than the read-ahead window bypass the cache */
+	if (blkcnt * blksz > max(_stats.readahead_kb << 10,
+				 (unsigned)BLKCACHE_LINE_SIZE))
 		return;
 
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
-		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
-		list_del(&node->lh);
-		_stats.entries--;
-		debug("drop: start " LBAF ", count " LBAFU "\n",
-		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
-			free(node->cache);
-			node->cache = 0;
-		}
-	} else {
-		node = malloc(sizeof(*node));
-		if (!node)
-			return;
-		node->cache = 0;
-	}
+	debug("fill: start " LBAF ", count " LBAFU "\n", start, blkcnt);
 
-	if (!node->cache) {
-		node->cache = malloc(bytes);
-		if (!node->cache) {
-			free(node);
-			return;
-		}
+	bpl = blocks_per_line(blksz);
+	for_each_line_span(start, blkcnt, bpl, line, first, n, done) {
+		cl = cache_find(iftype, devnum, line, blksz);
+		if (!cl)
+			cl = cache_alloc(iftype, devnum, line, blksz);
+		memcpy(cl->data + first * blksz, src, n * blksz);
+		cl->valid |= span_mask(first, n);
+		cache_touch(cl);
+		src += n * blksz;
 	}
+}
+
+static ulong cache_dev_read(struct blk_desc *block_dev, lbaint_t start,
+			    lbaint_t blkcnt, void *buffer)
+{
+#ifdef CONFIG_BLK
+	const struct blk_ops *ops = blk_get_ops(block_dev->bdev);
+
+	return ops->read(block_dev->bdev, start, blkcnt, buffer);
+#else
+	return block_dev->block_read(block_dev, start, blkcnt, buffer);
+#endif
+}
+
+ulong blkcache_readahead(struct blk_desc *block_dev, lbaint_t start,
+			 lbaint_t blkcnt, void *buffer)
+{
+	struct block_cache_dev *bcd;
+	unsigned long blksz = block_dev->blksz;
+	unsigned long ra_max = _stats.readahead_kb << 10;
+	lbaint_t total, blks_read;
+
+	if (!ra_buf || !cacheable_blksz(blksz))
+		return 0;
+
+	bcd = cache_dev(block_dev->if_type, block_dev->devnum);
+	if (!bcd || bcd->seq < BLKCACHE_SEQ_THRESHOLD)
+		return 0;
+	if (blkcnt * blksz >= ra_max)
+		return 0;
+	if (block_dev->lba && start >= block_dev->lba)
+		return 0;
 
-	debug("fill: start " LBAF ", count " LBAFU "\n",
-	      start, blkcnt);
+	/* ramp the window up while the stream stays sequential */
+	if (!bcd->ra_bytes)
+		bcd->ra_bytes = BLKCACHE_LINE_SIZE * BLKCACHE_WAYS;
+	else if (bcd->ra_bytes < ra_max)
+		bcd->ra_bytes *= 2;
+	bcd->ra_bytes = min(bcd->ra_bytes, (unsigned)ra_max);
 
-	node->iftype = iftype;
-	node->devnum = devnum;
-	node->start = start;
-	node->blkcnt = blkcnt;
-	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
-	list_add(&node->lh, &block_cache);
-	_stats.entries++;
+	total = max((lbaint_t)(bcd->ra_bytes / blksz), blkcnt + 1);
+	if (block_dev->lba && start + total > block_dev->lba)
+		total = block_dev->lba - start;
+	if (total <= blkcnt)
+		return 0;
+
+	blks_read = cache_dev_read(block_dev, start, total, ra_buf);
+	if (blks_read != total)
+		return 0;
+
+	debug("readahead: start " LBAF ", count " LBAFU "\n", start, total);
+	bcd->stats.readaheads++;
+	_stats.readaheads++;
+	blkcache_fill(block_dev->if_type, block_dev->devnum, start, total,
+		      blksz, ra_buf);
+	memcpy(buffer, ra_buf, blkcnt * blksz);
+
+	return blkcnt;
 }
 
 void blkcache_invalidate(int iftype, int devnum)
 {
-	struct list_head *entry, *n;
-	struct block_cache_node *node;
-
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
-			--_stats.entries;
+	struct block_cache_dev *bcd;
+	unsigned i;
+
+	if (lines) {
+		for (i = 0; i < num_sets * BLKCACHE_WAYS; i++) {
+			struct block_cache_line *cl = &lines[i];
+
+			if (cl->stamp && cl->iftype == iftype &&
+			    cl->devnum == devnum) {
+				cl->stamp = 0;
+				cl->valid = 0;
+				--_stats.entries;
+			}
 		}
 	}
-}
 
-void blkcache_configure(unsigned blocks, unsigned entries)
-{
-	struct block_cache_node *node;
-	if ((blocks != _stats.max_blocks_per_entry) ||
-	    (entries != _stats.max_entries)) {
-		/* invalidate cache */
-		while (!list_empty(&block_cache)) {
-			node = (struct block_cache_node *)block_cache.next;
-			list_del(&node->lh);
-			free(node->cache);
-			free(node);
+	list_for_each_entry(bcd, &block_cache_devs, lh) {
+		if (bcd->stats.iftype == iftype && bcd->stats.devnum == devnum) {
+			bcd->seq = 0;
+			bcd->ra_bytes = 0;
 		}
-		_stats.entries = 0;
 	}
+}
 
-	_stats.max_blocks_per_entry = blocks;
-	_stats.max_entries = entries;
+void blkcache_configure(unsigned megabytes, unsigned readahead_kb)
+{
+	struct block_cache_dev *bcd;
+
+	if (megabytes != _stats.size_mb ||
+	    readahead_kb != _stats.readahead_kb)
+		cache_free();
+
+	_stats.size_mb = megabytes;
+	_stats.readahead_kb = readahead_kb;
 
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.evictions = 0;
+	_stats.readaheads = 0;
+	list_for_each_entry(bcd, &block_cache_devs, lh) {
+		bcd->stats.hits = 0;
+		bcd->stats.misses = 0;
+		bcd->stats.evictions = 0;
+		bcd->stats.readaheads = 0;
+	}
 }
 
 void blkcache_stats(struct block_cache_stats *stats)
@@ -170,4 +429,24 @@ void blkcache_stats(struct block_cache_stats *stats)
 	memcpy(stats, &_stats, sizeof(*stats));
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.evictions = 0;
+	_stats.readaheads = 0;
+}
+
+int blkcache_dev_stats(int index, struct block_cache_dev_stats *stats)
+{
+	struct block_cache_dev *bcd;
+
+	list_for_each_entry(bcd, &block_cache_devs, lh) {
+		if (index--)
+			continue;
+		memcpy(stats, &bcd->stats, sizeof(*stats));
+		bcd->stats.hits = 0;
+		bcd->stats.misses = 0;
+		bcd->stats.evictions = 0;
+		bcd->stats.readaheads = 0;
+		return 0;
+	}
+
+	return -ENOENT;
 }
@@ -17,22 +17,104 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
+/* Alignment needed for O_DIRECT transfers, and the bounce buffer size */
+#define HOST_DIRECT_ALIGN	4096
+#define HOST_BOUNCE_SIZE	(256 << 10)
+
+/*
+ * Transfer through the bounce buffer, for O_DIRECT with an unaligned
+ * buffer. Returns the number of bytes transferred, or -1 on error.
+ */
+static ssize_t host_block_bounce(struct host_block_dev *host_dev, off_t offset,
+				 size_t size, void *buffer, bool write)
+{
+	size_t done, chunk;
+	ssize_t len;
+
+	for (done = 0; done < size; done += len) {
+		chunk = min_t(size_t, size - done, HOST_BOUNCE_SIZE);
+		if (write) {
+			memcpy(host_dev->bounce, buffer + done, chunk);
+			len = os_pwrite(host_dev->fd, host_dev->bounce, chunk,
+					offset + done);
+		} else {
+			len = os_pread(host_dev->fd, host_dev->bounce, chunk,
+				       offset + done);
+			if (len > 0)
+				memcpy(buffer + done, host_dev->bounce, len);
+		}
+		if (len < 0)
+			return -1;
+		if (len < chunk)
+			return done + len;
+	}
+
+	return done;
+}
+
+static long host_block_xfer(struct udevice *dev, lbaint_t start,
+			    lbaint_t blkcnt, void *buffer, bool write)
+{
+	struct host_block_dev *host_dev = dev_get_priv(dev);
+	struct blk_desc *block_dev = dev_get_uclass_platdata(dev);
+	off_t offset = (off_t)start * block_dev->blksz;
+	size_t size;
+	ssize_t len;
+
+	if (start > block_dev->lba) {
+		printf("ERROR: Invalid block " LBAF "\n", start);
+		return -1;
+	}
+	/* The backing file does not grow, so stop at the end of it */
+	blkcnt = min(blkcnt, block_dev->lba - start);
+	size = blkcnt * block_dev->blksz;
+
+	switch (host_dev->mode) {
+	case HOST_BLOCK_MMAP:
+		if (write)
+			memcpy(host_dev->map + offset, buffer, size);
+		else
+			memcpy(buffer, host_dev->map + offset, size);
+		return blkcnt;
+	case HOST_BLOCK_DIRECT:
+		if ((ulong)buffer & (HOST_DIRECT_ALIGN - 1)) {
+			len = host_block_bounce(host_dev, offset, size, buffer,
+						write);
+			break;
+		}
+		/* fall through */
+	default:
+		if (write)
+			len = os_pwrite(host_dev->fd, buffer, size, offset);
+		else
+			len = os_pread(host_dev->fd, buffer, size, offset);
+		break;
+	}
+	if (len < 0)
+		return -1;
+
+	return len / block_dev->blksz;
+}
+
 static unsigned long host_block_read(struct udevice *dev,
 				     unsigned long start, lbaint_t blkcnt,
 				     void *buffer)
 {
 	struct host_block_dev *host_dev = dev_get_priv(dev);
-	struct blk_desc *block_dev = dev_get_uclass_platdata(dev);
+	struct host_block_stats *stats = &host_dev->stats;
+	uint64_t base = os_get_nsec();
+	long count;
 
-	if (os_lseek(host_dev->fd, start * block_dev->blksz, OS_SEEK_SET) ==
-			-1) {
-		printf("ERROR: Invalid block %lx\n", start);
+	count = host_block_xfer(dev, start, blkcnt, buffer, false);
+	stats->read_nsec += os_get_nsec() - base;
+	stats->reads++;
+	if (count < 0) {
+		stats->errors++;
 		return -1;
 	}
-	ssize_t len = os_read(host_dev->fd, buffer, blkcnt * block_dev->blksz);
-	if (len >= 0)
-		return len / block_dev->blksz;
-	return -1;
+	stats->read_blocks += count;
+
+	return count;
 }
 
 static unsigned long host_block_write(struct udevice *dev,
@@ -40,25 +122,52 @@ static unsigned long host_block_write(struct udevice *dev,
 				      const void *buffer)
 {
 	struct host_block_dev *host_dev = dev_get_priv(dev);
-	struct blk_desc *block_dev = dev_get_uclass_platdata(dev);
+	struct host_block_stats *stats = &host_dev->stats;
+	uint64_t base = os_get_nsec();
+	long count;
 
-	if (os_lseek(host_dev->fd, start * block_dev->blksz, OS_SEEK_SET) ==
-			-1) {
-		printf("ERROR: Invalid block %lx\n", start);
+	count = host_block_xfer(dev, start, blkcnt, (void *)buffer, true);
+	stats->write_nsec += os_get_nsec() - base;
+	stats->writes++;
+	if (count < 0) {
+		stats->errors++;
 		return -1;
 	}
-	ssize_t len = os_write(host_dev->fd, buffer, blkcnt * block_dev->blksz);
-	if (len >= 0)
-		return len / block_dev->blksz;
-	return -1;
+	stats->write_blocks += count;
+
+	return count;
 }
 
-int host_dev_bind(int devnum, char *filename)
+static int host_block_probe(struct udevice *dev)
+{
+	struct host_block_dev *host_dev = dev_get_priv(dev);
+
+	host_dev->fd = -1;
+
+	return 0;
+}
+
+static int host_block_remove(struct udevice *dev)
+{
+	struct host_block_dev *host_dev = dev_get_priv(dev);
+
+	if (host_dev->map)
+		os_unmap_file(host_dev->map, host_dev->map_size);
+	free(host_dev->bounce);
+	if (host_dev->fd >= 0)
+		os_close(host_dev->fd);
+	free(host_dev->filename);
+
+	return 0;
+}
+
+int host_dev_bind_mode(int devnum, char *filename, enum host_block_mode mode)
 {
 	struct host_block_dev *host_dev;
 	struct udevice *dev;
 	char dev_name[20], *str, *fname;
-	int ret, fd;
+	int ret, fd, flags;
+	off_t size;
 
 	/* Remove and unbind the old device, if any */
 	ret = blk_get_device(IF_TYPE_HOST, devnum, &dev);
@@ -86,15 +195,18 @@ int host_dev_bind(int devnum, char *filename)
 		return -ENOMEM;
 	}
 
-	fd = os_open(filename, OS_O_RDWR);
+	flags = OS_O_RDWR;
+	if (mode == HOST_BLOCK_DIRECT)
+		flags |= OS_O_DIRECT;
+	fd = os_open(filename, flags);
 	if (fd == -1) {
 		printf("Failed to access host backing file '%s'\n", filename);
 		ret = -ENOENT;
 		goto err;
 	}
+	size = os_lseek(fd, 0, OS_SEEK_END);
 	ret = blk_create_device(gd->dm_root, "sandbox_host_blk", str,
-				IF_TYPE_HOST, devnum, 512,
-				os_lseek(fd, 0, OS_SEEK_END), &dev);
+				IF_TYPE_HOST, devnum, 512, size, &dev);
 	if (ret)
 		goto err_file;
 	ret = device_probe(dev);
@@ -103,11 +215,35 @@ int host_dev_bind(int devnum, char *filename)
 		goto err_file;
 	}
 
+	/* From here on, removing the device cleans up */
 	host_dev = dev_get_priv(dev);
 	host_dev->fd = fd;
 	host_dev->filename = fname;
+	host_dev->mode = mode;
+	if (mode == HOST_BLOCK_MMAP) {
+		host_dev->map = os_map_file(fd, size);
+		if (!host_dev->map) {
+			printf("Failed to map host backing file '%s'\n",
+			       filename);
+			ret = -EIO;
+			goto err_dev;
+		}
+		host_dev->map_size = size;
+	} else if (mode == HOST_BLOCK_DIRECT) {
+		host_dev->bounce = memalign(HOST_DIRECT_ALIGN,
+					    HOST_BOUNCE_SIZE);
+		if (!host_dev->bounce) {
+			ret = -ENOMEM;
+			goto err_dev;
+		}
+	}
 
 	return blk_prepare_device(dev);
+err_dev:
+	device_remove(dev);
+	device_unbind(dev);
+	free(str);
+	return ret;
 err_file:
 	os_close(fd);
 err:
@@ -116,6 +252,11 @@ err:
 	return ret;
 }
 
+int host_dev_bind(int devnum, char *filename)
+{
+	return host_dev_bind_mode(devnum, filename, HOST_BLOCK_PREAD);
+}
+
 int host_get_dev_err(int devnum, struct blk_desc **blk_devp)
 {
 	struct udevice *dev;
@@ -148,5 +289,7 @@ U_BOOT_DRIVER(sandbox_host_blk) = {
 	.name		= "sandbox_host_blk",
 	.id		= UCLASS_BLK,
 	.ops		= &sandbox_host_blk_ops,
+	.probe		= host_block_probe,
+	.remove		= host_block_remove,
 	.priv_auto_alloc_size	= sizeof(struct host_block_dev),
 };
@@ -7,7 +7,9 @@
 #include <common.h>
 #include <dm.h>
 #include <mapmem.h>
+#include <div64.h>
 #include <dm/root.h>
+#include <dm/uclass-internal.h>
 
 static void show_devices(struct udevice *dev, int depth, int last_flag)
 {
@@ -94,3 +96,31 @@ void dm_dump_uclass(void)
 		puts("\n");
 	}
 }
+
+void dm_dump_stats(void)
+{
+	static const char *const names[DM_LOOKUP_COUNT] = {
+		"uclass", "seq", "of_offset", "name",
+	};
+	struct dm_lookup_stats *stats = dm_get_lookup_stats();
+	ulong rate = get_tbclk();
+	int i;
+
+	if (!stats) {
+		puts("No lookup statistics (CONFIG_DM_STATS not enabled)\n");
+		return;
+	}
+
+	printf("Lookup        Count    Time (us)\n");
+	printf("--------------------------------\n");
+	for (i = 0; i < DM_LOOKUP_COUNT; i++) {
+		u64 us = stats->ticks[i] * 1000000;
+
+		if (rate)
+			do_div(us, rate);
+		printf("%-10s %8lu %12llu\n", names[i], stats->count[i],
+		       (unsigned long long)us);
+	}
+	printf("Maps built: %lu, map misses: %lu\n", stats->map_builds,
+	       stats->map_misses);
+}
@@ -17,6 +17,9 @@
 #include <dm/util.h>
 #include <fdtdec.h>
 #include <linux/compiler.h>
+#include <linux/err.h>
+
+DECLARE_GLOBAL_DATA_PTR;
 
 struct driver *lists_driver_lookup_name(const char *name)
 {
@@ -138,57 +141,269 @@ static int driver_check_compatible(const void *blob, int offset,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, const void *blob, int offset,
-		   struct udevice **devp)
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+#define COMPAT_END	0xffff
+
+/**
+ * struct compat_entry - A compatible string in a driver's of_match table
+ *
+ * @drv:	Driver which has the string
+ * @match:	Index of the string in the driver's of_match table
+ * @next:	Next entry in the same hash chain, or COMPAT_END
+ */
+struct compat_entry {
+	struct driver *drv;
+	u16 match;
+	u16 next;
+};
+
+/**
+ * struct lists_compat_index - Hash of all compatible strings in the drivers
+ *
+ * This is built on the first call to lists_bind_fdt(), so that binding a
+ * node needs a lookup for each of its compatible strings rather than a
+ * string comparison against every of_match entry of every driver.
+ *
+ * @mask:	Number of hash chains - 1
+ * @head:	First entry of each hash chain, or COMPAT_END
+ * @entry:	All entries, in driver and of_match order, so that a lower
+ *		entry is the better match
+ */
+struct lists_compat_index {
+	uint mask;
+	u16 *head;
+	struct compat_entry entry[0];
+};
+
+static uint compat_hash(const char *str, int len)
+{
+	uint hash = 5381;
+
+	while (len-- && *str)
+		hash = hash * 33 ^ (uchar)*str++;
+
+	return hash;
+}
+
+/* Number of entries in a driver's of_match table */
+static int compat_count(const struct udevice_id *of_match)
+{
+	int count = 0;
+
+	while (of_match && of_match[count].compatible)
+		count++;
+
+	return count;
+}
+
+/*
+ * The index is built on first use. If that fails, gd->compat_index holds an
+ * error pointer so that the drivers are scanned in turn without trying again.
+ */
+static struct lists_compat_index *lists_get_compat_index(void)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *of_match;
+	struct lists_compat_index *idx;
+	struct compat_entry *ent;
+	struct driver *entry;
+	int count = 0, match;
+	uint buckets, hash;
+
+	if (gd->compat_index)
+		return IS_ERR(gd->compat_index) ? NULL : gd->compat_index;
+
+	for (entry = driver; entry != driver + n_ents; entry++)
+		count += compat_count(entry->of_match);
+	if (count >= COMPAT_END) {
+		gd->compat_index = ERR_PTR(-E2BIG);
+		return NULL;
+	}
+	for (buckets = 16; buckets < count; buckets <<= 1)
+		;
+
+	idx = malloc(sizeof(*idx) + count * sizeof(struct compat_entry) +
+		     buckets * sizeof(u16));
+	if (!idx) {
+		gd->compat_index = ERR_PTR(-ENOMEM);
+		return NULL;
+	}
+	idx->mask = buckets - 1;
+	idx->head = (u16 *)&idx->entry[count];
+	memset(idx->head, '\xff', buckets * sizeof(u16));
+
+	/*
+	 * Add the entries in reverse so that each chain ends up in driver
+	 * and of_match order
+	 */
+	ent = &idx->entry[count];
+	for (entry = driver + n_ents; entry != driver;) {
+		entry--;
+		of_match = entry->of_match;
+		for (match = compat_count(of_match); match--;) {
+			ent--;
+			hash = compat_hash(of_match[match].compatible, -1) &
+				idx->mask;
+			ent->drv = entry;
+			ent->match = match;
+			ent->next = idx->head[hash];
+			idx->head[hash] = ent - idx->entry;
+		}
+	}
+	gd->compat_index = idx;
+
+	return idx;
+}
+
+/**
+ * lists_find_driver() - Find the driver to bind to a device tree node
+ *
+ * This uses the compatible-string index. As with a scan of the driver list,
+ * the first driver in the linker list that matches any of the node's
+ * compatible strings is used.
+ *
+ * @idx:	Compatible-string index
+ * @blob:	Device tree pointer
+ * @offset:	Offset of node in device tree
+ * @drvp:	Returns the driver that was found
+ * @of_idp:	Returns the match that was found
+ * @return 0 if there is a match, -ENOENT if no match, -ENODEV if the node
+ * does not have a compatible string, other error <0 if there is a device
+ * tree error
+ */
+static int lists_find_driver(struct lists_compat_index *idx, const void *blob,
+			     int offset, struct driver **drvp,
+			     const struct udevice_id **of_idp)
+{
+	struct compat_entry *ent, *best = NULL;
+	const struct udevice_id *id;
+	const char *compat, *end;
+	int len, slen;
+	uint i;
+
+	compat = fdt_getprop(blob, offset, "compatible", &len);
+	if (!compat)
+		return len == -FDT_ERR_NOTFOUND ? -ENODEV : -EINVAL;
+
+	for (end = compat + len; compat < end; compat += slen + 1) {
+		slen = strnlen(compat, end - compat);
+		for (i = idx->head[compat_hash(compat, slen) & idx->mask];
+		     i != COMPAT_END; i = ent->next) {
+			ent = &idx->entry[i];
+			if (best && ent > best)
+				break;
+			id = &ent->drv->of_match[ent->match];
+			if (!strncmp(id->compatible, compat, slen) &&
+			    !id->compatible[slen])
+				best = ent;
+		}
+	}
+	if (!best)
+		return -ENOENT;
+	*drvp = best->drv;
+	*of_idp = &best->drv->of_match[best->match];
+
+	return 0;
+}
+#else
+static inline struct lists_compat_index *lists_get_compat_index(void)
+{
+	return NULL;
+}
+
+static inline int lists_find_driver(struct lists_compat_index *idx,
+				    const void *blob, int offset,
+				    struct driver **drvp,
+				    const struct udevice_id **of_idp)
+{
+	return -ENOSYS;
+}
+#endif
+
+/**
+ * lists_scan_drivers() - Find the driver to bind to a device tree node
+ *
+ * This checks the of_match table of each driver in turn.
+ *
+ * @blob:	Device tree pointer
+ * @offset:	Offset of node in device tree
+ * @drvp:	Returns the driver that was found
+ * @of_idp:	Returns the match that was found
+ * @return 0 if there is a match, -ENOENT if no match, -ENODEV if the node
+ * does not have a compatible string, other error <0 if there is a device
+ * tree error
+ */
+static int lists_scan_drivers(const void *blob, int offset,
+			      struct driver **drvp,
+			      const struct udevice_id **of_idp)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	struct driver *entry;
+	int ret = -ENOENT;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		ret = driver_check_compatible(blob, offset, entry->of_match,
+					      of_idp);
+		if (ret == -ENOENT)
+			continue;
+		if (!ret)
+			*drvp = entry;
+		break;
+	}
+
+	return ret;
+}
+
+int lists_find_fdt_driver(const void *blob, int offset, bool scan,
+			  struct driver **drvp,
+			  const struct udevice_id **of_idp)
+{
+	struct lists_compat_index *idx;
+
+	idx = scan ? NULL : lists_get_compat_index();
+	if (idx)
+		return lists_find_driver(idx, blob, offset, drvp, of_idp);
+
+	return lists_scan_drivers(blob, offset, drvp, of_idp);
+}
+
+int lists_bind_fdt(struct udevice *parent, const void *blob, int offset,
+		   struct udevice **devp)
+{
 	const struct udevice_id *id;
 	struct driver *entry;
 	struct udevice *dev;
-	bool found = false;
 	const char *name;
-	int result = 0;
-	int ret = 0;
+	int ret;
 
 	dm_dbg("bind node %s\n", fdt_get_name(blob, offset, NULL));
 	if (devp)
 		*devp = NULL;
-	for (entry = driver; entry != driver + n_ents; entry++) {
-		ret = driver_check_compatible(blob, offset, entry->of_match,
-					      &id);
-		name = fdt_get_name(blob, offset, NULL);
-		if (ret == -ENOENT) {
-			continue;
-		} else if (ret == -ENODEV) {
-			dm_dbg("Device '%s' has no compatible string\n", name);
-			break;
-		} else if (ret) {
-			dm_warn("Device tree error at offset %d\n", offset);
-			result = ret;
-			break;
-		}
-
-		dm_dbg("   - found match at '%s'\n", entry->name);
-		ret = device_bind(parent, entry, name, NULL, offset, &dev);
-		if (ret) {
-			dm_warn("Error binding driver '%s': %d\n", entry->name,
-				ret);
-			return ret;
-		} else {
-			dev->driver_data = id->data;
-			found = true;
-			if (devp)
-				*devp = dev;
-		}
-		break;
+	name = fdt_get_name(blob, offset, NULL);
+	ret = lists_find_fdt_driver(blob, offset, false, &entry, &id);
+	if (ret == -ENOENT) {
+		dm_dbg("No match for node '%s'\n", name);
+		return 0;
+	} else if (ret == -ENODEV) {
+		dm_dbg("Device '%s' has no compatible string\n", name);
+		return 0;
+	} else if (ret) {
+		dm_warn("Device tree error at offset %d\n", offset);
+		return ret;
 	}
 
-	if (!found && !result && ret != -ENODEV) {
-		dm_dbg("No match for node '%s'\n",
-		       fdt_get_name(blob, offset, NULL));
+	dm_dbg("   - found match at '%s'\n", entry->name);
+	ret = device_bind(parent, entry, name, NULL, offset, &dev);
+	if (ret) {
+		dm_warn("Error binding driver '%s': %d\n", entry->name, ret);
+		return ret;
 	}
+	dev->driver_data = id->data;
+	if (devp)
+		*devp = dev;
 
-	return result;
+	return 0;
 }
 #endif
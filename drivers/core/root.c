@@ -18,6 +18,7 @@
 #include <dm/platdata.h>
 #include <dm/root.h>
 #include <dm/uclass.h>
+#include <dm/uclass-internal.h>
 #include <dm/util.h>
 #include <linux/list.h>
 
@@ -133,6 +134,7 @@ int dm_init(void)
 		return -EINVAL;
 	}
 	INIT_LIST_HEAD(&DM_UCLASS_ROOT_NON_CONST);
+	uclass_table_init();
 
 #if defined(CONFIG_NEEDS_MANUAL_RELOC)
 	fix_drivers();
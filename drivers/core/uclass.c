@@ -19,17 +19,86 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
-struct uclass *uclass_find(enum uclass_id key)
+#if CONFIG_IS_ENABLED(DM_STATS)
+struct dm_lookup_stats *dm_get_lookup_stats(void)
+{
+	return gd->uclass_table ? &gd->uclass_table->stats : NULL;
+}
+
+static u64 dm_stats_start(void)
+{
+	struct dm_lookup_stats *stats = dm_get_lookup_stats();
+	u64 start;
+
+	if (!stats || stats->busy)
+		return 0;
+	stats->busy = true;
+	start = get_ticks();
+	stats->busy = false;
+
+	return start;
+}
+
+static void dm_stats_end(enum dm_lookup_t type, u64 start)
+{
+	struct dm_lookup_stats *stats = dm_get_lookup_stats();
+
+	if (!stats || stats->busy)
+		return;
+	stats->busy = true;
+	stats->ticks[type] += get_ticks() - start;
+	stats->busy = false;
+	stats->count[type]++;
+}
+
+#define dm_stats_inc_field(field)					\
+	do {								\
+		if (gd->uclass_table)					\
+			gd->uclass_table->stats.field++;		\
+	} while (0)
+#else
+struct dm_lookup_stats *dm_get_lookup_stats(void)
+{
+	return NULL;
+}
+
+static inline u64 dm_stats_start(void)
+{
+	return 0;
+}
+
+static inline void dm_stats_end(enum dm_lookup_t type, u64 start)
+{
+}
+
+#define dm_stats_inc_field(field)	do { } while (0)
+#endif
+
+void uclass_table_init(void)
+{
+	/*
+	 * The table is never allocated from the small pre-relocation
+	 * malloc() area, so one left by an earlier dm_init() can be freed
+	 */
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT)) {
+		gd->uclass_table = NULL;
+		return;
+	}
+	free(gd->uclass_table);
+	gd->uclass_table = calloc(1, sizeof(*gd->uclass_table));
+}
+
+static struct uclass *_uclass_find(enum uclass_id key)
 {
 	struct uclass *uc;
 
 	if (!gd->dm_root)
 		return NULL;
-	/*
-	 * TODO(sjg@chromium.org): Optimise this, perhaps moving the found
-	 * node to the start of the list, or creating a linear array mapping
-	 * id to node.
-	 */
+	if (gd->uclass_table) {
+		if (key < 0 || key >= UCLASS_COUNT)
+			return NULL;
+		return gd->uclass_table->uclass[key];
+	}
 	list_for_each_entry(uc, &gd->uclass_root, sibling_node) {
 		if (uc->uc_drv->id == key)
 			return uc;
@@ -38,6 +107,124 @@ struct uclass *uclass_find(enum uclass_id key)
 	return NULL;
 }
 
+struct uclass *uclass_find(enum uclass_id key)
+{
+	u64 start = dm_stats_start();
+	struct uclass *uc;
+
+	uc = _uclass_find(key);
+	dm_stats_end(DM_LOOKUP_UCLASS, start);
+
+	return uc;
+}
+
+static int uclass_map_key(struct udevice *dev, enum uclass_map_id map_id)
+{
+	switch (map_id) {
+	case UCLASS_MAP_SEQ:
+		return dev->seq;
+	case UCLASS_MAP_REQ_SEQ:
+		return dev->req_seq;
+	default:
+		return dev->of_offset;
+	}
+}
+
+static uint uclass_map_hash(struct uclass_map *map, int key)
+{
+	return ((uint)key * 0x9e3779b1) & (map->size - 1);
+}
+
+static void uclass_map_insert(struct uclass_map *map, int key,
+			      struct udevice *dev)
+{
+	uint i;
+
+	for (i = uclass_map_hash(map, key); map->entry[i].key != -1;
+	     i = (i + 1) & (map->size - 1)) {
+		/* The first device in the uclass list wins */
+		if (map->entry[i].key == key)
+			return;
+	}
+	map->entry[i].key = key;
+	map->entry[i].dev = dev;
+	map->count++;
+}
+
+static struct udevice *uclass_map_lookup(struct uclass_map *map, int key)
+{
+	uint i;
+
+	for (i = uclass_map_hash(map, key); map->entry[i].key != -1;
+	     i = (i + 1) & (map->size - 1)) {
+		if (map->entry[i].key == key)
+			return map->entry[i].dev;
+	}
+
+	return NULL;
+}
+
+static void uclass_map_free(struct uclass_map *map)
+{
+	free(map->entry);
+	map->entry = NULL;
+	map->size = 0;
+	map->count = 0;
+}
+
+/* Drop all lookup maps, after a device is bound or unbound */
+static void uclass_map_invalidate(struct uclass *uc)
+{
+	int i;
+
+	for (i = 0; i < UCLASS_MAP_COUNT; i++)
+		uclass_map_free(&uc->map[i]);
+}
+
+/**
+ * uclass_map_get() - Get a lookup map for a uclass, building it if needed
+ *
+ * Maps are only used once full malloc() is available, since they are
+ * rebuilt as devices come and go.
+ *
+ * @uc: uclass to look in
+ * @map_id: Key to index the devices by
+ * @return map, or NULL if none is available
+ */
+static struct uclass_map *uclass_map_get(struct uclass *uc,
+					 enum uclass_map_id map_id)
+{
+	struct uclass_map *map = &uc->map[map_id];
+	struct udevice *dev;
+	int size, i;
+
+	if (map->size)
+		return map;
+	if (!gd->uclass_table)
+		return NULL;
+
+	/* Leave room for the sequence numbers allocated by probing */
+	size = 16;
+	while (size < 2 * list_count_items(&uc->dev_head))
+		size <<= 1;
+	map->entry = malloc(size * sizeof(*map->entry));
+	if (!map->entry)
+		return NULL;
+	for (i = 0; i < size; i++)
+		map->entry[i].key = -1;
+	map->size = size;
+
+	list_for_each_entry(dev, &uc->dev_head, uclass_node) {
+		int key = uclass_map_key(dev, map_id);
+
+		if (key >= 0)
+			uclass_map_insert(map, key, dev);
+	}
+	dm_stats_inc_field(map_builds);
+
+	return map;
+}
+
 /**
  * uclass_add() - Create new uclass in list
  * @id: Id number to create
@@ -79,6 +266,8 @@ static int uclass_add(enum uclass_id id, struct uclass **ucp)
 	INIT_LIST_HEAD(&uc->sibling_node);
 	INIT_LIST_HEAD(&uc->dev_head);
 	list_add(&uc->sibling_node, &DM_UCLASS_ROOT_NON_CONST);
+	if (gd->uclass_table)
+		gd->uclass_table->uclass[id] = uc;
 
 	if (uc_drv->init) {
 		ret = uc_drv->init(uc);
@@ -95,6 +284,8 @@ fail:
 		uc->priv = NULL;
 	}
 	list_del(&uc->sibling_node);
+	if (gd->uclass_table)
+		gd->uclass_table->uclass[id] = NULL;
 fail_mem:
 	free(uc);
 
@@ -128,6 +319,10 @@ int uclass_destroy(struct uclass *uc)
 	if (uc_drv->destroy)
 		uc_drv->destroy(uc);
 	list_del(&uc->sibling_node);
+	if (gd->uclass_table && uc_drv->id >= 0 && uc_drv->id < UCLASS_COUNT &&
+	    gd->uclass_table->uclass[uc_drv->id] == uc)
+		gd->uclass_table->uclass[uc_drv->id] = NULL;
+	uclass_map_invalidate(uc);
 	if (uc_drv->priv_auto_alloc_size)
 		free(uc->priv);
 	free(uc);
@@ -201,8 +396,8 @@ int uclass_find_next_device(struct udevice **devp)
 	return 0;
 }
 
-int uclass_find_device_by_name(enum uclass_id id, const char *name,
-			       struct udevice **devp)
+static int _uclass_find_device_by_name(enum uclass_id id, const char *name,
+				       struct udevice **devp)
 {
 	struct uclass *uc;
 	struct udevice *dev;
@@ -225,9 +420,22 @@ int uclass_find_device_by_name(enum uclass_id id, const char *name,
 	return -ENODEV;
 }
 
-int uclass_find_device_by_seq(enum uclass_id id, int seq_or_req_seq,
-			      bool find_req_seq, struct udevice **devp)
+int uclass_find_device_by_name(enum uclass_id id, const char *name,
+			       struct udevice **devp)
 {
+	u64 start = dm_stats_start();
+	int ret;
+
+	ret = _uclass_find_device_by_name(id, name, devp);
+	dm_stats_end(DM_LOOKUP_NAME, start);
+
+	return ret;
+}
+
+static int _uclass_find_device_by_seq(enum uclass_id id, int seq_or_req_seq,
+				      bool find_req_seq, struct udevice **devp)
+{
+	struct uclass_map *map;
 	struct uclass *uc;
 	struct udevice *dev;
 	int ret;
@@ -240,6 +448,26 @@ int uclass_find_device_by_seq(enum uclass_id id, int seq_or_req_seq,
 	if (ret)
 		return ret;
 
+	map = uclass_map_get(uc, find_req_seq ? UCLASS_MAP_REQ_SEQ :
+			     UCLASS_MAP_SEQ);
+	if (map) {
+		dev = uclass_map_lookup(map, seq_or_req_seq);
+		/*
+		 * dev->seq only changes through uclass_set_seq(), so the seq
+		 * map is complete. A driver may set req_seq after binding, so
+		 * check a req_seq hit and look further on a miss.
+		 */
+		if (!find_req_seq) {
+			*devp = dev;
+			return dev ? 0 : -ENODEV;
+		}
+		if (dev && dev->req_seq == seq_or_req_seq) {
+			*devp = dev;
+			return 0;
+		}
+		dm_stats_inc_field(map_misses);
+	}
+
 	list_for_each_entry(dev, &uc->dev_head, uclass_node) {
 		debug("   - %d %d\n", dev->req_seq, dev->seq);
 		if ((find_req_seq ? dev->req_seq : dev->seq) ==
@@ -254,9 +482,23 @@ int uclass_find_device_by_seq(enum uclass_id id, int seq_or_req_seq,
 	return -ENODEV;
 }
 
-int uclass_find_device_by_of_offset(enum uclass_id id, int node,
-				    struct udevice **devp)
+int uclass_find_device_by_seq(enum uclass_id id, int seq_or_req_seq,
+			      bool find_req_seq, struct udevice **devp)
 {
+	u64 start = dm_stats_start();
+	int ret;
+
+	ret = _uclass_find_device_by_seq(id, seq_or_req_seq, find_req_seq,
+					 devp);
+	dm_stats_end(DM_LOOKUP_SEQ, start);
+
+	return ret;
+}
+
+static int _uclass_find_device_by_of_offset(enum uclass_id id, int node,
+					    struct udevice **devp)
+{
+	struct uclass_map *map;
 	struct uclass *uc;
 	struct udevice *dev;
 	int ret;
@@ -268,6 +510,20 @@ int uclass_find_device_by_of_offset(enum uclass_id id, int node,
 	if (ret)
 		return ret;
 
+	/*
+	 * Some drivers set of_offset after binding a device, so check a hit
+	 * and fall back to the list on a miss
+	 */
+	map = uclass_map_get(uc, UCLASS_MAP_OF_OFFSET);
+	if (map) {
+		dev = uclass_map_lookup(map, node);
+		if (dev && dev->of_offset == node) {
+			*devp = dev;
+			return 0;
+		}
+		dm_stats_inc_field(map_misses);
+	}
+
 	list_for_each_entry(dev, &uc->dev_head, uclass_node) {
 		if (dev->of_offset == node) {
 			*devp = dev;
@@ -278,6 +534,18 @@ int uclass_find_device_by_of_offset(enum uclass_id id, int node,
 	return -ENODEV;
 }
 
+int uclass_find_device_by_of_offset(enum uclass_id id, int node,
+				    struct udevice **devp)
+{
+	u64 start = dm_stats_start();
+	int ret;
+
+	ret = _uclass_find_device_by_of_offset(id, node, devp);
+	dm_stats_end(DM_LOOKUP_OF_OFFSET, start);
+
+	return ret;
+}
+
 #if CONFIG_IS_ENABLED(OF_CONTROL)
 static int uclass_find_device_by_phandle(enum uclass_id id,
 					 struct udevice *parent,
@@ -433,6 +701,7 @@ int uclass_bind_device(struct udevice *dev)
 
 	uc = dev->uclass;
 	list_add_tail(&dev->uclass_node, &uc->dev_head);
+	uclass_map_invalidate(uc);
 
 	if (dev->parent) {
 		struct uclass_driver *uc_drv = dev->parent->uclass->uc_drv;
@@ -448,6 +717,7 @@ int uclass_bind_device(struct udevice *dev)
 err:
 	/* There is no need to undo the parent's post_bind call */
 	list_del(&dev->uclass_node);
+	uclass_map_invalidate(uc);
 
 	return ret;
 }
@@ -466,10 +736,27 @@ int uclass_unbind_device(struct udevice *dev)
 	}
 
 	list_del(&dev->uclass_node);
+	uclass_map_invalidate(uc);
 	return 0;
 }
 #endif
 
+void uclass_set_seq(struct udevice *dev, int seq)
+{
+	struct uclass_map *map = &dev->uclass->map[UCLASS_MAP_SEQ];
+
+	if (dev->seq == seq)
+		return;
+	if (map->size) {
+		/* Entries cannot be removed, so drop the map in that case */
+		if (dev->seq != -1 || 2 * (map->count + 1) > map->size)
+			uclass_map_free(map);
+		else
+			uclass_map_insert(map, seq, dev);
+	}
+	dev->seq = seq;
+}
+
 int uclass_resolve_seq(struct udevice *dev)
 {
 	struct udevice *dup;
@@ -8,6 +8,7 @@
  */
 
 #include <common.h>
+#include <div64.h>
 #include <errno.h>
 #include <malloc.h>
 #include <mmc.h>
@@ -107,7 +108,7 @@ unsigned char *dfu_get_buf(struct dfu_entity *dfu)
 	if (dfu->max_buf_size && dfu_buf_size > dfu->max_buf_size)
 		dfu_buf_size = dfu->max_buf_size;
 
-	dfu_buf = memalign(CONFIG_SYS_CACHELINE_SIZE, dfu_buf_size);
+	dfu_buf = memalign(ARCH_DMA_MINALIGN, dfu_buf_size);
 	if (dfu_buf == NULL)
 		printf("%s: Could not memalign 0x%lx bytes\n",
 		       __func__, dfu_buf_size);
@@ -134,6 +135,8 @@ static char *dfu_get_hash_algo(void)
 
 static int dfu_write_buffer_drain(struct dfu_entity *dfu)
 {
+	struct dfu_stats *stats = &dfu->stats;
+	ulong start, us;
 	long w_size;
 	int ret;
 
@@ -146,9 +149,16 @@ static int dfu_write_buffer_drain(struct dfu_entity *dfu)
 		dfu_hash_algo->hash_update(dfu_hash_algo, &dfu->crc,
 					   dfu->i_buf_start, w_size, 0);
 
+	start = timer_get_us();
 	ret = dfu->write_medium(dfu, dfu->offset, dfu->i_buf_start, &w_size);
+	us = timer_get_us() - start;
+	stats->writes++;
+	stats->write_us += us;
+	stats->max_write_us = max(stats->max_write_us, us);
 	if (ret)
 		debug("%s: Write error!\n", __func__);
+	else
+		stats->bytes += w_size;
 
 	/* point back */
 	dfu->i_buf = dfu->i_buf_start;
@@ -161,6 +171,17 @@ static int dfu_write_buffer_drain(struct dfu_entity *dfu)
 	return ret;
 }
 
+static void dfu_show_stats(struct dfu_entity *dfu)
+{
+	struct dfu_stats *stats = &dfu->stats;
+
+	printf("\nDFU %s: %llu bytes in %lu ms (%lu KiB/s), %lu writes taking %lu ms (max %lu us)\n",
+	       dfu->name, stats->bytes, stats->total_us / 1000,
+	       (ulong)lldiv((stats->bytes >> 10) * 1000000,
+			    max(stats->total_us, 1UL)),
+	       stats->writes, stats->write_us / 1000, stats->max_write_us);
+}
+
 void dfu_write_transaction_cleanup(struct dfu_entity *dfu)
 {
 	/* clear everything */
@@ -188,6 +209,11 @@ int dfu_flush(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 		printf("\nDFU complete %s: 0x%08x\n", dfu_hash_algo->name,
 		       dfu->crc);
 
+	if (dfu->inited) {
+		dfu->stats.total_us = timer_get_us() - dfu->start_us;
+		dfu_show_stats(dfu);
+	}
+
 	dfu_write_transaction_cleanup(dfu);
 
 	return ret;
@@ -212,6 +238,8 @@ int dfu_write(struct dfu_entity *dfu, void *buf, int size, int blk_seq_num)
 			return -ENOMEM;
 		dfu->i_buf_end = dfu_get_buf(dfu) + dfu_buf_size;
 		dfu->i_buf = dfu->i_buf_start;
+		memset(&dfu->stats, '\0', sizeof(dfu->stats));
+		dfu->start_us = timer_get_us();
 
 		dfu->inited = 1;
 	}
@@ -13,6 +13,7 @@
 #include <malloc.h>
 #include <errno.h>
 #include <dfu.h>
+#include <mapmem.h>
 
 static int dfu_transfer_medium_ram(enum dfu_op op, struct dfu_entity *dfu,
 				   u64 offset, void *buf, long *len)
@@ -54,6 +55,7 @@ static int dfu_read_medium_ram(struct dfu_entity *dfu, u64 offset,
 
 int dfu_fill_entity_ram(struct dfu_entity *dfu, char *devstr, char *s)
 {
+	ulong addr;
 	char *st;
 
 	dfu->dev_type = DFU_DEV_RAM;
@@ -64,9 +66,10 @@ int dfu_fill_entity_ram(struct dfu_entity *dfu, char *devstr, char *s)
 	}
 
 	dfu->layout = DFU_RAM_ADDR;
-	dfu->data.ram.start = (void *)simple_strtoul(s, &s, 16);
+	addr = simple_strtoul(s, &s, 16);
 	s++;
 	dfu->data.ram.size = simple_strtoul(s, &s, 16);
+	dfu->data.ram.start = map_sysmem(addr, dfu->data.ram.size);
 
 	dfu->write_medium = dfu_write_medium_ram;
 	dfu->get_medium_size = dfu_get_medium_size_ram;
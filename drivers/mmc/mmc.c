@@ -525,9 +525,14 @@ static int mmc_change_freq(struct mmc *mmc)
 	if (err)
 		return err;
 
-	cardtype = ext_csd[EXT_CSD_CARD_TYPE] & 0xf;
+	cardtype = ext_csd[EXT_CSD_CARD_TYPE] & 0x3f;
 
-	err = mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL, EXT_CSD_HS_TIMING, 1);
+	/* Stay with legacy timing if high speed has been turned off */
+	if (mmc->disabled_caps & MMC_MODE_HS)
+		return 0;
+
+	err = mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL, EXT_CSD_HS_TIMING,
+			 EXT_CSD_TIMING_HS);
 
 	if (err)
 		return err == SWITCH_ERR ? 0 : err;
@@ -546,6 +551,8 @@ static int mmc_change_freq(struct mmc *mmc)
 	if (cardtype & EXT_CSD_CARD_TYPE_52) {
 		if (cardtype & EXT_CSD_CARD_TYPE_DDR_1_8V)
 			mmc->card_caps |= MMC_MODE_DDR_52MHz;
+		if (cardtype & EXT_CSD_CARD_TYPE_HS200_1_8V)
+			mmc->card_caps |= MMC_MODE_HS200;
 		mmc->card_caps |= MMC_MODE_HS_52MHz | MMC_MODE_HS;
 	} else {
 		mmc->card_caps |= MMC_MODE_HS;
@@ -1028,6 +1035,254 @@ static void mmc_set_bus_width(struct mmc *mmc, uint width)
 	mmc_set_ios(mmc);
 }
 
+const char *mmc_mode_name(enum bus_mode mode)
+{
+	static const char *const names[] = {
+		[MMC_LEGACY]	= "MMC legacy",
+		[SD_LEGACY]	= "SD Legacy",
+		[MMC_HS]	= "MMC High Speed (26MHz)",
+		[SD_HS]		= "SD High Speed (50MHz)",
+		[MMC_HS_52]	= "MMC High Speed (52MHz)",
+		[MMC_DDR_52]	= "MMC DDR52 (52MHz)",
+		[MMC_HS_200]	= "HS200 (200MHz)",
+	};
+
+	if (mode >= MMC_MODES_END)
+		return "Unknown mode";
+
+	return names[mode];
+}
+
+void mmc_set_max_mode(struct mmc *mmc, enum bus_mode mode)
+{
+	uint caps = 0;
+
+	/* Turn off the capabilities needed by each faster mode */
+	switch (mode) {
+	case MMC_LEGACY:
+	case SD_LEGACY:
+		caps |= MMC_MODE_HS;
+		/* fall through */
+	case MMC_HS:
+	case SD_HS:
+		caps |= MMC_MODE_HS_52MHz;
+		/* fall through */
+	case MMC_HS_52:
+		caps |= MMC_MODE_DDR_52MHz;
+		/* fall through */
+	case MMC_DDR_52:
+		caps |= MMC_MODE_HS200;
+		break;
+	default:
+		break;
+	}
+	mmc->disabled_caps = caps;
+}
+
+const u8 tuning_blk_pattern_4bit[MMC_TUNING_BLK_PATTERN_4BIT_SIZE] = {
+	0xff, 0x0f, 0xff, 0x00, 0xff, 0xcc, 0xc3, 0xcc,
+	0xc3, 0x3c, 0xcc, 0xff, 0xfe, 0xff, 0xfe, 0xef,
+	0xff, 0xdf, 0xff, 0xdd, 0xff, 0xfb, 0xff, 0xfb,
+	0xbf, 0xff, 0x7f, 0xff, 0x77, 0xf7, 0xbd, 0xef,
+	0xff, 0xf0, 0xff, 0xf0, 0x0f, 0xfc, 0xcc, 0x3c,
+	0xcc, 0x33, 0xcc, 0xcf, 0xff, 0xef, 0xff, 0xee,
+	0xff, 0xfd, 0xff, 0xfd, 0xdf, 0xff, 0xbf, 0xff,
+	0xbb, 0xff, 0xf7, 0xff, 0xf7, 0x7f, 0x7b, 0xde,
+};
+
+const u8 tuning_blk_pattern_8bit[MMC_TUNING_BLK_PATTERN_8BIT_SIZE] = {
+	0xff, 0xff, 0x00, 0xff, 0xff, 0xff, 0x00, 0x00,
+	0xff, 0xff, 0xcc, 0xcc, 0xcc, 0x33, 0xcc, 0xcc,
+	0xcc, 0x33, 0x33, 0xcc, 0xcc, 0xcc, 0xff, 0xff,
+	0xff, 0xee, 0xff, 0xff, 0xff, 0xee, 0xee, 0xff,
+	0xff, 0xff, 0xdd, 0xff, 0xff, 0xff, 0xdd, 0xdd,
+	0xff, 0xff, 0xff, 0xbb, 0xff, 0xff, 0xff, 0xbb,
+	0xbb, 0xff, 0xff, 0xff, 0x77, 0xff, 0xff, 0xff,
+	0x77, 0x77, 0xff, 0x77, 0xbb, 0xdd, 0xee, 0xff,
+	0xff, 0xff, 0xff, 0x00, 0xff, 0xff, 0xff, 0x00,
+	0x00, 0xff, 0xff, 0xcc, 0xcc, 0xcc, 0x33, 0xcc,
+	0xcc, 0xcc, 0x33, 0x33, 0xcc, 0xcc, 0xcc, 0xff,
+	0xff, 0xff, 0xee, 0xff, 0xff, 0xff, 0xee, 0xee,
+	0xff, 0xff, 0xff, 0xdd, 0xff, 0xff, 0xff, 0xdd,
+	0xdd, 0xff, 0xff, 0xff, 0xbb, 0xff, 0xff, 0xff,
+	0xbb, 0xbb, 0xff, 0xff, 0xff, 0x77, 0xff, 0xff,
+	0xff, 0x77, 0x77, 0xff, 0x77, 0xbb, 0xdd, 0xee,
+};
+
+int mmc_send_tuning(struct mmc *mmc, uint opcode)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(u8, data_buf,
+				 MMC_TUNING_BLK_PATTERN_8BIT_SIZE);
+	const u8 *pattern;
+	struct mmc_cmd cmd;
+	struct mmc_data data;
+	int size, err;
+
+	if (mmc->bus_width == 8) {
+		pattern = tuning_blk_pattern_8bit;
+		size = MMC_TUNING_BLK_PATTERN_8BIT_SIZE;
+	} else if (mmc->bus_width == 4) {
+		pattern = tuning_blk_pattern_4bit;
+		size = MMC_TUNING_BLK_PATTERN_4BIT_SIZE;
+	} else {
+		return -EINVAL;
+	}
+
+	cmd.cmdidx = opcode;
+	cmd.resp_type = MMC_RSP_R1;
+	cmd.cmdarg = 0;
+
+	data.dest = (char *)data_buf;
+	data.blocks = 1;
+	data.blocksize = size;
+	data.flags = MMC_DATA_READ;
+
+	err = mmc_send_cmd(mmc, &cmd, &data);
+	if (err)
+		return err;
+
+	if (memcmp(data_buf, pattern, size))
+		return COMM_ERR;
+
+	return 0;
+}
+
+static int mmc_execute_tuning(struct mmc *mmc)
+{
+	/* Assume that a host without this method does not need tuning */
+	if (!mmc->cfg->ops->execute_tuning)
+		return 0;
+
+	return mmc->cfg->ops->execute_tuning(mmc,
+					     MMC_CMD_SEND_TUNING_BLOCK_HS200);
+}
+
+/*
+ * Select the widest bus that both the card and host support, checking that
+ * the card can still be read afterwards by comparing its EXT_CSD against
+ * @ext_csd.
+ */
+static int mmc_select_bus_width(struct mmc *mmc, const u8 *ext_csd)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(u8, test_csd, MMC_MAX_BLOCK_LEN);
+	int err = 0;
+	int idx;
+
+	/* An array of possible bus widths in order of preference */
+	static unsigned ext_csd_bits[] = {
+		EXT_CSD_DDR_BUS_WIDTH_8,
+		EXT_CSD_DDR_BUS_WIDTH_4,
+		EXT_CSD_BUS_WIDTH_8,
+		EXT_CSD_BUS_WIDTH_4,
+		EXT_CSD_BUS_WIDTH_1,
+	};
+
+	/* An array to map CSD bus widths to host cap bits */
+	static unsigned ext_to_hostcaps[] = {
+		[EXT_CSD_DDR_BUS_WIDTH_4] =
+			MMC_MODE_DDR_52MHz | MMC_MODE_4BIT,
+		[EXT_CSD_DDR_BUS_WIDTH_8] =
+			MMC_MODE_DDR_52MHz | MMC_MODE_8BIT,
+		[EXT_CSD_BUS_WIDTH_4] = MMC_MODE_4BIT,
+		[EXT_CSD_BUS_WIDTH_8] = MMC_MODE_8BIT,
+	};
+
+	/* An array to map chosen bus width to an integer */
+	static unsigned widths[] = {
+		8, 4, 8, 4, 1,
+	};
+
+	for (idx = 0; idx < ARRAY_SIZE(ext_csd_bits); idx++) {
+		unsigned int extw = ext_csd_bits[idx];
+		unsigned int caps = ext_to_hostcaps[extw];
+
+		/*
+		 * If the bus width is still not changed,
+		 * don't try to set the default again.
+		 * Otherwise, recover from switch attempts
+		 * by switching to 1-bit bus width.
+		 */
+		if (extw == EXT_CSD_BUS_WIDTH_1 && mmc->bus_width == 1) {
+			err = 0;
+			break;
+		}
+
+		/*
+		 * Check to make sure the card and controller support
+		 * these capabilities
+		 */
+		if ((mmc->card_caps & caps) != caps)
+			continue;
+
+		/* DDR is not used with HS200, which is SDR only */
+		if ((caps & MMC_MODE_DDR_52MHz) &&
+		    (mmc->card_caps & MMC_MODE_HS200))
+			continue;
+
+		err = mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL,
+				 EXT_CSD_BUS_WIDTH, extw);
+
+		if (err)
+			continue;
+
+		mmc->ddr_mode = (caps & MMC_MODE_DDR_52MHz) ? 1 : 0;
+		mmc_set_bus_width(mmc, widths[idx]);
+
+		err = mmc_send_ext_csd(mmc, test_csd);
+
+		if (err)
+			continue;
+
+		/* Only compare read only fields */
+		if (ext_csd[EXT_CSD_PARTITIONING_SUPPORT]
+			== test_csd[EXT_CSD_PARTITIONING_SUPPORT] &&
+		    ext_csd[EXT_CSD_HC_WP_GRP_SIZE]
+			== test_csd[EXT_CSD_HC_WP_GRP_SIZE] &&
+		    ext_csd[EXT_CSD_REV]
+			== test_csd[EXT_CSD_REV] &&
+		    ext_csd[EXT_CSD_HC_ERASE_GRP_SIZE]
+			== test_csd[EXT_CSD_HC_ERASE_GRP_SIZE] &&
+		    memcmp(&ext_csd[EXT_CSD_SEC_CNT],
+			   &test_csd[EXT_CSD_SEC_CNT], 4) == 0)
+			break;
+		else
+			err = SWITCH_ERR;
+	}
+
+	return err;
+}
+
+/*
+ * Switch the card to HS200 timing, raise the clock and ask the host to find
+ * the sampling point. If this fails the card and host are put back to
+ * high-speed timing at the clock they were using before.
+ */
+static int mmc_select_hs200(struct mmc *mmc)
+{
+	uint clock = mmc->clock;
+	int err;
+
+	err = mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL, EXT_CSD_HS_TIMING,
+			 EXT_CSD_TIMING_HS200);
+	if (err)
+		return err;
+
+	mmc->tran_speed = 200000000;
+	mmc_set_clock(mmc, mmc->tran_speed);
+	mmc->selected_mode = MMC_HS_200;
+	err = mmc_execute_tuning(mmc);
+	if (!err)
+		return 0;
+
+	debug("%s: tuning failed (err=%d)\n", __func__, err);
+	mmc->selected_mode = MMC_LEGACY;
+	mmc_set_clock(mmc, clock);
+	mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL, EXT_CSD_HS_TIMING,
+		   EXT_CSD_TIMING_HS);
+
+	return err;
+}
+
 static int mmc_startup(struct mmc *mmc)
 {
 	int err, i;
@@ -1035,7 +1290,6 @@ static int mmc_startup(struct mmc *mmc)
 	u64 cmult, csize, capacity;
 	struct mmc_cmd cmd;
 	ALLOC_CACHE_ALIGN_BUFFER(u8, ext_csd, MMC_MAX_BLOCK_LEN);
-	ALLOC_CACHE_ALIGN_BUFFER(u8, test_csd, MMC_MAX_BLOCK_LEN);
 	int timeout = 1000;
 	bool has_parts = false;
 	bool part_completed;
@@ -1347,8 +1601,11 @@ static int mmc_startup(struct mmc *mmc)
 	if (err)
 		return err;
 
-	/* Restrict card's capabilities by what the host can do */
-	mmc->card_caps &= mmc->cfg->host_caps;
+	/*
+	 * Restrict card's capabilities by what the host can do, and by any
+	 * limit set with mmc_set_max_mode()
+	 */
+	mmc->card_caps &= mmc->cfg->host_caps & ~mmc->disabled_caps;
 
 	if (IS_SD(mmc)) {
 		if (mmc->card_caps & MMC_MODE_4BIT) {
@@ -1370,99 +1627,39 @@ static int mmc_startup(struct mmc *mmc)
 			mmc_set_bus_width(mmc, 4);
 		}
 
-		if (mmc->card_caps & MMC_MODE_HS)
+		if (mmc->card_caps & MMC_MODE_HS) {
 			mmc->tran_speed = 50000000;
-		else
+			mmc->selected_mode = SD_HS;
+		} else {
 			mmc->tran_speed = 25000000;
+			mmc->selected_mode = SD_LEGACY;
+		}
 	} else if (mmc->version >= MMC_VERSION_4) {
-		/* Only version 4 of MMC supports wider bus widths */
-		int idx;
-
-		/* An array of possible bus widths in order of preference */
-		static unsigned ext_csd_bits[] = {
-			EXT_CSD_DDR_BUS_WIDTH_8,
-			EXT_CSD_DDR_BUS_WIDTH_4,
-			EXT_CSD_BUS_WIDTH_8,
-			EXT_CSD_BUS_WIDTH_4,
-			EXT_CSD_BUS_WIDTH_1,
-		};
-
-		/* An array to map CSD bus widths to host cap bits */
-		static unsigned ext_to_hostcaps[] = {
-			[EXT_CSD_DDR_BUS_WIDTH_4] =
-				MMC_MODE_DDR_52MHz | MMC_MODE_4BIT,
-			[EXT_CSD_DDR_BUS_WIDTH_8] =
-				MMC_MODE_DDR_52MHz | MMC_MODE_8BIT,
-			[EXT_CSD_BUS_WIDTH_4] = MMC_MODE_4BIT,
-			[EXT_CSD_BUS_WIDTH_8] = MMC_MODE_8BIT,
-		};
-
-		/* An array to map chosen bus width to an integer */
-		static unsigned widths[] = {
-			8, 4, 8, 4, 1,
-		};
-
-		for (idx=0; idx < ARRAY_SIZE(ext_csd_bits); idx++) {
-			unsigned int extw = ext_csd_bits[idx];
-			unsigned int caps = ext_to_hostcaps[extw];
-
-			/*
-			 * If the bus width is still not changed,
-			 * don't try to set the default again.
-			 * Otherwise, recover from switch attempts
-			 * by switching to 1-bit bus width.
-			 */
-			if (extw == EXT_CSD_BUS_WIDTH_1 &&
-					mmc->bus_width == 1) {
-				err = 0;
-				break;
-			}
-
-			/*
-			 * Check to make sure the card and controller support
-			 * these capabilities
-			 */
-			if ((mmc->card_caps & caps) != caps)
-				continue;
-
-			err = mmc_switch(mmc, EXT_CSD_CMD_SET_NORMAL,
-					EXT_CSD_BUS_WIDTH, extw);
-
-			if (err)
-				continue;
-
-			mmc->ddr_mode = (caps & MMC_MODE_DDR_52MHz) ? 1 : 0;
-			mmc_set_bus_width(mmc, widths[idx]);
-
-			err = mmc_send_ext_csd(mmc, test_csd);
+		err = mmc_select_bus_width(mmc, ext_csd);
+		if (err)
+			return err;
 
+		/*
+		 * HS200 needs at least a 4-bit bus. If it cannot be tuned,
+		 * fall back to the best mode which does not need tuning.
+		 */
+		if ((mmc->card_caps & MMC_MODE_HS200) && mmc->bus_width >= 4 &&
+		    mmc_select_hs200(mmc)) {
+			mmc->card_caps &= ~MMC_MODE_HS200;
+			err = mmc_select_bus_width(mmc, ext_csd);
 			if (err)
-				continue;
-
-			/* Only compare read only fields */
-			if (ext_csd[EXT_CSD_PARTITIONING_SUPPORT]
-				== test_csd[EXT_CSD_PARTITIONING_SUPPORT] &&
-			    ext_csd[EXT_CSD_HC_WP_GRP_SIZE]
-				== test_csd[EXT_CSD_HC_WP_GRP_SIZE] &&
-			    ext_csd[EXT_CSD_REV]
-				== test_csd[EXT_CSD_REV] &&
-			    ext_csd[EXT_CSD_HC_ERASE_GRP_SIZE]
-				== test_csd[EXT_CSD_HC_ERASE_GRP_SIZE] &&
-			    memcmp(&ext_csd[EXT_CSD_SEC_CNT],
-				   &test_csd[EXT_CSD_SEC_CNT], 4) == 0)
-				break;
-			else
-				err = SWITCH_ERR;
+				return err;
 		}
 
-		if (err)
-			return err;
-
-		if (mmc->card_caps & MMC_MODE_HS) {
-			if (mmc->card_caps & MMC_MODE_HS_52MHz)
-				mmc->tran_speed = 52000000;
-			else
-				mmc->tran_speed = 26000000;
+		if (mmc->selected_mode == MMC_HS_200) {
+			/* mmc_select_hs200() has set up the clock */
+		} else if (mmc->card_caps & MMC_MODE_HS_52MHz) {
+			mmc->tran_speed = 52000000;
+			mmc->selected_mode = mmc->ddr_mode ? MMC_DDR_52 :
+				MMC_HS_52;
+		} else if (mmc->card_caps & MMC_MODE_HS) {
+			mmc->tran_speed = 26000000;
+			mmc->selected_mode = MMC_HS;
 		}
 	}
 
@@ -1562,9 +1759,11 @@ struct mmc *mmc_create(const struct mmc_config *cfg, void *priv)
 	mmc->block_dev.if_type = IF_TYPE_MMC;
 	mmc->block_dev.devnum = cur_dev_num++;
 	mmc->block_dev.removable = 1;
+#ifndef CONFIG_BLK
 	mmc->block_dev.block_read = mmc_bread;
 	mmc->block_dev.block_write = mmc_bwrite;
 	mmc->block_dev.block_erase = mmc_berase;
+#endif
 
 	/* setup initial part type */
 	mmc->block_dev.part_type = mmc->cfg->part_type;
@@ -1578,10 +1777,67 @@ struct mmc *mmc_create(const struct mmc_config *cfg, void *priv)
 
 void mmc_destroy(struct mmc *mmc)
 {
-	/* only freeing memory for now */
+	list_del(&mmc->link);
 	free(mmc);
 }
 
+#ifdef CONFIG_BLK
+static unsigned long mmc_blk_read(struct udevice *dev, lbaint_t start,
+				  lbaint_t blkcnt, void *buffer)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev->parent);
+
+	return mmc_bread(&mmc->block_dev, start, blkcnt, buffer);
+}
+
+static unsigned long mmc_blk_write(struct udevice *dev, lbaint_t start,
+				   lbaint_t blkcnt, const void *buffer)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev->parent);
+
+	return mmc_bwrite(&mmc->block_dev, start, blkcnt, buffer);
+}
+
+static unsigned long mmc_blk_erase(struct udevice *dev, lbaint_t start,
+				   lbaint_t blkcnt)
+{
+	struct mmc *mmc = mmc_get_mmc_dev(dev->parent);
+
+	return mmc_berase(&mmc->block_dev, start, blkcnt);
+}
+
+int mmc_create_blk(struct udevice *dev, struct mmc *mmc)
+{
+	struct udevice *bdev;
+	char dev_name[30], *str;
+	int ret;
+
+	snprintf(dev_name, sizeof(dev_name), "%s.blk", dev->name);
+	str = strdup(dev_name);
+	if (!str)
+		return -ENOMEM;
+	ret = blk_create_device(dev, "mmc_blk", str, IF_TYPE_MMC,
+				mmc->block_dev.devnum, 512, 0, &bdev);
+	if (ret)
+		return ret;
+	mmc->block_dev.bdev = bdev;
+
+	return 0;
+}
+
+static const struct blk_ops mmc_blk_ops = {
+	.read	= mmc_blk_read,
+	.write	= mmc_blk_write,
+	.erase	= mmc_blk_erase,
+};
+
+U_BOOT_DRIVER(mmc_blk) = {
+	.name		= "mmc_blk",
+	.id		= UCLASS_BLK,
+	.ops		= &mmc_blk_ops,
+};
+#endif
+
 #ifdef CONFIG_PARTITIONS
 struct blk_desc *mmc_get_dev(int dev)
 {
@@ -1626,6 +1882,7 @@ int mmc_start_init(struct mmc *mmc)
 		return err;
 
 	mmc->ddr_mode = 0;
+	mmc->selected_mode = MMC_LEGACY;
 	mmc_set_bus_width(mmc, 1);
 	mmc_set_clock(mmc, 1);
 
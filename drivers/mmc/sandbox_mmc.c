@@ -8,11 +8,406 @@
 #include <common.h>
 #include <dm.h>
 #include <errno.h>
+#include <malloc.h>
 #include <mmc.h>
+#include <dm/device-internal.h>
 #include <asm/test.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
+/*
+ * This emulates both an eMMC host controller and a 1MB eMMC device attached
+ * to it. The device supports everything up to HS200 by default, but checks
+ * that the host has set up its bus width, DDR and clock to match the mode
+ * the device has been switched to, failing data transfers if not. At HS200
+ * data is only received correctly if the host samples it at a phase inside
+ * the device's tuning window.
+ */
+#define SANDBOX_MMC_SIZE	(1 << 20)
+#define SANDBOX_MMC_PHASES	16	/* sampling phases the host can use */
+
+#define SANDBOX_MMC_STATE_TRAN	(4 << 9)
+
+/**
+ * struct sandbox_mmc_priv - state of the emulated host and device
+ *
+ * @cfg:		Host configuration
+ * @mmc:		MMC device created for the host
+ * @data:		Contents of the device
+ * @ext_csd:		Device's EXT_CSD register
+ * @status:		Error bits to report in the next status response
+ * @erase_start:	Start address for the next erase
+ * @erase_end:		End address for the next erase
+ * @clock:		Host clock in Hz, as set by set_ios()
+ * @bus_width:		Host bus width, as set by set_ios()
+ * @ddr:		true if the host is using DDR, as set by set_ios()
+ * @phase:		Host sampling phase (0 to SANDBOX_MMC_PHASES - 1)
+ * @tune_start:		First phase at which the device can be read at HS200
+ * @tune_end:		Last phase at which the device can be read at HS200
+ */
+struct sandbox_mmc_priv {
+	struct mmc_config cfg;
+	struct mmc *mmc;
+	u8 *data;
+	u8 ext_csd[MMC_MAX_BLOCK_LEN];
+	uint status;
+	uint erase_start;
+	uint erase_end;
+	uint clock;
+	uint bus_width;
+	bool ddr;
+	int phase;
+	int tune_start;
+	int tune_end;
+};
+
+/* Check that the host's bus settings match the device's current mode */
+static bool sandbox_mmc_bus_ok(struct sandbox_mmc_priv *priv)
+{
+	u8 width = priv->ext_csd[EXT_CSD_BUS_WIDTH];
+	u8 timing = priv->ext_csd[EXT_CSD_HS_TIMING];
+	bool ddr = false;
+	uint bus_width, max_clock;
+
+	switch (width) {
+	case EXT_CSD_DDR_BUS_WIDTH_4:
+		ddr = true;
+		/* fall through */
+	case EXT_CSD_BUS_WIDTH_4:
+		bus_width = 4;
+		break;
+	case EXT_CSD_DDR_BUS_WIDTH_8:
+		ddr = true;
+		/* fall through */
+	case EXT_CSD_BUS_WIDTH_8:
+		bus_width = 8;
+		break;
+	default:
+		bus_width = 1;
+		break;
+	}
+	if (priv->bus_width != bus_width || priv->ddr != ddr)
+		return false;
+
+	if (timing == EXT_CSD_TIMING_HS200)
+		max_clock = 200000000;
+	else if (timing == EXT_CSD_TIMING_HS)
+		max_clock = 52000000;
+	else
+		max_clock = 26000000;
+	if (priv->clock > max_clock)
+		return false;
+
+	/* DDR52 needs high-speed timing */
+	if (ddr && timing != EXT_CSD_TIMING_HS)
+		return false;
+
+	/* Above 52MHz the host must sample at a tuned phase */
+	if (priv->clock > 52000000 &&
+	    (priv->phase < priv->tune_start || priv->phase > priv->tune_end))
+		return false;
+
+	return true;
+}
+
+static void sandbox_mmc_switch(struct sandbox_mmc_priv *priv, uint arg)
+{
+	uint index = (arg >> 16) & 0xff;
+	uint value = (arg >> 8) & 0xff;
+	u8 card_type = priv->ext_csd[EXT_CSD_CARD_TYPE];
+	bool ok;
+
+	switch (index) {
+	case EXT_CSD_HS_TIMING:
+		ok = value == EXT_CSD_TIMING_LEGACY ||
+			value == EXT_CSD_TIMING_HS ||
+			(value == EXT_CSD_TIMING_HS200 &&
+			 (card_type & EXT_CSD_CARD_TYPE_HS200));
+		break;
+	case EXT_CSD_BUS_WIDTH:
+		ok = value <= EXT_CSD_BUS_WIDTH_8 ||
+			((value == EXT_CSD_DDR_BUS_WIDTH_4 ||
+			  value == EXT_CSD_DDR_BUS_WIDTH_8) &&
+			 (card_type & EXT_CSD_CARD_TYPE_DDR_52));
+		break;
+	default:
+		/* Only the modes segment (below EXT_CSD_REV) is writable */
+		ok = index < EXT_CSD_REV;
+		break;
+	}
+
+	if ((arg >> 24) == MMC_SWITCH_MODE_WRITE_BYTE && ok)
+		priv->ext_csd[index] = value;
+	else
+		priv->status |= MMC_STATUS_SWITCH_ERROR;
+}
+
+static int sandbox_mmc_transfer(struct sandbox_mmc_priv *priv,
+				struct mmc_cmd *cmd, struct mmc_data *data)
+{
+	uint size = data->blocks * data->blocksize;
+	uint addr = cmd->cmdarg;
+
+	if (!sandbox_mmc_bus_ok(priv))
+		return COMM_ERR;
+	if (addr >= SANDBOX_MMC_SIZE || size > SANDBOX_MMC_SIZE - addr)
+		return -EINVAL;
+	if (data->flags & MMC_DATA_READ)
+		memcpy(data->dest, priv->data + addr, size);
+	else
+		memcpy(priv->data + addr, data->src, size);
+
+	return 0;
+}
+
+static int sandbox_mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd,
+				struct mmc_data *data)
+{
+	struct sandbox_mmc_priv *priv = mmc->priv;
+	u8 *ext_csd = priv->ext_csd;
+
+	cmd->response[0] = MMC_STATUS_RDY_FOR_DATA | SANDBOX_MMC_STATE_TRAN;
+	switch (cmd->cmdidx) {
+	case MMC_CMD_GO_IDLE_STATE:
+		ext_csd[EXT_CSD_HS_TIMING] = EXT_CSD_TIMING_LEGACY;
+		ext_csd[EXT_CSD_BUS_WIDTH] = EXT_CSD_BUS_WIDTH_1;
+		priv->status = 0;
+		break;
+	case MMC_CMD_SEND_EXT_CSD:
+		/* Without data this is the SD SEND_IF_COND, so ignore it */
+		if (!data)
+			return TIMEOUT;
+		if (!sandbox_mmc_bus_ok(priv))
+			return COMM_ERR;
+		memcpy(data->dest, ext_csd, MMC_MAX_BLOCK_LEN);
+		break;
+	case MMC_CMD_APP_CMD:
+		/* Not an SD card */
+		return TIMEOUT;
+	case MMC_CMD_SEND_OP_COND:
+		/* Powered up, byte addressing, 1.8V and 2.7-3.6V */
+		cmd->response[0] = OCR_BUSY | 0x00ff8080;
+		break;
+	case MMC_CMD_ALL_SEND_CID:
+	case MMC_CMD_SEND_CID:
+		/* Manufacturer 0x15, name "SBMMC" */
+		cmd->response[0] = 0x15 << 24 | 0x0100 << 8 | 'S';
+		cmd->response[1] = 'B' << 24 | 'M' << 16 | 'M' << 8 | 'C';
+		cmd->response[2] = 0x10000000;
+		cmd->response[3] = 0x00000000;
+		break;
+	case MMC_CMD_SEND_CSD:
+		/*
+		 * Version 4, 25MHz, 512-byte blocks, C_SIZE 127 and
+		 * C_SIZE_MULT 2, giving 1MB
+		 */
+		cmd->response[0] = 4 << 26 | 0x32;
+		cmd->response[1] = 9 << 16 | 127 >> 2;
+		cmd->response[2] = (127 & 3) << 30 | 2 << 15;
+		cmd->response[3] = 9 << 22;
+		break;
+	case MMC_CMD_SET_RELATIVE_ADDR:
+	case MMC_CMD_SELECT_CARD:
+	case MMC_CMD_SET_BLOCKLEN:
+	case MMC_CMD_STOP_TRANSMISSION:
+	case MMC_CMD_SET_BLOCK_COUNT:
+		break;
+	case MMC_CMD_SWITCH:
+		sandbox_mmc_switch(priv, cmd->cmdarg);
+		break;
+	case MMC_CMD_SEND_STATUS:
+		cmd->response[0] |= priv->status;
+		priv->status = 0;
+		break;
+	case MMC_CMD_READ_SINGLE_BLOCK:
+	case MMC_CMD_READ_MULTIPLE_BLOCK:
+	case MMC_CMD_WRITE_SINGLE_BLOCK:
+	case MMC_CMD_WRITE_MULTIPLE_BLOCK:
+		return sandbox_mmc_transfer(priv, cmd, data);
+	case MMC_CMD_SEND_TUNING_BLOCK_HS200:
+		if (ext_csd[EXT_CSD_HS_TIMING] != EXT_CSD_TIMING_HS200)
+			return TIMEOUT;
+		if (!sandbox_mmc_bus_ok(priv))
+			return COMM_ERR;
+		if (priv->bus_width == 8)
+			memcpy(data->dest, tuning_blk_pattern_8bit,
+			       MMC_TUNING_BLK_PATTERN_8BIT_SIZE);
+		else
+			memcpy(data->dest, tuning_blk_pattern_4bit,
+			       MMC_TUNING_BLK_PATTERN_4BIT_SIZE);
+		break;
+	case MMC_CMD_ERASE_GROUP_START:
+		priv->erase_start = cmd->cmdarg;
+		break;
+	case MMC_CMD_ERASE_GROUP_END:
+		priv->erase_end = cmd->cmdarg;
+		break;
+	case MMC_CMD_ERASE:
+		if (priv->erase_start > priv->erase_end ||
+		    priv->erase_end >= SANDBOX_MMC_SIZE)
+			return -EINVAL;
+		memset(priv->data + priv->erase_start, '\0',
+		       priv->erase_end - priv->erase_start + MMC_MAX_BLOCK_LEN);
+		break;
+	default:
+		debug("%s: Unsupported command %d\n", __func__, cmd->cmdidx);
+		return TIMEOUT;
+	}
+
+	return 0;
+}
+
+static void sandbox_mmc_set_ios(struct mmc *mmc)
+{
+	struct sandbox_mmc_priv *priv = mmc->priv;
+
+	priv->clock = mmc->clock;
+	priv->bus_width = mmc->bus_width;
+	priv->ddr = mmc->ddr_mode;
+}
+
+static int sandbox_mmc_init(struct mmc *mmc)
+{
+	struct sandbox_mmc_priv *priv = mmc->priv;
+
+	priv->phase = 0;
+
+	return 0;
+}
+
+/*
+ * Try each sampling phase in turn and use the middle of the longest run of
+ * phases which give the right tuning block
+ */
+static int sandbox_mmc_execute_tuning(struct mmc *mmc, uint opcode)
+{
+	struct sandbox_mmc_priv *priv = mmc->priv;
+	int start = -1, best_start = 0, best_len = 0;
+	int phase;
+
+	for (phase = 0; phase <= SANDBOX_MMC_PHASES; phase++) {
+		bool ok = false;
+
+		if (phase < SANDBOX_MMC_PHASES) {
+			priv->phase = phase;
+			ok = !mmc_send_tuning(mmc, opcode);
+		}
+		if (ok && start < 0) {
+			start = phase;
+		} else if (!ok && start >= 0) {
+			if (phase - start > best_len) {
+				best_start = start;
+				best_len = phase - start;
+			}
+			start = -1;
+		}
+	}
+	if (!best_len) {
+		priv->phase = 0;
+		return COMM_ERR;
+	}
+	priv->phase = best_start + (best_len - 1) / 2;
+	debug("%s: phase %d\n", __func__, priv->phase);
+
+	return 0;
+}
+
+static const struct mmc_ops sandbox_mmc_ops = {
+	.send_cmd	= sandbox_mmc_send_cmd,
+	.set_ios	= sandbox_mmc_set_ios,
+	.init		= sandbox_mmc_init,
+	.execute_tuning	= sandbox_mmc_execute_tuning,
+};
+
+void sandbox_mmc_set_card_type(struct udevice *dev, u8 card_type)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	priv->ext_csd[EXT_CSD_CARD_TYPE] = card_type;
+}
+
+void sandbox_mmc_set_tuning_window(struct udevice *dev, int start, int end)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	priv->tune_start = start;
+	priv->tune_end = end;
+}
+
+int sandbox_mmc_get_phase(struct udevice *dev)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+
+	return priv->phase;
+}
+
+static int sandbox_mmc_probe(struct udevice *dev)
+{
+	struct mmc_uclass_priv *upriv = dev_get_uclass_priv(dev);
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+	struct mmc_config *cfg = &priv->cfg;
+	u8 *ext_csd = priv->ext_csd;
+	uint sectors = SANDBOX_MMC_SIZE / MMC_MAX_BLOCK_LEN;
+
+	priv->data = calloc(1, SANDBOX_MMC_SIZE);
+	if (!priv->data)
+		return -ENOMEM;
+
+	ext_csd[EXT_CSD_REV] = 7;
+	ext_csd[EXT_CSD_CARD_TYPE] = EXT_CSD_CARD_TYPE_26 |
+		EXT_CSD_CARD_TYPE_52 | EXT_CSD_CARD_TYPE_DDR_1_8V |
+		EXT_CSD_CARD_TYPE_HS200_1_8V;
+	ext_csd[EXT_CSD_SEC_CNT] = sectors & 0xff;
+	ext_csd[EXT_CSD_SEC_CNT + 1] = (sectors >> 8) & 0xff;
+	ext_csd[EXT_CSD_SEC_CNT + 2] = (sectors >> 16) & 0xff;
+	ext_csd[EXT_CSD_SEC_CNT + 3] = sectors >> 24;
+	ext_csd[EXT_CSD_HC_WP_GRP_SIZE] = 1;
+	ext_csd[EXT_CSD_HC_ERASE_GRP_SIZE] = 1;
+	priv->tune_start = 4;
+	priv->tune_end = 11;
+
+	cfg->name = dev->name;
+	cfg->ops = &sandbox_mmc_ops;
+	cfg->host_caps = MMC_MODE_HS | MMC_MODE_HS_52MHz | MMC_MODE_4BIT |
+		MMC_MODE_8BIT | MMC_MODE_DDR_52MHz | MMC_MODE_HS200;
+	cfg->voltages = MMC_VDD_165_195 | MMC_VDD_32_33 | MMC_VDD_33_34;
+	cfg->f_min = 400000;
+	cfg->f_max = 200000000;
+	cfg->b_max = CONFIG_SYS_MMC_MAX_BLK_COUNT;
+
+	priv->mmc = mmc_create(cfg, priv);
+	if (!priv->mmc) {
+		free(priv->data);
+		return -ENOMEM;
+	}
+	upriv->mmc = priv->mmc;
+#ifdef CONFIG_BLK
+	int ret = mmc_create_blk(dev, priv->mmc);
+
+	if (ret) {
+		mmc_destroy(priv->mmc);
+		free(priv->data);
+		return ret;
+	}
+#endif
+
+	return 0;
+}
+
+static int sandbox_mmc_remove(struct udevice *dev)
+{
+	struct sandbox_mmc_priv *priv = dev_get_priv(dev);
+	int ret = 0;
+
+#ifdef CONFIG_BLK
+	ret = device_unbind(priv->mmc->block_dev.bdev);
+#endif
+	mmc_destroy(priv->mmc);
+	free(priv->data);
+
+	return ret;
+}
+
 static const struct udevice_id sandbox_mmc_ids[] = {
 	{ .compatible = "sandbox,mmc" },
 	{ }
@@ -22,4 +417,7 @@ U_BOOT_DRIVER(warm_mmc_sandbox) = {
 	.name		= "mmc_sandbox",
 	.id		= UCLASS_MMC,
 	.of_match	= sandbox_mmc_ids,
+	.probe		= sandbox_mmc_probe,
+	.remove		= sandbox_mmc_remove,
+	.priv_auto_alloc_size = sizeof(struct sandbox_mmc_priv),
 };
@@ -0,0 +1,693 @@
+/*
+ * Simulate a NAND flash controller and chip, backed by a file on the host
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <fdtdec.h>
+#include <malloc.h>
+#include <nand.h>
+#include <os.h>
+#include <asm/test.h>
+#include <linux/log2.h>
+#include <linux/sizes.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/*
+ * The backing file holds the main area of each page, one after the other,
+ * so that an image made by e.g. ubinize can be used as it is. Anything past
+ * the end of the file reads as erased, and the file is padded with 0xff
+ * when a page beyond its end is programmed. Without a file in the device
+ * tree, an unnamed temporary file is used, so the chip starts out blank
+ * and nothing is left behind.
+ *
+ * The OOB area is only kept in memory. It is stored inverted so that the
+ * zeroed memory from os_malloc() reads as erased, and so that the pages of
+ * a large chip which are never touched cost nothing. Factory bad blocks are
+ * marked there at start-up.
+ *
+ * ECC is done by the simulated controller: data is stored as written, and
+ * any bitflips injected into a page are reported as corrected when it is
+ * read, or corrupt the data if there are more than the ECC can correct.
+ *
+ * Nothing is delayed, but each operation adds the time which a real chip
+ * would take to the statistics, so that the effect of changes to the
+ * access pattern can be measured.
+ */
+
+/* Pages which can have bitflips injected at any one time */
+#define SB_NAND_MAX_FLIPS	16
+
+/* Maximum number of factory bad blocks in the device tree */
+#define SB_NAND_MAX_BAD		64
+
+/* Default timings, in nanoseconds, roughly those of an SLC part */
+#define SB_NAND_READ_NS		25000		/* tR */
+#define SB_NAND_PROG_NS		200000		/* tPROG */
+#define SB_NAND_ERASE_NS	2000000		/* tBERS */
+#define SB_NAND_BYTE_NS		25		/* tRC / tWC */
+
+struct sandbox_nand_flip {
+	int page;
+	int bits;
+};
+
+/* Internal state data for each NAND chip */
+struct sandbox_nand {
+	struct nand_chip chip;
+	struct nand_flash_dev type[2];
+	struct nand_ecclayout layout;
+	/* Geometry */
+	uint page_size;
+	uint oob_size;
+	uint pages_per_block;
+	uint blocks;
+	/* The file holding the main area, and how much of it there is */
+	int fd;
+	off_t file_size;
+	/* OOB area of every page, inverted */
+	u8 *oob;
+	/* Blocks which fail to erase or program, and the factory bad ones */
+	u8 *failing;
+	int bad[SB_NAND_MAX_BAD];
+	int bad_count;
+	u8 id[8];
+	/* Command being processed, page and column addressed */
+	uint cmd;
+	int page;
+	uint column;
+	u8 status;
+	/* The page register: main area then OOB */
+	u8 *buf;
+	/* Main area of 'page' is in 'buf' (the OOB always is) */
+	bool data_loaded;
+	/* Part of 'buf' written since NAND_CMD_SEQIN */
+	uint prog_start, prog_end;
+	/* Scratch page, and a block of 0xff for erasing */
+	u8 *cur;
+	u8 *ff;
+	/* Bitflips in the page just read, and in each injected page */
+	int flips;
+	struct sandbox_nand_flip flip[SB_NAND_MAX_FLIPS];
+	/* Timing model */
+	uint read_ns, prog_ns, erase_ns, byte_ns;
+	struct sandbox_nand_stats stats;
+};
+
+static inline struct sandbox_nand *sb_nand_priv(struct mtd_info *mtd)
+{
+	struct nand_chip *chip = mtd->priv;
+
+	return chip->priv;
+}
+
+static void sb_nand_timed(struct sandbox_nand *priv, uint64_t base)
+{
+	priv->stats.host_ns += os_get_nsec() - base;
+}
+
+/* Read the main area of the current page into the page register */
+static void sb_nand_load_data(struct sandbox_nand *priv)
+{
+	off_t offset = (off_t)priv->page * priv->page_size;
+	uint64_t base = os_get_nsec();
+	ssize_t len = 0;
+
+	if (offset < priv->file_size) {
+		len = os_pread(priv->fd, priv->buf,
+			       min_t(off_t, priv->page_size,
+				     priv->file_size - offset), offset);
+		if (len < 0)
+			len = 0;
+	}
+	memset(priv->buf + len, 0xff, priv->page_size - len);
+	priv->data_loaded = true;
+	sb_nand_timed(priv, base);
+}
+
+/* Start reading a page (the array-to-register transfer) */
+static void sb_nand_read(struct sandbox_nand *priv, int page)
+{
+	u8 *oob = priv->buf + priv->page_size;
+	uint total = priv->blocks * priv->pages_per_block;
+	int i;
+
+	priv->stats.reads++;
+	priv->stats.busy_ns += priv->read_ns;
+	priv->page = page;
+	priv->flips = 0;
+	if (page < 0 || page >= total) {
+		memset(priv->buf, 0xff, priv->page_size + priv->oob_size);
+		priv->data_loaded = true;
+		return;
+	}
+
+	/* The main area is only read if the caller asks for it */
+	priv->data_loaded = false;
+	for (i = 0; i < priv->oob_size; i++)
+		oob[i] = ~priv->oob[page * priv->oob_size + i];
+	for (i = 0; i < SB_NAND_MAX_FLIPS; i++) {
+		if (priv->flip[i].bits && priv->flip[i].page == page)
+			priv->flips = priv->flip[i].bits;
+	}
+}
+
+/* Extend the file with erased data up to @offset */
+static int sb_nand_extend(struct sandbox_nand *priv, off_t offset)
+{
+	uint block_size = priv->page_size * priv->pages_per_block;
+	ssize_t len;
+
+	while (priv->file_size < offset) {
+		len = min_t(off_t, block_size, offset - priv->file_size);
+		if (os_pwrite(priv->fd, priv->ff, len, priv->file_size) != len)
+			return -EIO;
+		priv->file_size += len;
+	}
+
+	return 0;
+}
+
+static void sb_nand_program(struct sandbox_nand *priv)
+{
+	uint block = priv->page / priv->pages_per_block;
+	off_t offset = (off_t)priv->page * priv->page_size;
+	uint start = priv->prog_start, end = priv->prog_end;
+	uint64_t base;
+	uint i;
+
+	priv->stats.programs++;
+	priv->stats.busy_ns += priv->prog_ns;
+	priv->status |= NAND_STATUS_FAIL;
+	if (priv->page < 0 || block >= priv->blocks || priv->failing[block])
+		return;
+
+	/* Programming can only clear bits */
+	base = os_get_nsec();
+	if (start < priv->page_size) {
+		uint data_end = min(end, priv->page_size);
+		u8 *cur = priv->cur + start;
+		ssize_t len = 0;
+
+		if (offset + start < priv->file_size) {
+			len = os_pread(priv->fd, cur, data_end - start,
+				       offset + start);
+			if (len < 0)
+				goto done;
+		}
+		memset(cur + len, 0xff, data_end - start - len);
+		for (i = start; i < data_end; i++)
+			priv->cur[i] &= priv->buf[i];
+		if (sb_nand_extend(priv, offset + start))
+			goto done;
+		if (os_pwrite(priv->fd, cur, data_end - start,
+			      offset + start) != data_end - start)
+			goto done;
+		if (offset + data_end > priv->file_size)
+			priv->file_size = offset + data_end;
+	}
+	for (i = max(start, priv->page_size); i < end; i++) {
+		priv->oob[priv->page * priv->oob_size + i - priv->page_size] |=
+			(u8)~priv->buf[i];
+	}
+	priv->status &= ~NAND_STATUS_FAIL;
+done:
+	sb_nand_timed(priv, base);
+}
+
+static void sb_nand_erase(struct sandbox_nand *priv)
+{
+	uint block = priv->page / priv->pages_per_block;
+	uint block_size = priv->page_size * priv->pages_per_block;
+	off_t offset = (off_t)block * block_size;
+	uint64_t base;
+	int i;
+
+	priv->stats.erases++;
+	priv->stats.busy_ns += priv->erase_ns;
+	priv->status |= NAND_STATUS_FAIL;
+	if (priv->page < 0 || block >= priv->blocks || priv->failing[block])
+		return;
+
+	base = os_get_nsec();
+	if (offset < priv->file_size) {
+		ssize_t len = min_t(off_t, block_size,
+				    priv->file_size - offset);
+
+		if (os_pwrite(priv->fd, priv->ff, len, offset) != len) {
+			sb_nand_timed(priv, base);
+			return;
+		}
+	}
+	sb_nand_timed(priv, base);
+	memset(priv->oob + (ulong)block * priv->pages_per_block *
+	       priv->oob_size, '\0', priv->pages_per_block * priv->oob_size);
+	for (i = 0; i < SB_NAND_MAX_FLIPS; i++) {
+		if (priv->flip[i].page / priv->pages_per_block == block)
+			priv->flip[i].bits = 0;
+	}
+	priv->status &= ~NAND_STATUS_FAIL;
+}
+
+static void sb_nand_cmdfunc(struct mtd_info *mtd, unsigned command,
+			    int column, int page_addr)
+{
+	struct sandbox_nand *priv = sb_nand_priv(mtd);
+
+	priv->cmd = command;
+	switch (command) {
+	case NAND_CMD_RESET:
+		priv->status = NAND_STATUS_READY | NAND_STATUS_WP;
+		break;
+	case NAND_CMD_READID:
+		priv->column = column;
+		break;
+	case NAND_CMD_READOOB:
+		column += priv->page_size;
+		priv->cmd = NAND_CMD_READ0;
+		/* fall through */
+	case NAND_CMD_READ0:
+		sb_nand_read(priv, page_addr);
+		/* fall through */
+	case NAND_CMD_RNDOUT:
+	case NAND_CMD_RNDIN:
+		priv->column = column;
+		break;
+	case NAND_CMD_SEQIN:
+		priv->page = page_addr;
+		priv->column = column;
+		memset(priv->buf, 0xff, priv->page_size + priv->oob_size);
+		priv->data_loaded = true;
+		priv->prog_start = priv->page_size + priv->oob_size;
+		priv->prog_end = 0;
+		break;
+	case NAND_CMD_PAGEPROG:
+		sb_nand_program(priv);
+		break;
+	case NAND_CMD_ERASE1:
+		priv->page = page_addr;
+		break;
+	case NAND_CMD_ERASE2:
+		sb_nand_erase(priv);
+		break;
+	case NAND_CMD_STATUS:
+		break;
+	default:
+		debug("%s: unsupported command %02x\n", __func__, command);
+		break;
+	}
+}
+
+static uint8_t sb_nand_read_byte(struct mtd_info *mtd)
+{
+	struct sandbox_nand *priv = sb_nand_priv(mtd);
+	uint column = priv->column++;
+
+	switch (priv->cmd) {
+	case NAND_CMD_STATUS:
+		return priv->status;
+	case NAND_CMD_READID:
+		return column < sizeof(priv->id) ? priv->id[column] : 0;
+	}
+	if (column >= priv->page_size + priv->oob_size)
+		return 0xff;
+	if (column < priv->page_size && !priv->data_loaded)
+		sb_nand_load_data(priv);
+	priv->stats.bytes_out++;
+	priv->stats.busy_ns += priv->byte_ns;
+
+	return priv->buf[column];
+}
+
+static void sb_nand_read_buf(struct mtd_info *mtd, uint8_t *buf, int len)
+{
+	struct sandbox_nand *priv = sb_nand_priv(mtd);
+	uint size = priv->page_size + priv->oob_size;
+	uint avail;
+
+	if (priv->cmd != NAND_CMD_READ0) {
+		while (len--)
+			*buf++ = sb_nand_read_byte(mtd);
+		return;
+	}
+	if (priv->column < priv->page_size && !priv->data_loaded)
+		sb_nand_load_data(priv);
+	avail = priv->column < size ? size - priv->column : 0;
+	memcpy(buf, priv->buf + priv->column, min_t(uint, len, avail));
+	if (len > avail)
+		memset(buf + avail, 0xff, len - avail);
+	priv->column += len;
+	priv->stats.bytes_out += len;
+	priv->stats.busy_ns += (u64)len * priv->byte_ns;
+}
+
+static void sb_nand_write_buf(struct mtd_info *mtd, const uint8_t *buf,
+			      int len)
+{
+	struct sandbox_nand *priv = sb_nand_priv(mtd);
+	uint size = priv->page_size + priv->oob_size;
+
+	if (priv->column >= size)
+		return;
+	len = min_t(uint, len, size - priv->column);
+	memcpy(priv->buf + priv->column, buf, len);
+	priv->prog_start = min(priv->prog_start, priv->column);
+	priv->prog_end = max(priv->prog_end, priv->column + len);
+	priv->column += len;
+	priv->stats.bytes_in += len;
+	priv->stats.busy_ns += (u64)len * priv->byte_ns;
+}
+
+static void sb_nand_select_chip(struct mtd_info *mtd, int chipnr)
+{
+}
+
+static int sb_nand_dev_ready(struct mtd_info *mtd)
+{
+	return 1;
+}
+
+static int sb_nand_wait(struct mtd_info *mtd, struct nand_chip *chip)
+{
+	struct sandbox_nand *priv = sb_nand_priv(mtd);
+
+	priv->cmd = NAND_CMD_STATUS;
+
+	return priv->status;
+}
+
+static int sb_nand_read_page(struct mtd_info *mtd, struct nand_chip *chip,
+			     uint8_t *buf, int oob_required, int page)
+{
+	struct sandbox_nand *priv = sb_nand_priv(mtd);
+	int i;
+
+	chip->read_buf(mtd, buf, mtd->writesize);
+	if (oob_required)
+		chip->read_buf(mtd, chip->oob_poi, mtd->oobsize);
+	if (!priv->flips)
+		return 0;
+
+	if (priv->flips > chip->ecc.strength) {
+		/* Too many to correct, so the caller sees them */
+		for (i = 0; i < priv->flips; i++)
+			buf[i] ^= 1;
+		mtd->ecc_stats.failed++;
+		priv->stats.failed++;
+		return 0;
+	}
+	mtd->ecc_stats.corrected += priv->flips;
+	priv->stats.corrected += priv->flips;
+
+	return priv->flips;
+}
+
+static int sb_nand_write_page(struct mtd_info *mtd, struct nand_chip *chip,
+			      const uint8_t *buf, int oob_required)
+{
+	chip->write_buf(mtd, buf, mtd->writesize);
+	if (oob_required)
+		chip->write_buf(mtd, chip->oob_poi, mtd->oobsize);
+
+	return 0;
+}
+
+static struct sandbox_nand *sb_nand_get(struct mtd_info *mtd)
+{
+	struct nand_chip *chip = mtd->priv;
+
+	if (!chip || chip->cmdfunc != sb_nand_cmdfunc)
+		return NULL;
+
+	return chip->priv;
+}
+
+int sandbox_nand_set_bitflips(struct mtd_info *mtd, int page, int bits)
+{
+	struct sandbox_nand *priv = sb_nand_get(mtd);
+	struct sandbox_nand_flip *slot = NULL;
+	int i;
+
+	if (!priv)
+		return -ENODEV;
+	for (i = 0; i < SB_NAND_MAX_FLIPS; i++) {
+		struct sandbox_nand_flip *flip = &priv->flip[i];
+
+		if (flip->bits && flip->page == page)
+			slot = flip;
+		else if (!flip->bits && !slot)
+			slot = flip;
+	}
+	if (!slot)
+		return bits ? -ENOSPC : 0;
+	slot->page = page;
+	slot->bits = bits;
+
+	/* Make sure the next read comes from the chip */
+	priv->chip.pagebuf = -1;
+
+	return 0;
+}
+
+int sandbox_nand_set_failing(struct mtd_info *mtd, int block, bool fail)
+{
+	struct sandbox_nand *priv = sb_nand_get(mtd);
+
+	if (!priv)
+		return -ENODEV;
+	if (block < 0 || block >= priv->blocks)
+		return -EINVAL;
+	priv->failing[block] = fail;
+
+	return 0;
+}
+
+/* Mark the factory bad blocks, in the first two pages as is usual */
+static void sb_nand_mark_bad(struct sandbox_nand *priv)
+{
+	uint pos = priv->chip.badblockpos;
+	int i;
+
+	for (i = 0; i < priv->bad_count; i++) {
+		ulong page = (ulong)priv->bad[i] * priv->pages_per_block;
+
+		priv->failing[priv->bad[i]] = true;
+		priv->oob[page * priv->oob_size + pos] = 0xff;
+		priv->oob[(page + 1) * priv->oob_size + pos] = 0xff;
+	}
+}
+
+int sandbox_nand_reset(struct mtd_info *mtd)
+{
+	struct sandbox_nand *priv = sb_nand_get(mtd);
+	uint block_size;
+	off_t offset;
+	ssize_t len;
+
+	if (!priv)
+		return -ENODEV;
+	block_size = priv->page_size * priv->pages_per_block;
+	for (offset = 0; offset < priv->file_size; offset += len) {
+		len = min_t(off_t, block_size, priv->file_size - offset);
+		if (os_pwrite(priv->fd, priv->ff, len, offset) != len)
+			return -EIO;
+	}
+	memset(priv->oob, '\0', (ulong)priv->blocks * priv->pages_per_block *
+	       priv->oob_size);
+	memset(priv->failing, '\0', priv->blocks);
+	memset(priv->flip, '\0', sizeof(priv->flip));
+	memset(&priv->stats, '\0', sizeof(priv->stats));
+	sb_nand_mark_bad(priv);
+
+	/* Forget blocks marked bad since start-up, and any cached page */
+	kfree(priv->chip.bbt);
+	priv->chip.bbt = NULL;
+	priv->chip.pagebuf = -1;
+
+	return priv->chip.scan_bbt(mtd);
+}
+
+struct sandbox_nand_stats *sandbox_nand_get_stats(struct mtd_info *mtd)
+{
+	struct sandbox_nand *priv = sb_nand_get(mtd);
+
+	return priv ? &priv->stats : NULL;
+}
+
+static int sb_nand_of_to_priv(struct sandbox_nand *priv, const void *blob,
+			      int node)
+{
+	u64 size;
+
+	priv->page_size = fdtdec_get_int(blob, node, "sandbox,page-size",
+					 2048);
+	priv->oob_size = fdtdec_get_int(blob, node, "sandbox,oob-size", 64);
+	priv->pages_per_block = fdtdec_get_int(blob, node,
+					       "sandbox,pages-per-block", 64);
+	priv->blocks = fdtdec_get_int(blob, node, "sandbox,blocks", 1024);
+	priv->read_ns = fdtdec_get_int(blob, node, "sandbox,read-ns",
+				       SB_NAND_READ_NS);
+	priv->prog_ns = fdtdec_get_int(blob, node, "sandbox,program-ns",
+				       SB_NAND_PROG_NS);
+	priv->erase_ns = fdtdec_get_int(blob, node, "sandbox,erase-ns",
+					SB_NAND_ERASE_NS);
+	priv->byte_ns = fdtdec_get_int(blob, node, "sandbox,byte-ns",
+				       SB_NAND_BYTE_NS);
+
+	size = (u64)priv->page_size * priv->pages_per_block * priv->blocks;
+	if (!is_power_of_2(priv->page_size) || priv->page_size < 512 ||
+	    priv->page_size > NAND_MAX_PAGESIZE ||
+	    priv->oob_size < 16 || priv->oob_size > NAND_MAX_OOBSIZE ||
+	    !is_power_of_2(priv->pages_per_block) || !priv->blocks ||
+	    size & (SZ_1M - 1)) {
+		debug("%s: invalid geometry\n", __func__);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int sb_nand_init(int devnum, const void *blob, int node)
+{
+	struct mtd_info *mtd = &nand_info[devnum];
+	char tmpname[] = "/tmp/u-boot.nand.XXXXXX";
+	struct sandbox_nand *priv;
+	struct nand_chip *chip;
+	const char *fname;
+	int ecc_strength;
+	ulong pages;
+	int ret;
+	int i;
+
+	fname = fdt_getprop(blob, node, "sandbox,filename", NULL);
+	priv = calloc(1, sizeof(*priv));
+	if (!priv)
+		return -ENOMEM;
+	ret = sb_nand_of_to_priv(priv, blob, node);
+	if (ret)
+		goto err;
+	ecc_strength = fdtdec_get_int(blob, node, "sandbox,ecc-strength", 8);
+
+	pages = priv->blocks * priv->pages_per_block;
+	priv->buf = malloc(priv->page_size + priv->oob_size);
+	priv->cur = malloc(priv->page_size);
+	priv->ff = malloc(priv->page_size * priv->pages_per_block);
+	priv->failing = calloc(priv->blocks, 1);
+	priv->oob = os_malloc(pages * priv->oob_size);
+	if (!priv->buf || !priv->cur || !priv->ff || !priv->failing ||
+	    !priv->oob) {
+		ret = -ENOMEM;
+		goto err;
+	}
+	memset(priv->ff, 0xff, priv->page_size * priv->pages_per_block);
+
+	if (fname) {
+		priv->fd = os_open(fname, OS_O_RDWR | OS_O_CREAT);
+	} else {
+		fname = tmpname;
+		priv->fd = os_mkstemp(tmpname);
+		if (priv->fd >= 0)
+			os_unlink(tmpname);
+	}
+	if (priv->fd < 0) {
+		printf("Failed to open NAND backing file '%s'\n", fname);
+		ret = -ENOENT;
+		goto err;
+	}
+	priv->file_size = os_lseek(priv->fd, 0, OS_SEEK_END);
+
+	/* An ONFI-less SLC chip, identified by a table made to fit */
+	priv->id[0] = NAND_MFR_MICRON;
+	priv->id[1] = 0xd3;
+	priv->type[0].name = "Sandbox NAND";
+	memcpy(priv->type[0].id, priv->id, 4);
+	priv->type[0].id_len = 4;
+	priv->type[0].pagesize = priv->page_size;
+	priv->type[0].oobsize = priv->oob_size;
+	priv->type[0].erasesize = priv->page_size * priv->pages_per_block;
+	priv->type[0].chipsize = ((u64)pages * priv->page_size) >> 20;
+	priv->type[0].ecc.strength_ds = ecc_strength;
+	priv->type[0].ecc.step_ds = 512;
+
+	/* The simulated ECC needs no room in the OOB area */
+	priv->layout.oobfree[0].offset = 2;
+	priv->layout.oobfree[0].length = priv->oob_size - 2;
+
+	chip = &priv->chip;
+	chip->priv = priv;
+	mtd->priv = chip;
+	chip->cmdfunc = sb_nand_cmdfunc;
+	chip->read_byte = sb_nand_read_byte;
+	chip->read_buf = sb_nand_read_buf;
+	chip->write_buf = sb_nand_write_buf;
+	chip->select_chip = sb_nand_select_chip;
+	chip->dev_ready = sb_nand_dev_ready;
+	chip->waitfunc = sb_nand_wait;
+	chip->options = NAND_NO_SUBPAGE_WRITE;
+	chip->ecc.mode = NAND_ECC_HW;
+	chip->ecc.size = 512;
+	chip->ecc.strength = ecc_strength;
+	chip->ecc.layout = &priv->layout;
+	chip->ecc.read_page = sb_nand_read_page;
+	chip->ecc.write_page = sb_nand_write_page;
+
+	ret = nand_scan_ident(mtd, 1, priv->type);
+	if (ret)
+		goto err_file;
+
+	ret = fdtdec_get_int_array_count(blob, node, "sandbox,bad-blocks",
+					 (u32 *)priv->bad,
+					 ARRAY_SIZE(priv->bad));
+	for (i = 0; i < ret; i++) {
+		if (priv->bad[i] >= 0 && priv->bad[i] < priv->blocks)
+			priv->bad[priv->bad_count++] = priv->bad[i];
+	}
+	sb_nand_mark_bad(priv);
+
+	ret = nand_scan_tail(mtd);
+	if (ret)
+		goto err_file;
+
+	return nand_register(devnum);
+err_file:
+	os_close(priv->fd);
+err:
+	if (priv->oob)
+		os_free(priv->oob);
+	free(priv->failing);
+	free(priv->ff);
+	free(priv->cur);
+	free(priv->buf);
+	free(priv);
+	mtd->priv = NULL;
+	return ret;
+}
+
+void board_nand_init(void)
+{
+	const void *blob = gd->fdt_blob;
+	int devnum = 0;
+	int node = -1;
+	int ret;
+
+	if (!blob)
+		return;
+	while (devnum < CONFIG_SYS_MAX_NAND_DEVICE) {
+		node = fdt_node_offset_by_compatible(blob, node,
+						     "sandbox,nand");
+		if (node < 0)
+			break;
+		if (!fdtdec_get_is_enabled(blob, node))
+			continue;
+		ret = sb_nand_init(devnum, blob, node);
+		if (ret) {
+			printf("%s: failed to set up NAND '%s' (err=%d)\n",
+			       __func__, fdt_get_name(blob, node, NULL), ret);
+			continue;
+		}
+		devnum++;
+	}
+}
@@ -17,7 +17,10 @@
 #include <spi_flash.h>
 #include "sf_internal.h"
 
+#include <linux/log2.h>
+
 #include <asm/getopt.h>
+#include <asm/unaligned.h>
 #include <asm/spi.h>
 #include <asm/state.h>
 #include <dm/device-internal.h>
@@ -41,13 +44,14 @@ enum sandbox_sf_state {
 	SF_READ_STATUS, /* read the flash's status register */
 	SF_READ_STATUS1, /* read the flash's status register upper 8 bits*/
 	SF_WRITE_STATUS, /* write the flash's status register */
+	SF_READ_SFDP, /* read the flash's SFDP tables */
 };
 
 static const char *sandbox_sf_state_name(enum sandbox_sf_state state)
 {
 	static const char * const states[] = {
 		"CMD", "ID", "ADDR", "READ", "WRITE", "ERASE", "READ_STATUS",
-		"READ_STATUS1", "WRITE_STATUS",
+		"READ_STATUS1", "WRITE_STATUS", "READ_SFDP",
 	};
 	return states[state];
 }
@@ -56,11 +60,16 @@ static const char *sandbox_sf_state_name(enum sandbox_sf_state state)
 #define STAT_WIP	(1 << 0)
 #define STAT_WEL	(1 << 1)
 
-/* Assume all SPI flashes have 3 byte addresses since they do atm */
-#define SF_ADDR_LEN	3
-
 #define IDCODE_LEN 3
 
+/*
+ * Layout of the SFDP tables: the header, two parameter headers, the BFPT
+ * and then the 4-byte address instruction table
+ */
+#define SF_SFDP_BFPT	0x20
+#define SF_SFDP_4BAIT	(SF_SFDP_BFPT + SFDP_BFPT_DWORDS * 4)
+#define SF_SFDP_SIZE	(SF_SFDP_4BAIT + SFDP_4BAIT_DWORDS * 4)
+
 /* Used to quickly bulk erase backing store */
 static u8 sandbox_sf_0xff[0x1000];
 
@@ -83,14 +92,18 @@ struct sandbox_spi_flash {
 	uint erase_size;
 	/* Current position in the flash; used when reading/writing/etc... */
 	uint off;
-	/* How many address bytes we've consumed */
-	uint addr_bytes, pad_addr_bytes;
+	/* How many address bytes we've consumed, and how many to expect */
+	uint addr_bytes, pad_addr_bytes, addr_len;
 	/* The current flash status (see STAT_XXX defines above) */
 	u16 status;
 	/* Data describing the flash we're emulating */
 	const struct spi_flash_params *data;
 	/* The file on disk to serv up data from */
 	int fd;
+	/* SFDP tables describing the flash */
+	u8 sfdp[SF_SFDP_SIZE];
+	/* Number of erase commands carried out, for tests */
+	uint erase_count;
 };
 
 struct sandbox_spi_flash_plat_data {
@@ -100,6 +113,128 @@ struct sandbox_spi_flash_plat_data {
 	int cs;
 };
 
+static void sandbox_sf_put_sfdp(struct sandbox_spi_flash *sbsf, uint offset,
+				const u32 *table, int dwords)
+{
+	int i;
+
+	for (i = 0; i < dwords; i++)
+		put_unaligned_le32(table[i], sbsf->sfdp + offset + i * 4);
+}
+
+/*
+ * Build SFDP tables which describe what this emulator supports for the
+ * flash, i.e. the erase sizes allowed by its flags and its read commands.
+ * Flash larger than 16MiB also gets a 4-byte address instruction table.
+ */
+static void sandbox_sf_setup_sfdp(struct sandbox_spi_flash *sbsf)
+{
+	const struct spi_flash_params *data = sbsf->data;
+	u64 bits = (u64)data->sector_size * data->nr_sectors * 8;
+	u32 bfpt[SFDP_BFPT_DWORDS], fbait[SFDP_4BAIT_DWORDS];
+	struct sfdp_param_header *ph;
+	struct sfdp_header *hdr;
+	bool large = bits > SPI_FLASH_16MB_BOUN * 8;
+
+	memset(sbsf->sfdp, 0xff, sizeof(sbsf->sfdp));
+	memset(bfpt, '\0', sizeof(bfpt));
+	memset(fbait, '\0', sizeof(fbait));
+
+	hdr = (struct sfdp_header *)sbsf->sfdp;
+	hdr->signature = cpu_to_le32(SFDP_SIGNATURE);
+	hdr->minor = 6;
+	hdr->major = 1;
+	hdr->nph = large ? 1 : 0;
+
+	ph = (struct sfdp_param_header *)(hdr + 1);
+	ph->id_lsb = SFDP_BFPT_ID & 0xff;
+	ph->id_msb = SFDP_BFPT_ID >> 8;
+	ph->minor = 6;
+	ph->major = 1;
+	ph->length = SFDP_BFPT_DWORDS;
+	ph->ptp[0] = SF_SFDP_BFPT;
+	ph->ptp[1] = 0;
+	ph->ptp[2] = 0;
+	if (large) {
+		ph++;
+		ph->id_lsb = SFDP_4BAIT_ID & 0xff;
+		ph->id_msb = SFDP_4BAIT_ID >> 8;
+		ph->minor = 0;
+		ph->major = 1;
+		ph->length = SFDP_4BAIT_DWORDS;
+		ph->ptp[0] = SF_SFDP_4BAIT;
+		ph->ptp[1] = 0;
+		ph->ptp[2] = 0;
+	}
+
+	/* The 4KiB erase opcode lives in DWORD1 as well as DWORD8 */
+	if (data->flags & SECT_4K)
+		bfpt[0] = 1 | CMD_ERASE_4K << 8;
+	else
+		bfpt[0] = 3 | 0xff << 8;
+	if (large)
+		bfpt[0] |= BFPT_DW1_ADDR_BYTES_3_OR_4;
+	if (bits > 1ULL << 31)
+		bfpt[1] = BFPT_DW2_DENSITY_POW2 | ilog2(bits);
+	else
+		bfpt[1] = bits - 1;
+
+	/*
+	 * Describe the dual/quad reads with the dummy cycles that the driver
+	 * has always used for them
+	 */
+	if (data->e_rd_cmd & QUAD_IO_FAST) {
+		bfpt[0] |= BFPT_DW1_FAST_READ_1_4_4;
+		bfpt[2] |= CMD_READ_QUAD_IO_FAST << 8 | 2 << 5 | 2;
+	}
+	if (data->e_rd_cmd & QUAD_OUTPUT_FAST) {
+		bfpt[0] |= BFPT_DW1_FAST_READ_1_1_4;
+		bfpt[2] |= (CMD_READ_QUAD_OUTPUT_FAST << 8 | 8) << 16;
+	}
+	if (data->e_rd_cmd & DUAL_OUTPUT_FAST) {
+		bfpt[0] |= BFPT_DW1_FAST_READ_1_1_2;
+		bfpt[3] |= CMD_READ_DUAL_OUTPUT_FAST << 8 | 8;
+	}
+	if (data->e_rd_cmd & DUAL_IO_FAST) {
+		bfpt[0] |= BFPT_DW1_FAST_READ_1_2_2;
+		bfpt[3] |= (CMD_READ_DUAL_IO_FAST << 8 | 4) << 16;
+	}
+
+	/* Erase types 1-3 are 4KiB, 32KiB (if supported) and a whole sector */
+	if (data->flags & SECT_4K)
+		bfpt[7] |= CMD_ERASE_4K << 8 | 12;
+	if (data->flags & SECT_32K)
+		bfpt[7] |= (CMD_ERASE_32K << 8 | 15) << 16;
+	bfpt[8] |= CMD_ERASE_64K << 8 | ilog2(data->sector_size);
+
+	/* 256-byte pages */
+	bfpt[10] = 8 << 4;
+	sandbox_sf_put_sfdp(sbsf, SF_SFDP_BFPT, bfpt, SFDP_BFPT_DWORDS);
+
+	if (!large)
+		return;
+	fbait[0] = SFDP_4BAIT_READ_1_1_1 | SFDP_4BAIT_FAST_READ_1_1_1 |
+		SFDP_4BAIT_PP_1_1_1;
+	if (data->e_rd_cmd & DUAL_OUTPUT_FAST)
+		fbait[0] |= SFDP_4BAIT_FAST_READ_1_1_2;
+	if (data->e_rd_cmd & DUAL_IO_FAST)
+		fbait[0] |= SFDP_4BAIT_FAST_READ_1_2_2;
+	if (data->e_rd_cmd & QUAD_OUTPUT_FAST)
+		fbait[0] |= SFDP_4BAIT_FAST_READ_1_1_4;
+	if (data->e_rd_cmd & QUAD_IO_FAST)
+		fbait[0] |= SFDP_4BAIT_FAST_READ_1_4_4;
+	if (data->flags & WR_QPP)
+		fbait[0] |= SFDP_4BAIT_PP_1_1_4;
+	if (data->flags & SECT_4K)
+		fbait[0] |= SFDP_4BAIT_ERASE_TYPE(0);
+	if (data->flags & SECT_32K)
+		fbait[0] |= SFDP_4BAIT_ERASE_TYPE(1);
+	fbait[0] |= SFDP_4BAIT_ERASE_TYPE(2);
+	fbait[1] = CMD_ERASE_4K_4B | CMD_ERASE_32K_4B << 8 |
+		CMD_ERASE_64K_4B << 16 | 0xff << 24;
+	sandbox_sf_put_sfdp(sbsf, SF_SFDP_4BAIT, fbait, SFDP_4BAIT_DWORDS);
+}
+
 /**
  * This is a very strange probe function. If it has platform data (which may
  * have come from the device tree) then this function gets the filename and
@@ -195,6 +330,7 @@ static int sandbox_sf_probe(struct udevice *dev)
 
 	sbsf->data = data;
 	sbsf->cs = cs;
+	sandbox_sf_setup_sfdp(sbsf);
 
 	return 0;
 
@@ -222,6 +358,7 @@ static void sandbox_sf_cs_activate(struct udevice *dev)
 	sbsf->off = 0;
 	sbsf->addr_bytes = 0;
 	sbsf->pad_addr_bytes = 0;
+	sbsf->addr_len = SPI_FLASH_3B_ADDR_LEN;
 	sbsf->state = SF_CMD;
 	sbsf->cmd = SF_CMD;
 }
@@ -244,6 +381,27 @@ static void sandbox_spi_tristate(u8 *buf, uint len)
 	memset(buf, 0xff, len);
 }
 
+/* Get the spi_read_cmds bit for a dual/quad read opcode */
+static uint sandbox_sf_read_cmd(uint op)
+{
+	switch (op) {
+	case CMD_READ_DUAL_OUTPUT_FAST:
+	case CMD_READ_DUAL_OUTPUT_FAST_4B:
+		return DUAL_OUTPUT_FAST;
+	case CMD_READ_DUAL_IO_FAST:
+	case CMD_READ_DUAL_IO_FAST_4B:
+		return DUAL_IO_FAST;
+	case CMD_READ_QUAD_OUTPUT_FAST:
+	case CMD_READ_QUAD_OUTPUT_FAST_4B:
+		return QUAD_OUTPUT_FAST;
+	case CMD_READ_QUAD_IO_FAST:
+	case CMD_READ_QUAD_IO_FAST_4B:
+		return QUAD_IO_FAST;
+	default:
+		return 0;
+	}
+}
+
 /* Figure out what command this stream is telling us to do */
 static int sandbox_sf_process_cmd(struct sandbox_spi_flash *sbsf, const u8 *rx,
 				  u8 *tx)
@@ -260,10 +418,50 @@ static int sandbox_sf_process_cmd(struct sandbox_spi_flash *sbsf, const u8 *rx,
 		sbsf->state = SF_ID;
 		sbsf->cmd = SF_ID;
 		break;
+	case CMD_READ_ARRAY_FAST_4B:
+	case CMD_READ_ARRAY_SLOW_4B:
+	case CMD_PAGE_PROGRAM_4B:
+		sbsf->addr_len = SPI_FLASH_4B_ADDR_LEN;
+		/* fall through */
 	case CMD_READ_ARRAY_FAST:
-		sbsf->pad_addr_bytes = 1;
 	case CMD_READ_ARRAY_SLOW:
 	case CMD_PAGE_PROGRAM:
+	case CMD_READ_SFDP:
+		if (sbsf->cmd == CMD_READ_ARRAY_FAST ||
+		    sbsf->cmd == CMD_READ_ARRAY_FAST_4B ||
+		    sbsf->cmd == CMD_READ_SFDP)
+			sbsf->pad_addr_bytes = 1;
+		sbsf->state = SF_ADDR;
+		break;
+	case CMD_READ_DUAL_OUTPUT_FAST_4B:
+	case CMD_READ_DUAL_IO_FAST_4B:
+	case CMD_READ_QUAD_OUTPUT_FAST_4B:
+	case CMD_READ_QUAD_IO_FAST_4B:
+		sbsf->addr_len = SPI_FLASH_4B_ADDR_LEN;
+		/* fall through */
+	case CMD_READ_DUAL_OUTPUT_FAST:
+	case CMD_READ_DUAL_IO_FAST:
+	case CMD_READ_QUAD_OUTPUT_FAST:
+	case CMD_READ_QUAD_IO_FAST: {
+		/* Dummy bytes match the cycles advertised in the SFDP tables */
+		uint rd = sandbox_sf_read_cmd(sbsf->cmd);
+
+		if (!(sbsf->data->e_rd_cmd & rd)) {
+			debug(" cmd unsupported: %#x\n", sbsf->cmd);
+			return -EIO;
+		}
+		sbsf->pad_addr_bytes = rd == QUAD_IO_FAST ? 2 : 1;
+		sbsf->state = SF_ADDR;
+		break;
+	}
+	case CMD_QUAD_PAGE_PROGRAM_4B:
+		sbsf->addr_len = SPI_FLASH_4B_ADDR_LEN;
+		/* fall through */
+	case CMD_QUAD_PAGE_PROGRAM:
+		if (!(sbsf->data->flags & WR_QPP)) {
+			debug(" cmd unsupported: %#x\n", sbsf->cmd);
+			return -EIO;
+		}
 		sbsf->state = SF_ADDR;
 		break;
 	case CMD_WRITE_DISABLE:
@@ -285,18 +483,32 @@ static int sandbox_sf_process_cmd(struct sandbox_spi_flash *sbsf, const u8 *rx,
 		break;
 	default: {
 		int flags = sbsf->data->flags;
+		uint cmd = sbsf->cmd;
+
+		switch (cmd) {
+		case CMD_ERASE_4K_4B:
+			cmd = CMD_ERASE_4K;
+			break;
+		case CMD_ERASE_32K_4B:
+			cmd = CMD_ERASE_32K;
+			break;
+		case CMD_ERASE_64K_4B:
+			cmd = CMD_ERASE_64K;
+			break;
+		}
+		if (cmd != sbsf->cmd)
+			sbsf->addr_len = SPI_FLASH_4B_ADDR_LEN;
 
 		/* we only support erase here */
-		if (sbsf->cmd == CMD_ERASE_CHIP) {
+		if (cmd == CMD_ERASE_CHIP) {
 			sbsf->erase_size = sbsf->data->sector_size *
 				sbsf->data->nr_sectors;
-		} else if (sbsf->cmd == CMD_ERASE_4K && (flags & SECT_4K)) {
+		} else if (cmd == CMD_ERASE_4K && (flags & SECT_4K)) {
 			sbsf->erase_size = 4 << 10;
-		} else if (sbsf->cmd == CMD_ERASE_32K && (flags & SECT_32K)) {
+		} else if (cmd == CMD_ERASE_32K && (flags & SECT_32K)) {
 			sbsf->erase_size = 32 << 10;
-		} else if (sbsf->cmd == CMD_ERASE_64K &&
-			   !(flags & (SECT_4K | SECT_32K))) {
-			sbsf->erase_size = 64 << 10;
+		} else if (cmd == CMD_ERASE_64K) {
+			sbsf->erase_size = sbsf->data->sector_size;
 		} else {
 			debug(" cmd unknown: %#x\n", sbsf->cmd);
 			return -EIO;
@@ -376,7 +588,7 @@ static int sandbox_sf_xfer(struct udevice *dev, unsigned int bitlen,
 			debug(" addr: bytes:%u rx:%02x ", sbsf->addr_bytes,
 			      rx[pos]);
 
-			if (sbsf->addr_bytes++ < SF_ADDR_LEN)
+			if (sbsf->addr_bytes++ < sbsf->addr_len)
 				sbsf->off = (sbsf->off << 8) | rx[pos];
 			debug("addr:%06x\n", sbsf->off);
 
@@ -386,10 +598,14 @@ static int sandbox_sf_xfer(struct udevice *dev, unsigned int bitlen,
 
 			/* See if we're done processing */
 			if (sbsf->addr_bytes <
-					SF_ADDR_LEN + sbsf->pad_addr_bytes)
+					sbsf->addr_len + sbsf->pad_addr_bytes)
 				break;
 
 			/* Next state! */
+			if (sbsf->cmd == CMD_READ_SFDP) {
+				sbsf->state = SF_READ_SFDP;
+				break;
+			}
 			if (os_lseek(sbsf->fd, sbsf->off, OS_SEEK_SET) < 0) {
 				puts("sandbox_sf: os_lseek() failed");
 				return -EIO;
@@ -397,9 +613,22 @@ static int sandbox_sf_xfer(struct udevice *dev, unsigned int bitlen,
 			switch (sbsf->cmd) {
 			case CMD_READ_ARRAY_FAST:
 			case CMD_READ_ARRAY_SLOW:
+			case CMD_READ_DUAL_OUTPUT_FAST:
+			case CMD_READ_DUAL_IO_FAST:
+			case CMD_READ_QUAD_OUTPUT_FAST:
+			case CMD_READ_QUAD_IO_FAST:
+			case CMD_READ_ARRAY_FAST_4B:
+			case CMD_READ_ARRAY_SLOW_4B:
+			case CMD_READ_DUAL_OUTPUT_FAST_4B:
+			case CMD_READ_DUAL_IO_FAST_4B:
+			case CMD_READ_QUAD_OUTPUT_FAST_4B:
+			case CMD_READ_QUAD_IO_FAST_4B:
 				sbsf->state = SF_READ;
 				break;
 			case CMD_PAGE_PROGRAM:
+			case CMD_QUAD_PAGE_PROGRAM:
+			case CMD_PAGE_PROGRAM_4B:
+			case CMD_QUAD_PAGE_PROGRAM_4B:
 				sbsf->state = SF_WRITE;
 				break;
 			default:
@@ -439,8 +668,28 @@ static int sandbox_sf_xfer(struct udevice *dev, unsigned int bitlen,
 			pos += cnt;
 			break;
 		case SF_WRITE_STATUS:
-			debug(" write status: %#x (ignored)\n", rx[pos]);
-			pos = bytes;
+			/* The second byte, if any, is the upper 8 bits */
+			debug(" write status: %#x\n", rx[pos]);
+			if (sbsf->off++)
+				sbsf->status = (sbsf->status & 0xff) |
+					rx[pos] << 8;
+			else
+				sbsf->status = (sbsf->status & 0xff00) |
+					(rx[pos] & ~(STAT_WIP | STAT_WEL));
+			pos++;
+			if (pos == bytes || sbsf->off == 2) {
+				sbsf->status &= ~STAT_WEL;
+				pos = bytes;
+			}
+			break;
+		case SF_READ_SFDP:
+			cnt = bytes - pos;
+			debug(" read sfdp: off:%#x len:%u\n", sbsf->off, cnt);
+			while (cnt--) {
+				tx[pos++] = sbsf->off < SF_SFDP_SIZE ?
+					sbsf->sfdp[sbsf->off] : 0xff;
+				sbsf->off++;
+			}
 			break;
 		case SF_WRITE:
 			/*
@@ -495,6 +744,7 @@ static int sandbox_sf_xfer(struct udevice *dev, unsigned int bitlen,
 			 * delay before clearing it ?
 			 */
 			ret = sandbox_erase_part(sbsf, sbsf->erase_size);
+			sbsf->erase_count++;
 			sbsf->status &= ~STAT_WEL;
 			if (ret) {
 				debug("sandbox_sf: Erase failed\n");
@@ -514,6 +764,13 @@ static int sandbox_sf_xfer(struct udevice *dev, unsigned int bitlen,
 	return pos == bytes ? 0 : -EIO;
 }
 
+uint sandbox_sf_get_erase_count(struct udevice *dev)
+{
+	struct sandbox_spi_flash *sbsf = dev_get_priv(dev);
+
+	return sbsf->erase_count;
+}
+
 int sandbox_sf_ofdata_to_platdata(struct udevice *dev)
 {
 	struct sandbox_spi_flash_plat_data *pdata = dev_get_platdata(dev);
@@ -54,7 +54,9 @@ enum spi_nor_option_flags {
 };
 
 #define SPI_FLASH_3B_ADDR_LEN		3
+#define SPI_FLASH_4B_ADDR_LEN		4
 #define SPI_FLASH_CMD_LEN		(1 + SPI_FLASH_3B_ADDR_LEN)
+#define SPI_FLASH_CMD_MAX_LEN		(1 + SPI_FLASH_4B_ADDR_LEN)
 #define SPI_FLASH_16MB_BOUN		0x1000000
 
 /* CFI Manufacture ID's */
@@ -92,6 +94,20 @@ enum spi_nor_option_flags {
 #define CMD_READ_CONFIG			0x35
 #define CMD_FLAG_STATUS			0x70
 #define CMD_READ_EVCR			0x65
+#define CMD_READ_SFDP			0x5a
+
+/* 4-byte address commands */
+#define CMD_READ_ARRAY_SLOW_4B		0x13
+#define CMD_READ_ARRAY_FAST_4B		0x0c
+#define CMD_READ_DUAL_OUTPUT_FAST_4B	0x3c
+#define CMD_READ_DUAL_IO_FAST_4B	0xbc
+#define CMD_READ_QUAD_OUTPUT_FAST_4B	0x6c
+#define CMD_READ_QUAD_IO_FAST_4B	0xec
+#define CMD_PAGE_PROGRAM_4B		0x12
+#define CMD_QUAD_PAGE_PROGRAM_4B	0x34
+#define CMD_ERASE_4K_4B			0x21
+#define CMD_ERASE_32K_4B		0x5c
+#define CMD_ERASE_64K_4B		0xdc
 
 /* Bank addr access commands */
 #ifdef CONFIG_SPI_FLASH_BAR
@@ -111,6 +127,67 @@ enum spi_nor_option_flags {
 #define SR_BP1				BIT(3)  /* Block protect 1 */
 #define SR_BP2				BIT(4)  /* Block protect 2 */
 
+/* SFDP (JESD216) tables */
+#define SFDP_SIGNATURE			0x50444653	/* "SFDP" */
+#define SFDP_BFPT_ID			0xff00	/* Basic Flash Parameters */
+#define SFDP_4BAIT_ID			0xff84	/* 4-byte Address Instrs */
+#define SFDP_BFPT_DWORDS		16
+#define SFDP_4BAIT_DWORDS		2
+
+struct sfdp_header {
+	u32 signature;
+	u8 minor;
+	u8 major;
+	u8 nph;			/* number of parameter headers, less one */
+	u8 unused;
+} __packed;
+
+struct sfdp_param_header {
+	u8 id_lsb;
+	u8 minor;
+	u8 major;
+	u8 length;		/* in 32-bit words */
+	u8 ptp[3];		/* table pointer, little endian */
+	u8 id_msb;
+} __packed;
+
+/* BFPT DWORD1 */
+#define BFPT_DW1_ERASE_4K_OPCODE(dw)	(((dw) >> 8) & 0xff)
+#define BFPT_DW1_FAST_READ_1_1_2	BIT(16)
+#define BFPT_DW1_ADDR_BYTES_MASK	(3 << 17)
+#define BFPT_DW1_ADDR_BYTES_3_ONLY	(0 << 17)
+#define BFPT_DW1_ADDR_BYTES_3_OR_4	(1 << 17)
+#define BFPT_DW1_ADDR_BYTES_4_ONLY	(2 << 17)
+#define BFPT_DW1_FAST_READ_1_2_2	BIT(20)
+#define BFPT_DW1_FAST_READ_1_4_4	BIT(21)
+#define BFPT_DW1_FAST_READ_1_1_4	BIT(22)
+
+/* BFPT DWORD2: density in bits, less one, or 2^N bits if bit 31 is set */
+#define BFPT_DW2_DENSITY_POW2		BIT(31)
+
+/*
+ * BFPT DWORD3/4 each describe two fast reads, one in each half: the number
+ * of wait states in bits 4:0, mode clocks in bits 7:5 and the opcode in
+ * bits 15:8
+ */
+#define BFPT_READ_WAIT(half)		((half) & 0x1f)
+#define BFPT_READ_MODE(half)		(((half) >> 5) & 0x7)
+#define BFPT_READ_OPCODE(half)		(((half) >> 8) & 0xff)
+
+/* BFPT DWORD11: page size is 2^N bytes */
+#define BFPT_DW11_PAGE_SIZE_SHIFT(dw)	(((dw) >> 4) & 0xf)
+
+/* 4BAIT DWORD1 */
+#define SFDP_4BAIT_READ_1_1_1		BIT(0)
+#define SFDP_4BAIT_FAST_READ_1_1_1	BIT(1)
+#define SFDP_4BAIT_FAST_READ_1_1_2	BIT(2)
+#define SFDP_4BAIT_FAST_READ_1_2_2	BIT(3)
+#define SFDP_4BAIT_FAST_READ_1_1_4	BIT(4)
+#define SFDP_4BAIT_FAST_READ_1_4_4	BIT(5)
+#define SFDP_4BAIT_PP_1_1_1		BIT(6)
+#define SFDP_4BAIT_PP_1_1_4		BIT(7)
+#define SFDP_4BAIT_ERASE_TYPE(n)	BIT(9 + (n))
+
 /* Flash timeout values */
 #define SPI_FLASH_PROG_TIMEOUT		(2 * CONFIG_SYS_HZ)
 #define SPI_FLASH_PAGE_ERASE_TIMEOUT	(5 * CONFIG_SYS_HZ)
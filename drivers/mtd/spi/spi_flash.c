@@ -22,12 +22,13 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
-static void spi_flash_addr(u32 addr, u8 *cmd)
+static void spi_flash_addr(struct spi_flash *flash, u32 addr, u8 *cmd)
 {
+	int i;
+
 	/* cmd[0] is actual command */
-	cmd[1] = addr >> 16;
-	cmd[2] = addr >> 8;
-	cmd[3] = addr >> 0;
+	for (i = flash->addr_width; i > 0; i--, addr >>= 8)
+		cmd[i] = addr;
 }
 
 static int read_sr(struct spi_flash *flash, u8 *rs)
@@ -149,6 +150,10 @@ static int spi_flash_write_bar(struct spi_flash *flash, u32 offset)
 	u8 cmd, bank_sel;
 	int ret;
 
+	/* 4-byte addresses reach the whole flash without a bank register */
+	if (flash->addr_width == SPI_FLASH_4B_ADDR_LEN)
+		return 0;
+
 	bank_sel = offset / (SPI_FLASH_16MB_BOUN << flash->shift);
 	if (bank_sel == flash->bank_curr)
 		goto bar_end;
@@ -170,7 +175,8 @@ static int spi_flash_read_bar(struct spi_flash *flash, u8 idcode0)
 	u8 curr_bank = 0;
 	int ret;
 
-	if (flash->size <= SPI_FLASH_16MB_BOUN)
+	if (flash->size <= SPI_FLASH_16MB_BOUN ||
+	    flash->addr_width == SPI_FLASH_4B_ADDR_LEN)
 		goto bar_end;
 
 	switch (idcode0) {
@@ -323,10 +329,47 @@ int spi_flash_write_common(struct spi_flash *flash, const u8 *cmd,
 	return ret;
 }
 
+/* Record an erase command, keeping erase_types sorted by size */
+static void spi_flash_add_erase(struct spi_flash *flash, u32 size, u8 cmd)
+{
+	struct spi_flash_erase_type *et = flash->erase_types;
+	int i;
+
+	for (i = 0; i < SPI_FLASH_ERASE_TYPES && et[i].size; i++) {
+		if (et[i].size == size)
+			return;
+		if (et[i].size > size)
+			break;
+	}
+	if (et[SPI_FLASH_ERASE_TYPES - 1].size)
+		return;
+	memmove(&et[i + 1], &et[i], (SPI_FLASH_ERASE_TYPES - 1 - i) *
+		sizeof(*et));
+	et[i].size = size;
+	et[i].cmd = cmd;
+}
+
+/* Pick the largest erase command that fits the start of a region */
+static const struct spi_flash_erase_type *
+spi_flash_plan_erase(struct spi_flash *flash, u32 offset, size_t len)
+{
+	const struct spi_flash_erase_type *et;
+	int i;
+
+	for (i = SPI_FLASH_ERASE_TYPES - 1; i > 0; i--) {
+		et = &flash->erase_types[i];
+		if (et->size && !(offset % et->size) && len >= et->size)
+			return et;
+	}
+
+	return &flash->erase_types[0];
+}
+
 int spi_flash_cmd_erase_ops(struct spi_flash *flash, u32 offset, size_t len)
 {
+	const struct spi_flash_erase_type *et;
 	u32 erase_size, erase_addr;
-	u8 cmd[SPI_FLASH_CMD_LEN];
+	u8 cmd[SPI_FLASH_CMD_MAX_LEN];
 	int ret = -1;
 
 	erase_size = flash->erase_size;
@@ -343,8 +386,9 @@ int spi_flash_cmd_erase_ops(struct spi_flash *flash, u32 offset, size_t len)
 		}
 	}
 
-	cmd[0] = flash->erase_cmd;
 	while (len) {
+		et = spi_flash_plan_erase(flash, offset, len);
+		cmd[0] = et->cmd;
 		erase_addr = offset;
 
 #ifdef CONFIG_SF_DUAL_FLASH
@@ -356,19 +400,20 @@ int spi_flash_cmd_erase_ops(struct spi_flash *flash, u32 offset, size_t len)
 		if (ret < 0)
 			return ret;
 #endif
-		spi_flash_addr(erase_addr, cmd);
+		spi_flash_addr(flash, erase_addr, cmd);
 
-		debug("SF: erase %2x %2x %2x %2x (%x)\n", cmd[0], cmd[1],
-		      cmd[2], cmd[3], erase_addr);
+		debug("SF: erase %2x (%x) size %x\n", cmd[0], erase_addr,
+		      et->size);
 
-		ret = spi_flash_write_common(flash, cmd, sizeof(cmd), NULL, 0);
+		ret = spi_flash_write_common(flash, cmd, 1 + flash->addr_width,
+					     NULL, 0);
 		if (ret < 0) {
 			debug("SF: erase failed\n");
 			break;
 		}
 
-		offset += erase_size;
-		len -= erase_size;
+		offset += et->size;
+		len -= et->size;
 	}
 
 	return ret;
@@ -381,7 +426,7 @@ int spi_flash_cmd_write_ops(struct spi_flash *flash, u32 offset,
 	unsigned long byte_addr, page_size;
 	u32 write_addr;
 	size_t chunk_len, actual;
-	u8 cmd[SPI_FLASH_CMD_LEN];
+	u8 cmd[SPI_FLASH_CMD_MAX_LEN];
 	int ret = -1;
 
 	page_size = flash->page_size;
@@ -414,12 +459,12 @@ int spi_flash_cmd_write_ops(struct spi_flash *flash, u32 offset,
 			chunk_len = min(chunk_len,
 					(size_t)spi->max_write_size);
 
-		spi_flash_addr(write_addr, cmd);
+		spi_flash_addr(flash, write_addr, cmd);
 
-		debug("SF: 0x%p => cmd = { 0x%02x 0x%02x%02x%02x } chunk_len = %zu\n",
-		      buf + actual, cmd[0], cmd[1], cmd[2], cmd[3], chunk_len);
+		debug("SF: 0x%p => cmd = { 0x%02x 0x%x } chunk_len = %zu\n",
+		      buf + actual, cmd[0], write_addr, chunk_len);
 
-		ret = spi_flash_write_common(flash, cmd, sizeof(cmd),
+		ret = spi_flash_write_common(flash, cmd, 1 + flash->addr_width,
 					buf + actual, chunk_len);
 		if (ret < 0) {
 			debug("SF: write failed\n");
@@ -491,7 +536,7 @@ int spi_flash_cmd_read_ops(struct spi_flash *flash, u32 offset,
 		return 0;
 	}
 
-	cmdsz = SPI_FLASH_CMD_LEN + flash->dummy_byte;
+	cmdsz = 1 + flash->addr_width + flash->dummy_byte;
 	cmd = calloc(1, cmdsz);
 	if (!cmd) {
 		debug("SF: Failed to allocate cmd\n");
@@ -514,12 +559,13 @@ int spi_flash_cmd_read_ops(struct spi_flash *flash, u32 offset,
 #endif
 		remain_len = ((SPI_FLASH_16MB_BOUN << flash->shift) *
 				(bank_sel + 1)) - offset;
-		if (len < remain_len)
+		if (len < remain_len ||
+		    flash->addr_width == SPI_FLASH_4B_ADDR_LEN)
 			read_len = len;
 		else
 			read_len = remain_len;
 
-		spi_flash_addr(read_addr, cmd);
+		spi_flash_addr(flash, read_addr, cmd);
 
 		ret = spi_flash_read_common(flash, cmd, cmdsz, data, read_len);
 		if (ret < 0) {
@@ -536,6 +582,206 @@ int spi_flash_cmd_read_ops(struct spi_flash *flash, u32 offset,
 	return ret;
 }
 
+static bool spi_flash_is_erased(const u8 *buf, size_t len)
+{
+	while (len--) {
+		if (*buf++ != 0xff)
+			return false;
+	}
+
+	return true;
+}
+
+/* Check whether going from @cur to @data needs any bits to be set */
+static bool spi_flash_needs_erase(const u8 *cur, const u8 *data, size_t len)
+{
+	while (len--) {
+		if ((*cur++ & *data) != *data)
+			return true;
+		data++;
+	}
+
+	return false;
+}
+
+/**
+ * struct spi_flash_update_ctx - State for spi_flash_update()
+ *
+ * @flash:	SPI flash being updated
+ * @offset:	Offset of the region being written
+ * @len:	Length of the region being written
+ * @buf:	Data to write to the region
+ * @flags:	SPI_FLASH_UPDATE_... flags
+ * @merged:	Data for the first and last erase blocks (in that order), if
+ *		the region only covers part of them
+ * @stats:	What has been done so far
+ */
+struct spi_flash_update_ctx {
+	struct spi_flash *flash;
+	u32 offset;
+	u32 len;
+	const u8 *buf;
+	uint flags;
+	u8 *merged;
+	struct spi_flash_update_stats *stats;
+};
+
+/* Get the data which an erase block should end up holding */
+static u8 *spi_flash_update_data(struct spi_flash_update_ctx *ctx, u32 addr)
+{
+	u32 blk = ctx->flash->erase_size;
+
+	if (addr >= ctx->offset && addr + blk <= ctx->offset + ctx->len)
+		return (u8 *)ctx->buf + addr - ctx->offset;
+
+	/* Only the first and last blocks can be partly covered */
+	if (addr == rounddown(ctx->offset, blk))
+		return ctx->merged;
+
+	return ctx->merged + blk;
+}
+
+/* Check whether an erase block must be erased before it is programmed */
+static bool spi_flash_update_needs_erase(struct spi_flash_update_ctx *ctx,
+					 const u8 *cur, const u8 *data)
+{
+	u32 blk = ctx->flash->erase_size;
+
+	if (!memcmp(cur, data, blk) || spi_flash_is_erased(cur, blk))
+		return false;
+	if (ctx->flags & SPI_FLASH_UPDATE_NO_ERASE)
+		return spi_flash_needs_erase(cur, data, blk);
+
+	return true;
+}
+
+/*
+ * Program the pages of an erase block which differ from @cur, the current
+ * contents, or from the erased state if @cur is NULL
+ */
+static int spi_flash_update_pages(struct spi_flash_update_ctx *ctx, u32 addr,
+				  const u8 *cur)
+{
+	struct spi_flash *flash = ctx->flash;
+	const u8 *data = spi_flash_update_data(ctx, addr);
+	u32 pos, todo;
+	int ret;
+
+	for (pos = 0; pos < flash->erase_size; pos += todo) {
+		todo = min(flash->page_size, flash->erase_size - pos);
+		if (cur ? !memcmp(cur + pos, data + pos, todo) :
+		    spi_flash_is_erased(data + pos, todo))
+			continue;
+		ret = spi_flash_write(flash, addr + pos, todo, data + pos);
+		if (ret)
+			return ret;
+		ctx->stats->programmed += todo;
+	}
+
+	return 0;
+}
+
+/* Erase a run of blocks in as few commands as possible, then program them */
+static int spi_flash_update_run(struct spi_flash_update_ctx *ctx, u32 start,
+				u32 end)
+{
+	u32 addr;
+	int ret;
+
+	if (start == end)
+		return 0;
+	ret = spi_flash_erase(ctx->flash, start, end - start);
+	if (ret)
+		return ret;
+	ctx->stats->erased += end - start;
+	for (addr = start; addr < end; addr += ctx->flash->erase_size) {
+		ret = spi_flash_update_pages(ctx, addr, NULL);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+int spi_flash_update(struct spi_flash *flash, u32 offset, size_t len,
+		     const void *buf, uint flags,
+		     struct spi_flash_update_stats *stats)
+{
+	struct spi_flash_update_stats local_stats;
+	struct spi_flash_update_ctx ctx;
+	u32 blk = flash->erase_size;
+	u32 start, end, addr, run;
+	u8 *cur, *data;
+	int ret = 0;
+
+	if (offset > flash->size || len > flash->size - offset)
+		return -EINVAL;
+	memset(&ctx, '\0', sizeof(ctx));
+	ctx.flash = flash;
+	ctx.offset = offset;
+	ctx.len = len;
+	ctx.buf = buf;
+	ctx.flags = flags;
+	ctx.stats = stats ? stats : &local_stats;
+	memset(ctx.stats, '\0', sizeof(*ctx.stats));
+	if (!len)
+		return 0;
+
+	start = rounddown(offset, blk);
+	end = roundup(offset + len, blk);
+	cur = memalign(ARCH_DMA_MINALIGN, blk);
+	if (!cur)
+		return -ENOMEM;
+
+	/* Partial blocks at either end are merged with what is there */
+	if (start != offset || end != offset + len) {
+		ctx.merged = malloc(2 * blk);
+		if (!ctx.merged) {
+			free(cur);
+			return -ENOMEM;
+		}
+	}
+
+	/* Blocks which need erasing are collected into runs from @run */
+	for (addr = run = start; addr < end; addr += blk) {
+		u32 from = max(addr, offset);
+		u32 to = min(addr + blk, offset + (u32)len);
+
+		ret = spi_flash_read(flash, addr, blk, cur);
+		if (ret)
+			break;
+		data = spi_flash_update_data(&ctx, addr);
+		if (from != addr || to != addr + blk) {
+			memcpy(data, cur, blk);
+			memcpy(data + from - addr, ctx.buf + from - offset,
+			       to - from);
+		}
+		if (spi_flash_update_needs_erase(&ctx, cur, data))
+			continue;
+
+		ret = spi_flash_update_run(&ctx, run, addr);
+		if (ret)
+			break;
+		run = addr + blk;
+		if (!memcmp(cur, data, blk)) {
+			ctx.stats->skipped += to - from;
+			continue;
+		}
+		ret = spi_flash_update_pages(&ctx, addr, cur);
+		if (ret)
+			break;
+	}
+	if (!ret)
+		ret = spi_flash_update_run(&ctx, run, end);
+	debug("SF: update: %u skipped, %u erased, %u programmed\n",
+	      ctx.stats->skipped, ctx.stats->erased, ctx.stats->programmed);
+
+	free(ctx.merged);
+	free(cur);
+
+	return ret;
+}
+
 #ifdef CONFIG_SPI_FLASH_SST
 static int sst_byte_write(struct spi_flash *flash, u32 offset, const void *buf)
 {
@@ -945,6 +1191,267 @@ static int set_quad_mode(struct spi_flash *flash, u8 idcode0)
 	}
 }
 
+static bool spi_flash_is_quad_cmd(u8 cmd)
+{
+	switch (cmd) {
+	case CMD_READ_QUAD_OUTPUT_FAST:
+	case CMD_READ_QUAD_IO_FAST:
+	case CMD_QUAD_PAGE_PROGRAM:
+	case CMD_READ_QUAD_OUTPUT_FAST_4B:
+	case CMD_READ_QUAD_IO_FAST_4B:
+	case CMD_QUAD_PAGE_PROGRAM_4B:
+		return true;
+	default:
+		return false;
+	}
+}
+
+#ifdef CONFIG_SPI_FLASH_SFDP
+/**
+ * struct sfdp_read - How SFDP describes one of the reads in spi_read_cmds
+ *
+ * @bfpt_bit:	Support bit in BFPT DWORD1, 0 for the plain 1-1-1 reads
+ * @dword:	BFPT DWORD (counting from 0) holding the read's description
+ * @shift:	Bit position of the description within that DWORD
+ * @addr_lines:	Number of lines used for the address and dummy cycles
+ * @fbait_bit:	Support bit in 4BAIT DWORD1
+ * @cmd_4b:	Opcode for the read with a 4-byte address
+ */
+struct sfdp_read {
+	u32 bfpt_bit;
+	u8 dword;
+	u8 shift;
+	u8 addr_lines;
+	u16 fbait_bit;
+	u8 cmd_4b;
+};
+
+/* In the same order as enum spi_read_cmds */
+static const struct sfdp_read sfdp_reads[] = {
+	{ 0, 0, 0, 1, SFDP_4BAIT_READ_1_1_1, CMD_READ_ARRAY_SLOW_4B },
+	{ 0, 0, 0, 1, SFDP_4BAIT_FAST_READ_1_1_1, CMD_READ_ARRAY_FAST_4B },
+	{ BFPT_DW1_FAST_READ_1_1_2, 3, 0, 1, SFDP_4BAIT_FAST_READ_1_1_2,
+	  CMD_READ_DUAL_OUTPUT_FAST_4B },
+	{ BFPT_DW1_FAST_READ_1_1_4, 2, 16, 1, SFDP_4BAIT_FAST_READ_1_1_4,
+	  CMD_READ_QUAD_OUTPUT_FAST_4B },
+	{ BFPT_DW1_FAST_READ_1_2_2, 3, 16, 2, SFDP_4BAIT_FAST_READ_1_2_2,
+	  CMD_READ_DUAL_IO_FAST_4B },
+	{ BFPT_DW1_FAST_READ_1_4_4, 2, 0, 4, SFDP_4BAIT_FAST_READ_1_4_4,
+	  CMD_READ_QUAD_IO_FAST_4B },
+};
+
+/* Get erase type @i (0-3) from BFPT DWORD8/9: size as a power of 2, opcode */
+static u16 sfdp_erase_type(const u32 *bfpt, int i)
+{
+	return bfpt[7 + i / 2] >> (16 * (i % 2));
+}
+
+static int spi_flash_read_sfdp(struct spi_flash *flash, u32 addr, void *buf,
+			       size_t len)
+{
+	u8 cmd[SPI_FLASH_CMD_LEN + 1];
+
+	/* SFDP always uses a 3-byte address and 8 dummy cycles */
+	cmd[0] = CMD_READ_SFDP;
+	cmd[1] = addr >> 16;
+	cmd[2] = addr >> 8;
+	cmd[3] = addr;
+	cmd[4] = 0;
+
+	return spi_flash_read_common(flash, cmd, sizeof(cmd), buf, len);
+}
+
+/* Read a parameter table, returning the number of DWORDs read */
+static int spi_flash_read_sfdp_table(struct spi_flash *flash,
+				     const struct sfdp_param_header *ph,
+				     u32 *table, int max_dwords)
+{
+	u32 addr = ph->ptp[0] | ph->ptp[1] << 8 | ph->ptp[2] << 16;
+	int dwords = min_t(int, ph->length, max_dwords);
+	int ret, i;
+
+	memset(table, '\0', max_dwords * sizeof(*table));
+	ret = spi_flash_read_sfdp(flash, addr, table, dwords * sizeof(*table));
+	if (ret)
+		return ret;
+	for (i = 0; i < dwords; i++)
+		table[i] = le32_to_cpu(table[i]);
+
+	return dwords;
+}
+
+/**
+ * spi_flash_parse_sfdp() - Set up the flash from its SFDP tables
+ *
+ * This replaces the size, page size, erase command and read command found
+ * from spi_flash_params_table with those the flash reports itself. Flash
+ * larger than 16MiB is switched to 4-byte addresses when it supports 4-byte
+ * versions of all the commands we use.
+ *
+ * @flash:	Flash to set up
+ * @return 0 if OK, -ve if the flash has no usable SFDP tables
+ */
+static int spi_flash_parse_sfdp(struct spi_flash *flash)
+{
+	u8 read_op[ARRAY_SIZE(sfdp_reads)], read_dummy[ARRAY_SIZE(sfdp_reads)];
+	u32 bfpt[SFDP_BFPT_DWORDS], fbait[SFDP_4BAIT_DWORDS];
+	struct sfdp_param_header ph;
+	struct sfdp_header hdr;
+	bool have_fbait = false, use_fbait = false;
+	int erase_type, erase_shift;
+	u32 supported, size, addr_bytes;
+	int ret, i, rd;
+
+	ret = spi_flash_read_sfdp(flash, 0, &hdr, sizeof(hdr));
+	if (ret)
+		return ret;
+	if (le32_to_cpu(hdr.signature) != SFDP_SIGNATURE || hdr.major != 1)
+		return -ENOENT;
+
+	/* The BFPT always comes first */
+	ret = spi_flash_read_sfdp(flash, sizeof(hdr), &ph, sizeof(ph));
+	if (ret)
+		return ret;
+	if ((ph.id_msb << 8 | ph.id_lsb) != SFDP_BFPT_ID || ph.major != 1)
+		return -EPROTONOSUPPORT;
+	ret = spi_flash_read_sfdp_table(flash, &ph, bfpt, SFDP_BFPT_DWORDS);
+	if (ret < 0)
+		return ret;
+	if (ret < 9)
+		return -EPROTONOSUPPORT;
+	if (ret >= 11 && BFPT_DW11_PAGE_SIZE_SHIFT(bfpt[10]))
+		flash->page_size = 1 << BFPT_DW11_PAGE_SIZE_SHIFT(bfpt[10]);
+
+	for (i = 1; i <= hdr.nph; i++) {
+		ret = spi_flash_read_sfdp(flash, sizeof(hdr) + i * sizeof(ph),
+					  &ph, sizeof(ph));
+		if (ret)
+			return ret;
+		if ((ph.id_msb << 8 | ph.id_lsb) != SFDP_4BAIT_ID)
+			continue;
+		ret = spi_flash_read_sfdp_table(flash, &ph, fbait,
+						SFDP_4BAIT_DWORDS);
+		if (ret < 0)
+			return ret;
+		have_fbait = ret == SFDP_4BAIT_DWORDS;
+		break;
+	}
+
+	/* Density is in bits */
+	if (bfpt[1] & BFPT_DW2_DENSITY_POW2) {
+		i = bfpt[1] & ~BFPT_DW2_DENSITY_POW2;
+		if (i < 3 || i - 3 >= 32)
+			return -EFBIG;
+		size = 1U << (i - 3);
+	} else {
+		size = (bfpt[1] >> 3) + 1;
+	}
+
+	/*
+	 * Pick the erase type to use as the erase size: the smallest if we
+	 * want small sectors, otherwise the largest
+	 */
+	erase_type = -1;
+	erase_shift = 0;
+	for (i = 0; i < 4; i++) {
+		int shift = sfdp_erase_type(bfpt, i) & 0xff;
+
+		if (!shift)
+			continue;
+		if (erase_type == -1 ||
+		    (IS_ENABLED(CONFIG_SPI_FLASH_USE_4K_SECTORS) ?
+		     shift < erase_shift : shift > erase_shift)) {
+			erase_type = i;
+			erase_shift = shift;
+		}
+	}
+	if (erase_type == -1 || erase_shift >= 32)
+		return -EPROTONOSUPPORT;
+
+	/* The plain reads need no description */
+	read_op[0] = CMD_READ_ARRAY_SLOW;
+	read_dummy[0] = 0;
+	read_op[1] = CMD_READ_ARRAY_FAST;
+	read_dummy[1] = 1;
+	supported = ARRAY_SLOW | ARRAY_FAST;
+	for (i = 2; i < ARRAY_SIZE(sfdp_reads); i++) {
+		const struct sfdp_read *sr = &sfdp_reads[i];
+		u32 desc = bfpt[sr->dword] >> sr->shift;
+		uint bits;
+
+		if (!(bfpt[0] & sr->bfpt_bit))
+			continue;
+		bits = (BFPT_READ_WAIT(desc) + BFPT_READ_MODE(desc)) *
+			sr->addr_lines;
+		/* We can only send whole dummy bytes */
+		if (bits % 8)
+			continue;
+		read_op[i] = BFPT_READ_OPCODE(desc);
+		read_dummy[i] = bits / 8;
+		supported |= 1 << i;
+	}
+
+	/* Look for the fastest read cmd, as with the params table */
+	rd = fls(supported & flash->spi->mode_rx);
+	rd = rd ? rd - 1 : 1;
+
+	flash->size = size;
+	flash->erase_size = 1 << erase_shift;
+	flash->sector_size = flash->erase_size;
+	flash->erase_cmd = sfdp_erase_type(bfpt, erase_type) >> 8;
+	flash->read_cmd = read_op[rd];
+	flash->dummy_byte = read_dummy[rd];
+
+	/* 3-byte addresses are enough for up to 16MiB */
+	addr_bytes = bfpt[0] & BFPT_DW1_ADDR_BYTES_MASK;
+	if (size <= SPI_FLASH_16MB_BOUN)
+		addr_bytes = BFPT_DW1_ADDR_BYTES_3_ONLY;
+	switch (addr_bytes) {
+	case BFPT_DW1_ADDR_BYTES_4_ONLY:
+		/* The usual opcodes take a 4-byte address */
+		flash->addr_width = SPI_FLASH_4B_ADDR_LEN;
+		break;
+	case BFPT_DW1_ADDR_BYTES_3_OR_4: {
+		u32 need = sfdp_reads[rd].fbait_bit |
+			SFDP_4BAIT_ERASE_TYPE(erase_type);
+		bool qpp = flash->write_cmd == CMD_QUAD_PAGE_PROGRAM;
+
+		need |= qpp ? SFDP_4BAIT_PP_1_1_4 : SFDP_4BAIT_PP_1_1_1;
+		if (!have_fbait || (fbait[0] & need) != need)
+			break;
+		flash->addr_width = SPI_FLASH_4B_ADDR_LEN;
+		flash->read_cmd = sfdp_reads[rd].cmd_4b;
+		flash->write_cmd = qpp ? CMD_QUAD_PAGE_PROGRAM_4B :
+			CMD_PAGE_PROGRAM_4B;
+		flash->erase_cmd = fbait[1] >> (8 * erase_type);
+		use_fbait = true;
+		break;
+	}
+	default:
+		break;
+	}
+
+	/* Larger erase types are used for regions aligned to them */
+	memset(flash->erase_types, '\0', sizeof(flash->erase_types));
+	for (i = 0; i < 4; i++) {
+		u16 desc = sfdp_erase_type(bfpt, i);
+		int shift = desc & 0xff;
+		u8 cmd = desc >> 8;
+
+		if (!shift || shift < erase_shift || shift >= 32)
+			continue;
+		if (use_fbait) {
+			if (!(fbait[0] & SFDP_4BAIT_ERASE_TYPE(i)))
+				continue;
+			cmd = fbait[1] >> (8 * i);
+		}
+		spi_flash_add_erase(flash, 1 << shift, cmd);
+	}
+
+	return 0;
+}
+#endif
+
 #if CONFIG_IS_ENABLED(OF_CONTROL)
 int spi_flash_decode_fdt(const void *blob, struct spi_flash *flash)
 {
@@ -1030,6 +1537,7 @@ int spi_flash_scan(struct spi_flash *flash)
 	flash->name = params->name;
 	flash->memory_map = spi->memory_map;
 	flash->dual_flash = spi->option;
+	flash->addr_width = SPI_FLASH_3B_ADDR_LEN;
 
 	/* Assign spi flash flags */
 	if (params->flags & SST_WR)
@@ -1100,6 +1608,10 @@ int spi_flash_scan(struct spi_flash *flash)
 		flash->erase_size = flash->sector_size;
 	}
 
+	/* Whole sectors can always be erased in one go with CMD_ERASE_64K */
+	spi_flash_add_erase(flash, flash->erase_size, flash->erase_cmd);
+	spi_flash_add_erase(flash, flash->sector_size, CMD_ERASE_64K);
+
 	/* Now erase size becomes valid sector size */
 	flash->sector_size = flash->erase_size;
 
@@ -1120,17 +1632,6 @@ int spi_flash_scan(struct spi_flash *flash)
 		/* Go for default supported write cmd */
 		flash->write_cmd = CMD_PAGE_PROGRAM;
 
-	/* Set the quad enable bit - only for quad commands */
-	if ((flash->read_cmd == CMD_READ_QUAD_OUTPUT_FAST) ||
-	    (flash->read_cmd == CMD_READ_QUAD_IO_FAST) ||
-	    (flash->write_cmd == CMD_QUAD_PAGE_PROGRAM)) {
-		ret = set_quad_mode(flash, idcode[0]);
-		if (ret) {
-			debug("SF: Fail to set QEB for %02x\n", idcode[0]);
-			return -EINVAL;
-		}
-	}
-
 	/* Read dummy_byte: dummy byte is determined based on the
 	 * dummy cycles of a particular command.
 	 * Fast commands - dummy_byte = dummy_cycles/8
@@ -1150,6 +1651,26 @@ int spi_flash_scan(struct spi_flash *flash)
 		flash->dummy_byte = 1;
 	}
 
+#ifdef CONFIG_SPI_FLASH_SFDP
+	/* Let the flash describe itself, where it can */
+	if (flash->dual_flash == SF_SINGLE_FLASH) {
+		ret = spi_flash_parse_sfdp(flash);
+		if (ret)
+			debug("SF: No usable SFDP tables (err=%d)\n", ret);
+		ret = 0;
+	}
+#endif
+
+	/* Set the quad enable bit - only for quad commands */
+	if (spi_flash_is_quad_cmd(flash->read_cmd) ||
+	    spi_flash_is_quad_cmd(flash->write_cmd)) {
+		ret = set_quad_mode(flash, idcode[0]);
+		if (ret) {
+			debug("SF: Fail to set QEB for %02x\n", idcode[0]);
+			return -EINVAL;
+		}
+	}
+
 #ifdef CONFIG_SPI_FLASH_STMICRO
 	if (params->flags & E_FSR)
 		flash->flags |= SNOR_F_USE_FSR;
@@ -1181,10 +1702,11 @@ int spi_flash_scan(struct spi_flash *flash)
 #endif
 
 #ifndef CONFIG_SPI_FLASH_BAR
-	if (((flash->dual_flash == SF_SINGLE_FLASH) &&
-	     (flash->size > SPI_FLASH_16MB_BOUN)) ||
+	if (flash->addr_width == SPI_FLASH_3B_ADDR_LEN &&
+	    (((flash->dual_flash == SF_SINGLE_FLASH) &&
+	      (flash->size > SPI_FLASH_16MB_BOUN)) ||
 	     ((flash->dual_flash > SF_SINGLE_FLASH) &&
-	     (flash->size > SPI_FLASH_16MB_BOUN << 1))) {
+	      (flash->size > SPI_FLASH_16MB_BOUN << 1)))) {
 		puts("SF: Warning - Only lower 16MiB accessible,");
 		puts(" Full access #define CONFIG_SPI_FLASH_BAR\n");
 	}
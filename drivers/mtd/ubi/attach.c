@@ -91,6 +91,38 @@ static int self_check_ai(struct ubi_device *ubi, struct ubi_attach_info *ai);
 static struct ubi_ec_hdr *ech;
 static struct ubi_vid_hdr *vidh;
 
+/**
+ * ubi_alloc_aeb - allocate an attaching information PEB object.
+ * @ai: attaching information
+ *
+ * Scanning needs about one &struct ubi_ainf_peb object per PEB, so these are
+ * handed out from an array allocated along with @ai, which saves a heap
+ * allocation per PEB. Once the array is used up they come from the slab
+ * cache. Returns %NULL if out of memory.
+ */
+struct ubi_ainf_peb *ubi_alloc_aeb(struct ubi_attach_info *ai)
+{
+	if (ai->aeb_pool_used < ai->aeb_pool_size)
+		return &ai->aeb_pool[ai->aeb_pool_used++];
+
+	return kmem_cache_alloc(ai->aeb_slab_cache, GFP_KERNEL);
+}
+
+/**
+ * ubi_free_aeb - free an attaching information PEB object.
+ * @ai: attaching information
+ * @aeb: the object to free
+ *
+ * Objects from the array are not re-used, they go away along with @ai.
+ */
+void ubi_free_aeb(struct ubi_attach_info *ai, struct ubi_ainf_peb *aeb)
+{
+	if (aeb >= ai->aeb_pool && aeb < ai->aeb_pool + ai->aeb_pool_size)
+		return;
+
+	kmem_cache_free(ai->aeb_slab_cache, aeb);
+}
+
 /**
  * add_to_list - add physical eraseblock to a list.
  * @ai: attaching information
@@ -127,7 +159,7 @@ static int add_to_list(struct ubi_attach_info *ai, int pnum, int vol_id,
 	} else
 		BUG();
 
-	aeb = kmem_cache_alloc(ai->aeb_slab_cache, GFP_KERNEL);
+	aeb = ubi_alloc_aeb(ai);
 	if (!aeb)
 		return -ENOMEM;
 
@@ -159,7 +191,7 @@ static int add_corrupted(struct ubi_attach_info *ai, int pnum, int ec)
 
 	dbg_bld("add to corrupted: PEB %d, EC %d", pnum, ec);
 
-	aeb = kmem_cache_alloc(ai->aeb_slab_cache, GFP_KERNEL);
+	aeb = ubi_alloc_aeb(ai);
 	if (!aeb)
 		return -ENOMEM;
 
@@ -567,7 +599,7 @@ int ubi_add_to_av(struct ubi_device *ubi, struct ubi_attach_info *ai, int pnum,
 	if (err)
 		return err;
 
-	aeb = kmem_cache_alloc(ai->aeb_slab_cache, GFP_KERNEL);
+	aeb = ubi_alloc_aeb(ai);
 	if (!aeb)
 		return -ENOMEM;
 
@@ -816,7 +848,8 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		    int pnum, int *vid, unsigned long long *sqnum)
 {
 	long long uninitialized_var(ec);
-	int err, bitflips = 0, vol_id = -1, ec_err = 0;
+	int err, vid_err, bitflips = 0, vol_id = -1, ec_err = 0;
+	unsigned long start;
 
 	dbg_bld("scan PEB %d", pnum);
 
@@ -829,7 +862,9 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 		return 0;
 	}
 
-	err = ubi_io_read_ec_hdr(ubi, pnum, ech, 0);
+	start = timer_get_us();
+	err = ubi_io_read_hdrs(ubi, pnum, ech, vidh, &vid_err);
+	ubi->attach_stats.read_us += timer_get_us() - start;
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -912,7 +947,7 @@ static int scan_peb(struct ubi_device *ubi, struct ubi_attach_info *ai,
 
 	/* OK, we've done with the EC header, let's look at the VID header */
 
-	err = ubi_io_read_vid_hdr(ubi, pnum, vidh, 0);
+	err = vid_err;
 	if (err < 0)
 		return err;
 	switch (err) {
@@ -1150,7 +1185,7 @@ static void destroy_av(struct ubi_attach_info *ai, struct ubi_ainf_volume *av)
 					this->rb_right = NULL;
 			}
 
-			kmem_cache_free(ai->aeb_slab_cache, aeb);
+			ubi_free_aeb(ai, aeb);
 		}
 	}
 	kfree(av);
@@ -1168,19 +1203,19 @@ static void destroy_ai(struct ubi_attach_info *ai)
 
 	list_for_each_entry_safe(aeb, aeb_tmp, &ai->alien, u.list) {
 		list_del(&aeb->u.list);
-		kmem_cache_free(ai->aeb_slab_cache, aeb);
+		ubi_free_aeb(ai, aeb);
 	}
 	list_for_each_entry_safe(aeb, aeb_tmp, &ai->erase, u.list) {
 		list_del(&aeb->u.list);
-		kmem_cache_free(ai->aeb_slab_cache, aeb);
+		ubi_free_aeb(ai, aeb);
 	}
 	list_for_each_entry_safe(aeb, aeb_tmp, &ai->corr, u.list) {
 		list_del(&aeb->u.list);
-		kmem_cache_free(ai->aeb_slab_cache, aeb);
+		ubi_free_aeb(ai, aeb);
 	}
 	list_for_each_entry_safe(aeb, aeb_tmp, &ai->free, u.list) {
 		list_del(&aeb->u.list);
-		kmem_cache_free(ai->aeb_slab_cache, aeb);
+		ubi_free_aeb(ai, aeb);
 	}
 
 	/* Destroy the volume RB-tree */
@@ -1208,6 +1243,7 @@ static void destroy_ai(struct ubi_attach_info *ai)
 	if (ai->aeb_slab_cache)
 		kmem_cache_destroy(ai->aeb_slab_cache);
 
+	vfree(ai->aeb_pool);
 	kfree(ai);
 }
 
@@ -1297,7 +1333,7 @@ out_ech:
 	return err;
 }
 
-static struct ubi_attach_info *alloc_ai(void)
+static struct ubi_attach_info *alloc_ai(struct ubi_device *ubi)
 {
 	struct ubi_attach_info *ai;
 
@@ -1315,9 +1351,14 @@ static struct ubi_attach_info *alloc_ai(void)
 					       0, 0, NULL);
 	if (!ai->aeb_slab_cache) {
 		kfree(ai);
-		ai = NULL;
+		return NULL;
 	}
 
+	/* Without the array we just use the slab cache for every PEB */
+	ai->aeb_pool = vmalloc(ubi->peb_count * sizeof(struct ubi_ainf_peb));
+	if (ai->aeb_pool)
+		ai->aeb_pool_size = ubi->peb_count;
+
 	return ai;
 }
 
@@ -1371,7 +1412,7 @@ static int scan_fast(struct ubi_device *ubi, struct ubi_attach_info **ai)
 		return UBI_NO_FASTMAP;
 
 	destroy_ai(*ai);
-	*ai = alloc_ai();
+	*ai = alloc_ai(ubi);
 	if (!*ai)
 		return -ENOMEM;
 
@@ -1399,8 +1440,12 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 {
 	int err;
 	struct ubi_attach_info *ai;
+	struct ubi_attach_stats *stats = &ubi->attach_stats;
+	unsigned long start, t;
 
-	ai = alloc_ai();
+	memset(stats, '\0', sizeof(*stats));
+	start = timer_get_us();
+	ai = alloc_ai(ubi);
 	if (!ai)
 		return -ENOMEM;
 
@@ -1418,7 +1463,7 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 		if (err > 0 || mtd_is_eccerr(err)) {
 			if (err != UBI_NO_FASTMAP) {
 				destroy_ai(ai);
-				ai = alloc_ai();
+				ai = alloc_ai(ubi);
 				if (!ai)
 					return -ENOMEM;
 
@@ -1433,6 +1478,7 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 #endif
 	if (err)
 		goto out_ai;
+	stats->scan_us = timer_get_us() - start;
 
 	ubi->bad_peb_count = ai->bad_peb_count;
 	ubi->good_peb_count = ubi->peb_count - ubi->bad_peb_count;
@@ -1441,23 +1487,29 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 	ubi->mean_ec = ai->mean_ec;
 	dbg_gen("max. sequence number:       %llu", ai->max_sqnum);
 
+	t = timer_get_us();
 	err = ubi_read_volume_table(ubi, ai);
 	if (err)
 		goto out_ai;
+	stats->vtbl_us = timer_get_us() - t;
 
+	t = timer_get_us();
 	err = ubi_wl_init(ubi, ai);
 	if (err)
 		goto out_vtbl;
+	stats->wl_us = timer_get_us() - t;
 
+	t = timer_get_us();
 	err = ubi_eba_init(ubi, ai);
 	if (err)
 		goto out_wl;
+	stats->eba_us = timer_get_us() - t;
 
 #ifdef CONFIG_MTD_UBI_FASTMAP
 	if (ubi->fm && ubi_dbg_chk_fastmap(ubi)) {
 		struct ubi_attach_info *scan_ai;
 
-		scan_ai = alloc_ai();
+		scan_ai = alloc_ai(ubi);
 		if (!scan_ai) {
 			err = -ENOMEM;
 			goto out_wl;
@@ -1478,6 +1530,7 @@ int ubi_attach(struct ubi_device *ubi, int force_scan)
 #endif
 
 	destroy_ai(ai);
+	stats->total_us = timer_get_us() - start;
 	return 0;
 
 out_wl:
@@ -700,52 +700,23 @@ bad:
 }
 
 /**
- * ubi_io_read_ec_hdr - read and check an erase counter header.
+ * check_ec_hdr - check an erase counter header which has been read.
  * @ubi: UBI device description object
- * @pnum: physical eraseblock to read from
- * @ec_hdr: a &struct ubi_ec_hdr object where to store the read erase counter
- * header
+ * @pnum: physical eraseblock the header was read from
+ * @ec_hdr: the erase counter header
+ * @read_err: result of reading the header, zero or one of %UBI_IO_BITFLIPS
+ *            and %-EBADMSG
  * @verbose: be verbose if the header is corrupted or was not found
  *
- * This function reads erase counter header from physical eraseblock @pnum and
- * stores it in @ec_hdr. This function also checks CRC checksum of the read
- * erase counter header. The following codes may be returned:
- *
- * o %0 if the CRC checksum is correct and the header was successfully read;
- * o %UBI_IO_BITFLIPS if the CRC is correct, but bit-flips were detected
- *   and corrected by the flash driver; this is harmless but may indicate that
- *   this eraseblock may become bad soon (but may be not);
- * o %UBI_IO_BAD_HDR if the erase counter header is corrupted (a CRC error);
- * o %UBI_IO_BAD_HDR_EBADMSG is the same as %UBI_IO_BAD_HDR, but there also was
- *   a data integrity error (uncorrectable ECC error in case of NAND);
- * o %UBI_IO_FF if only 0xFF bytes were read (the PEB is supposedly empty)
- * o a negative error code in case of failure.
+ * This is a helper for 'ubi_io_read_ec_hdr()' and 'ubi_io_read_hdrs()' and
+ * returns the same codes.
  */
-int ubi_io_read_ec_hdr(struct ubi_device *ubi, int pnum,
-		       struct ubi_ec_hdr *ec_hdr, int verbose)
+static int check_ec_hdr(const struct ubi_device *ubi, int pnum,
+			struct ubi_ec_hdr *ec_hdr, int read_err, int verbose)
 {
-	int err, read_err;
+	int err;
 	uint32_t crc, magic, hdr_crc;
 
-	dbg_io("read EC header from PEB %d", pnum);
-	ubi_assert(pnum >= 0 && pnum < ubi->peb_count);
-
-	read_err = ubi_io_read(ubi, ec_hdr, pnum, 0, UBI_EC_HDR_SIZE);
-	if (read_err) {
-		if (read_err != UBI_IO_BITFLIPS && !mtd_is_eccerr(read_err))
-			return read_err;
-
-		/*
-		 * We read all the data, but either a correctable bit-flip
-		 * occurred, or MTD reported a data integrity error
-		 * (uncorrectable ECC error in case of NAND). The former is
-		 * harmless, the later may mean that the read data is
-		 * corrupted. But we have a CRC check-sum and we will detect
-		 * this. If the EC header is still OK, we just report this as
-		 * there was a bit-flip, to force scrubbing.
-		 */
-	}
-
 	magic = be32_to_cpu(ec_hdr->magic);
 	if (magic != UBI_EC_HDR_MAGIC) {
 		if (mtd_is_eccerr(read_err))
@@ -815,6 +786,55 @@ int ubi_io_read_ec_hdr(struct ubi_device *ubi, int pnum,
 	return read_err ? UBI_IO_BITFLIPS : 0;
 }
 
+/**
+ * ubi_io_read_ec_hdr - read and check an erase counter header.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock to read from
+ * @ec_hdr: a &struct ubi_ec_hdr object where to store the read erase counter
+ * header
+ * @verbose: be verbose if the header is corrupted or was not found
+ *
+ * This function reads erase counter header from physical eraseblock @pnum and
+ * stores it in @ec_hdr. This function also checks CRC checksum of the read
+ * erase counter header. The following codes may be returned:
+ *
+ * o %0 if the CRC checksum is correct and the header was successfully read;
+ * o %UBI_IO_BITFLIPS if the CRC is correct, but bit-flips were detected
+ *   and corrected by the flash driver; this is harmless but may indicate that
+ *   this eraseblock may become bad soon (but may be not);
+ * o %UBI_IO_BAD_HDR if the erase counter header is corrupted (a CRC error);
+ * o %UBI_IO_BAD_HDR_EBADMSG is the same as %UBI_IO_BAD_HDR, but there also was
+ *   a data integrity error (uncorrectable ECC error in case of NAND);
+ * o %UBI_IO_FF if only 0xFF bytes were read (the PEB is supposedly empty)
+ * o a negative error code in case of failure.
+ */
+int ubi_io_read_ec_hdr(struct ubi_device *ubi, int pnum,
+		       struct ubi_ec_hdr *ec_hdr, int verbose)
+{
+	int read_err;
+
+	dbg_io("read EC header from PEB %d", pnum);
+	ubi_assert(pnum >= 0 && pnum < ubi->peb_count);
+
+	read_err = ubi_io_read(ubi, ec_hdr, pnum, 0, UBI_EC_HDR_SIZE);
+	if (read_err) {
+		if (read_err != UBI_IO_BITFLIPS && !mtd_is_eccerr(read_err))
+			return read_err;
+
+		/*
+		 * We read all the data, but either a correctable bit-flip
+		 * occurred, or MTD reported a data integrity error
+		 * (uncorrectable ECC error in case of NAND). The former is
+		 * harmless, the later may mean that the read data is
+		 * corrupted. But we have a CRC check-sum and we will detect
+		 * this. If the EC header is still OK, we just report this as
+		 * there was a bit-flip, to force scrubbing.
+		 */
+	}
+
+	return check_ec_hdr(ubi, pnum, ec_hdr, read_err, verbose);
+}
+
 /**
  * ubi_io_write_ec_hdr - write an erase counter header.
  * @ubi: UBI device description object
@@ -979,36 +999,18 @@ bad:
 }
 
 /**
- * ubi_io_read_vid_hdr - read and check a volume identifier header.
+ * check_vid_hdr - check a volume identifier header which has been read.
  * @ubi: UBI device description object
- * @pnum: physical eraseblock number to read from
- * @vid_hdr: &struct ubi_vid_hdr object where to store the read volume
- * identifier header
- * @verbose: be verbose if the header is corrupted or wasn't found
- *
- * This function reads the volume identifier header from physical eraseblock
- * @pnum and stores it in @vid_hdr. It also checks CRC checksum of the read
- * volume identifier header. The error codes are the same as in
- * 'ubi_io_read_ec_hdr()'.
- *
- * Note, the implementation of this function is also very similar to
- * 'ubi_io_read_ec_hdr()', so refer commentaries in 'ubi_io_read_ec_hdr()'.
+ * @pnum: physical eraseblock the header was read from
+ * @vid_hdr: the volume identifier header
+ * @read_err: result of reading the header, as for 'check_ec_hdr()'
+ * @verbose: be verbose if the header is corrupted or was not found
  */
-int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
-			struct ubi_vid_hdr *vid_hdr, int verbose)
+static int check_vid_hdr(const struct ubi_device *ubi, int pnum,
+			 struct ubi_vid_hdr *vid_hdr, int read_err, int verbose)
 {
-	int err, read_err;
+	int err;
 	uint32_t crc, magic, hdr_crc;
-	void *p;
-
-	dbg_io("read VID header from PEB %d", pnum);
-	ubi_assert(pnum >= 0 &&  pnum < ubi->peb_count);
-
-	p = (char *)vid_hdr - ubi->vid_hdr_shift;
-	read_err = ubi_io_read(ubi, p, pnum, ubi->vid_hdr_aloffset,
-			  ubi->vid_hdr_alsize);
-	if (read_err && read_err != UBI_IO_BITFLIPS && !mtd_is_eccerr(read_err))
-		return read_err;
 
 	magic = be32_to_cpu(vid_hdr->magic);
 	if (magic != UBI_VID_HDR_MAGIC) {
@@ -1063,6 +1065,111 @@ int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
 	return read_err ? UBI_IO_BITFLIPS : 0;
 }
 
+/**
+ * ubi_io_read_vid_hdr - read and check a volume identifier header.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock number to read from
+ * @vid_hdr: &struct ubi_vid_hdr object where to store the read volume
+ * identifier header
+ * @verbose: be verbose if the header is corrupted or wasn't found
+ *
+ * This function reads the volume identifier header from physical eraseblock
+ * @pnum and stores it in @vid_hdr. It also checks CRC checksum of the read
+ * volume identifier header. The error codes are the same as in
+ * 'ubi_io_read_ec_hdr()'.
+ *
+ * Note, the implementation of this function is also very similar to
+ * 'ubi_io_read_ec_hdr()', so refer commentaries in 'ubi_io_read_ec_hdr()'.
+ */
+int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
+			struct ubi_vid_hdr *vid_hdr, int verbose)
+{
+	int read_err;
+	void *p;
+
+	dbg_io("read VID header from PEB %d", pnum);
+	ubi_assert(pnum >= 0 &&  pnum < ubi->peb_count);
+
+	p = (char *)vid_hdr - ubi->vid_hdr_shift;
+	read_err = ubi_io_read(ubi, p, pnum, ubi->vid_hdr_aloffset,
+			  ubi->vid_hdr_alsize);
+	if (read_err && read_err != UBI_IO_BITFLIPS && !mtd_is_eccerr(read_err))
+		return read_err;
+
+	return check_vid_hdr(ubi, pnum, vid_hdr, read_err, verbose);
+}
+
+/**
+ * ubi_io_read_hdrs - read and check both headers of a physical eraseblock.
+ * @ubi: UBI device description object
+ * @pnum: physical eraseblock number to read from
+ * @ec_hdr: &struct ubi_ec_hdr object where to store the erase counter header
+ * @vid_hdr: &struct ubi_vid_hdr object where to store the volume identifier
+ *           header
+ * @vid_err: returns the result of checking the volume identifier header
+ *
+ * Attaching needs both headers of every PEB. When the VID header directly
+ * follows the EC header, as it does unless the VID header offset was set
+ * by hand, this function reads both with a single flash read. That halves
+ * the number of MTD calls and, when both headers share a NAND page, the
+ * number of page reads too.
+ *
+ * If the combined read reports bit-flips or an ECC error, there is no way
+ * to tell which header they are in, so the headers are read again one at
+ * a time. The results are therefore always the same as those of
+ * 'ubi_io_read_ec_hdr()' and 'ubi_io_read_vid_hdr()'.
+ *
+ * Each flash read issued is counted in @ubi->attach_stats.hdr_reads.
+ *
+ * Returns the same codes as 'ubi_io_read_ec_hdr()'. @vid_err is only set
+ * if the return value is not negative and not %UBI_IO_FF or
+ * %UBI_IO_FF_BITFLIPS, in which case the VID header is not needed.
+ */
+int ubi_io_read_hdrs(struct ubi_device *ubi, int pnum,
+		     struct ubi_ec_hdr *ec_hdr, struct ubi_vid_hdr *vid_hdr,
+		     int *vid_err)
+{
+	int err, len = ubi->vid_hdr_aloffset + ubi->vid_hdr_alsize;
+
+	dbg_io("read EC and VID headers from PEB %d", pnum);
+	ubi_assert(pnum >= 0 && pnum < ubi->peb_count);
+
+	if (ubi->vid_hdr_aloffset > ubi->ec_hdr_alsize)
+		goto separate;
+
+	mutex_lock(&ubi->buf_mutex);
+	ubi->attach_stats.hdr_reads++;
+	err = ubi_io_read(ubi, ubi->peb_buf, pnum, 0, len);
+	if (!err) {
+		memcpy(ec_hdr, ubi->peb_buf, UBI_EC_HDR_SIZE);
+		memcpy((char *)vid_hdr - ubi->vid_hdr_shift,
+		       ubi->peb_buf + ubi->vid_hdr_aloffset,
+		       ubi->vid_hdr_alsize);
+	}
+	mutex_unlock(&ubi->buf_mutex);
+	if (err && err != UBI_IO_BITFLIPS && !mtd_is_eccerr(err))
+		return err;
+	if (err)
+		goto separate;
+
+	err = check_ec_hdr(ubi, pnum, ec_hdr, 0, 0);
+	if (err < 0 || err == UBI_IO_FF)
+		return err;
+	*vid_err = check_vid_hdr(ubi, pnum, vid_hdr, 0, 0);
+
+	return err;
+
+separate:
+	ubi->attach_stats.hdr_reads++;
+	err = ubi_io_read_ec_hdr(ubi, pnum, ec_hdr, 0);
+	if (err < 0 || err == UBI_IO_FF || err == UBI_IO_FF_BITFLIPS)
+		return err;
+	ubi->attach_stats.hdr_reads++;
+	*vid_err = ubi_io_read_vid_hdr(ubi, pnum, vid_hdr, 0);
+
+	return err;
+}
+
 /**
  * ubi_io_write_vid_hdr - write a volume identifier header.
  * @ubi: UBI device description object
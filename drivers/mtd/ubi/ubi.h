@@ -412,6 +412,26 @@ struct ubi_debug_info {
 	struct dentry *dfs_power_cut_max;
 };
 
+/**
+ * struct ubi_attach_stats - where the time went when attaching a device
+ * @hdr_reads: number of flash reads issued for PEB headers while scanning
+ * @scan_us: scanning the PEB headers, including @read_us
+ * @read_us: reading PEB headers from the flash
+ * @vtbl_us: reading the volume table
+ * @wl_us: initializing the wear-leveling sub-system
+ * @eba_us: initializing the EBA sub-system
+ * @total_us: the whole of 'ubi_attach()'
+ */
+struct ubi_attach_stats {
+	int hdr_reads;
+	unsigned long scan_us;
+	unsigned long read_us;
+	unsigned long vtbl_us;
+	unsigned long wl_us;
+	unsigned long eba_us;
+	unsigned long total_us;
+};
+
 /**
  * struct ubi_device - UBI device description structure
  * @dev: UBI device object to use the the Linux device model
@@ -445,6 +465,7 @@ struct ubi_debug_info {
  *
  * @max_ec: current highest erase counter value
  * @mean_ec: current mean erase counter value
+ * @attach_stats: time taken by each step of attaching this device
  *
  * @global_sqnum: global sequence number
  * @ltree_lock: protects the lock tree and @global_sqnum
@@ -553,6 +574,7 @@ struct ubi_device {
 	int max_ec;
 	/* Note, mean_ec is not updated run-time - should be fixed */
 	int mean_ec;
+	struct ubi_attach_stats attach_stats;
 
 	/* EBA sub-system's stuff */
 	unsigned long long global_sqnum;
@@ -717,6 +739,10 @@ struct ubi_ainf_volume {
  * @ec_sum: a temporary variable used when calculating @mean_ec
  * @ec_count: a temporary variable used when calculating @mean_ec
  * @aeb_slab_cache: slab cache for &struct ubi_ainf_peb objects
+ * @aeb_pool: array with one &struct ubi_ainf_peb object per PEB, used before
+ *            falling back to @aeb_slab_cache
+ * @aeb_pool_size: number of objects in @aeb_pool
+ * @aeb_pool_used: number of objects handed out from @aeb_pool
  *
  * This data structure contains the result of attaching an MTD device and may
  * be used by other UBI sub-systems to build final UBI data structures, further
@@ -743,6 +769,9 @@ struct ubi_attach_info {
 	uint64_t ec_sum;
 	int ec_count;
 	struct kmem_cache *aeb_slab_cache;
+	struct ubi_ainf_peb *aeb_pool;
+	int aeb_pool_size;
+	int aeb_pool_used;
 };
 
 /**
@@ -783,6 +812,8 @@ extern struct mutex ubi_devices_mutex;
 extern struct blocking_notifier_head ubi_notifiers;
 
 /* attach.c */
+struct ubi_ainf_peb *ubi_alloc_aeb(struct ubi_attach_info *ai);
+void ubi_free_aeb(struct ubi_attach_info *ai, struct ubi_ainf_peb *aeb);
 int ubi_add_to_av(struct ubi_device *ubi, struct ubi_attach_info *ai, int pnum,
 		  int ec, const struct ubi_vid_hdr *vid_hdr, int bitflips);
 struct ubi_ainf_volume *ubi_find_av(const struct ubi_attach_info *ai,
@@ -895,6 +926,9 @@ int ubi_io_read_vid_hdr(struct ubi_device *ubi, int pnum,
 			struct ubi_vid_hdr *vid_hdr, int verbose);
 int ubi_io_write_vid_hdr(struct ubi_device *ubi, int pnum,
 			 struct ubi_vid_hdr *vid_hdr);
+int ubi_io_read_hdrs(struct ubi_device *ubi, int pnum,
+		     struct ubi_ec_hdr *ec_hdr, struct ubi_vid_hdr *vid_hdr,
+		     int *vid_err);
 
 /* build.c */
 int ubi_attach_mtd_dev(struct mtd_info *mtd, int ubi_num,
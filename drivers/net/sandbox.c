@@ -11,6 +11,7 @@
 #include <dm.h>
 #include <malloc.h>
 #include <net.h>
+#include <asm/eth.h>
 #include <asm/test.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -22,16 +23,31 @@ DECLARE_GLOBAL_DATA_PTR;
  * fake_host_ipaddr: IP address of mocked machine
  * recv_packet_buffer: buffer of the packet returned as received
  * recv_packet_length: length of the packet returned as received
+ * tftp_*: state of the mock TFTP server transfer; tftp_port is 0 when idle
  */
 struct eth_sandbox_priv {
 	uchar fake_host_hwaddr[ARP_HLEN];
 	struct in_addr fake_host_ipaddr;
 	uchar *recv_packet_buffer;
 	int recv_packet_length;
+	uchar tftp_hwaddr[ARP_HLEN];
+	struct in_addr tftp_ipaddr;
+	int tftp_port;
+	int tftp_block_size;
+	int tftp_window_size;
+	ulong tftp_blocks;
+	ulong tftp_acked;
+	ulong tftp_next;
+	bool tftp_dropped;
 };
 
 static bool disabled[8] = {false};
 static bool skip_timeout;
+static struct sandbox_eth_tftp *tftp_server;
+
+/* UDP ports the mock TFTP server listens on and answers from */
+#define SB_TFTP_WELL_KNOWN_PORT	69
+#define SB_TFTP_PORT		3069
 
 /*
  * sandbox_eth_disable_response()
@@ -54,6 +70,153 @@ void sandbox_eth_skip_timeout(void)
 	skip_timeout = true;
 }
 
+/*
+ * sandbox_eth_set_tftp()
+ *
+ * tftp - Server to run, or NULL to ignore TFTP requests
+ */
+void sandbox_eth_set_tftp(struct sandbox_eth_tftp *tftp)
+{
+	tftp_server = tftp;
+}
+
+/* Fill in the Ethernet, IP and UDP headers of a packet to the TFTP client */
+static int sb_tftp_headers(struct eth_sandbox_priv *priv, int len)
+{
+	struct ethernet_hdr *eth = (void *)priv->recv_packet_buffer;
+	struct ip_udp_hdr *ip = (void *)priv->recv_packet_buffer +
+		ETHER_HDR_SIZE;
+
+	memcpy(eth->et_dest, priv->tftp_hwaddr, ARP_HLEN);
+	memcpy(eth->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth->et_protlen = htons(PROT_IP);
+
+	net_set_ip_header((uchar *)ip, priv->tftp_ipaddr,
+			  priv->fake_host_ipaddr);
+	ip->ip_len = htons(IP_UDP_HDR_SIZE + len);
+	ip->ip_p = IPPROTO_UDP;
+	ip->ip_sum = compute_ip_checksum(ip, IP_HDR_SIZE);
+	ip->udp_src = htons(SB_TFTP_PORT);
+	ip->udp_dst = htons(priv->tftp_port);
+	ip->udp_len = htons(UDP_HDR_SIZE + len);
+	ip->udp_xsum = 0;
+
+	return ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + len;
+}
+
+/* Answer a read request with an OACK for the options we support */
+static void sb_tftp_rrq(struct eth_sandbox_priv *priv,
+			struct ethernet_hdr *eth, struct ip_udp_hdr *ip,
+			int len)
+{
+	char *req = (char *)ip + IP_UDP_HDR_SIZE + 2;
+	char *end = (char *)ip + IP_UDP_HDR_SIZE + len;
+	char *oack = (char *)priv->recv_packet_buffer + ETHER_HDR_SIZE +
+		IP_UDP_HDR_SIZE;
+	char *p = oack + 2;
+	char *opt;
+
+	memcpy(priv->tftp_hwaddr, eth->et_src, ARP_HLEN);
+	net_copy_ip(&priv->tftp_ipaddr, &ip->ip_src);
+	priv->fake_host_ipaddr = net_read_ip(&ip->ip_dst);
+	priv->tftp_port = ntohs(ip->udp_src);
+	priv->tftp_block_size = 512;
+	priv->tftp_window_size = 1;
+	priv->tftp_dropped = false;
+
+	*(__be16 *)oack = htons(6);	/* OACK */
+	/* skip the file name and mode, then walk the option pairs */
+	opt = req + strlen(req) + 1;
+	opt += strlen(opt) + 1;
+	while (opt < end) {
+		char *val = opt + strlen(opt) + 1;
+
+		if (val >= end)
+			break;
+		if (!strcmp(opt, "blksize")) {
+			priv->tftp_block_size = simple_strtoul(val, NULL, 10);
+			p += sprintf(p, "blksize%c%d%c", 0,
+				     priv->tftp_block_size, 0);
+		} else if (!strcmp(opt, "windowsize") &&
+			   tftp_server->max_window) {
+			priv->tftp_window_size = min_t(int,
+						       tftp_server->max_window,
+						       simple_strtoul(val, NULL, 10));
+			p += sprintf(p, "windowsize%c%d%c", 0,
+				     priv->tftp_window_size, 0);
+		} else if (!strcmp(opt, "tsize")) {
+			p += sprintf(p, "tsize%c%lu%c", 0,
+				     tftp_server->file_size, 0);
+		}
+		opt = val + strlen(val) + 1;
+	}
+
+	priv->tftp_blocks = tftp_server->file_size / priv->tftp_block_size + 1;
+	priv->tftp_acked = 0;
+	priv->tftp_next = 0;	/* nothing to send until OACK is ACKed */
+	priv->recv_packet_length = sb_tftp_headers(priv, p - oack);
+}
+
+/* Restart the window after the block the client acknowledged */
+static void sb_tftp_ack(struct eth_sandbox_priv *priv, ushort block)
+{
+	ushort ahead = block - (ushort)priv->tftp_acked;
+
+	tftp_server->acks++;
+	/* ignore stale ACKs for blocks before the current window */
+	if (priv->tftp_acked + ahead > priv->tftp_blocks ||
+	    (priv->tftp_next && ahead >= priv->tftp_next - priv->tftp_acked))
+		return;
+	priv->tftp_acked += ahead;
+	if (priv->tftp_acked == priv->tftp_blocks)
+		priv->tftp_port = 0;	/* transfer complete */
+	else
+		priv->tftp_next = priv->tftp_acked + 1;
+}
+
+/* Build the next data packet of the current window, if any */
+static void sb_tftp_data(struct eth_sandbox_priv *priv)
+{
+	ulong end = min(priv->tftp_acked + priv->tftp_window_size,
+			priv->tftp_blocks);
+	ulong block, offset, i;
+	uchar *pkt;
+	int len;
+
+	for (;;) {
+		if (!priv->tftp_port || !priv->tftp_next ||
+		    priv->tftp_next > end)
+			return;
+
+		/* with reordering, send the blocks of each pair swapped */
+		block = priv->tftp_next++;
+		if (tftp_server->reorder) {
+			if ((block - priv->tftp_acked) & 1) {
+				if (block < end)
+					block++;
+			} else {
+				block--;
+			}
+		}
+		if (block == tftp_server->drop_block && !priv->tftp_dropped) {
+			priv->tftp_dropped = true;
+			continue;
+		}
+		break;
+	}
+
+	offset = (block - 1) * priv->tftp_block_size;
+	len = min_t(ulong, priv->tftp_block_size,
+		    tftp_server->file_size - offset);
+	pkt = priv->recv_packet_buffer + ETHER_HDR_SIZE + IP_UDP_HDR_SIZE;
+	*(__be16 *)pkt = htons(3);	/* DATA */
+	*(__be16 *)(pkt + 2) = htons(block);
+	for (i = 0; i < len; i++)
+		pkt[4 + i] = sandbox_eth_tftp_byte(offset + i);
+	tftp_server->data_sent++;
+	priv->recv_packet_length = sb_tftp_headers(priv, 4 + len);
+}
+
 static int sb_eth_start(struct udevice *dev)
 {
 	struct eth_sandbox_priv *priv = dev_get_priv(dev);
@@ -146,6 +309,16 @@ static int sb_eth_send(struct udevice *dev, void *packet, int length)
 
 				priv->recv_packet_length = length;
 			}
+		} else if (ip->ip_p == IPPROTO_UDP && tftp_server) {
+			int len = ntohs(ip->udp_len) - UDP_HDR_SIZE;
+			__be16 *op = (void *)ip + IP_UDP_HDR_SIZE;
+
+			if (ntohs(ip->udp_dst) == SB_TFTP_WELL_KNOWN_PORT &&
+			    ntohs(*op) == 1)	/* RRQ */
+				sb_tftp_rrq(priv, eth, ip, len);
+			else if (ntohs(ip->udp_dst) == SB_TFTP_PORT &&
+				 priv->tftp_port && ntohs(*op) == 4) /* ACK */
+				sb_tftp_ack(priv, ntohs(op[1]));
 		}
 	}
 
@@ -170,6 +343,17 @@ static int sb_eth_recv(struct udevice *dev, int flags, uchar **packetp)
 		*packetp = priv->recv_packet_buffer;
 		return lcl_recv_packet_length;
 	}
+
+	if (tftp_server) {
+		sb_tftp_data(priv);
+		if (priv->recv_packet_length) {
+			int len = priv->recv_packet_length;
+
+			priv->recv_packet_length = 0;
+			*packetp = priv->recv_packet_buffer;
+			return len;
+		}
+	}
 	return 0;
 }
 
@@ -19,6 +19,7 @@
 #include <linux/usb/gadget.h>
 #include <linux/usb/composite.h>
 #include <linux/compiler.h>
+#include <linux/bug.h>
 #include <version.h>
 #include <g_dnl.h>
 #ifdef CONFIG_FASTBOOT_FLASH_MMC_DEV
@@ -27,6 +28,9 @@
 #ifdef CONFIG_FASTBOOT_FLASH_NAND_DEV
 #include <fb_nand.h>
 #endif
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+#include <image-sparse.h>
+#endif
 
 #define FASTBOOT_VERSION		"0.4"
 
@@ -40,6 +44,15 @@
 
 #define EP_BUFFER_SIZE			4096
 
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+#ifndef CONFIG_FASTBOOT_FLASH_MMC_DEV
+#error "CONFIG_FASTBOOT_FLASH_STREAM needs CONFIG_FASTBOOT_FLASH_MMC_DEV"
+#endif
+#ifndef CONFIG_FASTBOOT_STREAM_BUF_SIZE
+#define CONFIG_FASTBOOT_STREAM_BUF_SIZE	0x100000
+#endif
+#endif
+
 struct f_fastboot {
 	struct usb_function usb_function;
 
@@ -59,6 +72,34 @@ static unsigned int download_size;
 static unsigned int download_bytes;
 static bool is_high_speed;
 
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+/*
+ * After 'oem stream <partition>', downloads are written to the partition as
+ * they arrive instead of being kept in the download buffer. The start of
+ * the buffer is used as two receive buffers: the controller fills one while
+ * the other is written out.
+ */
+static struct {
+	char part[32];			/* partition to write, or "" */
+	sparse_storage_t storage;
+	void *priv;
+	struct sparse_stream ss;
+	void *cmd_buf;			/* out_req's buffer, while streaming */
+	int cur;			/* receive buffer being filled */
+	int err;
+} fb_stream;
+
+static void *fastboot_stream_buf(int i)
+{
+	/* Both receive buffers must fit in the download buffer */
+	BUILD_BUG_ON(2 * CONFIG_FASTBOOT_STREAM_BUF_SIZE >
+		     CONFIG_FASTBOOT_BUF_SIZE);
+
+	return (void *)CONFIG_FASTBOOT_BUF_ADDR +
+		i * CONFIG_FASTBOOT_STREAM_BUF_SIZE;
+}
+#endif
+
 static struct usb_endpoint_descriptor fs_ep_in = {
 	.bLength            = USB_DT_ENDPOINT_SIZE,
 	.bDescriptorType    = USB_DT_ENDPOINT,
@@ -189,6 +230,9 @@ static int fastboot_bind(struct usb_configuration *c, struct usb_function *f)
 static void fastboot_unbind(struct usb_configuration *c, struct usb_function *f)
 {
 	memset(fastboot_func, 0, sizeof(*fastboot_func));
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+	fb_stream.part[0] = '\0';
+#endif
 }
 
 static void fastboot_disable(struct usb_function *f)
@@ -198,6 +242,14 @@ static void fastboot_disable(struct usb_function *f)
 	usb_ep_disable(f_fb->out_ep);
 	usb_ep_disable(f_fb->in_ep);
 
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+	/* Give back the request's buffer if a download was cut short */
+	if (fb_stream.cmd_buf) {
+		f_fb->out_req->buf = fb_stream.cmd_buf;
+		fb_stream.cmd_buf = NULL;
+		sparse_stream_finish(&fb_stream.ss);
+	}
+#endif
 	if (f_fb->out_req) {
 		free(f_fb->out_req->buf);
 		usb_ep_free_request(f_fb->out_ep, f_fb->out_req);
@@ -370,6 +422,17 @@ static int strcmp_l1(const char *s1, const char *s2)
 	return strncmp(s1, s2, strlen(s1));
 }
 
+static unsigned int fastboot_max_download_size(void)
+{
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+	/* A streamed download only has to fit in the partition */
+	if (fb_stream.part[0])
+		return min_t(u64, (u64)fb_stream.storage.size *
+			     fb_stream.storage.block_sz, UINT_MAX);
+#endif
+	return CONFIG_FASTBOOT_BUF_SIZE;
+}
+
 static void cb_getvar(struct usb_ep *ep, struct usb_request *req)
 {
 	char *cmd = req->buf;
@@ -395,7 +458,7 @@ static void cb_getvar(struct usb_ep *ep, struct usb_request *req)
 		!strcmp_l1("max-download-size", cmd)) {
 		char str_num[12];
 
-		sprintf(str_num, "0x%08x", CONFIG_FASTBOOT_BUF_SIZE);
+		sprintf(str_num, "0x%08x", fastboot_max_download_size());
 		strncat(response, str_num, chars_left);
 
 		/*
@@ -427,14 +490,16 @@ static void cb_getvar(struct usb_ep *ep, struct usb_request *req)
 	fastboot_tx_write_str(response);
 }
 
-static unsigned int rx_bytes_expected(unsigned int maxpacket)
+static unsigned int rx_bytes_expected(unsigned int maxpacket,
+				      unsigned int buf_size)
 {
-	int rx_remain = download_size - download_bytes;
+	unsigned int rx_remain;
 	int rem = 0;
-	if (rx_remain < 0)
+	if (download_bytes > download_size)
 		return 0;
-	if (rx_remain > EP_BUFFER_SIZE)
-		return EP_BUFFER_SIZE;
+	rx_remain = download_size - download_bytes;
+	if (rx_remain > buf_size)
+		return buf_size;
 	if (rx_remain < maxpacket) {
 		rx_remain = maxpacket;
 	} else if (rx_remain % maxpacket != 0) {
@@ -445,13 +510,28 @@ static unsigned int rx_bytes_expected(unsigned int maxpacket)
 }
 
 #define BYTES_PER_DOT	0x20000
+/* Add up the bytes received, printing a dot every BYTES_PER_DOT */
+static void rx_count_bytes(unsigned int transfer_size)
+{
+	unsigned int pre_dot_num, now_dot_num;
+
+	pre_dot_num = download_bytes / BYTES_PER_DOT;
+	download_bytes += transfer_size;
+	now_dot_num = download_bytes / BYTES_PER_DOT;
+
+	if (pre_dot_num != now_dot_num) {
+		putc('.');
+		if (!(now_dot_num % 74))
+			putc('\n');
+	}
+}
+
 static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 {
 	char response[FASTBOOT_RESPONSE_LEN];
 	unsigned int transfer_size = download_size - download_bytes;
 	const unsigned char *buffer = req->buf;
 	unsigned int buffer_size = req->actual;
-	unsigned int pre_dot_num, now_dot_num;
 	unsigned int max;
 
 	if (req->status != 0) {
@@ -464,16 +544,7 @@ static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 
 	memcpy((void *)CONFIG_FASTBOOT_BUF_ADDR + download_bytes,
 	       buffer, transfer_size);
-
-	pre_dot_num = download_bytes / BYTES_PER_DOT;
-	download_bytes += transfer_size;
-	now_dot_num = download_bytes / BYTES_PER_DOT;
-
-	if (pre_dot_num != now_dot_num) {
-		putc('.');
-		if (!(now_dot_num % 74))
-			putc('\n');
-	}
+	rx_count_bytes(transfer_size);
 
 	/* Check if transfer is done */
 	if (download_bytes >= download_size) {
@@ -492,7 +563,7 @@ static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 	} else {
 		max = is_high_speed ? hs_ep_out.wMaxPacketSize :
 				fs_ep_out.wMaxPacketSize;
-		req->length = rx_bytes_expected(max);
+		req->length = rx_bytes_expected(max, EP_BUFFER_SIZE);
 		if (req->length < ep->maxpacket)
 			req->length = ep->maxpacket;
 	}
@@ -501,6 +572,68 @@ static void rx_handler_dl_image(struct usb_ep *ep, struct usb_request *req)
 	usb_ep_queue(ep, req, 0);
 }
 
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+static void rx_handler_dl_stream(struct usb_ep *ep, struct usb_request *req)
+{
+	char response[FASTBOOT_RESPONSE_LEN];
+	unsigned int transfer_size = download_size - download_bytes;
+	void *buffer = req->buf;
+	unsigned int max;
+	int ret;
+
+	if (req->status != 0) {
+		printf("Bad status: %d\n", req->status);
+		return;
+	}
+
+	if (req->actual < transfer_size)
+		transfer_size = req->actual;
+	rx_count_bytes(transfer_size);
+
+	/* Receive the next part into the other buffer while writing this one */
+	if (download_bytes < download_size) {
+		fb_stream.cur = !fb_stream.cur;
+		req->buf = fastboot_stream_buf(fb_stream.cur);
+		max = is_high_speed ? hs_ep_out.wMaxPacketSize :
+				fs_ep_out.wMaxPacketSize;
+		req->length = rx_bytes_expected(max,
+					CONFIG_FASTBOOT_STREAM_BUF_SIZE);
+		if (req->length < ep->maxpacket)
+			req->length = ep->maxpacket;
+		req->actual = 0;
+		usb_ep_queue(ep, req, 0);
+	}
+
+	/* After an error the rest of the download is read and dropped */
+	if (!fb_stream.err)
+		fb_stream.err = sparse_stream_write(&fb_stream.ss, buffer,
+						    transfer_size);
+	if (download_bytes < download_size)
+		return;
+
+	ret = sparse_stream_finish(&fb_stream.ss);
+	if (!fb_stream.err)
+		fb_stream.err = ret;
+
+	download_size = 0;
+	req->buf = fb_stream.cmd_buf;
+	fb_stream.cmd_buf = NULL;
+	req->complete = rx_handler_command;
+	req->length = EP_BUFFER_SIZE;
+
+	printf("\ndownloading of %u bytes to '%s' finished\n", download_bytes,
+	       fb_stream.part);
+	if (fb_stream.err)
+		fastboot_fail(response, "error writing the image");
+	else
+		fastboot_okay(response, "");
+	fastboot_tx_write_str(response);
+
+	req->actual = 0;
+	usb_ep_queue(ep, req, 0);
+}
+#endif
+
 static void cb_download(struct usb_ep *ep, struct usb_request *req)
 {
 	char *cmd = req->buf;
@@ -511,19 +644,40 @@ static void cb_download(struct usb_ep *ep, struct usb_request *req)
 	download_size = simple_strtoul(cmd, NULL, 16);
 	download_bytes = 0;
 
-	printf("Starting download of %d bytes\n", download_size);
+	printf("Starting download of %u bytes\n", download_size);
 
 	if (0 == download_size) {
 		strcpy(response, "FAILdata invalid size");
-	} else if (download_size > CONFIG_FASTBOOT_BUF_SIZE) {
+	} else if (download_size > fastboot_max_download_size()) {
 		download_size = 0;
 		strcpy(response, "FAILdata too large");
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+	} else if (fb_stream.part[0]) {
+		if (sparse_stream_start(&fb_stream.ss, &fb_stream.storage,
+					fb_stream.priv)) {
+			download_size = 0;
+			strcpy(response, "FAILout of memory");
+		} else {
+			sprintf(response, "DATA%08x", download_size);
+			fb_stream.err = 0;
+			fb_stream.cur = 0;
+			fb_stream.cmd_buf = req->buf;
+			req->buf = fastboot_stream_buf(0);
+			req->complete = rx_handler_dl_stream;
+			max = is_high_speed ? hs_ep_out.wMaxPacketSize :
+				fs_ep_out.wMaxPacketSize;
+			req->length = rx_bytes_expected(max,
+					CONFIG_FASTBOOT_STREAM_BUF_SIZE);
+			if (req->length < ep->maxpacket)
+				req->length = ep->maxpacket;
+		}
+#endif
 	} else {
 		sprintf(response, "DATA%08x", download_size);
 		req->complete = rx_handler_dl_image;
 		max = is_high_speed ? hs_ep_out.wMaxPacketSize :
 			fs_ep_out.wMaxPacketSize;
-		req->length = rx_bytes_expected(max);
+		req->length = rx_bytes_expected(max, EP_BUFFER_SIZE);
 		if (req->length < ep->maxpacket)
 			req->length = ep->maxpacket;
 	}
@@ -546,6 +700,12 @@ static void do_bootm_on_complete(struct usb_ep *ep, struct usb_request *req)
 
 static void cb_boot(struct usb_ep *ep, struct usb_request *req)
 {
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+	if (fb_stream.part[0]) {
+		fastboot_tx_write_str("FAILdownload was written to flash");
+		return;
+	}
+#endif
 	fastboot_func->in_req->complete = do_bootm_on_complete;
 	fastboot_tx_write_str("OKAY");
 }
@@ -574,6 +734,17 @@ static void cb_flash(struct usb_ep *ep, struct usb_request *req)
 		return;
 	}
 
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+	/* The image was written while it was downloaded */
+	if (fb_stream.part[0]) {
+		if (strcmp(cmd, fb_stream.part))
+			fastboot_tx_write_str("FAILwrong partition");
+		else
+			fastboot_tx_write_str("OKAY");
+		return;
+	}
+#endif
+
 	strcpy(response, "FAILno flash device defined");
 #ifdef CONFIG_FASTBOOT_FLASH_MMC_DEV
 	fb_mmc_flash_write(cmd, fastboot_flash_session_id,
@@ -590,9 +761,40 @@ static void cb_flash(struct usb_ep *ep, struct usb_request *req)
 }
 #endif
 
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+/* 'oem stream <partition>' streams later downloads, 'oem stream' stops it */
+static void cb_oem_stream(const char *part)
+{
+	char response[FASTBOOT_RESPONSE_LEN];
+
+	while (*part == ' ')
+		part++;
+	if (strlcpy(fb_stream.part, part, sizeof(fb_stream.part)) >=
+	    sizeof(fb_stream.part)) {
+		fb_stream.part[0] = '\0';
+		fastboot_tx_write_str("FAILpartition name too long");
+		return;
+	}
+
+	if (!fb_stream.part[0]) {
+		fastboot_tx_write_str("OKAY");
+		return;
+	}
+	if (fb_mmc_stream_open(fb_stream.part, &fb_stream.storage,
+			       &fb_stream.priv, response))
+		fb_stream.part[0] = '\0';
+	fastboot_tx_write_str(response);
+}
+#endif
+
 static void cb_oem(struct usb_ep *ep, struct usb_request *req)
 {
 	char *cmd = req->buf;
+#ifdef CONFIG_FASTBOOT_FLASH_STREAM
+	if (strncmp("stream", cmd + 4, 6) == 0) {
+		cb_oem_stream(cmd + 10);
+	} else
+#endif
 #ifdef CONFIG_FASTBOOT_FLASH_MMC_DEV
 	if (strncmp("format", cmd + 4, 6) == 0) {
 		char cmdbuf[32];
@@ -1538,6 +1538,14 @@ int destroy_int_queue(struct usb_device *dev, struct int_queue *queue)
 {
 	return _ehci_destroy_int_queue(dev, queue);
 }
+
+int usb_get_max_xfer_size(struct usb_device *dev, size_t *size)
+{
+	/* qTDs are allocated per transfer, so any length fits in the heap */
+	*size = SIZE_MAX;
+
+	return 0;
+}
 #endif
 
 #ifdef CONFIG_DM_USB
@@ -1589,6 +1597,14 @@ static int ehci_destroy_int_queue(struct udevice *dev, struct usb_device *udev,
 	return _ehci_destroy_int_queue(udev, queue);
 }
 
+static int ehci_get_max_xfer_size(struct udevice *dev, size_t *size)
+{
+	/* qTDs are allocated per transfer, so any length fits in the heap */
+	*size = SIZE_MAX;
+
+	return 0;
+}
+
 int ehci_register(struct udevice *dev, struct ehci_hccr *hccr,
 		  struct ehci_hcor *hcor, const struct ehci_ops *ops,
 		  uint tweaks, enum usb_init_type init)
@@ -1651,6 +1667,7 @@ struct dm_usb_ops ehci_usb_ops = {
 	.create_int_queue = ehci_create_int_queue,
 	.poll_int_queue = ehci_poll_int_queue,
 	.destroy_int_queue = ehci_destroy_int_queue,
+	.get_max_xfer_size = ehci_get_max_xfer_size,
 };
 
 #endif
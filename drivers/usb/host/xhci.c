@@ -915,6 +915,23 @@ static int _xhci_submit_bulk_msg(struct usb_device *udev, unsigned long pipe,
 	return xhci_bulk_tx(udev, pipe, length, buffer);
 }
 
+/**
+ * Get the largest bulk transfer that fits in a transfer ring
+ *
+ * Each ring is a single segment ending in a link TRB and each TRB covers
+ * at most 64KB without crossing a 64KB boundary, so allow one TRB for the
+ * link and one for an unaligned buffer start.
+ *
+ * @param size	returns the maximum transfer size in bytes
+ * @return 0
+ */
+static int xhci_get_max_xfer_size(size_t *size)
+{
+	*size = (TRBS_PER_SEGMENT - 2) * TRB_MAX_BUFF_SIZE;
+
+	return 0;
+}
+
 /**
  * submit the control type of request to the Root hub/Device based on the devnum
  *
@@ -1052,6 +1069,11 @@ int submit_int_msg(struct usb_device *udev, unsigned long pipe, void *buffer,
 	return _xhci_submit_int_msg(udev, pipe, buffer, length, interval);
 }
 
+int usb_get_max_xfer_size(struct usb_device *udev, size_t *size)
+{
+	return xhci_get_max_xfer_size(size);
+}
+
 /**
  * Intialises the XHCI host controller
  * and allocates the necessary data structures
@@ -1235,11 +1257,17 @@ int xhci_deregister(struct udevice *dev)
 	return 0;
 }
 
+static int xhci_dm_get_max_xfer_size(struct udevice *dev, size_t *size)
+{
+	return xhci_get_max_xfer_size(size);
+}
+
 struct dm_usb_ops xhci_usb_ops = {
 	.control = xhci_submit_control_msg,
 	.bulk = xhci_submit_bulk_msg,
 	.interrupt = xhci_submit_int_msg,
 	.alloc_device = xhci_alloc_device,
+	.get_max_xfer_size = xhci_dm_get_max_xfer_size,
 };
 
 #endif
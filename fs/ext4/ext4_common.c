@@ -33,6 +33,7 @@
 
 struct ext2_data *ext4fs_root;
 struct ext2fs_node *ext4fs_file;
+static char *ext4fs_file_name;
 uint32_t *ext4fs_indir1_block;
 int ext4fs_indir1_size;
 int ext4fs_indir1_blkno = -1;
@@ -1875,12 +1876,19 @@ void ext4fs_reinit_global(void)
 		ext4fs_indir3_blkno = -1;
 	}
 }
-void ext4fs_close(void)
+static void ext4fs_close_file(void)
 {
 	if ((ext4fs_file != NULL) && (ext4fs_root != NULL)) {
 		ext4fs_free_node(ext4fs_file, &ext4fs_root->diropen);
 		ext4fs_file = NULL;
 	}
+	free(ext4fs_file_name);
+	ext4fs_file_name = NULL;
+}
+
+void ext4fs_close(void)
+{
+	ext4fs_close_file();
 	if (ext4fs_root != NULL) {
 		free(ext4fs_root);
 		ext4fs_root = NULL;
@@ -2013,9 +2021,10 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 					printf("< ? > ");
 					break;
 				}
-				printf("%10u %s\n",
-				       __le32_to_cpu(fdiro->inode.size),
-					filename);
+				printf("%10llu %s\n",
+				       (unsigned long long)
+				       ext4fs_inode_size(&fdiro->inode),
+				       filename);
 			}
 			free(fdiro);
 		}
@@ -2188,7 +2197,16 @@ int ext4fs_open(const char *filename, loff_t *len)
 	if (ext4fs_root == NULL)
 		return -1;
 
-	ext4fs_file = NULL;
+	/*
+	 * A file read a piece at a time is opened for each piece, so keep
+	 * the last one open rather than looking it up again
+	 */
+	if (ext4fs_file && ext4fs_file_name &&
+	    !strcmp(filename, ext4fs_file_name)) {
+		*len = ext4fs_inode_size(&ext4fs_file->inode);
+		return 0;
+	}
+	ext4fs_close_file();
 	status = ext4fs_find_file(filename, &ext4fs_root->diropen, &fdiro,
 				  FILETYPE_REG);
 	if (status == 0)
@@ -2200,8 +2218,9 @@ int ext4fs_open(const char *filename, loff_t *len)
 		if (status == 0)
 			goto fail;
 	}
-	*len = __le32_to_cpu(fdiro->inode.size);
+	*len = ext4fs_inode_size(&fdiro->inode);
 	ext4fs_file = fdiro;
+	ext4fs_file_name = strdup(filename);
 
 	return 0;
 fail:
@@ -48,6 +48,13 @@ static inline void *zalloc(size_t size)
 	return p;
 }
 
+/* 64-bit size of a file, including the i_size_high word */
+static inline loff_t ext4fs_inode_size(struct ext2_inode *inode)
+{
+	return ((loff_t)le32_to_cpu(inode->size_high) << 32) |
+		le32_to_cpu(inode->size);
+}
+
 int ext4fs_read_inode(struct ext2_data *data, int ino,
 		      struct ext2_inode *inode);
 int ext4fs_read_file(struct ext2fs_node *node, loff_t pos, loff_t len,
@@ -41,6 +41,163 @@ void ext4fs_free_node(struct ext2fs_node *node, struct ext2fs_node *currroot)
 		free(node);
 }
 
+/* State of a single pass over the extent tree of a file being read */
+struct ext4fs_extent_read {
+	int log2_fs_blocksize;	/* fs block to device block shift */
+	int blocksize;		/* fs block size in bytes */
+	loff_t pos;		/* file offset of buf */
+	loff_t end;		/* end of the requested range */
+	loff_t done;		/* file offset up to which buf is filled */
+	char *buf;
+	char *blkbuf[EXT4_EXT_MAX_DEPTH];
+};
+
+/* Read file bytes [from, to) covered by an extent starting at 'pblock' */
+static int ext4fs_read_extent_range(struct ext4fs_extent_read *er,
+				    uint64_t pblock, loff_t from, loff_t to,
+				    int uninit)
+{
+	char *dst = er->buf + (from - er->pos);
+
+	if (from > er->done)
+		memset(er->buf + (er->done - er->pos), 0, from - er->done);
+
+	if (uninit) {
+		memset(dst, 0, to - from);
+	} else {
+		uint64_t first = lldiv(from, er->blocksize);
+
+		/* ext4fs_devread() takes an int length */
+		while (from < to) {
+			uint64_t block = lldiv(from, er->blocksize);
+			int off = from - block * er->blocksize;
+			int chunk = min(to - from, (loff_t)(1 << 30));
+			lbaint_t sector = (lbaint_t)(pblock + block - first) <<
+					  er->log2_fs_blocksize;
+
+			if (!ext4fs_devread(sector, off, chunk, dst))
+				return -1;
+			from += chunk;
+			dst += chunk;
+		}
+	}
+	er->done = to;
+
+	return 0;
+}
+
+/*
+ * Walk the extent tree below 'eh' once, issuing one device read per
+ * physical extent that intersects the requested range. Index blocks are
+ * read into a buffer per tree level which is allocated once per file read.
+ */
+static int ext4fs_read_extent_tree(struct ext4fs_extent_read *er,
+				   struct ext4_extent_header *eh, int level)
+{
+	struct ext4_extent_idx *idx = (struct ext4_extent_idx *)(eh + 1);
+	int entries = le16_to_cpu(eh->eh_entries);
+	uint32_t first = lldiv(er->done, er->blocksize);
+	uint32_t last = lldiv(er->end - 1, er->blocksize);
+	int i;
+
+	if (le16_to_cpu(eh->eh_magic) != EXT4_EXT_MAGIC ||
+	    level >= EXT4_EXT_MAX_DEPTH) {
+		printf("invalid extent block\n");
+		return -1;
+	}
+
+	if (eh->eh_depth == 0) {
+		struct ext4_extent *ext = (struct ext4_extent *)(eh + 1);
+
+		for (i = 0; i < entries && er->done < er->end; i++) {
+			uint32_t block = le32_to_cpu(ext[i].ee_block);
+			unsigned int len = le16_to_cpu(ext[i].ee_len);
+			int uninit = len > EXT_INIT_MAX_LEN;
+			uint64_t start;
+			loff_t from, to;
+
+			if (uninit)
+				len -= EXT_INIT_MAX_LEN;
+			if ((uint64_t)block + len <= first)
+				continue;
+			if (block > last)
+				break;
+
+			from = max((loff_t)block * er->blocksize, er->done);
+			to = min(((loff_t)block + len) * er->blocksize,
+				 er->end);
+			start = le16_to_cpu(ext[i].ee_start_hi);
+			start = (start << 32) + le32_to_cpu(ext[i].ee_start_lo);
+			start += lldiv(from, er->blocksize) - block;
+
+			if (ext4fs_read_extent_range(er, start, from, to,
+						     uninit))
+				return -1;
+		}
+		return 0;
+	}
+
+	for (i = 0; i < entries && er->done < er->end; i++) {
+		uint64_t leaf;
+
+		/* skip subtrees which end before the range */
+		if (i + 1 < entries &&
+		    le32_to_cpu(idx[i + 1].ei_block) <= first)
+			continue;
+		if (le32_to_cpu(idx[i].ei_block) > last)
+			break;
+
+		if (!er->blkbuf[level]) {
+			er->blkbuf[level] = zalloc(er->blocksize);
+			if (!er->blkbuf[level])
+				return -1;
+		}
+		leaf = le16_to_cpu(idx[i].ei_leaf_hi);
+		leaf = (leaf << 32) + le32_to_cpu(idx[i].ei_leaf_lo);
+		if (!ext4fs_devread((lbaint_t)leaf << er->log2_fs_blocksize,
+				    0, er->blocksize, er->blkbuf[level]))
+			return -1;
+		if (ext4fs_read_extent_tree(er, (struct ext4_extent_header *)
+					    er->blkbuf[level], level + 1))
+			return -1;
+		first = lldiv(er->done, er->blocksize);
+	}
+
+	return 0;
+}
+
+/*
+ * Read 'len' bytes at 'pos' of an extent-mapped file, resolving each
+ * extent once rather than once per block. Holes and uninitialised extents
+ * read back as zeroes.
+ */
+static int ext4fs_read_file_extents(struct ext2fs_node *node, loff_t pos,
+				    loff_t len, char *buf)
+{
+	struct ext4fs_extent_read er;
+	int i, ret;
+
+	memset(&er, 0, sizeof(er));
+	er.log2_fs_blocksize = LOG2_BLOCK_SIZE(node->data) -
+			       get_fs()->dev_desc->log2blksz;
+	er.blocksize = EXT2_BLOCK_SIZE(node->data);
+	er.pos = pos;
+	er.end = pos + len;
+	er.done = pos;
+	er.buf = buf;
+
+	ret = ext4fs_read_extent_tree(&er, (struct ext4_extent_header *)
+				      node->inode.b.blocks.dir_blocks, 0);
+	/* zero the tail of the range beyond the last extent */
+	if (!ret && er.done < er.end)
+		memset(buf + (er.done - pos), 0, er.end - er.done);
+
+	for (i = 0; i < EXT4_EXT_MAX_DEPTH; i++)
+		free(er.blkbuf[i]);
+
+	return ret;
+}
+
 /*
  * Taken from openmoko-kernel mailing list: By Andy green
  * Optimized read file API : collects and defers contiguous sector
@@ -55,7 +212,7 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 	int log2blksz = fs->dev_desc->log2blksz;
 	int log2_fs_blocksize = LOG2_BLOCK_SIZE(node->data) - log2blksz;
 	int blocksize = (1 << (log2_fs_blocksize + log2blksz));
-	unsigned int filesize = __le32_to_cpu(node->inode.size);
+	loff_t filesize = ext4fs_inode_size(&node->inode);
 	lbaint_t previous_block_number = -1;
 	lbaint_t delayed_start = 0;
 	lbaint_t delayed_extent = 0;
@@ -65,14 +222,26 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 	short status;
 
 	/* Adjust len so it we can't read past the end of the file. */
-	if (len > filesize)
-		len = filesize;
+	if (pos >= filesize) {
+		*actread = 0;
+		return 0;
+	}
+	if (len > filesize - pos)
+		len = filesize - pos;
+
+	if (le32_to_cpu(node->inode.flags) & EXT4_EXTENTS_FL) {
+		if (len > 0 &&
+		    ext4fs_read_file_extents(node, pos, len, buf))
+			return -1;
+		*actread = len;
+		return 0;
+	}
 
 	blockcnt = lldiv(((len + pos) + blocksize - 1), blocksize);
 
 	for (i = lldiv(pos, blocksize); i < blockcnt; i++) {
 		lbaint_t blknr;
-		int blockoff = pos - (blocksize * i);
+		int blockoff = pos - ((loff_t)blocksize * i);
 		int blockend = blocksize;
 		int skipfirst = 0;
 		blknr = read_allocated_block(&(node->inode), i);
@@ -83,7 +252,7 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 
 		/* Last block.  */
 		if (i == blockcnt - 1) {
-			blockend = (len + pos) - (blocksize * i);
+			blockend = (len + pos) - ((loff_t)blocksize * i);
 
 			/* The last portion is exactly blocksize. */
 			if (!blockend)
@@ -190,12 +359,12 @@ int ext4fs_size(const char *filename, loff_t *size)
 	return ext4fs_open(filename, size);
 }
 
-int ext4fs_read(char *buf, loff_t len, loff_t *actread)
+int ext4fs_read(char *buf, loff_t offset, loff_t len, loff_t *actread)
 {
 	if (ext4fs_root == NULL || ext4fs_file == NULL)
 		return 0;
 
-	return ext4fs_read_file(ext4fs_file, 0, len, buf, actread);
+	return ext4fs_read_file(ext4fs_file, offset, len, buf, actread);
 }
 
 int ext4fs_probe(struct blk_desc *fs_dev_desc,
@@ -217,11 +386,6 @@ int ext4_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 	loff_t file_len;
 	int ret;
 
-	if (offset != 0) {
-		printf("** Cannot support non-zero offset **\n");
-		return -1;
-	}
-
 	ret = ext4fs_open(filename, &file_len);
 	if (ret < 0) {
 		printf("** File not found %s **\n", filename);
@@ -231,7 +395,7 @@ int ext4_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
 	if (len == 0)
 		len = file_len;
 
-	return ext4fs_read(buf, len, len_read);
+	return ext4fs_read(buf, offset, len, len_read);
 }
 
 int ext4fs_uuid(char *uuid_str)
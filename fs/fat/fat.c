@@ -41,6 +41,37 @@ static void downcase(char *str)
 static struct blk_desc *cur_dev;
 static disk_partition_t cur_part_info;
 
+/*
+ * Run-length map of the cluster chain of a file. Each extent describes a
+ * run of physically contiguous clusters and the index of its first cluster
+ * within the file, so a file offset can be located by binary search and
+ * each run can be read with a single disk_read().
+ */
+struct fat_extent {
+	__u32	file_clust;	/* Index of first cluster within the file */
+	__u32	start;		/* First cluster on disk */
+	__u32	len;		/* Number of contiguous clusters */
+};
+
+struct fat_extent_map {
+	struct blk_desc		*dev;
+	lbaint_t		part_start;
+	__u32			first_clust;	/* Start cluster of the file */
+	__u32			nr_clust;	/* Clusters covered by the map */
+	int			nr_extents;
+	int			max_extents;
+	struct fat_extent	*extents;
+};
+
+/* Map of the most recently read file, reused by subsequent reads */
+static struct fat_extent_map fat_extent_cache;
+
+static void fat_extent_cache_invalidate(void)
+{
+	free(fat_extent_cache.extents);
+	memset(&fat_extent_cache, '\0', sizeof(fat_extent_cache));
+}
+
 #define DOS_BOOT_MAGIC_OFFSET	0x1fe
 #define DOS_FS_TYPE_OFFSET	0x36
 #define DOS_FS32_TYPE_OFFSET	0x52
@@ -66,6 +97,7 @@ int fat_set_blk_dev(struct blk_desc *dev_desc, disk_partition_t *info)
 
 	cur_dev = dev_desc;
 	cur_part_info = *info;
+	fat_extent_cache_invalidate();
 
 	/* Make sure it has a valid FAT header */
 	if (disk_read(0, 1, buffer) != 1) {
@@ -322,6 +354,109 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 	return 0;
 }
 
+static int fat_extent_add(struct fat_extent_map *map, __u32 clust)
+{
+	struct fat_extent *ext;
+
+	if (map->nr_extents) {
+		ext = &map->extents[map->nr_extents - 1];
+		if (ext->start + ext->len == clust) {
+			ext->len++;
+			map->nr_clust++;
+			return 0;
+		}
+	}
+
+	if (map->nr_extents == map->max_extents) {
+		int max = map->max_extents ? map->max_extents * 2 : 16;
+
+		ext = malloc(max * sizeof(*ext));
+		if (!ext)
+			return -1;
+		if (map->extents) {
+			memcpy(ext, map->extents,
+			       map->nr_extents * sizeof(*ext));
+			free(map->extents);
+		}
+		map->extents = ext;
+		map->max_extents = max;
+	}
+
+	ext = &map->extents[map->nr_extents++];
+	ext->file_clust = map->nr_clust;
+	ext->start = clust;
+	ext->len = 1;
+	map->nr_clust++;
+
+	return 0;
+}
+
+/*
+ * Return the extent map for the chain starting at 'clust', covering at
+ * most 'nr_clust' clusters. The chain is walked only when the cached map
+ * does not already describe this file. The map may be shorter than
+ * requested if the chain ends early or contains an invalid entry.
+ * Return NULL on allocation failure.
+ */
+static struct fat_extent_map *fat_get_extent_map(fsdata *mydata, __u32 clust,
+						 __u32 nr_clust)
+{
+	struct fat_extent_map *map = &fat_extent_cache;
+	struct fat_extent *ext;
+
+	if (map->extents && map->dev == cur_dev &&
+	    map->part_start == cur_part_info.start &&
+	    map->first_clust == clust) {
+		if (map->nr_clust >= nr_clust)
+			return map;
+		/* extend the cached map from its last cluster */
+		ext = &map->extents[map->nr_extents - 1];
+		clust = get_fatent(mydata, ext->start + ext->len - 1);
+	} else {
+		fat_extent_cache_invalidate();
+		map->dev = cur_dev;
+		map->part_start = cur_part_info.start;
+		map->first_clust = clust;
+	}
+
+	while (map->nr_clust < nr_clust) {
+		if (CHECK_CLUST(clust, mydata->fatsize)) {
+			debug("curclust: 0x%x\n", clust);
+			debug("Invalid FAT entry\n");
+			/* do not reuse a truncated map */
+			map->dev = NULL;
+			break;
+		}
+		if (fat_extent_add(map, clust)) {
+			fat_extent_cache_invalidate();
+			return NULL;
+		}
+		if (map->nr_clust < nr_clust)
+			clust = get_fatent(mydata, clust);
+	}
+	debug("FAT: %u clusters in %d extents\n", map->nr_clust,
+	      map->nr_extents);
+
+	return map;
+}
+
+/* Return the index of the extent containing file cluster 'idx' */
+static int fat_find_extent(struct fat_extent_map *map, __u32 idx)
+{
+	int lo = 0, hi = map->nr_extents - 1;
+
+	while (lo < hi) {
+		int mid = (lo + hi + 1) / 2;
+
+		if (map->extents[mid].file_clust <= idx)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	return lo;
+}
+
 /*
  * Read at most 'maxsize' bytes from 'pos' in the file associated with 'dentptr'
  * into 'buffer'.
@@ -335,9 +470,11 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 {
 	loff_t filesize = FAT2CPU32(dentptr->size);
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
-	__u32 curclust = START(dentptr);
-	__u32 endclust, newclust;
+	struct fat_extent_map *map;
+	struct fat_extent *ext;
+	__u32 clustidx, skip;
 	loff_t actsize;
+	int i;
 
 	*gotsize = 0;
 	debug("Filesize: %llu bytes\n", filesize);
@@ -352,28 +489,31 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 
 	debug("%llu bytes\n", filesize);
 
-	actsize = bytesperclust;
+	map = fat_get_extent_map(mydata, START(dentptr),
+				 DIV_ROUND_UP(filesize, bytesperclust));
+	if (!map) {
+		debug("Error: allocating memory\n");
+		return -1;
+	}
 
 	/* go to cluster at pos */
-	while (actsize <= pos) {
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			debug("Invalid FAT entry\n");
-			return 0;
-		}
-		actsize += bytesperclust;
-	}
+	clustidx = pos / bytesperclust;
+	if (clustidx >= map->nr_clust)
+		return 0;
+	/* do not read past the end of the chain */
+	filesize = min(filesize, (loff_t)map->nr_clust * bytesperclust);
 
-	/* actsize > pos */
-	actsize -= bytesperclust;
-	filesize -= actsize;
-	pos -= actsize;
+	i = fat_find_extent(map, clustidx);
+	ext = &map->extents[i];
+	skip = clustidx - ext->file_clust;
+	pos -= (loff_t)clustidx * bytesperclust;
+	filesize -= (loff_t)clustidx * bytesperclust;
 
 	/* align to beginning of next cluster if any */
 	if (pos) {
 		actsize = min(filesize, (loff_t)bytesperclust);
-		if (get_cluster(mydata, curclust, get_contents_vfatname_block,
+		if (get_cluster(mydata, ext->start + skip,
+				get_contents_vfatname_block,
 				(int)actsize) != 0) {
 			printf("Error reading cluster\n");
 			return -1;
@@ -386,58 +526,29 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 			return 0;
 		buffer += actsize;
 
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			debug("Invalid FAT entry\n");
-			return 0;
+		if (++skip == ext->len) {
+			ext++;
+			skip = 0;
 		}
 	}
 
-	actsize = bytesperclust;
-	endclust = curclust;
-
-	do {
-		/* search for consecutive clusters */
-		while (actsize < filesize) {
-			newclust = get_fatent(mydata, endclust);
-			if ((newclust - 1) != endclust)
-				goto getit;
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				debug("curclust: 0x%x\n", newclust);
-				debug("Invalid FAT entry\n");
-				return 0;
-			}
-			endclust = newclust;
-			actsize += bytesperclust;
-		}
-
-		/* get remaining bytes */
-		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
+	/* read each run of contiguous clusters in one go */
+	while (filesize) {
+		actsize = min(filesize,
+			      (loff_t)(ext->len - skip) * bytesperclust);
+		if (get_cluster(mydata, ext->start + skip, buffer,
+				actsize) != 0) {
 			printf("Error reading cluster\n");
 			return -1;
 		}
 		*gotsize += actsize;
-		return 0;
-getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += (int)actsize;
 		filesize -= actsize;
 		buffer += actsize;
+		ext++;
+		skip = 0;
+	}
 
-		curclust = get_fatent(mydata, endclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return 0;
-		}
-		actsize = bytesperclust;
-		endclust = curclust;
-	} while (1);
+	return 0;
 }
 
 /*
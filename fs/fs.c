@@ -235,7 +235,7 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 	return -1;
 }
 
-static void fs_close(void)
+void fs_close(void)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
 
@@ -291,8 +291,8 @@ int fs_size(const char *filename, loff_t *size)
 	return ret;
 }
 
-int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
-	    loff_t *actread)
+int fs_read_at(const char *filename, ulong addr, loff_t offset, loff_t len,
+	       loff_t *actread)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
 	void *buf;
@@ -306,6 +306,16 @@ int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	ret = info->read(filename, buf, offset, len, actread);
 	unmap_sysmem(buf);
 
+	return ret;
+}
+
+int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
+	    loff_t *actread)
+{
+	int ret;
+
+	ret = fs_read_at(filename, addr, offset, len, actread);
+
 	/* If we requested a specific number of bytes, check we got it */
 	if (ret == 0 && len && *actread != len)
 		printf("** %s shorter than offset + len **\n", filename);
@@ -152,6 +152,7 @@ void ubifs_add_bud(struct ubifs_info *c, struct ubifs_bud *bud)
 	spin_unlock(&c->buds_lock);
 }
 
+#ifndef __UBOOT__
 /**
  * ubifs_add_bud_to_log - add a new bud to the log.
  * @c: UBIFS file-system description object
@@ -281,6 +282,7 @@ out_unlock:
 	kfree(bud);
 	return err;
 }
+#endif
 
 /**
  * remove_buds - remove used buds.
@@ -437,6 +439,7 @@ out:
 	return err;
 }
 
+#ifndef __UBOOT__
 /**
  * ubifs_log_end_commit - end commit.
  * @c: UBIFS file-system description object
@@ -482,6 +485,7 @@ out:
 	mutex_unlock(&c->log_mutex);
 	return err;
 }
+#endif
 
 /**
  * ubifs_log_post_commit - things to do after commit is completed.
@@ -42,7 +42,9 @@
  * than the maximum number of orphans allowed.
  */
 
+#ifndef __UBOOT__
 static int dbg_check_orphans(struct ubifs_info *c);
+#endif
 
 /**
  * ubifs_add_orphan - add an orphan.
@@ -182,6 +184,7 @@ int ubifs_orphan_start_commit(struct ubifs_info *c)
 	return 0;
 }
 
+#ifndef __UBOOT__
 /**
  * avail_orphs - calculate available space.
  * @c: UBIFS file-system description object
@@ -201,6 +204,7 @@ static int avail_orphs(struct ubifs_info *c)
 		avail += (gap - UBIFS_ORPH_NODE_SZ) / sizeof(__le64);
 	return avail;
 }
+#endif
 
 /**
  * tot_avail_orphs - calculate total space.
@@ -219,6 +223,7 @@ static int tot_avail_orphs(struct ubifs_info *c)
 	return avail / 2;
 }
 
+#ifndef __UBOOT__
 /**
  * do_write_orph_node - write a node to the orphan head.
  * @c: UBIFS file-system description object
@@ -467,6 +472,7 @@ int ubifs_orphan_end_commit(struct ubifs_info *c)
 	err = dbg_check_orphans(c);
 	return err;
 }
+#endif
 
 /**
  * ubifs_clear_orphans - erase all LEBs used for orphans.
@@ -716,6 +722,7 @@ int ubifs_mount_orphans(struct ubifs_info *c, int unclean, int read_only)
 	return err;
 }
 
+#ifndef __UBOOT__
 /*
  * Everything below is related to debugging.
  */
@@ -944,3 +951,4 @@ out:
 	kfree(ci.node);
 	return err;
 }
+#endif
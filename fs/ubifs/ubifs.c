@@ -13,6 +13,7 @@
  */
 
 #include <common.h>
+#include <mapmem.h>
 #include <memalign.h>
 #include "ubifs.h"
 #include <u-boot/zlib.h>
@@ -681,23 +682,17 @@ static inline void *kmap(struct page *page)
 	return page->addr;
 }
 
-static int read_block(struct inode *inode, void *addr, unsigned int block,
-		      struct ubifs_data_node *dn)
+/*
+ * Check a data node which has been read and decompress it into @addr, which
+ * has room for a whole block.
+ */
+static int decompress_block(struct ubifs_info *c, struct inode *inode,
+			    void *addr, unsigned int block,
+			    struct ubifs_data_node *dn)
 {
-	struct ubifs_info *c = inode->i_sb->s_fs_info;
 	int err, len, out_len;
-	union ubifs_key key;
 	unsigned int dlen;
 
-	data_key_init(c, &key, inode->i_ino, block);
-	err = ubifs_tnc_lookup(c, &key, dn);
-	if (err) {
-		if (err == -ENOENT)
-			/* Not found, so it must be a hole */
-			memset(addr, 0, UBIFS_BLOCK_SIZE);
-		return err;
-	}
-
 	ubifs_assert(le64_to_cpu(dn->ch.sqnum) > ubifs_inode(inode)->creat_sqnum);
 
 	len = le32_to_cpu(dn->size);
@@ -728,6 +723,95 @@ dump:
 	return -EINVAL;
 }
 
+static int read_block(struct inode *inode, void *addr, unsigned int block,
+		      struct ubifs_data_node *dn)
+{
+	struct ubifs_info *c = inode->i_sb->s_fs_info;
+	union ubifs_key key;
+	int err;
+
+	data_key_init(c, &key, inode->i_ino, block);
+	err = ubifs_tnc_lookup(c, &key, dn);
+	if (err) {
+		if (err == -ENOENT)
+			/* Not found, so it must be a hole */
+			memset(addr, 0, UBIFS_BLOCK_SIZE);
+		return err;
+	}
+
+	return decompress_block(c, inode, addr, block, dn);
+}
+
+/*
+ * Read @count whole blocks of @inode, starting at @block, into @addr.
+ *
+ * Rather than looking up each data node in the index and reading it on its
+ * own, walk the index once for each run of data nodes which sit next to each
+ * other in the same LEB and read the whole run with a single flash read.
+ * This is how Linux does bulk-read, but without the page cache.
+ */
+static int read_blocks_bulk(struct ubifs_info *c, struct inode *inode,
+			    void *addr, unsigned int block, unsigned int count)
+{
+	struct bu_info *bu = &c->bu;
+	unsigned int end = block + count, holes;
+	int err = 0, i;
+
+	mutex_lock(&c->bu_mutex);
+	while (block < end) {
+		data_key_init(c, &bu->key, inode->i_ino, block);
+		bu->buf_len = c->max_bu_buf_len;
+		err = ubifs_tnc_get_bu_keys(c, bu);
+		if (err)
+			break;
+		if (bu->cnt) {
+			err = ubifs_tnc_bulk_read(c, bu);
+			if (err)
+				break;
+		}
+
+		for (i = 0; i < bu->cnt && block < end; i++) {
+			struct ubifs_zbranch *zbr = &bu->zbranch[i];
+			unsigned int next = key_block(c, &zbr->key);
+			void *dn = bu->buf + zbr->offs - bu->zbranch[0].offs;
+
+			/* Blocks with no data node are holes */
+			for (; block < next && block < end; block++) {
+				memset(addr, 0, UBIFS_BLOCK_SIZE);
+				addr += UBIFS_BLOCK_SIZE;
+			}
+			if (block == end)
+				break;
+
+			err = decompress_block(c, inode, addr, block, dn);
+			if (err)
+				goto out;
+			addr += UBIFS_BLOCK_SIZE;
+			block++;
+		}
+
+		/*
+		 * With no data node found, the next one (if any) is at least
+		 * UBIFS_MAX_BULK_READ blocks away. Past the last one the rest
+		 * of the file is a hole.
+		 */
+		if (bu->eof)
+			holes = end - block;
+		else if (!bu->cnt)
+			holes = min_t(unsigned int, end - block,
+				      UBIFS_MAX_BULK_READ);
+		else
+			holes = 0;
+		memset(addr, 0, holes * UBIFS_BLOCK_SIZE);
+		addr += holes * UBIFS_BLOCK_SIZE;
+		block += holes;
+	}
+out:
+	mutex_unlock(&c->bu_mutex);
+
+	return err;
+}
+
 static int do_readpage(struct ubifs_info *c, struct inode *inode,
 		       struct page *page, int last_block_size)
 {
@@ -897,7 +981,28 @@ int ubifs_read(const char *filename, void *buf, loff_t offset,
 	page.addr = buf;
 	page.index = offset / PAGE_SIZE;
 	page.inode = inode;
-	for (i = 0; i < count; i++) {
+	i = 0;
+
+	/*
+	 * Read all but the last block in bulk, as it may be partial. A bulk
+	 * read covers nodes beyond those asked for, so if it fails, read the
+	 * blocks one at a time and only report errors in the wanted ones.
+	 */
+	if (c->bulk_read && count > 1) {
+		err = read_blocks_bulk(c, inode, buf,
+				       page.index * UBIFS_BLOCKS_PER_PAGE,
+				       count - 1);
+		if (!err) {
+			i = count - 1;
+			page.addr += i * PAGE_SIZE;
+			page.index += i;
+		} else {
+			dbg_gen("bulk-read failed, error %d", err);
+			err = 0;
+		}
+	}
+
+	for (; !err && i < count; i++) {
 		/*
 		 * Make sure to not read beyond the requested size
 		 */
@@ -939,7 +1044,8 @@ int ubifs_load(char *filename, u32 addr, u32 size)
 
 	printf("Loading file '%s' to addr 0x%08x...\n", filename, addr);
 
-	err = ubifs_read(filename, (void *)addr, 0, size, &actread);
+	err = ubifs_read(filename, map_sysmem(addr, size), 0, size,
+			 &actread);
 	if (err == 0) {
 		setenv_hex("filesize", actread);
 		printf("Done\n");
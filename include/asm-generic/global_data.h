@@ -79,6 +79,9 @@ typedef struct global_data {
 	struct udevice	*dm_root;	/* Root instance for Driver Model */
 	struct udevice	*dm_root_f;	/* Pre-relocation root instance */
 	struct list_head uclass_root;	/* Head of core tree */
+	struct uclass_table *uclass_table;	/* Uclasses indexed by id */
+	/* Driver compatible strings, see lists_bind_fdt() */
+	struct lists_compat_index *compat_index;
 #endif
 #ifdef CONFIG_TIMER
 	struct udevice	*timer;	/* Timer instance for Driver Model */
@@ -118,6 +118,25 @@ void blkcache_fill
 	 lbaint_t start, lbaint_t blkcnt,
 	 unsigned long blksz, void const *buffer);
 
+/**
+ * blkcache_readahead() - service a cache miss with a read-ahead batch
+ *
+ * When the device is being read sequentially, this reads the requested
+ * blocks plus a read-ahead window in a single device read and makes the
+ * whole batch available to the cache.
+ *
+ * @param block_dev - block device to read from
+ * @param start - starting block number
+ * @param blkcnt - number of blocks to read
+ * @param buf - buffer to contain the requested blocks
+ *
+ * @return - number of blocks read into buf, '0' if no read-ahead was
+ * done and the caller should read the blocks itself.
+ */
+ulong blkcache_readahead
+	(struct blk_desc *block_dev,
+	 lbaint_t start, lbaint_t blkcnt, void *buffer);
+
 /**
  * blkcache_invalidate() - discard the cache for a set of blocks
  * because of a write or device (re)initialization.
@@ -131,10 +150,10 @@ void blkcache_invalidate
 /**
  * blkcache_configure() - configure block cache
  *
- * @param blocks - maximum blocks per entry
- * @param entries - maximum entries in cache
+ * @param megabytes - cache capacity in MiB, 0 to disable the cache
+ * @param readahead_kb - maximum read-ahead window in KiB, 0 to disable
  */
-void blkcache_configure(unsigned blocks, unsigned entries);
+void blkcache_configure(unsigned megabytes, unsigned readahead_kb);
 
 /*
  * statistics of the block cache
@@ -142,9 +161,25 @@ void blkcache_configure(unsigned blocks, unsigned entries);
 struct block_cache_stats {
 	unsigned hits;
 	unsigned misses;
-	unsigned entries; /* current entry count */
-	unsigned max_blocks_per_entry;
-	unsigned max_entries;
+	unsigned evictions;
+	unsigned readaheads;
+	unsigned entries; /* current count of valid cache lines */
+	unsigned max_entries; /* total cache lines */
+	unsigned size_mb;
+	unsigned readahead_kb;
+	unsigned ways;
+};
+
+/*
+ * per-device statistics of the block cache
+ */
+struct block_cache_dev_stats {
+	int iftype;
+	int devnum;
+	unsigned hits;
+	unsigned misses;
+	unsigned evictions; /* lines of this device evicted */
+	unsigned readaheads;
 };
 
 /**
@@ -154,6 +189,16 @@ struct block_cache_stats {
  */
 void blkcache_stats(struct block_cache_stats *stats);
 
+/**
+ * blkcache_dev_stats() - return per-device statistics and reset
+ *
+ * @param index - index of the device, starting at 0
+ * @param stats - statistics are copied here
+ *
+ * @return - 0 if OK, -ENOENT if there is no device with that index
+ */
+int blkcache_dev_stats(int index, struct block_cache_dev_stats *stats);
+
 #else
 
 static inline int blkcache_read
@@ -169,6 +214,13 @@ static inline void blkcache_fill
 	 lbaint_t start, lbaint_t blkcnt,
 	 unsigned long blksz, void const *buffer) {}
 
+static inline ulong blkcache_readahead
+	(struct blk_desc *block_dev,
+	 lbaint_t start, lbaint_t blkcnt, void *buffer)
+{
+	return 0;
+}
+
 static inline void blkcache_invalidate
 	(int iftype, int dev) {}
 
@@ -319,6 +371,9 @@ static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	if (blkcache_read(block_dev->if_type, block_dev->devnum,
 			  start, blkcnt, block_dev->blksz, buffer))
 		return blkcnt;
+	blks_read = blkcache_readahead(block_dev, start, blkcnt, buffer);
+	if (blks_read)
+		return blks_read;
 
 	/*
 	 * We could check if block_read is NULL and return -ENOSYS. But this
@@ -25,9 +25,6 @@
 
 #define CONFIG_SYS_STDIO_DEREGISTER
 
-/* Number of bits in a C 'long' on this architecture */
-#define CONFIG_SANDBOX_BITS_PER_LONG	64
-
 #define CONFIG_LMB
 #define CONFIG_CMD_FDT
 #define CONFIG_ANDROID_BOOT_IMAGE
@@ -88,6 +85,17 @@
 #define CONFIG_CMD_SF_TEST
 #define CONFIG_CMD_SPI
 
+/* NAND (see "sandbox,nand" in the device tree) with UBI and UBIFS */
+#define CONFIG_SYS_MAX_NAND_DEVICE	1
+#define CONFIG_MTD_DEVICE
+#define CONFIG_MTD_PARTITIONS
+#define CONFIG_CMD_MTDPARTS
+#define MTDIDS_DEFAULT			"nand0=sandbox-nand"
+#define MTDPARTS_DEFAULT		"mtdparts=sandbox-nand:-(ubi)"
+#define CONFIG_CMD_UBI
+#define CONFIG_CMD_UBIFS
+#define CONFIG_RBTREE
+
 #define CONFIG_CMD_I2C
 #define CONFIG_I2C_EDID
 #define CONFIG_I2C_EEPROM
@@ -187,6 +195,9 @@
 					"eth5addr=00:00:11:22:33:47\0" \
 					"ipaddr=1.2.3.4\0"
 
+#define SANDBOX_MTD_SETTINGS		"mtdids=" MTDIDS_DEFAULT "\0" \
+					"mtdparts=" MTDPARTS_DEFAULT "\0"
+
 #define MEM_LAYOUT_ENV_SETTINGS \
 	"bootm_size=0x10000000\0" \
 	"kernel_addr_r=0x1000000\0" \
@@ -198,6 +209,7 @@
 #define CONFIG_EXTRA_ENV_SETTINGS \
 	SANDBOX_SERIAL_SETTINGS \
 	SANDBOX_ETH_SETTINGS \
+	SANDBOX_MTD_SETTINGS \
 	BOOTENV \
 	MEM_LAYOUT_ENV_SETTINGS
 
@@ -210,4 +222,13 @@
 #define CONFIG_CMD_USB
 #define CONFIG_CMD_DATE
 
+#define CONFIG_MMC
+#define CONFIG_GENERIC_MMC
+#define CONFIG_CMD_MMC
+
+/* DFU back-end only (there is no USB gadget), used by the dm tests */
+#define CONFIG_USB_FUNCTION_DFU
+#define CONFIG_DFU_RAM
+#define CONFIG_SYS_DFU_DATA_BUF_SIZE	(1024 * 1024)
+
 #endif
@@ -95,6 +95,24 @@ struct sf_internal_data {
 #define DFU_MANIFEST_POLL_TIMEOUT	DFU_DEFAULT_POLL_TIMEOUT
 #endif
 
+/**
+ * struct dfu_stats - write statistics for the last transfer to an entity
+ *
+ * @bytes:		Bytes written to the medium
+ * @writes:		Number of write_medium() calls
+ * @write_us:		Time spent in write_medium()
+ * @max_write_us:	Longest single write_medium() call
+ * @total_us:		Time from the first dfu_write() to the end of
+ *			dfu_flush()
+ */
+struct dfu_stats {
+	u64 bytes;
+	ulong writes;
+	ulong write_us;
+	ulong max_write_us;
+	ulong total_us;
+};
+
 struct dfu_entity {
 	char			name[DFU_NAME_SIZE];
 	int                     alt;
@@ -137,6 +155,9 @@ struct dfu_entity {
 
 	u32 bad_skip;	/* for nand use */
 
+	struct dfu_stats stats;
+	ulong start_us;
+
 	unsigned int inited:1;
 };
 
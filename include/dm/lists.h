@@ -60,6 +60,26 @@ int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only);
 int lists_bind_fdt(struct udevice *parent, const void *blob, int offset,
 		   struct udevice **devp);
 
+/**
+ * lists_find_fdt_driver() - find the driver to bind to a device tree node
+ *
+ * This is the lookup used by lists_bind_fdt(): the first driver in the
+ * linker list with an of_match entry for any of the node's compatible
+ * strings.
+ *
+ * @blob: device tree blob
+ * @offset: offset of this device tree node
+ * @scan: true to check each driver in turn rather than use the
+ * compatible-string index (CONFIG_DM_COMPAT_INDEX)
+ * @drvp: returns the driver that was found
+ * @of_idp: returns the of_match entry that was found
+ * @return 0 if there is a match, -ENOENT if no match, -ENODEV if the node
+ * does not have a compatible string, other -ve value on device tree error
+ */
+int lists_find_fdt_driver(const void *blob, int offset, bool scan,
+			  struct driver **drvp,
+			  const struct udevice_id **of_idp);
+
 /**
  * device_bind_driver() - bind a device to a driver
  *
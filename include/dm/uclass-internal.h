@@ -10,6 +10,70 @@
 #ifndef _DM_UCLASS_INTERNAL_H
 #define _DM_UCLASS_INTERNAL_H
 
+#include <dm/uclass-id.h>
+
+/* Types of lookup counted with CONFIG_DM_STATS */
+enum dm_lookup_t {
+	DM_LOOKUP_UCLASS,	/* uclass_find() */
+	DM_LOOKUP_SEQ,		/* uclass_find_device_by_seq() */
+	DM_LOOKUP_OF_OFFSET,	/* uclass_find_device_by_of_offset() */
+	DM_LOOKUP_NAME,		/* uclass_find_device_by_name() */
+
+	DM_LOOKUP_COUNT,
+};
+
+/**
+ * struct dm_lookup_stats - driver model lookup statistics
+ *
+ * @count: Number of lookups of each type
+ * @ticks: Timer ticks spent in lookups of each type
+ * @map_builds: Number of uclass lookup maps built
+ * @map_misses: Lookups which a map could not answer and which fell back to
+ * walking the uclass device list
+ * @busy: true while reading the timer, to avoid counting lookups made by
+ * the timer driver itself
+ */
+struct dm_lookup_stats {
+	ulong count[DM_LOOKUP_COUNT];
+	u64 ticks[DM_LOOKUP_COUNT];
+	ulong map_builds;
+	ulong map_misses;
+	bool busy;
+};
+
+/**
+ * struct uclass_table - uclasses indexed by ID
+ *
+ * This is allocated by dm_init() once full malloc() is available, and is
+ * pointed to by gd->uclass_table. Before that uclass_find() walks the list
+ * of uclasses instead.
+ *
+ * @uclass: Uclass for each ID, or NULL if not yet created
+ * @stats: Lookup statistics, with CONFIG_DM_STATS
+ */
+struct uclass_table {
+	struct uclass *uclass[UCLASS_COUNT];
+#if CONFIG_IS_ENABLED(DM_STATS)
+	struct dm_lookup_stats stats;
+#endif
+};
+
+/**
+ * uclass_table_init() - Set up the table of uclasses indexed by ID
+ *
+ * This is called by dm_init(). If full malloc() is not yet available, or
+ * the allocation fails, gd->uclass_table is set to NULL.
+ */
+void uclass_table_init(void);
+
+/**
+ * dm_get_lookup_stats() - Get the driver model lookup statistics
+ *
+ * @return pointer to the statistics, or NULL if CONFIG_DM_STATS is not
+ * enabled or there is no uclass table
+ */
+struct dm_lookup_stats *dm_get_lookup_stats(void);
+
 /**
  * uclass_get_device_tail() - handle the end of a get_device call
  *
@@ -138,6 +202,16 @@ int uclass_unbind_device(struct udevice *dev);
 static inline int uclass_unbind_device(struct udevice *dev) { return 0; }
 #endif
 
+/**
+ * uclass_set_seq() - Set the sequence number of a device
+ *
+ * This updates dev->seq and keeps the uclass sequence map in step with it.
+ *
+ * @dev:	Pointer to the device
+ * @seq:	New sequence number, or -1 if the device has none
+ */
+void uclass_set_seq(struct udevice *dev, int seq);
+
 /**
  * uclass_pre_probe_device() - Deal with a device that is about to be probed
  *
@@ -14,6 +14,36 @@
 #include <linker_lists.h>
 #include <linux/list.h>
 
+/* Keys by which the devices of a uclass are indexed */
+enum uclass_map_id {
+	UCLASS_MAP_SEQ,		/* dev->seq of probed devices */
+	UCLASS_MAP_REQ_SEQ,	/* dev->req_seq */
+	UCLASS_MAP_OF_OFFSET,	/* dev->of_offset */
+
+	UCLASS_MAP_COUNT,
+};
+
+/**
+ * struct uclass_map - devices of a uclass indexed by an integer key
+ *
+ * This is an open-addressed hash table which is built the first time it is
+ * needed and thrown away when devices are bound to or unbound from the
+ * uclass. Only devices with a non-negative key are present. Where two
+ * devices have the same key, the first one in the uclass list is used.
+ *
+ * @entry: Hash table, unused entries have a key of -1
+ * @size: Number of entries in the table (a power of two), 0 if not built
+ * @count: Number of entries in use
+ */
+struct uclass_map {
+	struct uclass_map_entry {
+		int key;
+		struct udevice *dev;
+	} *entry;
+	int size;
+	int count;
+};
+
 /**
  * struct uclass - a U-Boot drive class, collecting together similar drivers
  *
@@ -30,12 +60,14 @@
  * @dev_head: List of devices in this uclass (devices are attached to their
  * uclass when their bind method is called)
  * @sibling_node: Next uclass in the linked list of uclasses
+ * @map: Lookup maps for the devices in this uclass, see enum uclass_map_id
  */
 struct uclass {
 	void *priv;
 	struct uclass_driver *uc_drv;
 	struct list_head dev_head;
 	struct list_head sibling_node;
+	struct uclass_map map[UCLASS_MAP_COUNT];
 };
 
 struct udevice;
@@ -39,6 +39,9 @@ void dm_dump_all(void);
 /* Dump out a list of uclasses and their devices */
 void dm_dump_uclass(void);
 
+/* Dump out the driver model lookup statistics (CONFIG_DM_STATS) */
+void dm_dump_stats(void);
+
 #ifdef CONFIG_DEBUG_DEVRES
 /* Dump out a list of device resources */
 void dm_dump_devres(void);
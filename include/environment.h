@@ -223,6 +223,40 @@ int env_import(const char *buf, int check);
 /* Export from hash table into binary representation */
 int env_export(env_t *env_out);
 
+/**
+ * struct env_storage - Storage for env_write_changed()
+ *
+ * @offset:	Offset of the environment in the storage
+ * @unit:	Size of the regions which are compared and written, in bytes
+ * @read:	Read @size bytes at @offset within the environment into @buf
+ * @write:	Erase if needed, then write @size bytes at @offset within the
+ *		environment from @buf. @offset is a multiple of @unit, as is
+ *		@size unless the region ends at the end of the environment.
+ * @priv:	Private data for @read and @write
+ */
+struct env_storage {
+	ulong offset;
+	ulong unit;
+	int (*read)(struct env_storage *stor, ulong offset, ulong size,
+		    void *buf);
+	int (*write)(struct env_storage *stor, ulong offset, ulong size,
+		     const void *buf);
+	void *priv;
+};
+
+/**
+ * env_write_changed() - Write the parts of the environment which differ
+ *
+ * This reads the environment currently held in the storage and writes
+ * each run of regions which differs from @env. It is only useful where each
+ * save goes to the same place, not with a redundant environment.
+ *
+ * @stor:	Storage to write to
+ * @env:	New environment image, from env_export()
+ * @return number of bytes written, 0 if nothing changed, or -ve on error
+ */
+int env_write_changed(struct env_storage *stor, const env_t *env);
+
 #endif /* DO_DEPS_ONLY */
 
 #endif /* _ENVIRONMENT_H_ */
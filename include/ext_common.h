@@ -141,7 +141,7 @@ struct ext2_inode {
 	} b;
 	uint32_t version;
 	uint32_t acl;
-	uint32_t dir_acl;
+	uint32_t size_high;	/* High 32 bits of the file size */
 	uint32_t fragment_addr;
 	uint32_t osd2[3];
 };
@@ -4,7 +4,22 @@
  * SPDX-License-Identifier:	GPL-2.0+
  */
 
+struct sparse_storage;
+
 void fb_mmc_flash_write(const char *cmd, unsigned int session_id,
 			void *download_buffer, unsigned int download_bytes,
 			char *response);
 void fb_mmc_erase(const char *cmd, char *response);
+
+/**
+ * fb_mmc_stream_open() - prepare to write a partition as data arrives
+ *
+ * @cmd:	partition name (or alias), which must stay valid while the
+ *		partition is written
+ * @storage:	returns where and how to write the partition
+ * @priv:	returns the private data for @storage->write()
+ * @response:	fastboot response, set to OKAY or FAIL
+ * @return 0 if OK, -ve on error
+ */
+int fb_mmc_stream_open(const char *cmd, struct sparse_storage *storage,
+		       void **priv, char *response);
@@ -64,6 +64,32 @@ int fs_size(const char *filename, loff_t *size);
 int fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	    loff_t *actread);
 
+/*
+ * fs_read_at - Read part of a file, leaving the partition open
+ *
+ * This is like fs_read(), except that the partition stays open afterwards.
+ * A file can then be read a piece at a time, without mounting the
+ * filesystem again for each piece and losing what it has cached. Call
+ * fs_close() when done.
+ *
+ * @filename: Name of file to read from
+ * @addr: The address to read into
+ * @offset: The offset in file to read from
+ * @len: The number of bytes to read. Maybe 0 to read entire file
+ * @actread: Returns the actual number of bytes read
+ * @return 0 if ok with valid *actread, -1 on error conditions
+ */
+int fs_read_at(const char *filename, ulong addr, loff_t offset, loff_t len,
+	       loff_t *actread);
+
+/*
+ * fs_close - Close the partition previously set by fs_set_blk_dev()
+ *
+ * This is only needed after fs_read_at(); the other functions close the
+ * partition themselves.
+ */
+void fs_close(void);
+
 /*
  * fs_write - Write file to the partition previously set by fs_set_blk_dev()
  * Note that not all filesystem types support offset!=0.
@@ -33,3 +33,71 @@ static inline int is_sparse_image(void *buf)
 
 int store_sparse_image(sparse_storage_t *storage, void *storage_priv,
 		       unsigned int session_id, void *data);
+
+/* Number of storage blocks buffered by a sparse stream */
+#define SPARSE_STREAM_BUF_BLKS	16
+
+/**
+ * struct sparse_stream - an image written to storage as it arrives
+ *
+ * The image may be sparse or raw; this is decided from its first bytes.
+ * Data arrives in pieces of any size, so headers and partial blocks which
+ * straddle two pieces are collected here until they are complete.
+ */
+struct sparse_stream {
+	sparse_storage_t *storage;
+	void *priv;
+	int state;
+	sparse_header_t header;
+	chunk_header_t chunk;
+	unsigned int hdr_len;		/* bytes of header/chunk header/fill */
+	unsigned int skip;		/* bytes left to skip */
+	u64 remain;			/* data bytes left in this chunk */
+	unsigned int chunks;		/* chunks seen */
+	unsigned int blk;		/* next storage block to write */
+	unsigned int written;		/* storage blocks written */
+	unsigned int skipped;		/* storage blocks skipped */
+	u32 fill;			/* fill value being collected */
+	char *buf;			/* SPARSE_STREAM_BUF_BLKS blocks */
+	unsigned int buf_len;		/* bytes of a partial block in @buf */
+};
+
+/**
+ * sparse_stream_start() - start writing an image to storage
+ *
+ * The image is written from @storage->start onwards. Don't-care chunks in
+ * a sparse image leave blocks untouched.
+ *
+ * @ss:		stream to set up
+ * @storage:	where to write the image
+ * @priv:	private data passed to @storage->write()
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+int sparse_stream_start(struct sparse_stream *ss, sparse_storage_t *storage,
+			void *priv);
+
+/**
+ * sparse_stream_write() - write the next piece of an image
+ *
+ * Whole blocks are written straight from @data; the rest is kept until the
+ * next piece arrives.
+ *
+ * @ss:		stream
+ * @data:	next bytes of the image
+ * @len:	number of bytes
+ * @return 0 if OK, -ve on error (the stream is then unusable)
+ */
+int sparse_stream_write(struct sparse_stream *ss, const void *data,
+			unsigned int len);
+
+/**
+ * sparse_stream_finish() - finish writing an image
+ *
+ * This writes a final partial block of a raw image, padded with zeroes,
+ * and checks that a sparse image was complete. The stream's buffer is
+ * freed, even on error.
+ *
+ * @ss:		stream
+ * @return 0 if OK, -ve on error
+ */
+int sparse_stream_finish(struct sparse_stream *ss);
@@ -258,6 +258,7 @@ struct lmb;
 #define IH_COMP_LZMA		3	/* lzma  Compression Used	*/
 #define IH_COMP_LZO		4	/* lzo   Compression Used	*/
 #define IH_COMP_LZ4		5	/* lz4   Compression Used	*/
+#define IH_COMP_ZSTD		6	/* zstd  Compression Used	*/
 
 #define IH_MAGIC	0x27051956	/* Image Magic Number		*/
 #define IH_NMLEN		32	/* Image Name Length		*/
@@ -933,6 +934,55 @@ int fit_check_ramdisk(const void *fit, int os_noffset,
 int calculate_hash(const void *data, int data_len, const char *algo,
 			uint8_t *value, int *value_len);
 
+/**
+ * struct fit_stream_src - A FIT which is read a piece at a time
+ *
+ * @read:	Read @size bytes starting at @offset within the FIT into @buf.
+ *		Returns the number of bytes read, or -ve error
+ * @addr:	Address of the FIT, if it is in memory
+ * @size:	Size of the FIT in memory, or 0 if it is not in memory. This
+ *		allows loading an image over its own data.
+ * @chunk_size:	Number of bytes to read at a time, or 0 for the default
+ * @priv:	Private data for @read
+ */
+struct fit_stream_src {
+	long (*read)(struct fit_stream_src *src, ulong offset, ulong size,
+		     void *buf);
+	ulong addr;
+	ulong size;
+	ulong chunk_size;
+	void *priv;
+};
+
+/* Use the load address given in the FIT */
+#define FIT_STREAM_LOAD_DEFAULT	(~0UL)
+
+/**
+ * fit_stream_load() - Load a FIT subimage without reading the FIT first
+ *
+ * This reads the FIT header, then reads the image data a chunk at a time,
+ * checking its hashes and decompressing it straight to the load address.
+ * Only the header and one chunk are held in memory. The image data must be
+ * uncompressed, gzip or zstd, and should be outside the FIT ('mkimage -E')
+ * to get the benefit of this. Signatures required by the control FDT are
+ * enforced: a configuration signature needs @uname to be NULL, and an image
+ * signature needs the image to be uncompressed.
+ *
+ * @src:	Where to read the FIT from
+ * @uname:	Name of the image to load, or NULL for the kernel of the
+ *		default configuration
+ * @loadp:	Address to load the image to, or FIT_STREAM_LOAD_DEFAULT.
+ *		Returns the address used.
+ * @max_size:	Maximum number of bytes to write
+ * @lenp:	Returns the number of bytes loaded
+ * @return 0 if OK, -ENOBUFS if the image is larger than @max_size, -EFAULT
+ * if loading would overwrite the image before it is read, -EBADMSG if a
+ * hash does not match, -EPERM or -EACCES if a required signature cannot be
+ * checked or does not verify, other -ve value on other error
+ */
+int fit_stream_load(struct fit_stream_src *src, const char *uname,
+		    ulong *loadp, ulong max_size, ulong *lenp);
+
 /*
  * At present we only support signing on the host, and verification on the
  * device
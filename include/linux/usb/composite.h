@@ -328,7 +328,7 @@ struct usb_composite_dev {
 	/* private: */
 	/* internals */
 	unsigned int			suspended:1;
-	struct usb_device_descriptor __aligned(CONFIG_SYS_CACHELINE_SIZE) desc;
+	struct usb_device_descriptor __aligned(ARCH_DMA_MINALIGN) desc;
 	struct list_head		configs;
 	struct usb_composite_driver	*driver;
 	u8				next_string_id;
@@ -876,9 +876,12 @@ extern Void_t*     sbrk();
 #define malloc malloc_simple
 #define realloc realloc_simple
 #define memalign memalign_simple
+#ifdef CONFIG_SYS_MALLOC_F_POOL
+#define free free_simple
+#else
 static inline void free(void *ptr) {}
+#endif
 void *calloc(size_t nmemb, size_t size);
-void *memalign_simple(size_t alignment, size_t bytes);
 void *realloc_simple(void *ptr, size_t size);
 #else
 
@@ -913,6 +916,17 @@ int initf_malloc(void);
 
 /* Simple versions which can be used when space is tight */
 void *malloc_simple(size_t size);
+void *memalign_simple(size_t alignment, size_t bytes);
+
+/* Only available with CONFIG_SYS_MALLOC_F_POOL, else free() is a no-op */
+void free_simple(void *ptr);
+
+/**
+ * malloc_simple_peak() - Get the most pre-relocation malloc() space used
+ *
+ * @return the high-water mark of the pre-relocation malloc() area, in bytes
+ */
+size_t malloc_simple_peak(void);
 
 #pragma GCC visibility push(hidden)
 # if __STD_C
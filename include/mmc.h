@@ -56,6 +56,7 @@
 #define MMC_MODE_8BIT		(1 << 3)
 #define MMC_MODE_SPI		(1 << 4)
 #define MMC_MODE_DDR_52MHz	(1 << 5)
+#define MMC_MODE_HS200		(1 << 6)
 
 #define SD_DATA_4BIT	0x00040000
 
@@ -86,6 +87,7 @@
 #define MMC_CMD_SET_BLOCKLEN		16
 #define MMC_CMD_READ_SINGLE_BLOCK	17
 #define MMC_CMD_READ_MULTIPLE_BLOCK	18
+#define MMC_CMD_SEND_TUNING_BLOCK_HS200	21
 #define MMC_CMD_SET_BLOCK_COUNT         23
 #define MMC_CMD_WRITE_SINGLE_BLOCK	24
 #define MMC_CMD_WRITE_MULTIPLE_BLOCK	25
@@ -206,6 +208,14 @@
 #define EXT_CSD_CARD_TYPE_DDR_1_2V	(1 << 3)
 #define EXT_CSD_CARD_TYPE_DDR_52	(EXT_CSD_CARD_TYPE_DDR_1_8V \
 					| EXT_CSD_CARD_TYPE_DDR_1_2V)
+#define EXT_CSD_CARD_TYPE_HS200_1_8V	(1 << 4)	/* 200MHz SDR at 1.8V */
+#define EXT_CSD_CARD_TYPE_HS200_1_2V	(1 << 5)	/* 200MHz SDR at 1.2V */
+#define EXT_CSD_CARD_TYPE_HS200	(EXT_CSD_CARD_TYPE_HS200_1_8V \
+					| EXT_CSD_CARD_TYPE_HS200_1_2V)
+
+#define EXT_CSD_TIMING_LEGACY	0	/* Backwards compatible timing */
+#define EXT_CSD_TIMING_HS	1	/* High-speed timing (HS52, DDR52) */
+#define EXT_CSD_TIMING_HS200	2	/* HS200 timing */
 
 #define EXT_CSD_BUS_WIDTH_1	0	/* Card is in 1 bit mode */
 #define EXT_CSD_BUS_WIDTH_4	1	/* Card is in 4 bit mode */
@@ -291,6 +301,20 @@ struct mmc_uclass_priv {
  */
 struct mmc *mmc_get_mmc_dev(struct udevice *dev);
 
+struct mmc;
+
+/**
+ * mmc_create_blk() - create the block device for an MMC device
+ *
+ * This should be called by the MMC driver once it has created its
+ * struct mmc, when CONFIG_BLK is enabled.
+ *
+ * @dev:	MMC device
+ * @mmc:	MMC struct for the device, from mmc_create()
+ * @return 0 if OK, -ve on error
+ */
+int mmc_create_blk(struct udevice *dev, struct mmc *mmc);
+
 /* End of driver model support */
 
 struct mmc_cid {
@@ -329,6 +353,12 @@ struct mmc_ops {
 	int (*init)(struct mmc *mmc);
 	int (*getcd)(struct mmc *mmc);
 	int (*getwp)(struct mmc *mmc);
+	/*
+	 * Find the sampling point for the current bus mode, sending the
+	 * tuning command given by @opcode as often as needed. Only called
+	 * for HS200; a host which does not need tuning can leave it NULL.
+	 */
+	int (*execute_tuning)(struct mmc *mmc, uint opcode);
 };
 
 struct mmc_config {
@@ -342,6 +372,18 @@ struct mmc_config {
 	unsigned char part_type;
 };
 
+/* Bus modes, from slowest to fastest within each card type */
+enum bus_mode {
+	MMC_LEGACY,
+	SD_LEGACY,
+	MMC_HS,
+	SD_HS,
+	MMC_HS_52,
+	MMC_DDR_52,
+	MMC_HS_200,
+	MMC_MODES_END
+};
+
 /* TODO struct mmc should be in mmc_private but it's hard to fix right now */
 struct mmc {
 	struct list_head link;
@@ -381,6 +423,8 @@ struct mmc {
 	char init_in_progress;	/* 1 if we have done mmc_start_init() */
 	char preinit;		/* start init as early as possible */
 	int ddr_mode;
+	enum bus_mode selected_mode;	/* mode chosen by mmc_startup() */
+	uint disabled_caps;	/* MMC_MODE_... flags not to be used */
 };
 
 struct mmc_hwpart_conf {
@@ -411,6 +455,43 @@ int mmc_initialize(bd_t *bis);
 int mmc_init(struct mmc *mmc);
 int mmc_read(struct mmc *mmc, u64 src, uchar *dst, int size);
 void mmc_set_clock(struct mmc *mmc, uint clock);
+
+/**
+ * mmc_mode_name() - get the name of a bus mode
+ *
+ * @mode:	Bus mode
+ * @return name of the mode, e.g. "HS200 (200MHz)"
+ */
+const char *mmc_mode_name(enum bus_mode mode);
+
+/**
+ * mmc_set_max_mode() - limit the bus mode used for an eMMC device
+ *
+ * This takes effect the next time the device is initialised. Modes faster
+ * than @mode are not used even if both the host and card support them.
+ *
+ * @mmc:	MMC device
+ * @mode:	Fastest mode to use, or MMC_MODES_END for no limit
+ */
+void mmc_set_max_mode(struct mmc *mmc, enum bus_mode mode);
+
+#define MMC_TUNING_BLK_PATTERN_4BIT_SIZE	64
+#define MMC_TUNING_BLK_PATTERN_8BIT_SIZE	128
+
+/* Data returned by the card for a tuning command, for 4- and 8-bit buses */
+extern const u8 tuning_blk_pattern_4bit[MMC_TUNING_BLK_PATTERN_4BIT_SIZE];
+extern const u8 tuning_blk_pattern_8bit[MMC_TUNING_BLK_PATTERN_8BIT_SIZE];
+
+/**
+ * mmc_send_tuning() - send a tuning command and check the block received
+ *
+ * This is intended for use by a host's execute_tuning() method.
+ *
+ * @mmc:	MMC device
+ * @opcode:	Tuning command to send
+ * @return 0 if the tuning block was received intact, -ve on error
+ */
+int mmc_send_tuning(struct mmc *mmc, uint opcode);
 struct mmc *find_mmc_device(int dev_num);
 int mmc_set_dev(int dev_num);
 void print_mmc_devices(char separator);
@@ -46,6 +46,56 @@ ssize_t os_read_no_block(int fd, void *buf, size_t count);
  */
 ssize_t os_write(int fd, const void *buf, size_t count);
 
+/**
+ * Read from a file at a given offset
+ *
+ * This uses the OS pread() system call, so the file offset is not changed.
+ * Short reads are retried until the whole buffer is filled or the end of
+ * the file is reached.
+ *
+ * \param fd	File descriptor as returned by os_open()
+ * \param buf	Buffer to place data
+ * \param count	Number of bytes to read
+ * \param offset	Offset in the file to read from
+ * \return number of bytes read, or -1 on error
+ */
+ssize_t os_pread(int fd, void *buf, size_t count, off_t offset);
+
+/**
+ * Write to a file at a given offset
+ *
+ * This uses the OS pwrite() system call, so the file offset is not changed.
+ * Short writes are retried until the whole buffer is written.
+ *
+ * \param fd	File descriptor as returned by os_open()
+ * \param buf	Buffer containing data to write
+ * \param count	Number of bytes to write
+ * \param offset	Offset in the file to write to
+ * \return number of bytes written, or -1 on error
+ */
+ssize_t os_pwrite(int fd, const void *buf, size_t count, off_t offset);
+
+/**
+ * Map a file into memory
+ *
+ * The mapping is shared, so writes to it end up in the file.
+ *
+ * \param fd	File descriptor as returned by os_open(), opened for
+ *		read/write
+ * \param size	Number of bytes to map, starting at the start of the file
+ * \return pointer to the mapping, or NULL on error
+ */
+void *os_map_file(int fd, size_t size);
+
+/**
+ * Remove a mapping created by os_map_file()
+ *
+ * \param ptr	Pointer returned by os_map_file()
+ * \param size	Size passed to os_map_file()
+ * \return 0 on success, -1 on error
+ */
+int os_unmap_file(void *ptr, size_t size);
+
 /**
  * Access to the OS lseek() system call
  *
@@ -75,6 +125,16 @@ int os_open(const char *pathname, int flags);
 #define OS_O_RDWR	2
 #define OS_O_MASK	3	/* Mask for read/write flags */
 #define OS_O_CREAT	0100
+#define OS_O_DIRECT	040000	/* Bypass the host page cache */
+
+/**
+ * Access to the OS mkstemp() call, to create a temporary file
+ *
+ * \param template	Path ending in "XXXXXX", which is replaced to give the
+ *			name of the file created
+ * \return file descriptor open for reading and writing, or -1 on error
+ */
+int os_mkstemp(char *template);
 
 /**
  * Access to the OS close() system call
@@ -7,14 +7,69 @@
 #ifndef __SANDBOX_BLOCK_DEV__
 #define __SANDBOX_BLOCK_DEV__
 
+/**
+ * enum host_block_mode - How a host device accesses its backing file
+ *
+ * @HOST_BLOCK_PREAD:	pread()/pwrite() through the host page cache
+ * @HOST_BLOCK_DIRECT:	pread()/pwrite() with O_DIRECT, bypassing the host
+ *			page cache. Unaligned buffers go through a bounce
+ *			buffer
+ * @HOST_BLOCK_MMAP:	the file is mapped into memory, so transfers are a
+ *			memcpy() with no system call
+ */
+enum host_block_mode {
+	HOST_BLOCK_PREAD,
+	HOST_BLOCK_DIRECT,
+	HOST_BLOCK_MMAP,
+};
+
+/**
+ * struct host_block_stats - Statistics for a host device
+ *
+ * @reads:		number of read requests
+ * @read_blocks:	number of blocks read
+ * @read_nsec:		time spent reading, in nanoseconds
+ * @writes:		number of write requests
+ * @write_blocks:	number of blocks written
+ * @write_nsec:		time spent writing, in nanoseconds
+ * @errors:		number of requests which failed
+ */
+struct host_block_stats {
+	ulong reads;
+	u64 read_blocks;
+	u64 read_nsec;
+	ulong writes;
+	u64 write_blocks;
+	u64 write_nsec;
+	ulong errors;
+};
+
 struct host_block_dev {
 #ifndef CONFIG_BLK
 	struct blk_desc blk_dev;
 #endif
 	char *filename;
 	int fd;
+	enum host_block_mode mode;
+	void *map;		/* mapping of the file, for HOST_BLOCK_MMAP */
+	size_t map_size;
+	void *bounce;		/* aligned buffer, for HOST_BLOCK_DIRECT */
+	struct host_block_stats stats;
 };
 
+/**
+ * host_dev_bind_mode() - Bind a host device to a file
+ *
+ * Any existing device with the same number is unbound first.
+ *
+ * @dev:	Host device number
+ * @filename:	Backing file, or NULL to just unbind the device
+ * @mode:	How to access the file
+ * @return 0 if OK, -ve on error
+ */
+int host_dev_bind_mode(int dev, char *filename, enum host_block_mode mode);
+
+/* Bind a host device to a file, using HOST_BLOCK_PREAD */
 int host_dev_bind(int dev, char *filename);
 
 #endif
@@ -53,6 +53,13 @@ struct hsearch_data {
 	struct _ENTRY *table;
 	unsigned int size;
 	unsigned int filled;
+/*
+ * Set whenever an entry is added, deleted or given a different value.
+ * It is never cleared here; a user which keeps a linearized copy of the
+ * table (see hexport_r()) clears it when that copy is brought up to date,
+ * and can then reuse the copy while it stays clear.
+ */
+	int dirty;
 /*
  * Callback function which will check whether the given change for variable
  * "item" to "newval" may be applied or not, and possibly apply such change.
@@ -28,6 +28,40 @@
 
 struct spi_slave;
 
+/* Number of different erase commands a flash can have */
+#define SPI_FLASH_ERASE_TYPES	4
+
+/**
+ * struct spi_flash_erase_type - An erase command supported by the flash
+ *
+ * @size:		Number of bytes erased, 0 if unused
+ * @cmd:		Erase cmd
+ */
+struct spi_flash_erase_type {
+	u32 size;
+	u8 cmd;
+};
+
+/**
+ * struct spi_flash_update_stats - What spi_flash_update() did
+ *
+ * @skipped:		Bytes which already held the right data
+ * @erased:		Bytes erased
+ * @programmed:		Bytes programmed
+ */
+struct spi_flash_update_stats {
+	u32 skipped;
+	u32 erased;
+	u32 programmed;
+};
+
+/*
+ * Flags for spi_flash_update(): program blocks which only need bits cleared
+ * without erasing them first. Parts with internal ECC do not allow a page
+ * to be programmed twice, so only use this if the flash is known to.
+ */
+#define SPI_FLASH_UPDATE_NO_ERASE	(1 << 0)
+
 /**
  * struct spi_flash - SPI flash structure
  *
@@ -45,9 +79,13 @@ struct spi_slave;
  * @bank_write_cmd:	Bank write cmd
  * @bank_curr:		Current flash bank
  * @erase_cmd:		Erase cmd 4K, 32K, 64K
+ * @erase_types:	Erase cmds which may be used, smallest first. The
+ *			first is erase_cmd, the others erase larger blocks
+ *			and are used for regions which are aligned to them.
  * @read_cmd:		Read cmd - Array Fast, Extn read and quad read.
  * @write_cmd:		Write cmd - page and quad program.
  * @dummy_byte:		Dummy cycles for read operation.
+ * @addr_width:		Number of address bytes sent with each command (3 or 4)
  * @memory_map:		Address of read-only SPI flash access
  * @flash_lock:		lock a region of the SPI Flash
  * @flash_unlock:	unlock a region of the SPI Flash
@@ -80,9 +118,11 @@ struct spi_flash {
 	u8 bank_curr;
 #endif
 	u8 erase_cmd;
+	struct spi_flash_erase_type erase_types[SPI_FLASH_ERASE_TYPES];
 	u8 read_cmd;
 	u8 write_cmd;
 	u8 dummy_byte;
+	u8 addr_width;
 
 	void *memory_map;
 
@@ -118,6 +158,26 @@ struct dm_spi_flash_ops {
 /* Access the serial operations for a device */
 #define sf_get_ops(dev) ((struct dm_spi_flash_ops *)(dev)->driver->ops)
 
+/**
+ * spi_flash_update() - Write data to SPI flash, skipping unchanged blocks
+ *
+ * Each erase block in the region is read first. Blocks which already hold
+ * the data are left alone and blocks which are erased are just programmed.
+ * The rest are erased, using the largest erase commands which fit, and then
+ * programmed. Data in those blocks outside the region is kept.
+ *
+ * @flash:	SPI flash
+ * @offset:	Offset into device in bytes to write to
+ * @len:	Number of bytes to write
+ * @buf:	Buffer containing bytes to write
+ * @flags:	SPI_FLASH_UPDATE_... flags
+ * @stats:	Returns what was done, or NULL if not wanted
+ * @return 0 if OK, -ve on error
+ */
+int spi_flash_update(struct spi_flash *flash, u32 offset, size_t len,
+		     const void *buf, uint flags,
+		     struct spi_flash_update_stats *stats);
+
 #ifdef CONFIG_DM_SPI_FLASH
 /**
  * spi_flash_read_dm() - Read data from SPI flash
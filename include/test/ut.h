@@ -39,6 +39,14 @@ void ut_failf(struct unit_test_state *uts, const char *fname, int line,
 	      const char *func, const char *cond, const char *fmt, ...)
 			__attribute__ ((format (__printf__, 6, 7)));
 
+/**
+ * ut_fill_random() - Fill a buffer with a repeatable pseudo-random pattern
+ *
+ * @buf: Buffer to fill
+ * @size: Number of bytes to fill
+ * @seed: Seed; the same seed always gives the same pattern
+ */
+void ut_fill_random(void *buf, int size, uint seed);
 
 /* Assert that a condition is non-zero */
 #define ut_assert(cond)							\
@@ -14,6 +14,39 @@ uint32_t crc32 (uint32_t, const unsigned char *, uint);
 uint32_t crc32_wd (uint32_t, const unsigned char *, uint, uint);
 uint32_t crc32_no_comp (uint32_t, const unsigned char *, uint);
 
+/**
+ * struct crc32_impl - An implementation of crc32_no_comp()
+ *
+ * crc32_no_comp() uses the first implementation that is available on the
+ * CPU it is running on.
+ *
+ * @name:	Short name of the implementation, e.g. "slice8"
+ * @calc:	Update a CRC32 with the contents of a buffer, without the
+ *		ones complement of crc32()
+ * @available:	Check whether the CPU supports this implementation, NULL if
+ *		it can always be used
+ */
+struct crc32_impl {
+	const char *name;
+	uint32_t (*calc)(uint32_t crc, const unsigned char *buf, uint len);
+	int (*available)(void);
+};
+
+/**
+ * crc32_get_impl() - Get a CRC32 implementation
+ *
+ * This is intended for tests and benchmarks which need to check each
+ * implementation built into U-Boot.
+ *
+ * @index:	Index of the implementation, in order of preference
+ * @return implementation, or NULL if @index is out of range
+ */
+const struct crc32_impl *crc32_get_impl(int index);
+
+/* arch/arm/cpu/armv8/crc32.c */
+uint32_t crc32_armv8(uint32_t crc, const unsigned char *buf, uint len);
+int crc32_armv8_available(void);
+
 /**
  * crc32_wd_buf - Perform CRC32 on a buffer and return result in buffer
  *
@@ -99,6 +99,41 @@ void sha1_hmac(const unsigned char *key, int keylen,
  */
 int sha1_self_test( void );
 
+/**
+ * struct sha1_impl - An implementation of the SHA-1 block function
+ *
+ * sha1_update() uses the first implementation that is available on the
+ * CPU it is running on.
+ *
+ * @name:	Short name of the implementation, e.g. "armv8-ce"
+ * @process:	Hash @blocks 64-byte blocks from @data into @state. Only the
+ *		bottom 32 bits of each state word are significant.
+ * @available:	Check whether the CPU supports this implementation, NULL if
+ *		it can always be used
+ */
+struct sha1_impl {
+	const char *name;
+	void (*process)(unsigned long state[5], const unsigned char *data,
+			unsigned int blocks);
+	int (*available)(void);
+};
+
+/**
+ * sha1_get_impl() - Get a SHA-1 implementation
+ *
+ * @index:	Index of the implementation, in order of preference
+ * @return implementation, or NULL if @index is out of range
+ */
+const struct sha1_impl *sha1_get_impl(int index);
+
+/* Accelerated block functions, see struct sha1_impl */
+void sha1_armv8_ce_process(unsigned long state[5], const unsigned char *data,
+			   unsigned int blocks);
+int sha1_armv8_ce_available(void);
+void sha1_ni_process(unsigned long state[5], const unsigned char *data,
+		     unsigned int blocks);
+int sha_ni_available(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -19,4 +19,38 @@ void sha256_finish(sha256_context * ctx, uint8_t digest[SHA256_SUM_LEN]);
 void sha256_csum_wd(const unsigned char *input, unsigned int ilen,
 		unsigned char *output, unsigned int chunk_sz);
 
+/**
+ * struct sha256_impl - An implementation of the SHA-256 block function
+ *
+ * sha256_update() uses the first implementation that is available on the
+ * CPU it is running on.
+ *
+ * @name:	Short name of the implementation, e.g. "armv8-ce"
+ * @process:	Hash @blocks 64-byte blocks from @data into @state
+ * @available:	Check whether the CPU supports this implementation, NULL if
+ *		it can always be used
+ */
+struct sha256_impl {
+	const char *name;
+	void (*process)(uint32_t state[8], const uint8_t *data,
+			unsigned int blocks);
+	int (*available)(void);
+};
+
+/**
+ * sha256_get_impl() - Get a SHA-256 implementation
+ *
+ * @index:	Index of the implementation, in order of preference
+ * @return implementation, or NULL if @index is out of range
+ */
+const struct sha256_impl *sha256_get_impl(int index);
+
+/* Accelerated block functions, see struct sha256_impl */
+void sha256_armv8_ce_process(uint32_t state[8], const uint8_t *data,
+			     unsigned int blocks);
+int sha256_armv8_ce_available(void);
+void sha256_ni_process(uint32_t state[8], const uint8_t *data,
+		       unsigned int blocks);
+int sha_ni_available(void);
+
 #endif /* _SHA256_H */
@@ -0,0 +1,110 @@
+/*
+ * Zstandard decompression
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#ifndef _U_BOOT_ZSTD_H
+#define _U_BOOT_ZSTD_H
+
+#include <linux/types.h>
+
+/* Largest window accepted by the streaming decoder unless told otherwise */
+#define ZSTD_WINDOW_DEFAULT_MAX	(8 << 20)
+
+/**
+ * zstd_decompress() - Decompress a buffer holding one or more zstd frames
+ *
+ * Skippable frames are ignored. Dictionaries are not supported. If a frame
+ * carries a content checksum it is verified.
+ *
+ * @src:	Compressed data
+ * @srcn:	Size of compressed data in bytes
+ * @dst:	Output buffer
+ * @dstn:	On entry, size of the output buffer. On exit, number of bytes
+ *		written to it (also on error)
+ * @return 0 if OK, -ENOBUFS if the output buffer is too small,
+ * -EPROTONOSUPPORT if the data is not zstd or needs a dictionary, -ENOMEM
+ * if out of memory, or -EINVAL if the data is corrupt
+ */
+int zstd_decompress(const void *src, size_t srcn, void *dst, size_t *dstn);
+
+/**
+ * zstd_get_content_size() - Get the decompressed size of a zstd frame
+ *
+ * @src:	Start of the frame
+ * @srcn:	Number of bytes available at @src
+ * @sizep:	Returns the content size recorded in the frame header
+ * @return 0 if OK, -ENOENT if the frame does not record its size,
+ * -EPROTONOSUPPORT if this is not a zstd frame, -EINVAL if the header is
+ * truncated or invalid
+ */
+int zstd_get_content_size(const void *src, size_t srcn, u64 *sizep);
+
+/**
+ * struct zstd_in - Input buffer for streaming decompression
+ *
+ * @src:	Compressed data
+ * @size:	Number of bytes at @src
+ * @pos:	Number of bytes consumed so far, updated by the decoder
+ */
+struct zstd_in {
+	const void *src;
+	size_t size;
+	size_t pos;
+};
+
+/**
+ * struct zstd_out - Output buffer for streaming decompression
+ *
+ * @dst:	Space for decompressed data
+ * @size:	Number of bytes of space at @dst
+ * @pos:	Number of bytes written so far, updated by the decoder
+ */
+struct zstd_out {
+	void *dst;
+	size_t size;
+	size_t pos;
+};
+
+struct zstd_stream;
+
+/**
+ * zstd_stream_create() - Create a streaming decoder
+ *
+ * The decoder keeps the frame's window of history plus one block of input
+ * and one block of output, so its memory use is bounded by @max_window
+ * plus about 400KB regardless of how much data is decompressed.
+ *
+ * @max_window:	Largest window size to accept, 0 for ZSTD_WINDOW_DEFAULT_MAX.
+ *		Frames needing more are rejected with -EFBIG.
+ * @return new decoder, or NULL if out of memory
+ */
+struct zstd_stream *zstd_stream_create(size_t max_window);
+
+/**
+ * zstd_stream_decompress() - Decompress as much as possible
+ *
+ * Consumes input from @in and writes output to @out, advancing their 'pos'
+ * members, until either the input is exhausted, the output is full or a
+ * frame ends. Call it again with more input or output space as needed. A
+ * following frame is started automatically on the next call.
+ *
+ * @zs:		Decoder
+ * @in:		Input buffer
+ * @out:	Output buffer
+ * @return 1 if a frame has been completely decompressed and output,
+ * 0 if more input or output space is needed, or -ve error (see
+ * zstd_decompress(); -EFBIG if the frame's window is too large)
+ */
+int zstd_stream_decompress(struct zstd_stream *zs, struct zstd_in *in,
+			   struct zstd_out *out);
+
+/**
+ * zstd_stream_free() - Free a streaming decoder
+ *
+ * @zs:		Decoder to free (may be NULL)
+ */
+void zstd_stream_free(struct zstd_stream *zs);
+
+#endif
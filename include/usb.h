@@ -180,6 +180,19 @@ int usb_reset_root_port(struct usb_device *dev);
 #define usb_reset_root_port(dev)
 #endif
 
+/**
+ * usb_get_max_xfer_size() - Get the largest supported bulk transfer
+ *
+ * This is the largest buffer the host controller can transfer in a single
+ * bulk request to @dev, which class drivers such as USB storage use to size
+ * their transfers.
+ *
+ * @dev:	USB device to check
+ * @size:	Returns the maximum transfer size in bytes
+ * @return 0 if OK, -ENOSYS if the controller does not report a limit
+ */
+int usb_get_max_xfer_size(struct usb_device *dev, size_t *size);
+
 int submit_bulk_msg(struct usb_device *dev, unsigned long pipe,
 			void *buffer, int transfer_len);
 int submit_control_msg(struct usb_device *dev, unsigned long pipe, void *buffer,
@@ -731,6 +744,14 @@ struct dm_usb_ops {
 	 * reset_root_port() - Reset usb root port
 	 */
 	int (*reset_root_port)(struct udevice *bus, struct usb_device *udev);
+
+	/**
+	 * get_max_xfer_size() - Get the largest bulk transfer supported
+	 *
+	 * @size:	Returns the maximum transfer size in bytes
+	 * @return 0 if OK, -ve on error
+	 */
+	int (*get_max_xfer_size)(struct udevice *bus, size_t *size);
 };
 
 #define usb_get_ops(dev)	((struct dm_usb_ops *)(dev)->driver->ops)
@@ -26,6 +26,16 @@
 
 #define tole(x) cpu_to_le32(x)
 
+#ifdef USE_HOSTCC
+#define CRC32_SLICE_BY_8
+#elif CONFIG_IS_ENABLED(CRC32_SLICE_BY_8)
+#define CRC32_SLICE_BY_8
+#endif
+
+#ifdef CRC32_SLICE_BY_8
+#include "crc32table.h"
+#endif
+
 #ifdef DYNAMIC_CRC_TABLE
 
 local int crc_table_empty = 1;
@@ -173,10 +183,8 @@ const uint32_t * ZEXPORT get_crc_table()
 
 /* ========================================================================= */
 
-/* No ones complement version. JFFS2 (and other things ?)
- * don't use ones compliment in their CRC calculations.
- */
-uint32_t ZEXPORT crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
+/* Byte-at-a-time version, using a single 256-entry table */
+local uint32_t crc32_byte(uint32_t crc, const Bytef *buf, uInt len)
 {
     const uint32_t *tab = crc_table;
     const uint32_t *b =(const uint32_t *)buf;
@@ -218,6 +226,68 @@ uint32_t ZEXPORT crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
 }
 #undef DO_CRC
 
+#ifdef CRC32_SLICE_BY_8
+/*
+ * Slice-by-8 version: the CRC is folded into the first four bytes of each
+ * eight-byte block and all eight bytes are then looked up independently,
+ * which avoids the serial dependency of the byte-wise loop.
+ */
+local uint32_t crc32_slice8(uint32_t crc, const Bytef *buf, uInt len)
+{
+	const uint32_t (*t)[256] = crc32_table8;
+	uint32_t one, two;
+
+	while (len && ((uintptr_t)buf & 3)) {
+		crc = t[0][(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+		len--;
+	}
+	for (; len >= 8; len -= 8, buf += 8) {
+		one = le32_to_cpu(*(const uint32_t *)buf) ^ crc;
+		two = le32_to_cpu(*(const uint32_t *)(buf + 4));
+		crc = t[7][one & 0xff] ^ t[6][(one >> 8) & 0xff] ^
+			t[5][(one >> 16) & 0xff] ^ t[4][one >> 24] ^
+			t[3][two & 0xff] ^ t[2][(two >> 8) & 0xff] ^
+			t[1][(two >> 16) & 0xff] ^ t[0][two >> 24];
+	}
+	while (len--)
+		crc = t[0][(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+
+	return crc;
+}
+#endif
+
+/* Implementations in order of preference; the last is always available */
+local const struct crc32_impl crc32_impls[] = {
+#if !defined(USE_HOSTCC) && defined(CONFIG_CRC32_ARMV8)
+	{ "armv8", crc32_armv8, crc32_armv8_available },
+#endif
+#ifdef CRC32_SLICE_BY_8
+	{ "slice8", crc32_slice8, NULL },
+#endif
+	{ "byte", crc32_byte, NULL },
+};
+
+const struct crc32_impl *crc32_get_impl(int index)
+{
+	if (index < 0 || index >= sizeof(crc32_impls) / sizeof(crc32_impls[0]))
+		return NULL;
+
+	return &crc32_impls[index];
+}
+
+/* No ones complement version. JFFS2 (and other things ?)
+ * don't use ones compliment in their CRC calculations.
+ */
+uint32_t ZEXPORT crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
+{
+	const struct crc32_impl *impl = crc32_impls;
+
+	while (impl->available && !impl->available())
+		impl++;
+
+	return impl->calc(crc, buf, len);
+}
+
 uint32_t ZEXPORT crc32 (uint32_t crc, const Bytef *p, uInt len)
 {
      return crc32_no_comp(crc ^ 0xffffffffL, p, len) ^ 0xffffffffL;
@@ -159,6 +159,7 @@ void hdestroy_r(struct hsearch_data *htab)
 
 	/* the sign for an existing table is an value != NULL in htable */
 	htab->table = NULL;
+	htab->dirty = 1;
 }
 
 /*
@@ -252,12 +253,16 @@ static inline int _compare_and_overwrite_entry(ENTRY item, ACTION action,
 				return 0;
 			}
 
-			free(htab->table[idx].entry.data);
-			htab->table[idx].entry.data = strdup(item.data);
-			if (!htab->table[idx].entry.data) {
-				__set_errno(ENOMEM);
-				*retval = NULL;
-				return 0;
+			/* Setting the same value again changes nothing */
+			if (strcmp(htab->table[idx].entry.data, item.data)) {
+				free(htab->table[idx].entry.data);
+				htab->table[idx].entry.data = strdup(item.data);
+				if (!htab->table[idx].entry.data) {
+					__set_errno(ENOMEM);
+					*retval = NULL;
+					return 0;
+				}
+				htab->dirty = 1;
 			}
 		}
 		/* return found entry */
@@ -375,6 +380,7 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 		}
 
 		++htab->filled;
+		htab->dirty = 1;
 
 		/* This is a new entry, so look up a possible callback */
 		env_callback_init(&htab->table[idx].entry);
@@ -437,6 +443,7 @@ static void _hdelete(const char *key, struct hsearch_data *htab, ENTRY *ep,
 	htab->table[idx].used = -1;
 
 	--htab->filled;
+	htab->dirty = 1;
 }
 
 int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
@@ -61,7 +61,8 @@ void sha1_starts (sha1_context * ctx)
 	ctx->state[4] = 0xC3D2E1F0;
 }
 
-static void sha1_process(sha1_context *ctx, const unsigned char data[64])
+static void sha1_process(unsigned long state[5],
+			 const unsigned char data[64])
 {
 	unsigned long temp, W[16], A, B, C, D, E;
 
@@ -94,11 +95,11 @@ static void sha1_process(sha1_context *ctx, const unsigned char data[64])
 	e += S(a,5) + F(b,c,d) + K + x; b = S(b,30);	\
 }
 
-	A = ctx->state[0];
-	B = ctx->state[1];
-	C = ctx->state[2];
-	D = ctx->state[3];
-	E = ctx->state[4];
+	A = state[0];
+	B = state[1];
+	C = state[2];
+	D = state[3];
+	E = state[4];
 
 #define F(x,y,z) (z ^ (x & (y ^ z)))
 #define K 0x5A827999
@@ -208,11 +209,49 @@ static void sha1_process(sha1_context *ctx, const unsigned char data[64])
 #undef K
 #undef F
 
-	ctx->state[0] += A;
-	ctx->state[1] += B;
-	ctx->state[2] += C;
-	ctx->state[3] += D;
-	ctx->state[4] += E;
+	state[0] += A;
+	state[1] += B;
+	state[2] += C;
+	state[3] += D;
+	state[4] += E;
+}
+
+static void sha1_generic_process(unsigned long state[5],
+				 const unsigned char *data, unsigned int blocks)
+{
+	for (; blocks; blocks--, data += 64)
+		sha1_process(state, data);
+}
+
+/* Implementations in order of preference; the last is always available */
+static const struct sha1_impl sha1_impls[] = {
+#ifndef USE_HOSTCC
+#ifdef CONFIG_SHA1_ARMV8_CE
+	{ "armv8-ce", sha1_armv8_ce_process, sha1_armv8_ce_available },
+#endif
+#ifdef CONFIG_SANDBOX_SHA_NI
+	{ "sha-ni", sha1_ni_process, sha_ni_available },
+#endif
+#endif
+	{ "generic", sha1_generic_process, NULL },
+};
+
+const struct sha1_impl *sha1_get_impl(int index)
+{
+	if (index < 0 || index >= sizeof(sha1_impls) / sizeof(sha1_impls[0]))
+		return NULL;
+
+	return &sha1_impls[index];
+}
+
+static void sha1_blocks(sha1_context *ctx, const unsigned char *data,
+			unsigned int blocks)
+{
+	const struct sha1_impl *impl = sha1_impls;
+
+	while (impl->available && !impl->available())
+		impl++;
+	impl->process(ctx->state, data, blocks);
 }
 
 /*
@@ -238,16 +277,16 @@ void sha1_update(sha1_context *ctx, const unsigned char *input,
 
 	if (left && ilen >= fill) {
 		memcpy ((void *) (ctx->buffer + left), (void *) input, fill);
-		sha1_process (ctx, ctx->buffer);
+		sha1_blocks(ctx, ctx->buffer, 1);
 		input += fill;
 		ilen -= fill;
 		left = 0;
 	}
 
-	while (ilen >= 64) {
-		sha1_process (ctx, input);
-		input += 64;
-		ilen -= 64;
+	if (ilen >= 64) {
+		sha1_blocks(ctx, input, ilen / 64);
+		input += ilen & ~0x3f;
+		ilen &= 0x3f;
 	}
 
 	if (ilen > 0) {
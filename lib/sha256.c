@@ -50,7 +50,7 @@ void sha256_starts(sha256_context * ctx)
 	ctx->state[7] = 0x5BE0CD19;
 }
 
-static void sha256_process(sha256_context *ctx, const uint8_t data[64])
+static void sha256_process(uint32_t state[8], const uint8_t data[64])
 {
 	uint32_t temp1, temp2;
 	uint32_t W[64];
@@ -97,14 +97,14 @@ static void sha256_process(sha256_context *ctx, const uint8_t data[64])
 	d += temp1; h = temp1 + temp2;		\
 }
 
-	A = ctx->state[0];
-	B = ctx->state[1];
-	C = ctx->state[2];
-	D = ctx->state[3];
-	E = ctx->state[4];
-	F = ctx->state[5];
-	G = ctx->state[6];
-	H = ctx->state[7];
+	A = state[0];
+	B = state[1];
+	C = state[2];
+	D = state[3];
+	E = state[4];
+	F = state[5];
+	G = state[6];
+	H = state[7];
 
 	P(A, B, C, D, E, F, G, H, W[0], 0x428A2F98);
 	P(H, A, B, C, D, E, F, G, W[1], 0x71374491);
@@ -171,14 +171,53 @@ static void sha256_process(sha256_context *ctx, const uint8_t data[64])
 	P(C, D, E, F, G, H, A, B, R(62), 0xBEF9A3F7);
 	P(B, C, D, E, F, G, H, A, R(63), 0xC67178F2);
 
-	ctx->state[0] += A;
-	ctx->state[1] += B;
-	ctx->state[2] += C;
-	ctx->state[3] += D;
-	ctx->state[4] += E;
-	ctx->state[5] += F;
-	ctx->state[6] += G;
-	ctx->state[7] += H;
+	state[0] += A;
+	state[1] += B;
+	state[2] += C;
+	state[3] += D;
+	state[4] += E;
+	state[5] += F;
+	state[6] += G;
+	state[7] += H;
+}
+
+static void sha256_generic_process(uint32_t state[8], const uint8_t *data,
+				   unsigned int blocks)
+{
+	for (; blocks; blocks--, data += 64)
+		sha256_process(state, data);
+}
+
+/* Implementations in order of preference; the last is always available */
+static const struct sha256_impl sha256_impls[] = {
+#ifndef USE_HOSTCC
+#ifdef CONFIG_SHA256_ARMV8_CE
+	{ "armv8-ce", sha256_armv8_ce_process, sha256_armv8_ce_available },
+#endif
+#ifdef CONFIG_SANDBOX_SHA_NI
+	{ "sha-ni", sha256_ni_process, sha_ni_available },
+#endif
+#endif
+	{ "generic", sha256_generic_process, NULL },
+};
+
+const struct sha256_impl *sha256_get_impl(int index)
+{
+	if (index < 0 ||
+	    index >= sizeof(sha256_impls) / sizeof(sha256_impls[0]))
+		return NULL;
+
+	return &sha256_impls[index];
+}
+
+static void sha256_blocks(sha256_context *ctx, const uint8_t *data,
+			  unsigned int blocks)
+{
+	const struct sha256_impl *impl = sha256_impls;
+
+	while (impl->available && !impl->available())
+		impl++;
+	impl->process(ctx->state, data, blocks);
 }
 
 void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length)
@@ -199,16 +238,16 @@ void sha256_update(sha256_context *ctx, const uint8_t *input, uint32_t length)
 
 	if (left && length >= fill) {
 		memcpy((void *) (ctx->buffer + left), (void *) input, fill);
-		sha256_process(ctx, ctx->buffer);
+		sha256_blocks(ctx, ctx->buffer, 1);
 		length -= fill;
 		input += fill;
 		left = 0;
 	}
 
-	while (length >= 64) {
-		sha256_process(ctx, input);
-		length -= 64;
-		input += 64;
+	if (length >= 64) {
+		sha256_blocks(ctx, input, length / 64);
+		input += length & ~0x3f;
+		length &= 0x3f;
 	}
 
 	if (length)
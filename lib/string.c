@@ -19,7 +19,27 @@
 #include <linux/string.h>
 #include <linux/ctype.h>
 #include <malloc.h>
+#include <asm/byteorder.h>
 
+/*
+ * Word type for the word-at-a-time memory functions. It may alias any
+ * other type, since these functions copy objects of every type.
+ */
+typedef unsigned long __attribute__((__may_alias__)) str_word_t;
+#define WSIZE	sizeof(unsigned long)
+#define WMASK	(WSIZE - 1)
+
+/*
+ * Combine the end of aligned word w0 with the start of the next aligned
+ * word w1, for a source that is 'shift' bits past a word boundary
+ */
+#ifdef __BIG_ENDIAN
+#define MERGE_WORDS(w0, w1, shift) \
+	(((w0) << (shift)) | ((w1) >> (WSIZE * 8 - (shift))))
+#else
+#define MERGE_WORDS(w0, w1, shift) \
+	(((w0) >> (shift)) | ((w1) << (WSIZE * 8 - (shift))))
+#endif
 
 /**
  * strncasecmp - Case insensitive, length-limited string comparison
@@ -436,24 +456,35 @@ char *strswab(const char *s)
  */
 void * memset(void * s,int c,size_t count)
 {
-	unsigned long *sl = (unsigned long *) s;
-	unsigned long cl = 0;
-	char *s8;
-	int i;
-
-	/* do it one word at a time (32 bits or 64 bits) while possible */
-	if ( ((ulong)s & (sizeof(*sl) - 1)) == 0) {
-		for (i = 0; i < sizeof(*sl); i++) {
-			cl <<= 8;
-			cl |= c & 0xff;
+	unsigned char *s8 = s;
+	str_word_t *sl;
+	unsigned long cl;
+
+	if (count >= 2 * WSIZE) {
+		/* fill bytes up to a word boundary */
+		while ((ulong)s8 & WMASK) {
+			*s8++ = c;
+			count--;
 		}
-		while (count >= sizeof(*sl)) {
-			*sl++ = cl;
-			count -= sizeof(*sl);
+
+		/* then a cache line at a time, then a word at a time */
+		cl = (unsigned char)c * (~0UL / 0xff);
+		sl = (str_word_t *)s8;
+		for (; count >= 8 * WSIZE; count -= 8 * WSIZE, sl += 8) {
+			sl[0] = cl;
+			sl[1] = cl;
+			sl[2] = cl;
+			sl[3] = cl;
+			sl[4] = cl;
+			sl[5] = cl;
+			sl[6] = cl;
+			sl[7] = cl;
 		}
+		for (; count >= WSIZE; count -= WSIZE)
+			*sl++ = cl;
+		s8 = (unsigned char *)sl;
 	}
 	/* fill 8 bits at a time */
-	s8 = (char *)sl;
 	while (count--)
 		*s8++ = c;
 
@@ -485,6 +516,78 @@ char * bcopy(const char * src, char * dest, int count)
 }
 #endif
 
+#if !defined(__HAVE_ARCH_MEMCPY) || !defined(__HAVE_ARCH_MEMMOVE)
+/*
+ * Copy forwards, a word at a time where possible. Each source word is read
+ * before the destination word at the same position is written, so this is
+ * also safe for overlapping areas where dest < src.
+ */
+static void copy_forward(unsigned char *d8, const unsigned char *s8,
+			 size_t count)
+{
+	const str_word_t *sl;
+	str_word_t *dl;
+	unsigned long w0, w1;
+	uint shift;
+
+	if (count >= 2 * WSIZE) {
+		/* copy bytes until the destination is word-aligned */
+		while ((ulong)d8 & WMASK) {
+			*d8++ = *s8++;
+			count--;
+		}
+		dl = (str_word_t *)d8;
+		shift = ((ulong)s8 & WMASK) * 8;
+		if (!shift) {
+			/* both aligned (common case): a cache line at a time */
+			sl = (const str_word_t *)s8;
+			for (; count >= 8 * WSIZE; count -= 8 * WSIZE) {
+				w0 = sl[0];
+				w1 = sl[1];
+				dl[0] = w0;
+				dl[1] = w1;
+				w0 = sl[2];
+				w1 = sl[3];
+				dl[2] = w0;
+				dl[3] = w1;
+				w0 = sl[4];
+				w1 = sl[5];
+				dl[4] = w0;
+				dl[5] = w1;
+				w0 = sl[6];
+				w1 = sl[7];
+				dl[6] = w0;
+				dl[7] = w1;
+				sl += 8;
+				dl += 8;
+			}
+			for (; count >= WSIZE; count -= WSIZE)
+				*dl++ = *sl++;
+			s8 = (const unsigned char *)sl;
+		} else {
+			/*
+			 * Read aligned source words and merge each adjacent
+			 * pair into one destination word. The last word read
+			 * never extends past the word holding the last source
+			 * byte, so this cannot fault.
+			 */
+			sl = (const str_word_t *)((ulong)s8 & ~WMASK);
+			w0 = *sl++;
+			for (; count >= WSIZE; count -= WSIZE) {
+				w1 = *sl++;
+				*dl++ = MERGE_WORDS(w0, w1, shift);
+				w0 = w1;
+			}
+			s8 = (const unsigned char *)sl - WSIZE + shift / 8;
+		}
+		d8 = (unsigned char *)dl;
+	}
+	/* copy the rest one byte at a time */
+	while (count--)
+		*d8++ = *s8++;
+}
+#endif
+
 #ifndef __HAVE_ARCH_MEMCPY
 /**
  * memcpy - Copy one area of memory to another
@@ -497,24 +600,8 @@ char * bcopy(const char * src, char * dest, int count)
  */
 void * memcpy(void *dest, const void *src, size_t count)
 {
-	unsigned long *dl = (unsigned long *)dest, *sl = (unsigned long *)src;
-	char *d8, *s8;
-
-	if (src == dest)
-		return dest;
-
-	/* while all data is aligned (common case), copy a word at a time */
-	if ( (((ulong)dest | (ulong)src) & (sizeof(*dl) - 1)) == 0) {
-		while (count >= sizeof(*dl)) {
-			*dl++ = *sl++;
-			count -= sizeof(*dl);
-		}
-	}
-	/* copy the reset one byte at a time */
-	d8 = (char *)dl;
-	s8 = (char *)sl;
-	while (count--)
-		*d8++ = *s8++;
+	if (src != dest)
+		copy_forward(dest, src, count);
 
 	return dest;
 }
@@ -531,23 +618,33 @@ void * memcpy(void *dest, const void *src, size_t count)
  */
 void * memmove(void * dest,const void *src,size_t count)
 {
-	char *tmp, *s;
+	unsigned char *tmp;
+	const unsigned char *s;
 
 	if (src == dest)
 		return dest;
 
-	if (dest <= src) {
-		tmp = (char *) dest;
-		s = (char *) src;
-		while (count--)
-			*tmp++ = *s++;
-		}
-	else {
-		tmp = (char *) dest + count;
-		s = (char *) src + count;
-		while (count--)
+	if (dest <= src || (const char *)src + count <= (char *)dest) {
+		copy_forward(dest, src, count);
+		return dest;
+	}
+
+	/* overlapping with dest above src: copy backwards */
+	tmp = (unsigned char *)dest + count;
+	s = (const unsigned char *)src + count;
+	if (!(((ulong)tmp ^ (ulong)s) & WMASK) && count >= 2 * WSIZE) {
+		while ((ulong)tmp & WMASK) {
 			*--tmp = *--s;
+			count--;
+		}
+		for (; count >= WSIZE; count -= WSIZE) {
+			tmp -= WSIZE;
+			s -= WSIZE;
+			*(str_word_t *)tmp = *(const str_word_t *)s;
 		}
+	}
+	while (count--)
+		*--tmp = *--s;
 
 	return dest;
 }
@@ -562,10 +659,26 @@ void * memmove(void * dest,const void *src,size_t count)
  */
 int memcmp(const void * cs,const void * ct,size_t count)
 {
-	const unsigned char *su1, *su2;
+	const unsigned char *su1 = cs, *su2 = ct;
 	int res = 0;
 
-	for( su1 = cs, su2 = ct; 0 < count; ++su1, ++su2, count--)
+	/*
+	 * When both areas have the same alignment, skip equal words. The
+	 * first differing word is then compared byte by byte below.
+	 */
+	if (!(((ulong)su1 ^ (ulong)su2) & WMASK) && count >= 2 * WSIZE) {
+		for (; (ulong)su1 & WMASK; ++su1, ++su2, count--)
+			if ((res = *su1 - *su2) != 0)
+				return res;
+		while (count >= WSIZE &&
+		       *(const str_word_t *)su1 == *(const str_word_t *)su2) {
+			su1 += WSIZE;
+			su2 += WSIZE;
+			count -= WSIZE;
+		}
+	}
+
+	for (; 0 < count; ++su1, ++su2, count--)
 		if ((res = *su1 - *su2) != 0)
 			break;
 	return res;
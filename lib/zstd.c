@@ -0,0 +1,1573 @@
+/*
+ * Zstandard decompression, as described in RFC 8878
+ *
+ * This is a compact decoder for U-Boot's needs: buffer-to-buffer
+ * decompression of boot images plus a streaming mode whose memory use is
+ * bounded by the frame's window size. Dictionaries are not supported.
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <errno.h>
+#include <malloc.h>
+#include <asm/unaligned.h>
+#include <linux/bitops.h>
+#include <u-boot/zstd.h>
+
+#define ZSTD_MAGIC		0xfd2fb528
+#define ZSTD_SKIP_MAGIC		0x184d2a50	/* low 4 bits may vary */
+#define ZSTD_SKIP_MASK		0xfffffff0
+#define ZSTD_BLOCK_MAX		(128 << 10)
+#define ZSTD_HEADER_MAX		18		/* magic + largest header */
+#define ZSTD_SIZE_UNKNOWN	(~0ULL)
+
+/* Extra space needed by the fast sequence path, see wild_copy() */
+#define WILD_SLACK		8
+
+enum {
+	BLOCK_RAW,
+	BLOCK_RLE,
+	BLOCK_COMPRESSED,
+	BLOCK_RESERVED,
+};
+
+enum {
+	LIT_RAW,
+	LIT_RLE,
+	LIT_COMPRESSED,
+	LIT_TREELESS,
+};
+
+enum {
+	SEQ_PREDEFINED,
+	SEQ_RLE,
+	SEQ_COMPRESSED,
+	SEQ_REPEAT,
+};
+
+#define HUF_MAX_BITS		11
+#define HUF_MAX_SYMBOLS		256
+#define HUF_WEIGHT_LOG_MAX	6
+
+#define LL_MAX_LOG		9
+#define ML_MAX_LOG		9
+#define OF_MAX_LOG		8
+#define LL_MAX_SYMBOL		35
+#define ML_MAX_SYMBOL		52
+#define OF_MAX_SYMBOL		31
+#define FSE_MAX_SYMBOLS		(ML_MAX_SYMBOL + 1)
+
+/* Value and number of extra bits for each literal-length code */
+static const u32 ll_base[LL_MAX_SYMBOL + 1] = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+	16, 18, 20, 22, 24, 28, 32, 40, 48, 64, 128, 256, 512, 1024, 2048,
+	4096, 8192, 16384, 32768, 65536,
+};
+
+static const u8 ll_bits[LL_MAX_SYMBOL + 1] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	1, 1, 1, 1, 2, 2, 3, 3, 4, 6, 7, 8, 9, 10, 11,
+	12, 13, 14, 15, 16,
+};
+
+/* Value and number of extra bits for each match-length code */
+static const u32 ml_base[ML_MAX_SYMBOL + 1] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18,
+	19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34,
+	35, 37, 39, 41, 43, 47, 51, 59, 67, 83, 99, 131, 259, 515, 1027,
+	2051, 4099, 8195, 16387, 32771, 65539,
+};
+
+static const u8 ml_bits[ML_MAX_SYMBOL + 1] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	1, 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 7, 8, 9, 10,
+	11, 12, 13, 14, 15, 16,
+};
+
+/* Predefined distributions, used when a block does not supply its own */
+static const s16 ll_default[LL_MAX_SYMBOL + 1] = {
+	4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 1, 1, 1, 1, 1,
+	-1, -1, -1, -1,
+};
+
+static const s16 ml_default[ML_MAX_SYMBOL + 1] = {
+	1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1,
+	-1, -1, -1, -1, -1,
+};
+
+static const s16 of_default[] = {
+	1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1,
+};
+
+/* A state in an FSE decoding table */
+struct fse_entry {
+	u16 next;	/* base of the next state */
+	u8 symbol;
+	u8 bits;	/* number of bits to add to 'next' */
+};
+
+/* A state in a sequence decoding table, with the symbol already decoded */
+struct seq_entry {
+	u32 base;	/* value before adding extra bits */
+	u16 next;	/* base of the next state */
+	u8 extra;	/* number of extra bits for the value */
+	u8 bits;	/* number of bits to add to 'next' */
+};
+
+struct huf_entry {
+	u8 symbol;
+	u8 bits;
+};
+
+/* Description of one kind of sequence symbol (literal/match length, offset) */
+struct seq_kind {
+	const s16 *dflt;	/* predefined distribution */
+	uint dflt_max;		/* last symbol in 'dflt' */
+	uint dflt_log;
+	uint max_symbol;
+	uint max_log;
+	const u32 *base;	/* NULL for offsets */
+	const u8 *extra;
+};
+
+static const struct seq_kind ll_kind = {
+	ll_default, LL_MAX_SYMBOL, 6, LL_MAX_SYMBOL, LL_MAX_LOG,
+	ll_base, ll_bits,
+};
+
+static const struct seq_kind ml_kind = {
+	ml_default, ML_MAX_SYMBOL, 6, ML_MAX_SYMBOL, ML_MAX_LOG,
+	ml_base, ml_bits,
+};
+
+static const struct seq_kind of_kind = {
+	of_default, sizeof(of_default) / sizeof(of_default[0]) - 1, 5,
+	OF_MAX_SYMBOL, OF_MAX_LOG, NULL, NULL,
+};
+
+struct xxh64 {
+	u64 total;
+	u64 v[4];
+	u8 mem[32];
+	uint memsize;
+};
+
+struct zstd_frame {
+	u64 content_size;	/* ZSTD_SIZE_UNKNOWN if not recorded */
+	u64 window_size;
+	uint header_size;	/* including the magic number */
+	bool checksum;
+};
+
+/* Decoding state which lasts between blocks of a frame */
+struct zstd_ctx {
+	struct seq_entry ll[1 << LL_MAX_LOG];
+	struct seq_entry ml[1 << ML_MAX_LOG];
+	struct seq_entry of[1 << OF_MAX_LOG];
+	int ll_log, ml_log, of_log;	/* -1 if there is no table yet */
+	struct huf_entry huf[1 << HUF_MAX_BITS];
+	int huf_log;			/* -1 if there is no table yet */
+	u32 rep[3];			/* repeat offsets */
+	size_t block_max;		/* largest decompressed block size */
+	bool checksum;
+	struct xxh64 xxh;
+	u8 lit[ZSTD_BLOCK_MAX + WILD_SLACK];
+};
+
+/*
+ * XXH64, used for the optional content checksum. Only the lowest 32 bits of
+ * the hash are stored in the frame.
+ */
+#define PRIME64_1	0x9e3779b185ebca87ULL
+#define PRIME64_2	0xc2b2ae3d27d4eb4fULL
+#define PRIME64_3	0x165667b19e3779f9ULL
+#define PRIME64_4	0x85ebca77c2b2ae63ULL
+#define PRIME64_5	0x27d4eb2f165667c5ULL
+
+static inline u64 rotl64(u64 x, uint r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline u64 xxh64_round(u64 acc, u64 input)
+{
+	return rotl64(acc + input * PRIME64_2, 31) * PRIME64_1;
+}
+
+static inline u64 xxh64_merge(u64 acc, u64 val)
+{
+	return (acc ^ xxh64_round(0, val)) * PRIME64_1 + PRIME64_4;
+}
+
+static void xxh64_init(struct xxh64 *x)
+{
+	x->total = 0;
+	x->v[0] = PRIME64_1 + PRIME64_2;
+	x->v[1] = PRIME64_2;
+	x->v[2] = 0;
+	x->v[3] = -PRIME64_1;
+	x->memsize = 0;
+}
+
+static void xxh64_stripes(struct xxh64 *x, const u8 *p, size_t len)
+{
+	u64 v0 = x->v[0], v1 = x->v[1], v2 = x->v[2], v3 = x->v[3];
+
+	for (; len >= 32; len -= 32, p += 32) {
+		v0 = xxh64_round(v0, get_unaligned_le64(p));
+		v1 = xxh64_round(v1, get_unaligned_le64(p + 8));
+		v2 = xxh64_round(v2, get_unaligned_le64(p + 16));
+		v3 = xxh64_round(v3, get_unaligned_le64(p + 24));
+	}
+	x->v[0] = v0;
+	x->v[1] = v1;
+	x->v[2] = v2;
+	x->v[3] = v3;
+}
+
+static void xxh64_update(struct xxh64 *x, const u8 *p, size_t len)
+{
+	size_t n;
+
+	x->total += len;
+	if (x->memsize) {
+		n = min(len, (size_t)32 - x->memsize);
+		memcpy(x->mem + x->memsize, p, n);
+		x->memsize += n;
+		p += n;
+		len -= n;
+		if (x->memsize < 32)
+			return;
+		xxh64_stripes(x, x->mem, 32);
+		x->memsize = 0;
+	}
+	n = len & ~31;
+	xxh64_stripes(x, p, n);
+	memcpy(x->mem, p + n, len - n);
+	x->memsize = len - n;
+}
+
+static u64 xxh64_digest(const struct xxh64 *x)
+{
+	const u8 *p = x->mem, *end = x->mem + x->memsize;
+	u64 h;
+
+	if (x->total >= 32) {
+		h = rotl64(x->v[0], 1) + rotl64(x->v[1], 7) +
+			rotl64(x->v[2], 12) + rotl64(x->v[3], 18);
+		h = xxh64_merge(h, x->v[0]);
+		h = xxh64_merge(h, x->v[1]);
+		h = xxh64_merge(h, x->v[2]);
+		h = xxh64_merge(h, x->v[3]);
+	} else {
+		h = PRIME64_5;
+	}
+	h += x->total;
+	for (; p + 8 <= end; p += 8) {
+		h ^= xxh64_round(0, get_unaligned_le64(p));
+		h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+	}
+	if (p + 4 <= end) {
+		h ^= (u64)get_unaligned_le32(p) * PRIME64_1;
+		h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+		p += 4;
+	}
+	for (; p < end; p++) {
+		h ^= *p * PRIME64_5;
+		h = rotl64(h, 11) * PRIME64_1;
+	}
+	h ^= h >> 33;
+	h *= PRIME64_2;
+	h ^= h >> 29;
+	h *= PRIME64_3;
+	h ^= h >> 32;
+
+	return h;
+}
+
+/*
+ * Reverse bitstream, as used for Huffman and FSE-coded data. The stream is
+ * read from its last byte backwards, starting below the highest set bit of
+ * that byte. Up to 57 bits may be read between reloads.
+ */
+struct bitrev {
+	u64 bits;		/* bits loaded from 'ptr', little-endian */
+	uint used;		/* number of bits consumed from the top */
+	const u8 *ptr;
+	const u8 *start;
+};
+
+static int bitrev_init(struct bitrev *br, const u8 *src, size_t size)
+{
+	size_t i;
+
+	if (!size || !src[size - 1])
+		return -EINVAL;
+	br->start = src;
+	if (size >= sizeof(u64)) {
+		br->ptr = src + size - sizeof(u64);
+		br->bits = get_unaligned_le64(br->ptr);
+		br->used = 0;
+	} else {
+		br->ptr = src;
+		br->bits = 0;
+		for (i = 0; i < size; i++)
+			br->bits |= (u64)src[i] << (i * 8);
+		br->used = (sizeof(u64) - size) * 8;
+	}
+	br->used += 9 - fls(src[size - 1]);
+
+	return 0;
+}
+
+static inline ulong bitrev_peek(const struct bitrev *br, uint n)
+{
+	/* written this way so that n == 0 gives 0 without an invalid shift */
+	return ((br->bits << (br->used & 63)) >> 1) >> ((63 - n) & 63);
+}
+
+static inline ulong bitrev_read(struct bitrev *br, uint n)
+{
+	ulong val = bitrev_peek(br, n);
+
+	br->used += n;
+
+	return val;
+}
+
+static inline void bitrev_reload(struct bitrev *br)
+{
+	size_t nbytes = br->used >> 3;
+
+	/* over-reading means corrupt data; bitrev_done() will catch it */
+	if (br->used > 64)
+		return;
+	if (nbytes > br->ptr - br->start)
+		nbytes = br->ptr - br->start;
+	if (nbytes) {
+		br->ptr -= nbytes;
+		br->used -= nbytes * 8;
+		br->bits = get_unaligned_le64(br->ptr);
+	}
+}
+
+/* Check that exactly all of the stream has been read */
+static inline bool bitrev_done(const struct bitrev *br)
+{
+	return br->ptr == br->start && br->used == 64;
+}
+
+/* Read bits from a little-endian forward bitstream, zero past the end */
+static uint bits_fwd(const u8 *src, size_t size, size_t pos, uint n)
+{
+	uint val = 0;
+	uint i;
+
+	for (i = 0; i < n; i++, pos++) {
+		if (pos / 8 < size && (src[pos / 8] >> (pos % 8)) & 1)
+			val |= 1 << i;
+	}
+
+	return val;
+}
+
+/* Read bits backwards from 'pos', giving zeroes once past the start */
+static uint bits_rev(const u8 *src, int *pos, uint n)
+{
+	uint val = 0;
+	uint i;
+	int p;
+
+	*pos -= n;
+	for (i = 0; i < n; i++) {
+		p = *pos + i;
+		if (p >= 0 && (src[p / 8] >> (p % 8)) & 1)
+			val |= 1 << i;
+	}
+
+	return val;
+}
+
+/**
+ * fse_read_counts() - Read an FSE table description
+ *
+ * @src:	Description to read
+ * @size:	Bytes available at @src
+ * @norm:	Returns normalised count for each symbol
+ * @max_symbol:	On entry, the largest allowed symbol. On exit, the largest
+ *		symbol described
+ * @max_log:	Largest allowed accuracy log
+ * @logp:	Returns accuracy log
+ * @return number of bytes used, or -EINVAL if invalid
+ */
+static int fse_read_counts(const u8 *src, size_t size, s16 *norm,
+			   uint *max_symbol, uint max_log, uint *logp)
+{
+	int remaining, threshold, max, count;
+	uint log, nbits, symbol = 0;
+	uint val, rep;
+	size_t pos;
+
+	if (!size)
+		return -EINVAL;
+	log = (src[0] & 0xf) + 5;
+	if (log > max_log)
+		return -EINVAL;
+	pos = 4;
+	remaining = (1 << log) + 1;
+	threshold = 1 << log;
+	nbits = log + 1;
+	while (remaining > 1) {
+		if (symbol > *max_symbol)
+			return -EINVAL;
+		max = 2 * threshold - 1 - remaining;
+		val = bits_fwd(src, size, pos, nbits);
+		if ((val & (threshold - 1)) < max) {
+			count = val & (threshold - 1);
+			pos += nbits - 1;
+		} else {
+			count = val & (2 * threshold - 1);
+			if (count >= threshold)
+				count -= max;
+			pos += nbits;
+		}
+		count--;
+		remaining -= count < 0 ? -count : count;
+		norm[symbol++] = count;
+		if (!count) {
+			/* a zero count is followed by repeat flags */
+			do {
+				rep = bits_fwd(src, size, pos, 2);
+				pos += 2;
+				if (symbol + rep > *max_symbol + 1)
+					return -EINVAL;
+				for (val = 0; val < rep; val++)
+					norm[symbol++] = 0;
+			} while (rep == 3);
+		}
+		if (remaining < 1)
+			return -EINVAL;
+		while (remaining < threshold) {
+			nbits--;
+			threshold >>= 1;
+		}
+	}
+	if (remaining != 1 || (pos + 7) / 8 > size)
+		return -EINVAL;
+	*max_symbol = symbol - 1;
+	*logp = log;
+
+	return (pos + 7) / 8;
+}
+
+/* Build an FSE decoding table from normalised counts */
+static int fse_build(struct fse_entry *table, const s16 *norm,
+		     uint max_symbol, uint log)
+{
+	uint size = 1 << log, high = size - 1;
+	uint step = (size >> 1) + (size >> 3) + 3;
+	u16 next[FSE_MAX_SYMBOLS];
+	uint s, i, pos, state;
+	int n;
+
+	/* symbols with a 'less than one' probability go at the end */
+	for (s = 0; s <= max_symbol; s++) {
+		if (norm[s] == -1) {
+			table[high--].symbol = s;
+			next[s] = 1;
+		} else {
+			next[s] = norm[s];
+		}
+	}
+
+	/* spread the rest over the table */
+	pos = 0;
+	for (s = 0; s <= max_symbol; s++) {
+		for (n = 0; n < norm[s]; n++) {
+			table[pos].symbol = s;
+			do {
+				pos = (pos + step) & (size - 1);
+			} while (pos > high);
+		}
+	}
+	if (pos)
+		return -EINVAL;
+
+	for (i = 0; i < size; i++) {
+		s = table[i].symbol;
+		state = next[s]++;
+		table[i].bits = log + 1 - fls(state);
+		table[i].next = (state << table[i].bits) - size;
+	}
+
+	return 0;
+}
+
+/* Decode the FSE-compressed Huffman weights, returning their number */
+static int huf_read_fse_weights(u8 *weights, const u8 *src, size_t size)
+{
+	struct fse_entry table[1 << HUF_WEIGHT_LOG_MAX];
+	s16 norm[FSE_MAX_SYMBOLS];
+	uint max_symbol = HUF_MAX_BITS;
+	const struct fse_entry *e;
+	uint log, state[2], n = 0, i;
+	int ret, pos;
+
+	ret = fse_read_counts(src, size, norm, &max_symbol,
+			      HUF_WEIGHT_LOG_MAX, &log);
+	if (ret < 0)
+		return ret;
+	if (fse_build(table, norm, max_symbol, log))
+		return -EINVAL;
+	src += ret;
+	size -= ret;
+	if (!size || !src[size - 1])
+		return -EINVAL;
+
+	/*
+	 * Two interleaved states share one reverse bitstream. Reading past
+	 * the start of the stream gives zeroes; the first state to do so
+	 * ends decoding, after which the other state gives one last weight.
+	 */
+	pos = (size - 1) * 8 + fls(src[size - 1]) - 1;
+	state[0] = bits_rev(src, &pos, log);
+	state[1] = bits_rev(src, &pos, log);
+	for (i = 0; ; i ^= 1) {
+		if (n >= HUF_MAX_SYMBOLS - 2)
+			return -EINVAL;
+		e = &table[state[i]];
+		weights[n++] = e->symbol;
+		state[i] = e->next + bits_rev(src, &pos, e->bits);
+		if (pos < 0) {
+			weights[n++] = table[state[i ^ 1]].symbol;
+			break;
+		}
+	}
+
+	return n;
+}
+
+/**
+ * huf_read_table() - Read a Huffman tree description and build its table
+ *
+ * @ctx:	Context to hold the table
+ * @src:	Tree description
+ * @size:	Bytes available at @src
+ * @return number of bytes used, or -EINVAL if invalid
+ */
+static int huf_read_table(struct zstd_ctx *ctx, const u8 *src, size_t size)
+{
+	u8 weights[HUF_MAX_SYMBOLS];
+	uint rank[HUF_MAX_BITS + 2];
+	uint hdr, sum, rest, bits, len, n, i, w;
+	int used, ret;
+
+	if (!size)
+		return -EINVAL;
+	hdr = src[0];
+	if (hdr >= 128) {
+		/* weights stored directly, 4 bits each */
+		n = hdr - 127;
+		used = 1 + (n + 1) / 2;
+		if (used > size)
+			return -EINVAL;
+		for (i = 0; i < n; i++)
+			weights[i] = i & 1 ? src[1 + i / 2] & 0xf :
+				src[1 + i / 2] >> 4;
+	} else {
+		used = 1 + hdr;
+		if (used > size)
+			return -EINVAL;
+		ret = huf_read_fse_weights(weights, src + 1, hdr);
+		if (ret < 0)
+			return ret;
+		n = ret;
+	}
+
+	/* the last weight is implied by the total being a power of two */
+	sum = 0;
+	for (i = 0; i < n; i++) {
+		if (weights[i] > HUF_MAX_BITS)
+			return -EINVAL;
+		if (weights[i])
+			sum += 1 << (weights[i] - 1);
+	}
+	if (!sum)
+		return -EINVAL;
+	bits = fls(sum);
+	rest = (1 << bits) - sum;
+	if (bits > HUF_MAX_BITS || rest & (rest - 1))
+		return -EINVAL;
+	weights[n++] = fls(rest);
+
+	/*
+	 * A symbol of weight w has a code of (bits + 1 - w) bits and so
+	 * covers 1 << (w - 1) table entries. Codes are allotted in order of
+	 * increasing weight, then symbol.
+	 */
+	memset(rank, '\0', sizeof(rank));
+	for (i = 0; i < n; i++)
+		rank[weights[i]]++;
+	for (w = 1, sum = 0; w <= bits; w++) {
+		len = rank[w] << (w - 1);
+		rank[w] = sum;
+		sum += len;
+	}
+	for (i = 0; i < n; i++) {
+		w = weights[i];
+		if (!w)
+			continue;
+		len = 1 << (w - 1);
+		while (len--) {
+			ctx->huf[rank[w]].symbol = i;
+			ctx->huf[rank[w]++].bits = bits + 1 - w;
+		}
+	}
+	ctx->huf_log = bits;
+
+	return used;
+}
+
+static int huf_decode_stream(const struct zstd_ctx *ctx, u8 *out, size_t n,
+			     const u8 *src, size_t size)
+{
+	const struct huf_entry *huf = ctx->huf, *e;
+	uint log = ctx->huf_log;
+	struct bitrev br;
+
+	if (bitrev_init(&br, src, size))
+		return -EINVAL;
+
+	/* four symbols per reload, since 4 * HUF_MAX_BITS <= 57 */
+	for (; n >= 4; n -= 4) {
+		bitrev_reload(&br);
+		e = &huf[bitrev_peek(&br, log)];
+		br.used += e->bits;
+		*out++ = e->symbol;
+		e = &huf[bitrev_peek(&br, log)];
+		br.used += e->bits;
+		*out++ = e->symbol;
+		e = &huf[bitrev_peek(&br, log)];
+		br.used += e->bits;
+		*out++ = e->symbol;
+		e = &huf[bitrev_peek(&br, log)];
+		br.used += e->bits;
+		*out++ = e->symbol;
+	}
+	bitrev_reload(&br);
+	while (n--) {
+		e = &huf[bitrev_peek(&br, log)];
+		br.used += e->bits;
+		*out++ = e->symbol;
+	}
+	bitrev_reload(&br);
+
+	return bitrev_done(&br) ? 0 : -EINVAL;
+}
+
+/**
+ * decode_literals() - Decode the literals section of a compressed block
+ *
+ * @ctx:	Decoding context
+ * @src:	Start of block
+ * @size:	Size of block
+ * @litp:	Returns a pointer to the literals
+ * @lit_sizep:	Returns the number of literals
+ * @return number of bytes used from @src, or -EINVAL if invalid
+ */
+static int decode_literals(struct zstd_ctx *ctx, const u8 *src, size_t size,
+			   const u8 **litp, size_t *lit_sizep)
+{
+	uint type = src[0] & 3, format = (src[0] >> 2) & 3;
+	size_t regen, csize, hsize, used, seg, last;
+	size_t ssize[4];
+	uint streams, bits, i;
+	const u8 *p;
+	u64 hdr;
+	int ret;
+
+	if (type == LIT_RAW || type == LIT_RLE) {
+		switch (format) {
+		case 1:
+			hsize = 2;
+			break;
+		case 3:
+			hsize = 3;
+			break;
+		default:
+			hsize = 1;
+			break;
+		}
+		if (size < hsize + 1)
+			return -EINVAL;
+		if (hsize == 1)
+			regen = src[0] >> 3;
+		else if (hsize == 2)
+			regen = (src[0] >> 4) | src[1] << 4;
+		else
+			regen = (src[0] >> 4) | src[1] << 4 | src[2] << 12;
+		if (regen > ctx->block_max)
+			return -EINVAL;
+		*lit_sizep = regen;
+		if (type == LIT_RLE) {
+			memset(ctx->lit, src[hsize], regen);
+			*litp = ctx->lit;
+			return hsize + 1;
+		}
+		if (size < hsize + regen)
+			return -EINVAL;
+		*litp = src + hsize;
+		return hsize + regen;
+	}
+
+	streams = format ? 4 : 1;
+	hsize = format < 2 ? 3 : format + 2;
+	bits = format < 2 ? 10 : 14 + (format - 2) * 4;
+	if (size < hsize)
+		return -EINVAL;
+	for (hdr = 0, i = 0; i < hsize; i++)
+		hdr |= (u64)src[i] << (i * 8);
+	regen = (hdr >> 4) & ((1 << bits) - 1);
+	csize = (hdr >> (4 + bits)) & ((1 << bits) - 1);
+	used = hsize + csize;
+	if (regen > ctx->block_max || size < used)
+		return -EINVAL;
+	p = src + hsize;
+	if (type == LIT_COMPRESSED) {
+		ret = huf_read_table(ctx, p, csize);
+		if (ret < 0)
+			return ret;
+		p += ret;
+		csize -= ret;
+	} else if (ctx->huf_log < 0) {
+		return -EINVAL;
+	}
+
+	if (streams == 1) {
+		ret = huf_decode_stream(ctx, ctx->lit, regen, p, csize);
+	} else {
+		if (csize < 6)
+			return -EINVAL;
+		ssize[0] = get_unaligned_le16(p);
+		ssize[1] = get_unaligned_le16(p + 2);
+		ssize[2] = get_unaligned_le16(p + 4);
+		p += 6;
+		csize -= 6;
+		if (ssize[0] + ssize[1] + ssize[2] > csize)
+			return -EINVAL;
+		ssize[3] = csize - ssize[0] - ssize[1] - ssize[2];
+		seg = (regen + 3) / 4;
+		if (seg * 3 > regen)
+			return -EINVAL;
+		last = regen - seg * 3;
+		for (ret = 0, i = 0; !ret && i < 4; i++) {
+			ret = huf_decode_stream(ctx, ctx->lit + seg * i,
+						i == 3 ? last : seg, p,
+						ssize[i]);
+			p += ssize[i];
+		}
+	}
+	if (ret)
+		return ret;
+	*litp = ctx->lit;
+	*lit_sizep = regen;
+
+	return used;
+}
+
+/* Build a sequence decoding table from normalised counts */
+static int seq_build(struct seq_entry *table, const struct seq_kind *kind,
+		     const s16 *norm, uint max_symbol, uint log)
+{
+	struct fse_entry fse[1 << LL_MAX_LOG];
+	uint i, s;
+
+	if (fse_build(fse, norm, max_symbol, log))
+		return -EINVAL;
+	for (i = 0; i < 1 << log; i++) {
+		s = fse[i].symbol;
+		table[i].base = kind->base ? kind->base[s] : 1U << s;
+		table[i].extra = kind->extra ? kind->extra[s] : s;
+		table[i].next = fse[i].next;
+		table[i].bits = fse[i].bits;
+	}
+
+	return 0;
+}
+
+/**
+ * seq_read_table() - Set up the decoding table for one kind of symbol
+ *
+ * @table:	Table to set up
+ * @logp:	Accuracy log of the table, -1 if there is no table yet
+ * @kind:	Kind of symbol
+ * @mode:	Compression mode from the block (SEQ_...)
+ * @src:	Table description, if any
+ * @size:	Bytes available at @src
+ * @return number of bytes used from @src, or -EINVAL if invalid
+ */
+static int seq_read_table(struct seq_entry *table, int *logp,
+			  const struct seq_kind *kind, uint mode,
+			  const u8 *src, size_t size)
+{
+	s16 norm[FSE_MAX_SYMBOLS];
+	uint max_symbol, log;
+	int ret;
+
+	switch (mode) {
+	case SEQ_PREDEFINED:
+		if (seq_build(table, kind, kind->dflt, kind->dflt_max,
+			      kind->dflt_log))
+			return -EINVAL;
+		*logp = kind->dflt_log;
+		return 0;
+	case SEQ_RLE:
+		if (!size || src[0] > kind->max_symbol)
+			return -EINVAL;
+		table[0].base = kind->base ? kind->base[src[0]] : 1U << src[0];
+		table[0].extra = kind->extra ? kind->extra[src[0]] : src[0];
+		table[0].next = 0;
+		table[0].bits = 0;
+		*logp = 0;
+		return 1;
+	case SEQ_COMPRESSED:
+		max_symbol = kind->max_symbol;
+		ret = fse_read_counts(src, size, norm, &max_symbol,
+				      kind->max_log, &log);
+		if (ret < 0)
+			return ret;
+		if (seq_build(table, kind, norm, max_symbol, log))
+			return -EINVAL;
+		*logp = log;
+		return ret;
+	default:
+		return *logp < 0 ? -EINVAL : 0;
+	}
+}
+
+static inline void copy8(u8 *dst, const u8 *src)
+{
+	put_unaligned(get_unaligned((const u64 *)src), (u64 *)dst);
+}
+
+/*
+ * Copy 8 bytes at a time. This reads and writes up to WILD_SLACK - 1 bytes
+ * beyond the end, and copies at least 8 bytes even if len is 0. If the
+ * areas overlap, dst must be at least 8 bytes after src.
+ */
+static inline void wild_copy(u8 *dst, const u8 *src, size_t len)
+{
+	u8 *end = dst + len;
+
+	do {
+		copy8(dst, src);
+		dst += 8;
+		src += 8;
+	} while (dst < end);
+}
+
+/*
+ * Copy a match which may overlap its destination, using wild_copy().
+ * For offsets under 8, copy the first 8 bytes singly; the data then
+ * repeats with a period of at least 8 (a multiple of 'offset').
+ */
+static inline void wild_copy_match(u8 *op, size_t offset, size_t len)
+{
+	const u8 *match = op - offset;
+	uint i;
+
+	if (offset < 8) {
+		for (i = 0; i < 8; i++)
+			op[i] = match[i];
+		if (len <= 8)
+			return;
+		op += 8;
+		len -= 8;
+		match = op - offset * ((8 + offset - 1) / offset);
+	}
+	wild_copy(op, match, len);
+}
+
+/*
+ * Copy a match which may overlap its destination, without writing beyond
+ * it. Data repeating with period 'offset' also repeats with period
+ * 2 * offset, so the distance can be doubled after each copy.
+ */
+static inline void copy_match(u8 *op, size_t offset, size_t len)
+{
+	if (offset == 1) {
+		memset(op, op[-1], len);
+		return;
+	}
+	while (len > offset) {
+		memcpy(op, op - offset, offset);
+		op += offset;
+		len -= offset;
+		offset *= 2;
+	}
+	memcpy(op, op - offset, len);
+}
+
+/**
+ * decode_sequences() - Decode and execute the sequences of a block
+ *
+ * @ctx:	Decoding context
+ * @src:	Start of sequences section
+ * @size:	Size of sequences section
+ * @lit:	Literals for this block
+ * @lit_size:	Number of literals
+ * @lit_limit:	End of readable memory after the literals
+ * @hist:	Start of history available for matches
+ * @op:	Output position
+ * @oend:	End of output space
+ * @return number of bytes written, or -ve error
+ */
+static long decode_sequences(struct zstd_ctx *ctx, const u8 *src,
+			     size_t size, const u8 *lit, size_t lit_size,
+			     const u8 *lit_limit, const u8 *hist, u8 *op,
+			     u8 *oend)
+{
+	const u8 *end = src + size, *lit_end = lit + lit_size;
+	u8 *ostart = op;
+	uint ll_state = 0, ml_state = 0, of_state = 0, modes;
+	size_t nseq, count, ll, ml, offset, prev;
+	size_t rep0, rep1, rep2;
+	const struct seq_entry *e_ll, *e_ml, *e_of;
+	struct bitrev br;
+	int ret;
+
+	if (src >= end)
+		return -EINVAL;
+	nseq = *src++;
+	if (nseq >= 128) {
+		if (nseq == 255) {
+			if (end - src < 2)
+				return -EINVAL;
+			nseq = get_unaligned_le16(src) + 0x7f00;
+			src += 2;
+		} else {
+			if (src >= end)
+				return -EINVAL;
+			nseq = ((nseq - 128) << 8) + *src++;
+		}
+	}
+
+	count = nseq;
+	if (nseq) {
+		if (src >= end)
+			return -EINVAL;
+		modes = *src++;
+		if (modes & 3)
+			return -EINVAL;
+		ret = seq_read_table(ctx->ll, &ctx->ll_log, &ll_kind,
+				     modes >> 6, src, end - src);
+		if (ret < 0)
+			return ret;
+		src += ret;
+		ret = seq_read_table(ctx->of, &ctx->of_log, &of_kind,
+				     (modes >> 4) & 3, src, end - src);
+		if (ret < 0)
+			return ret;
+		src += ret;
+		ret = seq_read_table(ctx->ml, &ctx->ml_log, &ml_kind,
+				     (modes >> 2) & 3, src, end - src);
+		if (ret < 0)
+			return ret;
+		src += ret;
+
+		if (bitrev_init(&br, src, end - src))
+			return -EINVAL;
+		ll_state = bitrev_read(&br, ctx->ll_log);
+		of_state = bitrev_read(&br, ctx->of_log);
+		ml_state = bitrev_read(&br, ctx->ml_log);
+	}
+
+	/* keep the repeat offsets local, since output may alias anything */
+	rep0 = ctx->rep[0];
+	rep1 = ctx->rep[1];
+	rep2 = ctx->rep[2];
+	while (nseq--) {
+		e_ll = &ctx->ll[ll_state];
+		e_ml = &ctx->ml[ml_state];
+		e_of = &ctx->of[of_state];
+
+		/* at most 31 + 16 bits */
+		bitrev_reload(&br);
+		offset = e_of->base + bitrev_read(&br, e_of->extra);
+		ml = e_ml->base + bitrev_read(&br, e_ml->extra);
+
+		/* at most 16 + 9 + 9 + 8 bits */
+		bitrev_reload(&br);
+		ll = e_ll->base + bitrev_read(&br, e_ll->extra);
+		if (nseq) {
+			ll_state = e_ll->next + bitrev_read(&br, e_ll->bits);
+			ml_state = e_ml->next + bitrev_read(&br, e_ml->bits);
+			of_state = e_of->next + bitrev_read(&br, e_of->bits);
+		}
+
+		if (offset > 3) {
+			rep2 = rep1;
+			rep1 = rep0;
+			rep0 = offset - 3;
+		} else {
+			/* a repeat offset, shifted by one if there are no literals */
+			offset += !ll;
+			if (offset > 1) {
+				prev = offset == 2 ? rep1 : offset == 3 ? rep2 :
+					rep0 - 1;
+				if (offset != 2)
+					rep2 = rep1;
+				rep1 = rep0;
+				rep0 = prev;
+			}
+		}
+		offset = rep0;
+
+		if (ll > lit_end - lit)
+			return -EINVAL;
+		if (!offset || offset > (size_t)(op + ll - hist))
+			return -EINVAL;
+		if (likely(ll + ml + WILD_SLACK <= oend - op &&
+			   ll + WILD_SLACK <= lit_limit - lit)) {
+			wild_copy(op, lit, ll);
+			op += ll;
+			lit += ll;
+			wild_copy_match(op, offset, ml);
+		} else {
+			if (ll + ml > oend - op)
+				return -ENOBUFS;
+			memcpy(op, lit, ll);
+			op += ll;
+			lit += ll;
+			copy_match(op, offset, ml);
+		}
+		op += ml;
+	}
+	ctx->rep[0] = rep0;
+	ctx->rep[1] = rep1;
+	ctx->rep[2] = rep2;
+	if (count) {
+		bitrev_reload(&br);
+		if (!bitrev_done(&br))
+			return -EINVAL;
+	}
+
+	/* the remaining literals follow the last sequence */
+	if (lit_end - lit > oend - op)
+		return -ENOBUFS;
+	memcpy(op, lit, lit_end - lit);
+	op += lit_end - lit;
+
+	return op - ostart;
+}
+
+/**
+ * decode_block() - Decode a compressed block
+ *
+ * @ctx:	Decoding context
+ * @src:	Block contents
+ * @size:	Size of block contents
+ * @hist:	Start of history available for matches
+ * @op:		Output position
+ * @oend:	End of output space
+ * @return number of bytes written, or -ve error
+ */
+static long decode_block(struct zstd_ctx *ctx, const u8 *src, size_t size,
+			 const u8 *hist, u8 *op, u8 *oend)
+{
+	const u8 *lit = NULL, *lit_limit;
+	size_t lit_size = 0;
+	int ret;
+
+	if (!size)
+		return -EINVAL;
+	ret = decode_literals(ctx, src, size, &lit, &lit_size);
+	if (ret < 0)
+		return ret;
+	if (oend - op > (long)ctx->block_max)
+		oend = op + ctx->block_max;
+
+	/* raw literals are read in place and followed by the sequences */
+	lit_limit = lit == ctx->lit ? ctx->lit + sizeof(ctx->lit) :
+		src + size;
+
+	return decode_sequences(ctx, src + ret, size - ret, lit, lit_size,
+				lit_limit, hist, op, oend);
+}
+
+/* Number of bytes in a frame header, from its descriptor byte */
+static uint frame_header_size(uint fhd)
+{
+	static const u8 did_size[] = { 0, 1, 2, 4 };
+	static const u8 fcs_size[] = { 0, 2, 4, 8 };
+	bool single = fhd & 0x20;
+
+	return 5 + !single + did_size[fhd & 3] +
+		(fhd >> 6 ? fcs_size[fhd >> 6] : single);
+}
+
+/*
+ * Parse a frame header. The caller must provide at least 5 bytes, and
+ * frame_header_size() bytes in total.
+ */
+static int parse_frame_header(const u8 *src, struct zstd_frame *frame)
+{
+	uint fhd = src[4];
+	bool single = fhd & 0x20;
+	const u8 *p = src + 5;
+	uint exp, i;
+	u32 dict_id = 0;
+
+	if (get_unaligned_le32(src) != ZSTD_MAGIC)
+		return -EPROTONOSUPPORT;
+	if (fhd & 0x08)
+		return -EINVAL;
+	frame->header_size = frame_header_size(fhd);
+	frame->checksum = fhd & 0x04;
+	if (!single) {
+		exp = 10 + (*p >> 3);
+		frame->window_size = (1ULL << exp) +
+			((1ULL << exp) / 8) * (*p & 7);
+		p++;
+	}
+	for (i = 0; i < ((fhd & 3) == 3 ? 4 : fhd & 3); i++)
+		dict_id |= (u32)*p++ << (i * 8);
+	if (dict_id)
+		return -EPROTONOSUPPORT;
+	switch (fhd >> 6) {
+	case 0:
+		frame->content_size = single ? *p : ZSTD_SIZE_UNKNOWN;
+		break;
+	case 1:
+		frame->content_size = get_unaligned_le16(p) + 256;
+		break;
+	case 2:
+		frame->content_size = get_unaligned_le32(p);
+		break;
+	case 3:
+		frame->content_size = get_unaligned_le64(p);
+		break;
+	}
+	if (single)
+		frame->window_size = frame->content_size;
+
+	return 0;
+}
+
+static void reset_ctx(struct zstd_ctx *ctx, const struct zstd_frame *frame)
+{
+	ctx->ll_log = -1;
+	ctx->ml_log = -1;
+	ctx->of_log = -1;
+	ctx->huf_log = -1;
+	ctx->rep[0] = 1;
+	ctx->rep[1] = 4;
+	ctx->rep[2] = 8;
+	ctx->block_max = min_t(u64, frame->window_size, ZSTD_BLOCK_MAX);
+	ctx->checksum = frame->checksum;
+	if (ctx->checksum)
+		xxh64_init(&ctx->xxh);
+}
+
+int zstd_get_content_size(const void *src, size_t srcn, u64 *sizep)
+{
+	struct zstd_frame frame;
+	const u8 *p = src;
+	int ret;
+
+	if (srcn < 5)
+		return -EINVAL;
+	if (get_unaligned_le32(p) != ZSTD_MAGIC)
+		return -EPROTONOSUPPORT;
+	if (srcn < frame_header_size(p[4]))
+		return -EINVAL;
+	ret = parse_frame_header(p, &frame);
+	if (ret)
+		return ret;
+	if (frame.content_size == ZSTD_SIZE_UNKNOWN)
+		return -ENOENT;
+	*sizep = frame.content_size;
+
+	return 0;
+}
+
+/* Decompress one frame into a buffer, returning its size or -ve error */
+static long decompress_frame(struct zstd_ctx *ctx, const u8 **srcp,
+			     const u8 *end, u8 *dst, u8 *oend)
+{
+	const u8 *ip = *srcp;
+	struct zstd_frame frame;
+	u8 *op = dst;
+	size_t size;
+	u32 hdr;
+	uint type;
+	long ret;
+
+	if (end - ip < 5 || end - ip < frame_header_size(ip[4]))
+		return -EINVAL;
+	ret = parse_frame_header(ip, &frame);
+	if (ret)
+		return ret;
+	ip += frame.header_size;
+	reset_ctx(ctx, &frame);
+
+	do {
+		if (end - ip < 3)
+			return -EINVAL;
+		hdr = ip[0] | ip[1] << 8 | ip[2] << 16;
+		ip += 3;
+		type = (hdr >> 1) & 3;
+		size = hdr >> 3;
+		if (type == BLOCK_RLE) {
+			if (ip >= end)
+				return -EINVAL;
+			if (size > oend - op)
+				return -ENOBUFS;
+			memset(op, *ip++, size);
+			ret = size;
+		} else if (type == BLOCK_RESERVED || size > ctx->block_max ||
+			   size > end - ip) {
+			return -EINVAL;
+		} else if (type == BLOCK_RAW) {
+			if (size > oend - op)
+				return -ENOBUFS;
+			memcpy(op, ip, size);
+			ip += size;
+			ret = size;
+		} else {
+			ret = decode_block(ctx, ip, size, dst, op, oend);
+			if (ret < 0)
+				return ret;
+			ip += size;
+		}
+		if (ctx->checksum)
+			xxh64_update(&ctx->xxh, op, ret);
+		op += ret;
+	} while (!(hdr & 1));
+
+	if (ctx->checksum) {
+		if (end - ip < 4)
+			return -EINVAL;
+		if (get_unaligned_le32(ip) != (u32)xxh64_digest(&ctx->xxh))
+			return -EINVAL;
+		ip += 4;
+	}
+	if (frame.content_size != ZSTD_SIZE_UNKNOWN &&
+	    frame.content_size != op - dst)
+		return -EINVAL;
+	*srcp = ip;
+
+	return op - dst;
+}
+
+int zstd_decompress(const void *src, size_t srcn, void *dst, size_t *dstn)
+{
+	const u8 *ip = src, *end = ip + srcn;
+	u8 *op = dst, *oend = op + *dstn;
+	struct zstd_ctx *ctx;
+	u32 magic, size;
+	long ret = 0;
+
+	ctx = malloc(sizeof(*ctx));
+	if (!ctx)
+		return -ENOMEM;
+
+	do {
+		if (end - ip < 4) {
+			ret = -EINVAL;
+			break;
+		}
+		magic = get_unaligned_le32(ip);
+		if ((magic & ZSTD_SKIP_MASK) == ZSTD_SKIP_MAGIC) {
+			if (end - ip < 8) {
+				ret = -EINVAL;
+				break;
+			}
+			size = get_unaligned_le32(ip + 4);
+			if (size > end - ip - 8) {
+				ret = -EINVAL;
+				break;
+			}
+			ip += 8 + size;
+			continue;
+		}
+		ret = decompress_frame(ctx, &ip, end, op, oend);
+		if (ret < 0)
+			break;
+		op += ret;
+	} while (ip < end);
+
+	free(ctx);
+	*dstn = op - (u8 *)dst;
+
+	return ret < 0 ? ret : 0;
+}
+
+enum zstd_stage {
+	ZS_HEADER,		/* gathering a frame header */
+	ZS_SKIP,		/* skipping a skippable frame */
+	ZS_BLOCK_HEADER,
+	ZS_BLOCK,
+	ZS_FLUSH,		/* writing out a decoded block */
+	ZS_CHECKSUM,
+};
+
+struct zstd_stream {
+	struct zstd_ctx ctx;
+	struct zstd_frame frame;
+	enum zstd_stage stage;
+	size_t max_window;
+	u8 hdr[ZSTD_HEADER_MAX];	/* frame or block header */
+	size_t hdr_len;
+	u64 skip;			/* bytes left in a skippable frame */
+	bool last;			/* current block is the last one */
+	uint type;			/* block type */
+	size_t need;			/* size of current block's data */
+	size_t have;			/* bytes of block data so far */
+	u8 *in_buf;			/* staging for split compressed blocks */
+	u8 *win;			/* window, followed by space for a block */
+	size_t win_alloc;
+	size_t win_pos;			/* end of decoded data */
+	size_t flush_pos;		/* start of data not yet output */
+	u64 frame_pos;			/* bytes decoded in this frame */
+};
+
+struct zstd_stream *zstd_stream_create(size_t max_window)
+{
+	struct zstd_stream *zs;
+
+	zs = calloc(1, sizeof(*zs));
+	if (!zs)
+		return NULL;
+	zs->in_buf = malloc(ZSTD_BLOCK_MAX);
+	if (!zs->in_buf) {
+		free(zs);
+		return NULL;
+	}
+	zs->max_window = max_window ? max_window : ZSTD_WINDOW_DEFAULT_MAX;
+
+	return zs;
+}
+
+void zstd_stream_free(struct zstd_stream *zs)
+{
+	if (!zs)
+		return;
+	free(zs->win);
+	free(zs->in_buf);
+	free(zs);
+}
+
+/* Copy input into zs->hdr until it holds 'len' bytes; true when done */
+static bool zs_gather(struct zstd_stream *zs, struct zstd_in *in, size_t len)
+{
+	size_t n = min(len - zs->hdr_len, in->size - in->pos);
+
+	memcpy(zs->hdr + zs->hdr_len, in->src + in->pos, n);
+	zs->hdr_len += n;
+	in->pos += n;
+
+	return zs->hdr_len == len;
+}
+
+/* Set up a new frame from the header in zs->hdr */
+static int zs_start_frame(struct zstd_stream *zs)
+{
+	struct zstd_frame *frame = &zs->frame;
+	size_t need;
+	u8 *win;
+	int ret;
+
+	ret = parse_frame_header(zs->hdr, frame);
+	if (ret)
+		return ret;
+	if (frame->window_size > zs->max_window)
+		return -EFBIG;
+	reset_ctx(&zs->ctx, frame);
+
+	/* the window is followed by room to decode one more block */
+	need = frame->window_size + zs->ctx.block_max;
+	if (need > zs->win_alloc || !zs->win) {
+		win = malloc(need);
+		if (!win)
+			return -ENOMEM;
+		free(zs->win);
+		zs->win = win;
+		zs->win_alloc = need;
+	}
+	zs->win_pos = 0;
+	zs->flush_pos = 0;
+	zs->frame_pos = 0;
+
+	return 0;
+}
+
+/* Decode the current block into the window, once all its data is here */
+static int zs_decode_block(struct zstd_stream *zs, struct zstd_in *in)
+{
+	struct zstd_ctx *ctx = &zs->ctx;
+	size_t avail = in->size - in->pos;
+	const u8 *src = in->src + in->pos;
+	u8 *op = zs->win + zs->win_pos;
+	size_t keep, n;
+	long ret;
+
+	/* make room for the block, keeping one window of history */
+	if (!zs->have && zs->win_pos + ctx->block_max > zs->win_alloc) {
+		keep = min_t(u64, zs->win_pos, zs->frame.window_size);
+		memmove(zs->win, zs->win + zs->win_pos - keep, keep);
+		zs->win_pos = keep;
+		zs->flush_pos = keep;
+		op = zs->win + keep;
+	}
+
+	switch (zs->type) {
+	case BLOCK_RAW:
+		/* copy straight into the window as the data arrives */
+		n = min(zs->need - zs->have, avail);
+		memcpy(op + zs->have, src, n);
+		in->pos += n;
+		zs->have += n;
+		if (zs->have < zs->need)
+			return 0;
+		ret = zs->need;
+		break;
+	case BLOCK_RLE:
+		if (!avail)
+			return 0;
+		memset(op, *src, zs->need);
+		in->pos++;
+		ret = zs->need;
+		break;
+	default:
+		/* use the input in place if the whole block is there */
+		if (!zs->have && avail >= zs->need) {
+			in->pos += zs->need;
+		} else {
+			n = min(zs->need - zs->have, avail);
+			memcpy(zs->in_buf + zs->have, src, n);
+			in->pos += n;
+			zs->have += n;
+			if (zs->have < zs->need)
+				return 0;
+			src = zs->in_buf;
+		}
+		ret = decode_block(ctx, src, zs->need, zs->win, op,
+				   op + ctx->block_max);
+		if (ret < 0)
+			return ret == -ENOBUFS ? -EINVAL : ret;
+		break;
+	}
+	if (ctx->checksum)
+		xxh64_update(&ctx->xxh, op, ret);
+	zs->win_pos += ret;
+	zs->frame_pos += ret;
+	zs->stage = ZS_FLUSH;
+
+	return 0;
+}
+
+int zstd_stream_decompress(struct zstd_stream *zs, struct zstd_in *in,
+			   struct zstd_out *out)
+{
+	size_t len, n;
+	bool skip;
+	u32 hdr;
+	int ret;
+
+	while (1) {
+		switch (zs->stage) {
+		case ZS_HEADER:
+			/*
+			 * The first five bytes give the header size: eight for
+			 * a skippable frame, else from the descriptor byte
+			 */
+			skip = false;
+			len = 5;
+			if (zs->hdr_len >= 5) {
+				skip = (get_unaligned_le32(zs->hdr) &
+					ZSTD_SKIP_MASK) == ZSTD_SKIP_MAGIC;
+				len = skip ? 8 : frame_header_size(zs->hdr[4]);
+			}
+			if (!zs_gather(zs, in, len))
+				return 0;
+			if (len == 5)
+				break;
+			zs->hdr_len = 0;
+			if (skip) {
+				zs->skip = get_unaligned_le32(zs->hdr + 4);
+				zs->stage = ZS_SKIP;
+				break;
+			}
+			ret = zs_start_frame(zs);
+			if (ret)
+				return ret;
+			zs->stage = ZS_BLOCK_HEADER;
+			break;
+		case ZS_SKIP:
+			n = min_t(u64, zs->skip, in->size - in->pos);
+			in->pos += n;
+			zs->skip -= n;
+			if (zs->skip)
+				return 0;
+			zs->stage = ZS_HEADER;
+			break;
+		case ZS_BLOCK_HEADER:
+			if (!zs_gather(zs, in, 3))
+				return 0;
+			zs->hdr_len = 0;
+			hdr = zs->hdr[0] | zs->hdr[1] << 8 | zs->hdr[2] << 16;
+			zs->last = hdr & 1;
+			zs->type = (hdr >> 1) & 3;
+			zs->need = hdr >> 3;
+			zs->have = 0;
+			if (zs->type == BLOCK_RESERVED ||
+			    zs->need > zs->ctx.block_max ||
+			    (zs->type == BLOCK_COMPRESSED && !zs->need))
+				return -EINVAL;
+			zs->stage = ZS_BLOCK;
+			break;
+		case ZS_BLOCK:
+			ret = zs_decode_block(zs, in);
+			if (ret)
+				return ret;
+			if (zs->stage == ZS_BLOCK)
+				return 0;
+			break;
+		case ZS_FLUSH:
+			n = min(zs->win_pos - zs->flush_pos,
+				out->size - out->pos);
+			memcpy(out->dst + out->pos, zs->win + zs->flush_pos, n);
+			out->pos += n;
+			zs->flush_pos += n;
+			if (zs->flush_pos < zs->win_pos)
+				return 0;
+			if (!zs->last) {
+				zs->stage = ZS_BLOCK_HEADER;
+				break;
+			}
+			zs->stage = ZS_CHECKSUM;
+			break;
+		case ZS_CHECKSUM:
+			if (zs->ctx.checksum) {
+				if (!zs_gather(zs, in, 4))
+					return 0;
+				zs->hdr_len = 0;
+				if (get_unaligned_le32(zs->hdr) !=
+				    (u32)xxh64_digest(&zs->ctx.xxh))
+					return -EINVAL;
+			}
+			if (zs->frame.content_size != ZSTD_SIZE_UNKNOWN &&
+			    zs->frame.content_size != zs->frame_pos)
+				return -EINVAL;
+			zs->stage = ZS_HEADER;
+			return 1;
+		}
+	}
+}
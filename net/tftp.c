@@ -133,6 +133,30 @@ static char tftp_filename[MAX_LEN];
 static unsigned short tftp_block_size = TFTP_BLOCK_SIZE;
 static unsigned short tftp_block_size_option = TFTP_MTU_BLOCKSIZE;
 
+/*
+ * RFC 7440 windowsize: the server sends up to tftp_window_size blocks
+ * before waiting for an ACK. Blocks arriving out of order within the
+ * window are stored straight away and recorded in tftp_window_map, so
+ * only a missing block costs a retransmission.
+ */
+#ifdef CONFIG_TFTP_WINDOWSIZE
+#define TFTP_WINDOWSIZE CONFIG_TFTP_WINDOWSIZE
+#else
+#define TFTP_WINDOWSIZE 1
+#endif
+/* one bit per block in tftp_window_map */
+#define TFTP_MAX_WINDOWSIZE	64
+
+static unsigned short tftp_window_size = 1;
+static unsigned short tftp_window_size_option = TFTP_WINDOWSIZE;
+/* bit n set: block tftp_prev_block + 1 + n has been stored */
+static u64	tftp_window_map;
+/* last block number we acknowledged */
+static ulong	tftp_window_acked;
+/* the short block ending the file has been received */
+static int	tftp_window_last_seen;
+static ulong	tftp_window_last_block;
+
 #ifdef CONFIG_MCAST_TFTP
 #include <malloc.h>
 #define MTFTP_BITMAPSIZE	0x1000
@@ -210,6 +234,9 @@ static void new_transfer(void)
 	tftp_prev_block = 0;
 	tftp_block_wrap = 0;
 	tftp_block_wrap_offset = 0;
+	tftp_window_map = 0;
+	tftp_window_acked = 0;
+	tftp_window_last_seen = 0;
 #ifdef CONFIG_CMD_TFTPPUT
 	tftp_put_final_block_sent = 0;
 #endif
@@ -240,6 +267,7 @@ static int load_block(unsigned block, uchar *dst, unsigned len)
 
 static void tftp_send(void);
 static void tftp_timeout_handler(void);
+static void tftp_window_receive(uchar *src, unsigned len);
 
 /**********************************************************************/
 
@@ -371,6 +399,10 @@ static void tftp_send(void)
 		/* try for more effic. blk size */
 		pkt += sprintf((char *)pkt, "blksize%c%d%c",
 				0, tftp_block_size_option, 0);
+		/* windowsize only applies to data we receive */
+		if (tftp_state == STATE_SEND_RRQ && tftp_window_size_option > 1)
+			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
+					0, tftp_window_size_option, 0);
 #ifdef CONFIG_MCAST_TFTP
 		/* Check all preconditions before even trying the option */
 		if (!tftp_mcast_disabled) {
@@ -403,6 +435,7 @@ static void tftp_send(void)
 		s[0] = htons(TFTP_ACK);
 		s[1] = htons(tftp_cur_block);
 		pkt = (uchar *)(s + 2);
+		tftp_window_acked = tftp_cur_block;
 #ifdef CONFIG_CMD_TFTPPUT
 		if (tftp_put_active) {
 			int toload = tftp_block_size;
@@ -444,6 +477,63 @@ static void tftp_send(void)
 			    tftp_remote_port, tftp_our_port, len);
 }
 
+/**
+ * Handle a data block when a window size has been negotiated
+ *
+ * Blocks within the window ahead of the last contiguous block are stored
+ * as they arrive. The contiguous block is acknowledged once the server has
+ * sent a whole window past the previous ACK, so a single missing block
+ * gets the rest of the window resent without waiting for a timeout.
+ *
+ * @param src	Block data
+ * @param len	Number of bytes of block data
+ */
+static void tftp_window_receive(uchar *src, unsigned len)
+{
+	ushort block = tftp_cur_block;
+	ushort delta = block - tftp_prev_block - 1;
+	ushort ahead;
+
+	tftp_cur_block = tftp_prev_block;
+	if (delta < tftp_window_size &&
+	    !(tftp_window_map & (1ULL << delta))) {
+		timeout_count_max = tftp_timeout_count_max;
+		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
+
+		store_block(tftp_prev_block + delta, src, len);
+		tftp_window_map |= 1ULL << delta;
+		if (len < tftp_block_size) {
+			tftp_window_last_seen = 1;
+			tftp_window_last_block = block;
+		}
+
+		/* Move past every block we now hold in sequence */
+		while (tftp_window_map & 1) {
+			tftp_window_map >>= 1;
+			tftp_cur_block = (ushort)(tftp_prev_block + 1);
+			update_block_number();
+			tftp_prev_block = tftp_cur_block;
+			if (tftp_window_last_seen &&
+			    tftp_prev_block == tftp_window_last_block) {
+				tftp_send();
+				tftp_complete();
+				return;
+			}
+		}
+	}
+
+	/*
+	 * The end of the window (or of the file) has gone past: ACK what we
+	 * hold in sequence so the server carries on from the first gap. A
+	 * repeat of the block we last ACKed means that ACK was lost.
+	 */
+	ahead = block - tftp_window_acked;
+	if ((ahead >= tftp_window_size && ahead < 0x8000) ||
+	    (tftp_window_last_seen && block == tftp_window_last_block) ||
+	    (block == tftp_window_acked && block == tftp_prev_block))
+		tftp_send();
+}
+
 #ifdef CONFIG_CMD_TFTPPUT
 static void icmp_handler(unsigned type, unsigned code, unsigned dest,
 			 struct in_addr sip, unsigned src, uchar *pkt,
@@ -539,6 +629,14 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				debug("Blocksize ack: %s, %d\n",
 				      (char *)pkt + i + 8, tftp_block_size);
 			}
+			if (i + 11 < len &&
+			    strcmp((char *)pkt + i, "windowsize") == 0) {
+				tftp_window_size = (unsigned short)
+					simple_strtoul((char *)pkt + i + 11,
+						       NULL, 10);
+				debug("Windowsize ack: %s, %d\n",
+				      (char *)pkt + i + 11, tftp_window_size);
+			}
 #ifdef CONFIG_TFTP_TSIZE
 			if (strcmp((char *)pkt+i, "tsize") == 0) {
 				tftp_tsize = simple_strtoul((char *)pkt + i + 6,
@@ -548,8 +646,14 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			}
 #endif
 		}
+		/* The server may only lower the size we asked for */
+		if (tftp_window_size < 1 ||
+		    tftp_window_size > tftp_window_size_option)
+			tftp_window_size = 1;
 #ifdef CONFIG_MCAST_TFTP
 		parse_multicast_oack((char *)pkt, len - 1);
+		if (tftp_mcast_active)
+			tftp_window_size = 1;
 		if ((tftp_mcast_active) && (!tftp_mcast_master_client))
 			tftp_state = STATE_DATA;	/* passive.. */
 		else
@@ -569,7 +673,8 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		len -= 2;
 		tftp_cur_block = ntohs(*(__be16 *)pkt);
 
-		update_block_number();
+		if (tftp_window_size == 1)
+			update_block_number();
 
 		if (tftp_state == STATE_SEND_RRQ)
 			debug("Server did not acknowledge timeout option!\n");
@@ -586,7 +691,10 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 				tftp_prev_block = tftp_cur_block - 1;
 			} else
 #endif
-			if (tftp_cur_block != 1) {	/* Assertion */
+			if (tftp_window_size > 1 &&
+			    (ushort)(tftp_cur_block - 1) < tftp_window_size) {
+				/* an earlier block of the window may be late */
+			} else if (tftp_cur_block != 1) {	/* Assertion */
 				puts("\nTFTP error: ");
 				printf("First block is not block 1 (%ld)\n",
 				       tftp_cur_block);
@@ -596,6 +704,11 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			}
 		}
 
+		if (tftp_window_size > 1) {
+			tftp_window_receive(pkt + 2, len);
+			break;
+		}
+
 		if (tftp_cur_block == tftp_prev_block) {
 			/* Same block again; ignore it. */
 			break;
@@ -709,6 +822,18 @@ void tftp_start(enum proto_t protocol)
 	if (ep != NULL)
 		tftp_block_size_option = simple_strtol(ep, NULL, 10);
 
+	ep = getenv("tftpwindowsize");
+	if (ep != NULL)
+		tftp_window_size_option = simple_strtol(ep, NULL, 10);
+
+	if (tftp_window_size_option > TFTP_MAX_WINDOWSIZE) {
+		printf("TFTP window size (%d) too large, set max = %d\n",
+		       tftp_window_size_option, TFTP_MAX_WINDOWSIZE);
+		tftp_window_size_option = TFTP_MAX_WINDOWSIZE;
+	} else if (tftp_window_size_option < 1) {
+		tftp_window_size_option = 1;
+	}
+
 	ep = getenv("tftptimeout");
 	if (ep != NULL)
 		timeout_ms = simple_strtol(ep, NULL, 10);
@@ -730,8 +855,8 @@ void tftp_start(enum proto_t protocol)
 	}
 #endif
 
-	debug("TFTP blocksize = %i, timeout = %ld ms\n",
-	      tftp_block_size_option, timeout_ms);
+	debug("TFTP blocksize = %i, windowsize = %i, timeout = %ld ms\n",
+	      tftp_block_size_option, tftp_window_size_option, timeout_ms);
 
 	tftp_remote_ip = net_server_ip;
 	if (net_boot_file_name[0] == '\0') {
@@ -833,6 +958,7 @@ void tftp_start(enum proto_t protocol)
 	memset(net_server_ethaddr, 0, 6);
 	/* Revert tftp_block_size to dflt */
 	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_window_size = 1;
 #ifdef CONFIG_MCAST_TFTP
 	mcast_cleanup();
 #endif
@@ -862,6 +988,7 @@ void tftp_start_server(void)
 
 	/* Revert tftp_block_size to dflt */
 	tftp_block_size = TFTP_BLOCK_SIZE;
+	tftp_window_size = 1;
 	tftp_cur_block = 0;
 	tftp_our_port = WELL_KNOWN_PORT;
 
@@ -0,0 +1,230 @@
+/*
+ * Throughput benchmarks for the checksum and memory functions
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <div64.h>
+#include <errno.h>
+#include <malloc.h>
+#include <test/suites.h>
+#include <test/ut.h>
+#include <u-boot/crc.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+
+#define BENCH_SIZE	(1 << 20)
+#define BENCH_SLACK	64
+
+/**
+ * struct bench - A function being timed
+ *
+ * @run: Function which processes @size bytes once
+ * @impl: Implementation for @run to call, if any
+ * @dst: Destination buffer for @run, @size + BENCH_SLACK bytes
+ * @src: Source buffer for @run, @size + BENCH_SLACK bytes
+ * @size: Number of bytes processed by each call to @run
+ */
+struct bench {
+	void (*run)(struct bench *b);
+	const void *impl;
+	u8 *dst;
+	const u8 *src;
+	int size;
+};
+
+/* Call b->run for at least half a second, to smooth out timer jitter */
+static void bench_run(struct bench *b, const char *name)
+{
+	ulong start, us;
+	u64 bytes = 0;
+
+	start = timer_get_us();
+	do {
+		b->run(b);
+		bytes += b->size;
+		us = timer_get_us() - start;
+	} while (us < 500000);
+	printf("%-28s %8lu MB/s\n", name, (ulong)lldiv(bytes, us));
+}
+
+static void bench_crc32_run(struct bench *b)
+{
+	const struct crc32_impl *impl = b->impl;
+
+	impl->calc(0, b->src, b->size);
+}
+
+static void bench_crc32(struct bench *b)
+{
+	const struct crc32_impl *impl;
+	int i;
+
+	b->run = bench_crc32_run;
+	for (i = 0; (impl = crc32_get_impl(i)); i++) {
+		if (impl->available && !impl->available())
+			continue;
+		b->impl = impl;
+		bench_run(b, impl->name);
+	}
+}
+
+static void bench_sha1_run(struct bench *b)
+{
+	const struct sha1_impl *impl = b->impl;
+	unsigned long state[5] = { };
+
+	impl->process(state, b->src, b->size / 64);
+}
+
+static void bench_sha1(struct bench *b)
+{
+	const struct sha1_impl *impl;
+	int i;
+
+	b->run = bench_sha1_run;
+	for (i = 0; (impl = sha1_get_impl(i)); i++) {
+		if (impl->available && !impl->available())
+			continue;
+		b->impl = impl;
+		bench_run(b, impl->name);
+	}
+}
+
+static void bench_sha256_run(struct bench *b)
+{
+	const struct sha256_impl *impl = b->impl;
+	uint32_t state[8] = { };
+
+	impl->process(state, b->src, b->size / 64);
+}
+
+static void bench_sha256(struct bench *b)
+{
+	const struct sha256_impl *impl;
+	int i;
+
+	b->run = bench_sha256_run;
+	for (i = 0; (impl = sha256_get_impl(i)); i++) {
+		if (impl->available && !impl->available())
+			continue;
+		b->impl = impl;
+		bench_run(b, impl->name);
+	}
+}
+
+static void bench_memcpy_run(struct bench *b)
+{
+	memcpy(b->dst, b->src, b->size);
+}
+
+static void bench_memmove_run(struct bench *b)
+{
+	memmove(b->dst, b->src, b->size);
+}
+
+static void bench_memset_run(struct bench *b)
+{
+	memset(b->dst, 0xa5, b->size);
+}
+
+static void bench_memcmp_run(struct bench *b)
+{
+	if (memcmp(b->dst, b->src, b->size))
+		b->dst[0] = b->src[0];
+}
+
+static void bench_string(struct bench *b)
+{
+	u8 *dst = b->dst, *src = (u8 *)b->src;
+
+	b->run = bench_memcpy_run;
+	bench_run(b, "memcpy aligned");
+	b->src = src + 3;
+	bench_run(b, "memcpy src misaligned");
+	b->src = src;
+	b->dst = dst + 5;
+	bench_run(b, "memcpy dest misaligned");
+
+	b->run = bench_memmove_run;
+	b->dst = dst + 64;
+	b->src = dst;
+	bench_run(b, "memmove overlapping up");
+	b->dst = dst;
+	b->src = dst + 61;
+	bench_run(b, "memmove overlapping down");
+
+	b->run = bench_memset_run;
+	bench_run(b, "memset");
+
+	b->run = bench_memcmp_run;
+	b->src = src;
+	memcpy(dst, src, b->size);
+	bench_run(b, "memcmp aligned");
+	b->dst = dst + 1;
+	memcpy(dst + 1, src, b->size);
+	bench_run(b, "memcmp misaligned");
+	b->dst = dst;
+}
+
+static const struct {
+	const char *name;
+	void (*func)(struct bench *b);
+} benches[] = {
+	{ "crc32", bench_crc32 },
+	{ "sha1", bench_sha1 },
+	{ "sha256", bench_sha256 },
+	{ "string", bench_string },
+};
+
+int do_ut_bench(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
+{
+	struct bench b = { .size = BENCH_SIZE };
+	const char *name;
+	u8 *src;
+	int i;
+
+	/* Benchmarks take a while, so only list them unless asked */
+	if (argc < 2) {
+		printf("Benchmarks:");
+		for (i = 0; i < ARRAY_SIZE(benches); i++)
+			printf(" %s", benches[i].name);
+		printf("\n");
+		return 0;
+	}
+	name = strcmp(argv[1], "all") ? argv[1] : NULL;
+	for (i = 0; name && i < ARRAY_SIZE(benches); i++) {
+		if (!strcmp(name, benches[i].name))
+			break;
+	}
+	if (i == ARRAY_SIZE(benches))
+		return CMD_RET_USAGE;
+	if (argc > 2)
+		b.size = simple_strtoul(argv[2], NULL, 0);
+	if (b.size < 64)
+		return CMD_RET_USAGE;
+
+	b.dst = malloc(b.size + BENCH_SLACK);
+	src = malloc(b.size + BENCH_SLACK);
+	if (!b.dst || !src) {
+		free(b.dst);
+		free(src);
+		return CMD_RET_FAILURE;
+	}
+	ut_fill_random(src, b.size + BENCH_SLACK, 1);
+	memcpy(b.dst, src, b.size + BENCH_SLACK);
+	b.src = src;
+
+	for (i = 0; i < ARRAY_SIZE(benches); i++) {
+		if (name && strcmp(name, benches[i].name))
+			continue;
+		printf("%s, %d bytes:\n", benches[i].name, b.size);
+		benches[i].func(&b);
+	}
+	free(b.dst);
+	free(src);
+
+	return 0;
+}
@@ -14,6 +14,9 @@ static const char test_cmd[] = "setenv list 1\n setenv list ${list}2; "
 
 static int do_ut_cmd(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
+	cmd_tbl_t *start = ll_entry_start(cmd_tbl_t, cmd);
+	const int count = ll_entry_count(cmd_tbl_t, cmd);
+
 	printf("%s: Testing commands\n", __func__);
 	run_command("env default -f -a", 0);
 
@@ -57,6 +60,17 @@ static int do_ut_cmd(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 
 	assert(run_command("'", 0) == 1);
 
+	/* every command can be found by its name, whatever the link order */
+	for (cmdtp = start; cmdtp != start + count; cmdtp++)
+		assert(find_cmd(cmdtp->name) == cmdtp);
+
+	/* abbreviations, size suffixes and ambiguous or unknown commands */
+	assert(find_cmd("printen") == find_cmd("printenv"));
+	assert(!strcmp("md", find_cmd("md.b")->name));
+	assert(!strcmp("?", find_cmd("?")->name));
+	assert(find_cmd("p") == NULL);
+	assert(find_cmd("no_such_command") == NULL);
+
 	printf("%s: Everything went swimmingly\n", __func__);
 	return 0;
 }
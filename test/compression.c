@@ -11,7 +11,9 @@
 #include <command.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <div64.h>
 #include <asm/io.h>
+#include <libfdt.h>
 
 #include <u-boot/zlib.h>
 #include <bzlib.h>
@@ -21,6 +23,8 @@
 #include <lzma/LzmaTools.h>
 
 #include <linux/lzo.h>
+#include <u-boot/zstd.h>
+#include <test/ut.h>
 
 static const char plain[] =
 	"I am a highly compressable bit of text.\n"
@@ -117,6 +121,166 @@ static const char lz4_compressed[] =
 	"\x9d\x12\x8c\x9d";
 static const unsigned long lz4_compressed_size = 276;
 
+/* zstd -19 /tmp/plain.txt -o /tmp/plain.zst */
+static const char zstd_compressed[] =
+	"\x28\xb5\x2f\xfd\x64\x5e\x00\xad\x05\x00\x42\x4e\x26\x17\x90\x3b"
+	"\x07\x04\x5a\x13\x8b\xa7\x65\x34\x12\x21\x6d\xb0\x39\xbb\xae\xe8"
+	"\xba\xc9\xcd\x5e\x02\x49\xd0\x2b\xa9\xfa\x96\x92\xe7\x1f\x19\x19"
+	"\x7c\x8f\xf1\x9d\x54\x37\xfc\xd6\x0a\xf3\x0c\x93\x56\xc7\x52\x4f"
+	"\x0a\x62\x3e\xd1\xa5\x83\x17\x31\xab\x5d\x8f\x57\xf3\xcc\x3b\x58"
+	"\xf8\x91\x8c\xf1\x2a\x5c\x89\xdd\xf2\x9b\x15\xb7\x92\x5b\xbe\xba"
+	"\xab\xd5\xd1\x34\xdf\xf0\x02\x0e\x61\xcd\x7b\xd6\x01\xfc\xc2\xa7"
+	"\xd4\xd1\x3d\x26\x9c\x10\x49\xb8\x5b\xcd\xba\x7c\xf7\xac\x4b\xad"
+	"\xb7\x31\x1c\xbc\xf9\xcb\x62\x8e\x2e\x9b\x0f\xd3\x87\x57\x45\x12"
+	"\x16\xfa\x3a\x79\xde\x65\xf8\xcc\x48\xd5\x43\xa6\xbd\xc3\x91\x29"
+	"\x65\x29\xa7\x5b\x9a\x08\x08\x00\x60\x13\x00\x63\xa3\x8e\x28\x94"
+	"\x79\x41\x2a\x78\xc2\x91\x70\x9f\xaa\x6a\x21\x7a\xa1\xaa\x0c\xe4"
+	"\xf4\x6e\xfa";
+static const unsigned long zstd_compressed_size = 195;
+
+/*
+ * zstd -19: 128KB of marked text, 128KB of 'x' and 40000 bytes of text
+ * marked with 0xff, giving Huffman and RLE literals and an RLE block
+ */
+static const char zstd_multi[] =
+	"\x28\xb5\x2f\xfd\x04\x68\xd4\x0c\x00\x06\x10\x35\x2a\x80\x6b\x3a"
+	"\x9c\xf1\x40\x33\xa6\x38\x22\x88\x90\xd9\x61\x83\x8c\xc9\x64\x89"
+	"\xb4\xa2\xed\xbd\xff\xec\xb6\x4a\xb4\xaa\x7c\x02\x19\x93\xb4\x41"
+	"\x72\x2c\x13\x23\x70\xd4\x01\x27\x00\x26\x00\x27\x00\xd1\xca\x6f"
+	"\x03\xc6\x6f\xd3\xc9\x6f\x75\xdf\xba\x2f\x31\x41\x52\x3f\xb6\x6f"
+	"\xd1\x37\xa4\xbe\x91\x72\xcc\x5b\x31\x49\xab\x6f\xf1\x5d\xf0\xdd"
+	"\x5d\xba\x67\x02\x3c\x97\xff\xaa\x4c\x7e\xa9\xf7\x60\x32\x62\x46"
+	"\xb5\x7e\x54\xb7\x2b\x7d\xfc\xad\xab\x7d\xba\x35\x41\xd2\x4e\x28"
+	"\xcf\xf0\x3b\xe9\x19\xbe\x7e\x67\xd4\x03\x18\xe6\xfe\x2a\xf8\x34"
+	"\x28\xda\x9c\x16\x51\x48\xfc\x6b\xa8\xbd\xd9\x6d\x7c\x1b\x2e\x6d"
+	"\xe5\x22\xf6\xe6\x0a\xad\xef\xeb\x4f\xf8\x95\xbf\x26\x84\x26\xfc"
+	"\x06\x8b\x42\xc5\xb2\xa0\x58\xd7\x21\x50\x15\x1a\x02\x06\x40\xe1"
+	"\x08\x22\x9b\x8b\x27\xf1\xe9\x7c\x10\x8d\x89\x64\x82\x24\xde\xcb"
+	"\x31\xaf\x84\xb6\x58\x29\xc5\xbe\x0e\xf7\x96\x3a\xed\x73\x75\x1b"
+	"\x68\xa8\x81\xe6\x7c\x0a\xea\x51\xe8\xc0\x33\x92\x0e\x22\x28\x14"
+	"\x82\x04\x21\xf8\xff\x7f\x85\xc0\x6c\xe8\x07\xe4\xdc\xa2\x96\x88"
+	"\x7a\x2b\x5a\x22\xaa\xad\x69\x89\xa8\xb7\xaa\x15\xa2\xda\xaa\x16"
+	"\x44\x6d\xab\x5a\x23\xea\xd6\x6a\x81\xa8\xb7\xd4\x1a\xa2\xda\x52"
+	"\x0b\x44\x6d\x8b\x5a\x11\xd5\xd6\x6a\x85\xa8\x5b\xd5\x3a\xa2\x6e"
+	"\x51\x2b\x44\x6d\x4b\x2d\x11\xd5\xd6\x6a\x45\x54\x5b\xd5\x0a\x51"
+	"\x6f\x55\x0b\x44\xbd\x45\xad\x11\xf5\x56\xb5\x44\xd4\x5b\x6a\x15"
+	"\x51\x6d\x51\x0b\xa2\xbe\x45\xad\x10\x75\x2b\xb5\x40\x54\x5b\x6a"
+	"\x05\x51\x6d\xa9\x05\xa2\xb6\x45\xad\x88\x6a\x6b\xb5\x42\xd4\xad"
+	"\x6a\x1d\x51\xb7\xa8\x15\xa2\xb6\xa5\x96\x88\xea\x6c\xfd\xaa\x56"
+	"\x6c\x86\x3a\x4c\xfa\xe0\x5d\x60\x76\xd1\xee\x29\x85\x00\xb2\x45"
+	"\xc4\xff\x35\x09\x53\x55\xb0\x17\x85\x10\xe9\x23\x6c\xf9\x2a\xbc"
+	"\x22\x4d\x0d\x02\x00\x10\x78\x45\x03\x00\x95\x02\xff\x39\xa8\xa0"
+	"\x3e\xb1\xbb\x7f\x07\x11\xfc\xff\xff\x8f\x10\x20\x08\xd0\x0f\x34"
+	"\x42\x8e\x16\xe1\x0f\x1f\x7e\x84\xf2\x5a\xc2\x13\x3e\x7c\x09\xe1"
+	"\xb4\x84\x47\xf8\xf0\x23\xb4\x16\xb1\xa6\x2c\xbc\xf0\x42\x48\x2d"
+	"\xa2\x5c\x49\xc2\x87\x1f\x21\x68\x05\x0a\x5b\xc3\x1b\x7e\x42\x68"
+	"\xf1\xa5\x23\x85\x1f\x3e\x42\xd1\xc2\x00\xb0\xc3\x1f\xfe\x84\xa2"
+	"\x75\x9d\xd3\x84\x17\xfe\xf0\x12\x3a\xb4\x08\x4f\x0f\x5f\x8c\x5e"
+	"\xae\x58\xee\x21\xca\x50";
+
+/* zstd -19 --no-check /tmp/plain.txt */
+static const char zstd_nocheck[] =
+	"\x28\xb5\x2f\xfd\x00\x68\xad\x05\x00\x42\x4e\x26\x17\x90\x3b\x07"
+	"\x04\x5a\x13\x8b\xa7\x65\x34\x12\x21\x6d\xb0\x39\xbb\xae\xe8\xba"
+	"\xc9\xcd\x5e\x02\x49\xd0\x2b\xa9\xfa\x96\x92\xe7\x1f\x19\x19\x7c"
+	"\x8f\xf1\x9d\x54\x37\xfc\xd6\x0a\xf3\x0c\x93\x56\xc7\x52\x4f\x0a"
+	"\x62\x3e\xd1\xa5\x83\x17\x31\xab\x5d\x8f\x57\xf3\xcc\x3b\x58\xf8"
+	"\x91\x8c\xf1\x2a\x5c\x89\xdd\xf2\x9b\x15\xb7\x92\x5b\xbe\xba\xab"
+	"\xd5\xd1\x34\xdf\xf0\x02\x0e\x61\xcd\x7b\xd6\x01\xfc\xc2\xa7\xd4"
+	"\xd1\x3d\x26\x9c\x10\x49\xb8\x5b\xcd\xba\x7c\xf7\xac\x4b\xad\xb7"
+	"\x31\x1c\xbc\xf9\xcb\x62\x8e\x2e\x9b\x0f\xd3\x87\x57\x45\x12\x16"
+	"\xfa\x3a\x79\xde\x65\xf8\xcc\x48\xd5\x43\xa6\xbd\xc3\x91\x29\x65"
+	"\x29\xa7\x5b\x9a\x08\x08\x00\x60\x13\x00\x63\xa3\x8e\x28\x94\x79"
+	"\x41\x2a\x78\xc2\x91\x70\x9f\xaa\x6a\x21\x7a\xa1\xaa\x0c";
+
+/* zstd -19: 200 random bytes, stored as a raw block */
+static const char zstd_raw[] =
+	"\x28\xb5\x2f\xfd\x04\x68\x41\x06\x00\x8c\x21\xff\x72\xed\xd7\x18"
+	"\xd9\x4e\x13\x95\x13\xdc\x1b\x63\xfc\x93\x06\xf6\xbf\x9c\xe5\x06"
+	"\xe0\x6d\xb0\x0a\x05\x9f\xf2\x75\x87\x8e\x34\xb3\xbc\xb3\x2b\xe2"
+	"\x02\xc0\xa1\x51\x8c\x80\x23\xb9\xec\x6d\x6f\x3d\x64\x0e\x9c\x23"
+	"\xec\x17\x07\x50\x03\x3f\x01\x85\x36\xdf\x3a\x5c\x71\x4f\xec\x00"
+	"\x09\x00\xc7\xaf\x85\x59\xa0\xf1\x30\x53\xd8\x95\x5f\xd3\x8d\x70"
+	"\x82\xca\x83\xd5\xed\x0f\xd1\xd3\x64\xf7\x4b\x31\x68\xba\xb3\x2b"
+	"\x44\x85\x9e\xe9\xd6\x5e\x28\xc3\x1e\xbc\x57\x37\x88\xe2\x50\xa6"
+	"\xf9\xff\x3c\xd1\x9c\x07\xf7\x17\x69\x4f\x7f\x6c\x7a\xeb\x17\x19"
+	"\x0d\xc7\x3e\x36\x58\x88\x53\xe7\x10\x20\x05\x59\xb8\x33\x7c\x7b"
+	"\xaa\x2d\x49\x7d\xe6\x20\x0e\x09\x9e\x5e\xed\x44\x7d\xda\xb1\x83"
+	"\xbb\x3f\xbf\xcd\xe2\xce\xbb\x15\x5d\xf8\xf9\x34\xc5\xbf\xaa\xa8"
+	"\xeb\xcd\xc3\x0f\xa5\x51\xac\x61\x59\x9d\xae\xf0\x4b\x81\x19\x21"
+	"\xa6\xbb\x17\x65\x3f";
+
+/* zstd -19 --long=18: the same 1000 random bytes 149000 bytes apart */
+static const char zstd_far[] =
+	"\x28\xb5\x2f\xfd\x04\x40\x9c\x1f\x00\x94\x3e\x8c\x21\xff\x72\xed"
+	"\xd7\x18\xd9\x4e\x13\x95\x13\xdc\x1b\x63\xfc\x93\x06\xf6\xbf\x9c"
+	"\xe5\x06\xe0\x6d\xb0\x0a\x05\x9f\xf2\x75\x87\x8e\x34\xb3\xbc\xb3"
+	"\x2b\xe2\x02\xc0\xa1\x51\x8c\x80\x23\xb9\xec\x6d\x6f\x3d\x64\x0e"
+	"\x9c\x23\xec\x17\x07\x50\x03\x3f\x01\x85\x36\xdf\x3a\x5c\x71\x4f"
+	"\xec\x00\x09\x00\xc7\xaf\x85\x59\xa0\xf1\x30\x53\xd8\x95\x5f\xd3"
+	"\x8d\x70\x82\xca\x83\xd5\xed\x0f\xd1\xd3\x64\xf7\x4b\x31\x68\xba"
+	"\xb3\x2b\x44\x85\x9e\xe9\xd6\x5e\x28\xc3\x1e\xbc\x57\x37\x88\xe2"
+	"\x50\xa6\xf9\xff\x3c\xd1\x9c\x07\xf7\x17\x69\x4f\x7f\x6c\x7a\xeb"
+	"\x17\x19\x0d\xc7\x3e\x36\x58\x88\x53\xe7\x10\x20\x05\x59\xb8\x33"
+	"\x7c\x7b\xaa\x2d\x49\x7d\xe6\x20\x0e\x09\x9e\x5e\xed\x44\x7d\xda"
+	"\xb1\x83\xbb\x3f\xbf\xcd\xe2\xce\xbb\x15\x5d\xf8\xf9\x34\xc5\xbf"
+	"\xaa\xa8\xeb\xcd\xc3\x0f\xa5\x51\xac\x61\x59\x9d\xae\xf0\x4b\x81"
+	"\x19\x21\xa6\x65\x38\xe8\x4c\x28\xf6\x05\x5d\xbc\x4c\x00\x89\x7d"
+	"\x72\xe5\x16\x56\xc1\xc0\xb0\x92\x6a\xd7\xf4\x83\xd9\xaa\xbb\xd5"
+	"\xe7\xab\x26\xaf\xc2\xbd\x6e\x8f\x9c\x6e\x69\xe2\x16\xf5\xdb\x66"
+	"\x6b\xea\x82\x40\x5d\xc7\xdf\xdd\xe0\x23\xc6\x89\x87\xa8\xa5\xd0"
+	"\xb2\xd9\x94\x98\x75\x86\x20\xfa\x47\x0a\xd7\xe5\x6f\x4b\x93\x71"
+	"\x2e\x6f\x87\x04\xad\x5e\x0b\x27\xa5\xfc\x27\x26\xd0\x23\xe1\x69"
+	"\x13\x63\x47\x95\x68\x79\x3b\x62\x8d\x90\x01\x3a\x6e\x39\x89\x97"
+	"\x53\x2c\x7d\x1a\xc9\xbc\x0b\x6a\x52\x1c\x6f\xd2\xcc\x54\x47\x99"
+	"\xa1\x01\x96\x20\xb4\xcf\x95\xbe\x07\xb7\x3e\x5c\x2c\xf9\x96\xcf"
+	"\x71\xd9\xbd\xf8\xcb\x19\xb6\x9d\x7e\x39\xf7\x06\x92\x71\xb0\x57"
+	"\xf6\x6a\xdc\xb1\x71\xc0\x08\x07\x4c\x39\xe6\xc0\xc1\xc2\x91\x11"
+	"\x22\x2d\x9e\x19\xc9\xad\xe6\xb9\xc3\x0d\x16\x39\x3b\xb3\xf3\x9c"
+	"\xa8\x58\x6e\xbf\xb6\x84\x6b\x34\xf5\xcc\x51\xe0\x44\xcc\x52\x56"
+	"\xfb\xe2\x77\xf2\xdb\xaf\x73\xb6\xb7\x4e\x24\xe4\xdf\x52\xe8\x5f"
+	"\x4f\x82\xa5\xc2\x9c\x54\x97\x3d\x9a\x2a\xd8\x34\xce\x4e\xb1\x96"
+	"\x97\xaf\xa2\xfd\x1b\x59\x33\x8a\xf2\xb6\x79\x7e\x95\x86\x67\x99"
+	"\x85\x9f\xda\x33\x3b\x66\x62\x1b\xd3\x09\xd1\x33\x77\x82\x86\xc8"
+	"\x8c\x4b\x77\xb2\x9f\xe1\x00\x2f\x0e\xfb\x6d\x80\x76\x87\x48\x41"
+	"\xe0\x69\x64\x89\xaa\xf2\xa6\xc6\x37\x22\x96\x55\x56\x9e\xa9\xe4"
+	"\x73\x70\x4c\x88\x80\x81\xb0\x9d\xa1\xd6\x58\x61\x9a\x8d\x64\x4f"
+	"\xf9\x96\x9b\x3d\x02\x32\x3a\x34\x5f\x2d\x7e\x13\x84\xdb\xf3\xe2"
+	"\xe4\xd4\x7b\xf7\xd5\x6f\x1d\xcb\x44\xff\x93\x9a\x18\xd0\x92\xbc"
+	"\x67\xe0\xd7\xc6\x5b\x5d\xf6\x60\xe2\xe3\xe2\xe4\x19\x72\x3b\xbc"
+	"\x76\x30\x5b\x78\xb7\xe4\x1e\xb1\x8e\x2e\x75\xa2\x09\x88\xaa\x7f"
+	"\xc3\xfd\x70\x9c\xcd\xab\xb2\x3f\x5a\xfa\x18\x41\x2c\x99\x59\x67"
+	"\xc2\x3d\x43\x82\x3e\x18\x8c\x48\x18\x1b\x56\xf1\x85\xec\x84\x91"
+	"\xa5\xa6\xbf\x38\x6f\x54\x46\xcb\x5d\x2b\x7a\xa1\xd6\x89\x25\xdd"
+	"\x5f\xb1\x8e\x8e\x82\x44\x3d\x88\x7a\x7e\x8e\x00\xa3\x36\xf8\xe9"
+	"\xa4\x94\x1b\x12\x5a\x8f\x8b\xfc\x83\x2e\x5f\x7c\x2f\x7a\x77\x15"
+	"\xe7\x45\x91\x13\x9a\x9e\x0b\x67\x4b\x0f\x76\x46\x7d\x9d\xdf\x80"
+	"\x5a\x7d\xdc\xa1\xa5\x96\x58\xc9\x66\xba\x1f\x4b\x4f\xa4\x28\x08"
+	"\xf0\xb1\xa6\x8a\x9f\x5f\xcd\xe0\x25\x86\x64\x3c\x28\x58\x0f\x4d"
+	"\x5c\x1a\x5a\x5d\x6a\x9f\x85\x2a\x9c\x89\x12\x86\x4d\x3f\x0f\xae"
+	"\x12\xad\x23\x6a\xa8\xbf\x5b\xe8\x9d\x9b\xb2\x59\xbf\xa1\x62\x49"
+	"\x45\x23\xed\xbf\xbf\xe4\xea\x18\xbd\x52\x90\xa4\x42\x83\x04\xfd"
+	"\xe7\xf1\x62\x2b\xcf\xf6\x8d\x79\x4e\x06\xb7\x15\x58\xae\xaf\x6b"
+	"\xab\x50\xee\x3e\xbc\x9b\x5f\x8b\x63\xcd\xf2\x1d\x45\xa8\xdf\xef"
+	"\x05\x35\xba\x46\x2a\x3c\x3c\x8b\xce\x7e\xcb\xe9\x0c\xb8\xce\xab"
+	"\x27\x59\xb3\x53\x7a\xfe\xbd\x79\x24\xb1\x8e\x6a\x6f\xe6\x78\x7c"
+	"\x05\x31\x84\x33\xd1\xc8\x3e\x15\xb6\xbd\x46\x4d\xf3\xf8\x98\x02"
+	"\x51\xf5\x96\x75\x12\x43\xdb\xdd\x99\xb8\xbe\x02\xd8\x75\xa8\x9b"
+	"\x7e\x9d\x16\x68\xde\xd4\x6d\x0f\x9e\x79\x81\xb8\x24\xa4\xe3\x67"
+	"\xc0\xde\xee\x1c\x99\xa3\x90\xac\x59\x98\xd9\x5e\x98\x8c\x46\x45"
+	"\x09\x31\xca\x60\x67\x97\xa0\x72\x1d\x6c\xd3\xa2\xb8\xf5\x89\xd3"
+	"\x0d\xcb\x14\xc1\x2a\x56\xb7\xe0\xfd\x0b\x38\xf5\xc6\x65\x29\x70"
+	"\x3e\xa4\xf7\x90\x85\x48\xaf\x35\xcc\x4c\x94\x84\xc7\x23\x61\x3d"
+	"\xd0\x74\x5e\xdc\xdb\x94\x25\x71\x1d\xc7\x31\x3f\x7b\x36\x2b\x17"
+	"\xb5\xb0\xf5\x72\x4f\x21\x73\x51\x43\xd3\x1c\xd5\x68\x66\x43\x9d"
+	"\xa0\x90\x26\xe3\xc4\x95\xb3\x56\x51\x85\x1e\xb5\xcf\x39\x24\x30"
+	"\x05\x0b\x1c\x7e\xde\x58\xc2\xbd\x19\xb7\xc3\x0e\xb4\xf6\x08\xec"
+	"\x16\xd9\xc2\x00\x01\x00\xe9\x29\xf8\x73\x90\x06\x6d\x00\x00\x00"
+	"\x02\x00\xe5\x17\x8c\xc4\x0a\x0a\x8c\x1d\x00\x01\xdc\xe1\x66\xbb";
+
+/* A skippable frame, which goes between the frames of the concatenated test */
+static const char zstd_skippable[] = "\x50\x2a\x4d\x18\x05\x00\x00\x00hello";
+
 
 #define TEST_BUFFER_SIZE	512
 
@@ -282,6 +446,87 @@ static int uncompress_using_lz4(void *in, unsigned long in_size,
 	return (ret != 0);
 }
 
+static int compress_using_zstd(void *in, unsigned long in_size,
+			       void *out, unsigned long out_max,
+			       unsigned long *out_size)
+{
+	/* There is no zstd compression in u-boot, so fake it. */
+	assert(in_size == strlen(plain));
+	assert(memcmp(plain, in, in_size) == 0);
+
+	if (zstd_compressed_size > out_max)
+		return -1;
+
+	memcpy(out, zstd_compressed, zstd_compressed_size);
+	if (out_size)
+		*out_size = zstd_compressed_size;
+
+	return 0;
+}
+
+static int uncompress_using_zstd(void *in, unsigned long in_size,
+				 void *out, unsigned long out_max,
+				 unsigned long *out_size)
+{
+	int ret;
+	size_t output_size = out_max;
+
+	ret = zstd_decompress(in, in_size, out, &output_size);
+	if (out_size)
+		*out_size = output_size;
+
+	return (ret != 0);
+}
+
+/* Stream the data through the decoder a few bytes at a time */
+static int uncompress_using_zstd_stream(void *in, unsigned long in_size,
+					void *out, unsigned long out_max,
+					unsigned long *out_size)
+{
+	struct zstd_stream *zs;
+	struct zstd_in zin = { .src = in };
+	struct zstd_out zout = { .dst = out };
+	int ret;
+
+	zs = zstd_stream_create(0);
+	if (!zs)
+		return -ENOMEM;
+	do {
+		zin.size = min(zin.size + 1, (size_t)in_size);
+		zout.size = min(zout.size + 7, (size_t)out_max);
+		ret = zstd_stream_decompress(zs, &zin, &zout);
+	} while (!ret && (zin.size < in_size || zout.size < out_max));
+	zstd_stream_free(zs);
+	if (out_size)
+		*out_size = zout.pos;
+
+	return (ret != 1);
+}
+
+/* Stream the data through the decoder in 64KB pieces, as a loader would */
+static int uncompress_using_zstd_stream_bulk(void *in, unsigned long in_size,
+					     void *out, unsigned long out_max,
+					     unsigned long *out_size)
+{
+	struct zstd_stream *zs;
+	struct zstd_in zin = { .src = in };
+	struct zstd_out zout = { .dst = out };
+	int ret;
+
+	zs = zstd_stream_create(0);
+	if (!zs)
+		return -ENOMEM;
+	do {
+		zin.size = min(zin.size + 0x10000, (size_t)in_size);
+		zout.size = min(zout.size + 0x10000, (size_t)out_max);
+		ret = zstd_stream_decompress(zs, &zin, &zout);
+	} while (!ret && (zin.size < in_size || zout.size < out_max));
+	zstd_stream_free(zs);
+	*out_size = zout.pos;
+
+	return ret < 0 ? ret : 0;
+}
+
 #define errcheck(statement) if (!(statement)) { \
 	fprintf(stderr, "\tFailed: %s\n", #statement); \
 	ret = 1; \
@@ -371,16 +616,282 @@ out:
 	return ret;
 }
 
+#define ZSTD_MAX_SIZE	0x50000
+#define ZSTD_GUARD	16
+
+/* Fill @buf with text, replacing every @mark'th byte by @mark_byte or noise */
+static void zstd_fill_text(char *buf, int size, int mark, int mark_byte)
+{
+	uint seed = 1;
+	int i;
+
+	for (i = 0; i < size; i++) {
+		if (i % mark) {
+			buf[i] = plain[i % (sizeof(plain) - 1)];
+		} else if (mark_byte < 0) {
+			seed = seed * 1103515245 + 12345;
+			buf[i] = seed >> 16;
+		} else {
+			buf[i] = mark_byte;
+		}
+	}
+}
+
+static int zstd_fill_multi(char *buf)
+{
+	zstd_fill_text(buf, 0x20000, 4099, -1);
+	memset(buf + 0x20000, 'x', 0x20000);
+	zstd_fill_text(buf + 0x40000, 40000, 997, 0xff);
+
+	return 0x40000 + 40000;
+}
+
+static int zstd_fill_nocheck(char *buf)
+{
+	memcpy(buf, plain, sizeof(plain) - 1);
+
+	return sizeof(plain) - 1;
+}
+
+static int zstd_fill_raw(char *buf)
+{
+	ut_fill_random(buf, 200, 2);
+
+	return 200;
+}
+
+static int zstd_fill_far(char *buf)
+{
+	ut_fill_random(buf, 1000, 2);
+	memset(buf + 1000, '\0', 148000);
+	memcpy(buf + 149000, buf, 1000);
+
+	return 150000;
+}
+
+static int zstd_fill_concat(char *buf)
+{
+	int size = zstd_fill_nocheck(buf);
+
+	return size + zstd_fill_raw(buf + size);
+}
+
+/**
+ * struct zstd_vector - A zstd test vector
+ *
+ * @name: Name to print
+ * @data: Compressed data, or NULL for the no-check frame, a skippable frame
+ *	and the raw-block frame one after the other
+ * @size: Size of @data in bytes
+ * @checksum: true if every frame has a content checksum, so that corrupt
+ *	data must not decompress successfully to the wrong output
+ * @fill: Function to write the decompressed data and return its size
+ */
+static const struct zstd_vector {
+	const char *name;
+	const char *data;
+	int size;
+	bool checksum;
+	int (*fill)(char *buf);
+} zstd_vectors[] = {
+	{ "multi-block", zstd_multi, sizeof(zstd_multi) - 1, true,
+		zstd_fill_multi },
+	{ "no checksum", zstd_nocheck, sizeof(zstd_nocheck) - 1, false,
+		zstd_fill_nocheck },
+	{ "raw block", zstd_raw, sizeof(zstd_raw) - 1, true, zstd_fill_raw },
+	{ "256KB window", zstd_far, sizeof(zstd_far) - 1, true,
+		zstd_fill_far },
+	{ "concatenated", NULL, 0, false, zstd_fill_concat },
+};
+
+static int zstd_get_src(const struct zstd_vector *vec, char *buf)
+{
+	int size;
+
+	if (vec->data) {
+		memcpy(buf, vec->data, vec->size);
+		return vec->size;
+	}
+	size = sizeof(zstd_nocheck) - 1;
+	memcpy(buf, zstd_nocheck, size);
+	memcpy(buf + size, zstd_skippable, sizeof(zstd_skippable) - 1);
+	size += sizeof(zstd_skippable) - 1;
+	memcpy(buf + size, zstd_raw, sizeof(zstd_raw) - 1);
+
+	return size + sizeof(zstd_raw) - 1;
+}
+
+/*
+ * Stream all the frames in @src through the decoder, offering @step more
+ * bytes of input and output space each time. Returns 0 if every frame was
+ * completed, -ENODATA if the decoder wants more input than there is, or the
+ * decoder's error.
+ */
+static int zstd_stream_all(const char *src, size_t srcn, char *dst,
+			   size_t *dstn, size_t step)
+{
+	struct zstd_stream *zs;
+	struct zstd_in zin = { .src = src };
+	struct zstd_out zout = { .dst = dst };
+	int ret;
+
+	zs = zstd_stream_create(0);
+	if (!zs)
+		return -ENOMEM;
+	do {
+		zin.size = min(zin.size + step, srcn);
+		zout.size = min(zout.size + step, *dstn);
+		ret = zstd_stream_decompress(zs, &zin, &zout);
+		if (!ret && zin.size == srcn && zout.size == *dstn) {
+			ret = -ENODATA;
+			break;
+		}
+	} while (ret >= 0 && (ret != 1 || zin.pos < srcn));
+	zstd_stream_free(zs);
+	*dstn = zout.pos;
+
+	return ret < 0 ? ret : 0;
+}
+
+/* Check that the decoder has not written past @size bytes of @buf */
+static bool zstd_guard_ok(const char *buf, size_t size)
+{
+	int i;
+
+	for (i = 0; i < ZSTD_GUARD; i++) {
+		if (buf[size + i] != 'A')
+			return false;
+	}
+
+	return true;
+}
+
+static int run_zstd_vector_test(const struct zstd_vector *vec)
+{
+	static const size_t steps[] = { 1, 7, 4096, 70000 };
+	char *expect, *out, *src, *bad;
+	size_t expect_size, src_size, size;
+	int ret, i, n;
+
+	printf(" testing zstd %s ...\n", vec->name);
+	expect = malloc(ZSTD_MAX_SIZE);
+	out = malloc(ZSTD_MAX_SIZE + ZSTD_GUARD);
+	src = malloc(4096);
+	bad = malloc(4096);
+	errcheck(expect && out && src && bad);
+	expect_size = vec->fill(expect);
+	src_size = zstd_get_src(vec, src);
+
+	/* Exactly the right amount of space, and one byte too little */
+	memset(out, 'A', expect_size + ZSTD_GUARD);
+	size = expect_size;
+	errcheck(zstd_decompress(src, src_size, out, &size) == 0);
+	errcheck(size == expect_size);
+	errcheck(memcmp(out, expect, expect_size) == 0);
+	errcheck(zstd_guard_ok(out, expect_size));
+	memset(out, 'A', expect_size + ZSTD_GUARD);
+	size = expect_size - 1;
+	errcheck(zstd_decompress(src, src_size, out, &size) == -ENOBUFS);
+	errcheck(zstd_guard_ok(out, expect_size - 1));
+
+	for (i = 0; i < ARRAY_SIZE(steps); i++) {
+		memset(out, 'A', expect_size + ZSTD_GUARD);
+		size = expect_size;
+		errcheck(zstd_stream_all(src, src_size, out, &size,
+					 steps[i]) == 0);
+		errcheck(size == expect_size);
+		errcheck(memcmp(out, expect, expect_size) == 0);
+		errcheck(zstd_guard_ok(out, expect_size));
+	}
+	printf("\tdecompresses in one go and streamed\n");
+
+	/*
+	 * Truncated input must give an error. The input is placed at the end
+	 * of its buffer so that a read past it is a read past the allocation,
+	 * which valgrind catches. The concatenated frames are skipped, since
+	 * they are valid when cut at a frame boundary.
+	 */
+	for (n = 0; vec->data && n < src_size; n++) {
+		memcpy(bad + 4096 - n, src, n);
+		size = expect_size;
+		ret = zstd_decompress(bad + 4096 - n, n, out, &size);
+		if (ret >= 0)
+			printf("\ttruncated to %d bytes: %d\n", n, ret);
+		errcheck(ret < 0);
+		errcheck(zstd_guard_ok(out, expect_size));
+		size = expect_size;
+		errcheck(zstd_stream_all(bad + 4096 - n, n, out, &size,
+					 4096) < 0);
+	}
+	printf("\ttruncated input fails\n");
+
+	/*
+	 * Flipping bits anywhere must either fail or, without a checksum to
+	 * catch it, produce something. It must never read or write out of
+	 * bounds.
+	 */
+	for (n = 0; n < src_size * 2; n++) {
+		memcpy(bad + 4096 - src_size, src, src_size);
+		bad[4096 - src_size + n / 2] ^= n & 1 ? 0xff : 0x01;
+		memset(out, 'A', expect_size + ZSTD_GUARD);
+		size = expect_size;
+		ret = zstd_decompress(bad + 4096 - src_size, src_size, out,
+				      &size);
+		if (ret && ret != -EINVAL && ret != -ENOBUFS &&
+		    ret != -EPROTONOSUPPORT && ret != -ENOMEM)
+			printf("\tbyte %d ^ %#x: %d\n", n / 2, n & 1 ? 0xff : 1,
+			       ret);
+		errcheck(!ret || ret == -EINVAL || ret == -ENOBUFS ||
+			 ret == -EPROTONOSUPPORT || ret == -ENOMEM);
+		errcheck(size <= expect_size);
+		errcheck(zstd_guard_ok(out, expect_size));
+		if (!ret && vec->checksum) {
+			if (size != expect_size ||
+			    memcmp(out, expect, expect_size))
+				printf("\tbyte %d ^ %#x: wrong output\n", n / 2,
+				       n & 1 ? 0xff : 1);
+			errcheck(size == expect_size);
+			errcheck(memcmp(out, expect, expect_size) == 0);
+		}
+		memset(out, 'A', expect_size + ZSTD_GUARD);
+		size = expect_size;
+		ret = zstd_stream_all(bad + 4096 - src_size, src_size, out,
+				      &size, 4096);
+		errcheck(size <= expect_size);
+		errcheck(zstd_guard_ok(out, expect_size));
+		if (!ret && vec->checksum)
+			errcheck(memcmp(out, expect, expect_size) == 0);
+	}
+	printf("\tcorrupt input fails safely\n");
+
+	ret = 0;
+out:
+	printf(" zstd %s: %s\n", vec->name, ret == 0 ? "ok" : "FAILED");
+
+	free(bad);
+	free(src);
+	free(out);
+	free(expect);
+
+	return ret;
+}
+
 static int do_ut_compression(cmd_tbl_t *cmdtp, int flag, int argc,
 			     char *const argv[])
 {
 	int err = 0;
+	int i;
 
 	err += run_test("gzip", compress_using_gzip, uncompress_using_gzip);
 	err += run_test("bzip2", compress_using_bzip2, uncompress_using_bzip2);
 	err += run_test("lzma", compress_using_lzma, uncompress_using_lzma);
 	err += run_test("lzo", compress_using_lzo, uncompress_using_lzo);
 	err += run_test("lz4", compress_using_lz4, uncompress_using_lz4);
+	err += run_test("zstd", compress_using_zstd, uncompress_using_zstd);
+	err += run_test("zstd stream", compress_using_zstd,
+			uncompress_using_zstd_stream);
+	for (i = 0; i < ARRAY_SIZE(zstd_vectors); i++)
+		err += run_zstd_vector_test(&zstd_vectors[i]);
 
 	printf("ut_compression %s\n", err == 0 ? "ok" : "FAILED");
 
@@ -448,6 +959,125 @@ static int run_bootm_test(int comp_type, mutate_func compress)
 	return 0;
 }
 
+#ifdef CONFIG_FIT_STREAM
+/* Addresses of the FIT and load area for the streaming tests */
+#define STREAM_FIT_ADDR		0x10000
+#define STREAM_LOAD_ADDR	0x20000
+
+static long stream_read(struct fit_stream_src *src, ulong offset, ulong size,
+			void *buf)
+{
+	memmove(buf, map_sysmem(src->addr + offset, size), size);
+
+	return size;
+}
+
+/* Create a FIT at STREAM_FIT_ADDR with external data, returning its size */
+static int make_stream_fit(const char *comp, const void *data, ulong size)
+{
+	u32 crc = cpu_to_uimage(crc32(0, data, size));
+	void *fit = map_sysmem(STREAM_FIT_ADDR, 0);
+	int ret, fit_size;
+
+	ret = fdt_create(fit, 0x1000);
+	ret |= fdt_finish_reservemap(fit);
+	ret |= fdt_begin_node(fit, "");
+	ret |= fdt_property_string(fit, FIT_DESC_PROP, "stream test");
+	ret |= fdt_property_u32(fit, FIT_TIMESTAMP_PROP, 0);
+	ret |= fdt_begin_node(fit, "images");
+	ret |= fdt_begin_node(fit, "kernel@1");
+	ret |= fdt_property_string(fit, FIT_TYPE_PROP, "kernel");
+	ret |= fdt_property_string(fit, FIT_COMP_PROP, comp);
+	ret |= fdt_property_u32(fit, FIT_LOAD_PROP, STREAM_LOAD_ADDR);
+	ret |= fdt_property_u32(fit, "data-offset", 0);
+	ret |= fdt_property_u32(fit, "data-size", size);
+	ret |= fdt_begin_node(fit, "hash@1");
+	ret |= fdt_property_string(fit, FIT_ALGO_PROP, "crc32");
+	ret |= fdt_property(fit, FIT_VALUE_PROP, &crc, sizeof(crc));
+	ret |= fdt_end_node(fit);
+	ret |= fdt_end_node(fit);
+	ret |= fdt_end_node(fit);
+	ret |= fdt_begin_node(fit, "configurations");
+	ret |= fdt_property_string(fit, FIT_DEFAULT_PROP, "conf@1");
+	ret |= fdt_begin_node(fit, "conf@1");
+	ret |= fdt_property_string(fit, FIT_KERNEL_PROP, "kernel@1");
+	ret |= fdt_end_node(fit);
+	ret |= fdt_end_node(fit);
+	ret |= fdt_end_node(fit);
+	ret |= fdt_finish(fit);
+	if (ret)
+		return -EINVAL;
+	fit_size = ALIGN(fdt_totalsize(fit), 4);
+	memcpy(fit + fit_size, data, size);
+
+	return fit_size;
+}
+
+/**
+ * run_fit_stream_test() - Test loading a FIT image with fit_stream_load()
+ *
+ * @comp_type:	Compression type to test
+ * @compress:	Our function to compress data
+ * @return 0 if OK, non-zero on failure
+ */
+static int run_fit_stream_test(int comp_type, mutate_func compress)
+{
+	ulong compress_size = 1024, unc_len = strlen(plain), load, len;
+	struct fit_stream_src src;
+	char data[1024], *fit;
+	int data_offset, ret;
+
+	printf("Testing stream: %s\n", genimg_get_comp_name(comp_type));
+	compress((void *)plain, unc_len, data, compress_size, &compress_size);
+	data_offset = make_stream_fit(genimg_get_comp_short_name(comp_type), data,
+				      compress_size);
+	if (data_offset < 0)
+		return data_offset;
+	fit = map_sysmem(STREAM_FIT_ADDR, 0);
+	memset(&src, '\0', sizeof(src));
+	src.read = stream_read;
+	src.addr = STREAM_FIT_ADDR;
+	src.chunk_size = 16;
+
+	/* load to the address in the FIT */
+	load = FIT_STREAM_LOAD_DEFAULT;
+	memset(map_sysmem(STREAM_LOAD_ADDR, 0), '\0', unc_len + 1);
+	ret = fit_stream_load(&src, NULL, &load, 0x1000, &len);
+	if (ret || load != STREAM_LOAD_ADDR || len != unc_len ||
+	    memcmp(map_sysmem(load, 0), plain, unc_len + 1))
+		return -EINVAL;
+
+	/* the output space is checked */
+	ret = fit_stream_load(&src, "kernel@1", &load, unc_len - 1, &len);
+	if (ret != -ENOBUFS)
+		return -EINVAL;
+
+	/* the hash is checked */
+	fit[data_offset + compress_size - 1] ^= 1;
+	ret = fit_stream_load(&src, NULL, &load, 0x1000, &len);
+	fit[data_offset + compress_size - 1] ^= 1;
+	if (!ret)
+		return -EINVAL;
+
+	/* the output may overlap the image data it has already read */
+	src.size = data_offset + compress_size;
+	load = STREAM_FIT_ADDR + data_offset + 8 - unc_len;
+	ret = fit_stream_load(&src, NULL, &load, 0x1000, &len);
+	if (ret || memcmp(map_sysmem(load, 0), plain, unc_len))
+		return -EINVAL;
+
+	/* but must not get ahead of it */
+	make_stream_fit(genimg_get_comp_short_name(comp_type), data,
+			compress_size);
+	load = STREAM_FIT_ADDR + data_offset;
+	ret = fit_stream_load(&src, NULL, &load, 0x1000, &len);
+	if (comp_type == IH_COMP_NONE ? ret : ret != -EFAULT)
+		return -EINVAL;
+
+	return 0;
+}
+#endif
+
 static int do_ut_image_decomp(cmd_tbl_t *cmdtp, int flag, int argc,
 			      char *const argv[])
 {
@@ -458,19 +1088,89 @@ static int do_ut_image_decomp(cmd_tbl_t *cmdtp, int flag, int argc,
 	err |= run_bootm_test(IH_COMP_LZMA, compress_using_lzma);
 	err |= run_bootm_test(IH_COMP_LZO, compress_using_lzo);
 	err |= run_bootm_test(IH_COMP_LZ4, compress_using_lz4);
+	err |= run_bootm_test(IH_COMP_ZSTD, compress_using_zstd);
 	err |= run_bootm_test(IH_COMP_NONE, compress_using_none);
+#ifdef CONFIG_FIT_STREAM
+	err |= run_fit_stream_test(IH_COMP_NONE, compress_using_none);
+	err |= run_fit_stream_test(IH_COMP_GZIP, compress_using_gzip);
+	err |= run_fit_stream_test(IH_COMP_ZSTD, compress_using_zstd);
+#endif
 
 	printf("ut_image_decomp %s\n", err == 0 ? "ok" : "FAILED");
 
 	return 0;
 }
 
+static const struct {
+	const char *name;
+	mutate_func uncompress;
+} bench_funcs[] = {
+	{ "gzip", uncompress_using_gzip },
+	{ "bzip2", uncompress_using_bzip2 },
+	{ "lzma", uncompress_using_lzma },
+	{ "lzo", uncompress_using_lzo },
+	{ "lz4", uncompress_using_lz4 },
+	{ "zstd", uncompress_using_zstd },
+	{ "zstd-stream", uncompress_using_zstd_stream_bulk },
+};
+
+/*
+ * Decompress a memory region repeatedly for at least a second and report
+ * the output rate, so that formats can be compared on real images
+ */
+static int do_ut_decomp_bench(cmd_tbl_t *cmdtp, int flag, int argc,
+			      char *const argv[])
+{
+	ulong src_size, dst_size, out_size, start, us;
+	void *src, *dst;
+	u64 bytes = 0;
+	int i, ret;
+
+	if (argc != 6)
+		return CMD_RET_USAGE;
+	for (i = 0; i < ARRAY_SIZE(bench_funcs); i++) {
+		if (!strcmp(argv[1], bench_funcs[i].name))
+			break;
+	}
+	if (i == ARRAY_SIZE(bench_funcs)) {
+		printf("Unknown format '%s'\n", argv[1]);
+		return CMD_RET_FAILURE;
+	}
+	src_size = simple_strtoul(argv[3], NULL, 16);
+	dst_size = simple_strtoul(argv[5], NULL, 16);
+	src = map_sysmem(simple_strtoul(argv[2], NULL, 16), src_size);
+	dst = map_sysmem(simple_strtoul(argv[4], NULL, 16), dst_size);
+
+	start = timer_get_us();
+	do {
+		out_size = dst_size;
+		ret = bench_funcs[i].uncompress(src, src_size, dst, dst_size,
+						&out_size);
+		if (ret) {
+			printf("%s: uncompress error %d\n", argv[1], ret);
+			return CMD_RET_FAILURE;
+		}
+		bytes += out_size;
+		us = timer_get_us() - start;
+	} while (us < 1000000);
+	printf("%s: %lu -> %lu bytes, %lu MB/s\n", argv[1], src_size,
+	       out_size, (ulong)lldiv(bytes, us));
+
+	return CMD_RET_SUCCESS;
+}
+
 U_BOOT_CMD(
 	ut_compression,	5,	1,	do_ut_compression,
-	"Basic test of compressors: gzip bzip2 lzma lzo", ""
+	"Basic test of compressors: gzip bzip2 lzma lzo lz4 zstd", ""
 );
 
 U_BOOT_CMD(
 	ut_image_decomp,	5,	1, do_ut_image_decomp,
 	"Basic test of bootm decompression", ""
 );
+
+U_BOOT_CMD(
+	ut_decomp_bench,	6,	1, do_ut_decomp_bench,
+	"Measure decompression throughput",
+	"<gzip|bzip2|lzma|lzo|lz4|zstd|zstd-stream> srcaddr srcsize dstaddr dstsize"
+);
@@ -6,6 +6,8 @@
 
 #include <common.h>
 #include <dm.h>
+#include <os.h>
+#include <sandboxblockdev.h>
 #include <usb.h>
 #include <asm/state.h>
 #include <dm/test.h>
@@ -94,3 +96,234 @@ static int dm_test_blk_usb(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_usb, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Check reading and writing a host device in the given mode */
+static int check_host_mode(struct unit_test_state *uts, const char *fname,
+			   enum host_block_mode mode, u8 *buf, u8 *cmp)
+{
+	struct host_block_dev *host_dev;
+	struct blk_desc *desc;
+	int i;
+
+	ut_assertok(host_dev_bind_mode(0, (char *)fname, mode));
+	ut_assertok(blk_get_device_by_str("host", "0", &desc));
+	ut_asserteq(64, desc->lba);
+	host_dev = dev_get_priv(desc->bdev);
+	ut_asserteq(mode, host_dev->mode);
+
+	/* Ignore the reads done while looking for a partition table */
+	memset(&host_dev->stats, '\0', sizeof(host_dev->stats));
+
+	/* Use a buffer which is not aligned, to exercise O_DIRECT bouncing */
+	for (i = 0; i < 8 * 512; i++)
+		buf[i + 1] = i + mode;
+	ut_asserteq(8, blk_dwrite(desc, 4, 8, buf + 1));
+	memset(cmp, '\0', 8 * 512);
+	ut_asserteq(8, blk_dread(desc, 4, 8, cmp));
+	ut_assertok(memcmp(buf + 1, cmp, 8 * 512));
+
+	/* Transfers stop at the end of the file */
+	ut_asserteq(2, blk_dread(desc, 62, 8, cmp));
+
+	ut_asserteq(2, host_dev->stats.reads);
+	ut_asserteq(10, host_dev->stats.read_blocks);
+	ut_asserteq(1, host_dev->stats.writes);
+	ut_asserteq(8, host_dev->stats.write_blocks);
+	ut_asserteq(0, host_dev->stats.errors);
+
+	return 0;
+}
+
+/* Check each access mode on the host file @fname, then its final contents */
+static int check_host_file(struct unit_test_state *uts, const char *fname,
+			   u8 *buf, u8 *cmp)
+{
+	int fd, mode;
+
+	for (mode = HOST_BLOCK_PREAD; mode <= HOST_BLOCK_MMAP; mode++)
+		ut_assertok(check_host_mode(uts, fname, mode, buf, cmp));
+
+	/* The data written by the last mode is in the file */
+	ut_assertok(host_dev_bind(0, NULL));
+	fd = os_open(fname, OS_O_RDONLY);
+	ut_assert(fd >= 0);
+	ut_asserteq(8 * 512, os_pread(fd, cmp, 8 * 512, 4 * 512));
+	os_close(fd);
+	ut_assertok(memcmp(buf + 1, cmp, 8 * 512));
+
+	return 0;
+}
+
+/* Test host devices in each access mode */
+static int dm_test_blk_host(struct unit_test_state *uts)
+{
+	char fname[] = "/tmp/u-boot.blk.XXXXXX";
+	u8 *buf, *cmp;
+	int fd, i, ret;
+
+	buf = memalign(4096, 8 * 512 + 1);
+	cmp = memalign(4096, 8 * 512);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(cmp);
+
+	/* A 32KiB backing file, removed even if the test fails */
+	memset(cmp, '\0', 8 * 512);
+	fd = os_mkstemp(fname);
+	ut_assert(fd >= 0);
+	for (i = 0; i < 8; i++)
+		ut_asserteq(8 * 512, os_write(fd, cmp, 8 * 512));
+	os_close(fd);
+
+	ret = check_host_file(uts, fname, buf, cmp);
+	host_dev_bind(0, NULL);
+	os_unlink(fname);
+	free(buf);
+	free(cmp);
+
+	return ret;
+}
+DM_TEST(dm_test_blk_host, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#ifdef CONFIG_BLOCK_CACHE
+/* A 4MiB device, four times the size of a 1MiB cache */
+#define CACHE_TEST_BLKS		8192
+#define CACHE_TEST_LINE_BLKS	8
+
+static u8 cache_test_byte(lbaint_t blk, int i)
+{
+	return blk * 7 + i;
+}
+
+static void cache_test_fill(u8 *buf, lbaint_t start, lbaint_t count)
+{
+	int i;
+
+	for (i = 0; i < count * 512; i++)
+		buf[i] = cache_test_byte(start + i / 512, i);
+}
+
+static int cache_test_check(u8 *buf, lbaint_t start, lbaint_t count)
+{
+	int i;
+
+	for (i = 0; i < count * 512; i++) {
+		if (buf[i] != cache_test_byte(start + i / 512, i))
+			return -EIO;
+	}
+
+	return 0;
+}
+
+/* Read @count blocks at @start through the cache and check the data */
+static int cache_test_read(struct unit_test_state *uts, struct blk_desc *desc,
+			   lbaint_t start, lbaint_t count, u8 *buf)
+{
+	memset(buf, '\0', count * 512);
+	ut_asserteq(count, blk_dread(desc, start, count, buf));
+	ut_assertok(cache_test_check(buf, start, count));
+
+	return 0;
+}
+
+static int check_blk_cache(struct unit_test_state *uts, const char *fname,
+			   u8 *buf)
+{
+	struct block_cache_stats stats;
+	struct host_block_stats *host;
+	struct host_block_dev *host_dev;
+	struct blk_desc *desc;
+	lbaint_t blk, lba;
+	ulong reads;
+
+	ut_assertok(host_dev_bind(0, (char *)fname));
+	ut_assertok(blk_get_device_by_str("host", "0", &desc));
+	lba = desc->lba;
+	ut_asserteq(CACHE_TEST_BLKS, lba);
+	host_dev = dev_get_priv(desc->bdev);
+	host = &host_dev->stats;
+
+	/* Without read-ahead, reading the same blocks again is a hit */
+	blkcache_configure(1, 0);
+	reads = host->reads;
+	ut_assertok(cache_test_read(uts, desc, 16, 8, buf));
+	ut_assertok(cache_test_read(uts, desc, 16, 8, buf));
+	ut_assertok(cache_test_read(uts, desc, 18, 2, buf));
+	ut_asserteq(reads + 1, host->reads);
+	blkcache_stats(&stats);
+	ut_asserteq(2, stats.hits);
+	ut_asserteq(1, stats.misses);
+
+	/* Reading the whole device evicts lines; what is left is correct */
+	for (blk = 0; blk < lba; blk += CACHE_TEST_LINE_BLKS)
+		ut_assertok(cache_test_read(uts, desc, blk,
+					    CACHE_TEST_LINE_BLKS, buf));
+	blkcache_stats(&stats);
+	ut_asserteq(256, stats.max_entries);
+	ut_asserteq(lba / CACHE_TEST_LINE_BLKS,
+		    stats.entries + stats.evictions);
+	ut_assert(stats.evictions >= lba / CACHE_TEST_LINE_BLKS -
+		  stats.max_entries);
+	for (blk = 0; blk < lba; blk += CACHE_TEST_LINE_BLKS)
+		ut_assertok(cache_test_read(uts, desc, blk,
+					    CACHE_TEST_LINE_BLKS, buf));
+	reads = host->reads;
+	ut_assertok(cache_test_read(uts, desc, lba - CACHE_TEST_LINE_BLKS,
+				    CACHE_TEST_LINE_BLKS, buf));
+	ut_asserteq(reads, host->reads);
+
+	/*
+	 * The third sequential read starts a 16KiB read-ahead, which is
+	 * clipped at the end of the device
+	 */
+	blkcache_configure(1, 16);
+	blkcache_stats(&stats);
+	reads = host->reads;
+	for (blk = lba - 6; blk < lba; blk++)
+		ut_assertok(cache_test_read(uts, desc, blk, 1, buf));
+	ut_asserteq(reads + 3, host->reads);
+	blkcache_stats(&stats);
+	ut_asserteq(1, stats.readaheads);
+	ut_asserteq(3, stats.hits);
+	ut_asserteq(3, stats.misses);
+
+	/* Sequential reads off the end do not read ahead */
+	reads = host->reads;
+	ut_asserteq(0, blk_dread(desc, lba, 1, buf));
+	blk_dread(desc, lba + 1, 1, buf);
+	ut_asserteq(reads + 2, host->reads);
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.readaheads);
+
+	return 0;
+}
+
+/* Test the block cache: hits, eviction and read-ahead */
+static int dm_test_blk_cache(struct unit_test_state *uts)
+{
+	char fname[] = "/tmp/u-boot.blk.XXXXXX";
+	lbaint_t blk;
+	u8 *buf;
+	int fd, ret;
+
+	buf = memalign(4096, CACHE_TEST_LINE_BLKS * 512);
+	ut_assertnonnull(buf);
+	fd = os_mkstemp(fname);
+	ut_assert(fd >= 0);
+	for (blk = 0; blk < CACHE_TEST_BLKS; blk += CACHE_TEST_LINE_BLKS) {
+		cache_test_fill(buf, blk, CACHE_TEST_LINE_BLKS);
+		ut_asserteq(CACHE_TEST_LINE_BLKS * 512,
+			    os_write(fd, buf, CACHE_TEST_LINE_BLKS * 512));
+	}
+	os_close(fd);
+
+	ret = check_blk_cache(uts, fname, buf);
+	host_dev_bind(0, NULL);
+	os_unlink(fname);
+	free(buf);
+	blkcache_configure(CONFIG_BLOCK_CACHE_SIZE,
+			   CONFIG_BLOCK_CACHE_READAHEAD);
+
+	return ret;
+}
+DM_TEST(dm_test_blk_cache, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
@@ -11,6 +11,7 @@
 #include <dm.h>
 #include <fdtdec.h>
 #include <malloc.h>
+#include <mapmem.h>
 #include <dm/device-internal.h>
 #include <dm/root.h>
 #include <dm/util.h>
@@ -499,6 +500,106 @@ static int dm_test_leak(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_leak, 0);
 
+#ifdef CONFIG_SYS_MALLOC_F_POOL
+#define PRE_RELOC_MALLOC_LEN	0x1000
+
+static struct driver_info driver_info_leak = {
+	.name = "test_drv",
+	.platdata = &test_pdata[0],
+};
+
+/* Bind a device, probe and remove all the test devices, then unbind it */
+static int probe_remove_devices(struct unit_test_state *uts)
+{
+	struct dm_test_state *dms = uts->priv;
+	struct udevice *dev, *extra;
+	int i;
+
+	ut_assertok(device_bind_by_name(dms->root, false, &driver_info_leak,
+					&extra));
+	for (i = 0; i < 4; i++)
+		ut_assertok(uclass_get_device(UCLASS_TEST, i, &dev));
+	for (i = 0; i < 4; i++) {
+		ut_assertok(uclass_find_device(UCLASS_TEST, i, &dev));
+		ut_assertok(device_remove(dev));
+	}
+	ut_assertok(device_unbind(extra));
+
+	return 0;
+}
+
+static int pre_reloc_leak_check(struct unit_test_state *uts)
+{
+	void *ptr, *keep;
+	size_t peak;
+	ulong used;
+	int i;
+
+	/* The last block goes back to the top, others are reused */
+	ptr = malloc(20);
+	keep = malloc(20);
+	ut_assertnonnull(ptr);
+	ut_assertnonnull(keep);
+	used = gd->malloc_ptr;
+	free(malloc(300));
+	ut_asserteq(used, gd->malloc_ptr);
+	free(ptr);
+	ut_asserteq(used, gd->malloc_ptr);
+	ut_asserteq_ptr(ptr, malloc(32));
+	free(ptr);
+	free(keep);
+	ut_assert(gd->malloc_ptr < used);
+
+	ut_assertok(probe_remove_devices(uts));
+	used = gd->malloc_ptr;
+	peak = malloc_simple_peak();
+	ut_assert(peak >= used);
+
+	for (i = 0; i < 10; i++) {
+		ut_assertok(probe_remove_devices(uts));
+		ut_asserteq(used, gd->malloc_ptr);
+		ut_asserteq(peak, malloc_simple_peak());
+	}
+
+	return 0;
+}
+
+/* Probing and removing devices before relocation should not use up memory */
+static int dm_test_leak_pre_reloc(struct unit_test_state *uts)
+{
+	ulong base, limit, ptr;
+	void *buf;
+	int ret;
+
+	buf = malloc(PRE_RELOC_MALLOC_LEN);
+	ut_assertnonnull(buf);
+
+	/* Whatever outlives the devices must use the full malloc() */
+	ut_assertok(probe_remove_devices(uts));
+
+	/* Switch to a fresh pre-relocation malloc() area */
+	base = gd->malloc_base;
+	limit = gd->malloc_limit;
+	ptr = gd->malloc_ptr;
+	gd->malloc_base = map_to_sysmem(buf);
+	gd->malloc_limit = PRE_RELOC_MALLOC_LEN;
+	gd->malloc_ptr = 0;
+	gd->flags &= ~GD_FLG_FULL_MALLOC_INIT;
+
+	ret = pre_reloc_leak_check(uts);
+
+	gd->flags |= GD_FLG_FULL_MALLOC_INIT;
+	gd->malloc_base = base;
+	gd->malloc_limit = limit;
+	gd->malloc_ptr = ptr;
+	free(buf);
+	ut_assertok(ret);
+
+	return 0;
+}
+DM_TEST(dm_test_leak_pre_reloc, DM_TESTF_SCAN_PDATA);
+#endif
+
 /* Test uclass init/destroy methods */
 static int dm_test_uclass(struct unit_test_state *uts)
 {
@@ -0,0 +1,98 @@
+/*
+ * Tests for the CRC32 implementations
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <dm/test.h>
+#include <test/ut.h>
+#include <u-boot/crc.h>
+
+#define TEST_BUF_SIZE	4096
+
+static u8 test_buf[TEST_BUF_SIZE];
+
+/* Find the byte-wise implementation, which the others are checked against */
+static const struct crc32_impl *get_reference(void)
+{
+	const struct crc32_impl *impl, *ref = NULL;
+	int i;
+
+	for (i = 0; (impl = crc32_get_impl(i)); i++)
+		ref = impl;
+
+	return ref;
+}
+
+/* Test each implementation and crc32() against known values */
+static int dm_test_crc32_known(struct unit_test_state *uts)
+{
+	static const struct {
+		const char *str;
+		uint32_t crc;
+	} vectors[] = {
+		{ "", 0 },
+		{ "a", 0xe8b7be43 },
+		{ "123456789", 0xcbf43926 },
+		{ "The quick brown fox jumps over the lazy dog", 0x414fa339 },
+	};
+	const struct crc32_impl *impl;
+	uint32_t crc;
+	int i, j;
+
+	for (i = 0; (impl = crc32_get_impl(i)); i++) {
+		if (impl->available && !impl->available())
+			continue;
+		for (j = 0; j < ARRAY_SIZE(vectors); j++) {
+			crc = impl->calc(~0U, (const u8 *)vectors[j].str,
+					 strlen(vectors[j].str)) ^ ~0U;
+			ut_assertf(crc == vectors[j].crc, "%s: '%s' gives %08x",
+				   impl->name, vectors[j].str, crc);
+		}
+	}
+	ut_asserteq(0xcbf43926, crc32(0, (const u8 *)"123456789", 9));
+
+	return 0;
+}
+DM_TEST(dm_test_crc32_known, 0);
+
+/* Test each implementation against the byte-wise one */
+static int dm_test_crc32_reference(struct unit_test_state *uts)
+{
+	const struct crc32_impl *impl, *ref = get_reference();
+	const u8 *buf = test_buf;
+	uint32_t expect, crc;
+	int i, align, len, split;
+
+	ut_fill_random(test_buf, TEST_BUF_SIZE, 1);
+	for (i = 0; (impl = crc32_get_impl(i)); i++) {
+		if (impl->available && !impl->available())
+			continue;
+
+		/* Every alignment with lengths around the block sizes */
+		for (align = 0; align < 16; align++) {
+			for (len = 0; len < 80; len++) {
+				expect = ref->calc(align, buf + align, len);
+				crc = impl->calc(align, buf + align, len);
+				ut_assertf(crc == expect,
+					   "%s: align %d len %d: %08x, expected %08x",
+					   impl->name, align, len, crc,
+					   expect);
+			}
+		}
+
+		/* A CRC built up from pieces must match the whole buffer's */
+		len = TEST_BUF_SIZE - 16;
+		expect = ref->calc(~0U, buf + 3, len);
+		for (split = 1; split < len; split = split * 3 + 1) {
+			crc = impl->calc(~0U, buf + 3, split);
+			crc = impl->calc(crc, buf + 3 + split, len - split);
+			ut_assertf(crc == expect, "%s: split at %d: %08x",
+				   impl->name, split, crc);
+		}
+	}
+
+	return 0;
+}
+DM_TEST(dm_test_crc32_reference, 0);
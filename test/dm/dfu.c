@@ -0,0 +1,142 @@
+/*
+ * Tests for DFU writes and their statistics, using a RAM entity
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <dfu.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <asm/test.h>
+#include <dm/test.h>
+#include <test/ut.h>
+#include <u-boot/crc.h>
+
+#define TEST_ADDR	0x4000000
+#define TEST_SIZE	(4 << 20)
+#define TEST_CHUNK	4096
+
+/* Writing to the medium is modelled on the sandbox timer at this rate */
+#define MEDIUM_KB_PER_MS	8
+
+static int (*ram_write_medium)(struct dfu_entity *dfu, u64 offset,
+			       void *buf, long *len);
+static u64 fail_offset;
+static u32 last_crc;
+
+static int test_write_medium(struct dfu_entity *dfu, u64 offset, void *buf,
+			     long *len)
+{
+	if (offset + *len > fail_offset)
+		return -EIO;
+	/* The data is hashed before it is written */
+	last_crc = dfu->crc;
+	sandbox_timer_add_offset(DIV_ROUND_UP(*len, MEDIUM_KB_PER_MS << 10));
+
+	return ram_write_medium(dfu, offset, buf, len);
+}
+
+/* Send @size bytes from @src in DFU-sized chunks */
+static int dfu_test_transfer(const u8 *src, int size, struct dfu_stats *stats)
+{
+	struct dfu_entity *dfu;
+	char str[40];
+	int i, ret;
+
+	snprintf(str, sizeof(str), "image ram %x %x", TEST_ADDR, TEST_SIZE);
+	setenv("dfu_alt_info", str);
+	ret = dfu_init_env_entities("ram", "0");
+	if (ret)
+		return ret;
+	dfu = dfu_get_entity(0);
+	ram_write_medium = dfu->write_medium;
+	dfu->write_medium = test_write_medium;
+
+	for (i = 0; i * TEST_CHUNK < size; i++) {
+		ret = dfu_write(dfu, (void *)src + i * TEST_CHUNK,
+				min(TEST_CHUNK, size - i * TEST_CHUNK), i);
+		if (ret)
+			goto out;
+	}
+	ret = dfu_flush(dfu, NULL, 0, i);
+	*stats = dfu->stats;
+out:
+	dfu_free_entities();
+	setenv("dfu_alt_info", NULL);
+
+	return ret;
+}
+
+/* Test that the data and checksum come out right */
+static int dm_test_dfu_data(struct unit_test_state *uts)
+{
+	const int size = TEST_SIZE - 1234;
+	struct dfu_stats stats;
+	u8 *src, *dst;
+
+	src = malloc(size);
+	ut_assertnonnull(src);
+	ut_fill_random(src, size, 1);
+	dst = map_sysmem(TEST_ADDR, TEST_SIZE);
+	memset(dst, '\0', TEST_SIZE);
+	fail_offset = ~0ULL;
+
+	setenv("dfu_hash_algo", "crc32");
+	ut_assertok(dfu_test_transfer(src, size, &stats));
+	setenv("dfu_hash_algo", NULL);
+	ut_assertok(memcmp(src, dst, size));
+	ut_asserteq(crc32(0, src, size), last_crc);
+	free(src);
+
+	return 0;
+}
+DM_TEST(dm_test_dfu_data, 0);
+
+/* Test the statistics kept for the entity */
+static int dm_test_dfu_stats(struct unit_test_state *uts)
+{
+	const int size = TEST_SIZE - 1234;
+	const ulong buf_us = 1000 * (CONFIG_SYS_DFU_DATA_BUF_SIZE >> 10) /
+			     MEDIUM_KB_PER_MS;
+	struct dfu_stats stats;
+	u8 *src;
+
+	src = malloc(size);
+	ut_assertnonnull(src);
+	ut_fill_random(src, size, 1);
+	fail_offset = ~0ULL;
+	ut_assertok(dfu_test_transfer(src, size, &stats));
+	free(src);
+
+	/* One write per buffer; each full one takes buf_us to write */
+	ut_asserteq(size, stats.bytes);
+	ut_asserteq(DIV_ROUND_UP(size, CONFIG_SYS_DFU_DATA_BUF_SIZE),
+		    stats.writes);
+	ut_assert(stats.max_write_us >= buf_us);
+	ut_assert(stats.write_us >= (size >> 10) * 1000 / MEDIUM_KB_PER_MS);
+	ut_assert(stats.total_us >= stats.write_us);
+
+	return 0;
+}
+DM_TEST(dm_test_dfu_stats, 0);
+
+/* Test that a failed write is reported */
+static int dm_test_dfu_error(struct unit_test_state *uts)
+{
+	const int size = TEST_SIZE - 1234;
+	struct dfu_stats stats;
+	u8 *src;
+	int ret;
+
+	src = malloc(size);
+	ut_assertnonnull(src);
+	ut_fill_random(src, size, 1);
+	fail_offset = 1 << 20;
+	ret = dfu_test_transfer(src, size, &stats);
+	free(src);
+	ut_asserteq(-EIO, ret);
+
+	return 0;
+}
+DM_TEST(dm_test_dfu_error, 0);
@@ -11,6 +11,7 @@
 #include <dm.h>
 #include <fdtdec.h>
 #include <malloc.h>
+#include <mapmem.h>
 #include <net.h>
 #include <dm/test.h>
 #include <dm/device-internal.h>
@@ -259,3 +260,97 @@ static int dm_test_net_retry(struct unit_test_state *uts)
 	return retval;
 }
 DM_TEST(dm_test_net_retry, DM_TESTF_SCAN_FDT);
+
+/* Fetch a file from the mock TFTP server and check what was loaded */
+static int sb_tftp_get(struct unit_test_state *uts,
+		       struct sandbox_eth_tftp *tftp, const char *windowsize)
+{
+	const ulong addr = 0x100000;
+	uchar *buf;
+	ulong i;
+
+	setenv("tftpwindowsize", windowsize);
+	tftp->data_sent = 0;
+	tftp->acks = 0;
+	load_addr = addr;
+	copy_filename(net_boot_file_name, "window.bin",
+		      sizeof(net_boot_file_name));
+	ut_asserteq(tftp->file_size, net_loop(TFTPGET));
+
+	buf = map_sysmem(addr, tftp->file_size);
+	for (i = 0; i < tftp->file_size; i++) {
+		if (buf[i] != sandbox_eth_tftp_byte(i))
+			break;
+	}
+	unmap_sysmem(buf);
+	ut_asserteq(tftp->file_size, i);
+
+	return 0;
+}
+
+/* The asserts include a return on fail; cleanup in the caller */
+static int _dm_test_eth_tftp_window(struct unit_test_state *uts,
+				    struct sandbox_eth_tftp *tftp)
+{
+	ulong blocks;
+
+	setenv("ethact", "eth@10002000");
+	setenv("tftpblocksize", "1024");
+	tftp->file_size = 300 * 1024 + 123;
+	blocks = tftp->file_size / 1024 + 1;
+
+	/* Lock-step: one ACK per block, plus the one for the OACK */
+	tftp->max_window = 16;
+	ut_assertok(sb_tftp_get(uts, tftp, "1"));
+	ut_asserteq(blocks, tftp->data_sent);
+	ut_asserteq(blocks + 1, tftp->acks);
+
+	/* One ACK per window of 8 blocks */
+	ut_assertok(sb_tftp_get(uts, tftp, "8"));
+	ut_asserteq(blocks, tftp->data_sent);
+	ut_asserteq(DIV_ROUND_UP(blocks, 8) + 1, tftp->acks);
+
+	/* A server without windowsize support falls back to lock-step */
+	tftp->max_window = 0;
+	ut_assertok(sb_tftp_get(uts, tftp, "8"));
+	ut_asserteq(blocks + 1, tftp->acks);
+
+	/* The server may grant a smaller window than requested */
+	tftp->max_window = 4;
+	ut_assertok(sb_tftp_get(uts, tftp, "8"));
+	ut_asserteq(DIV_ROUND_UP(blocks, 4) + 1, tftp->acks);
+
+	/* Out-of-order blocks are kept, a lost one is resent */
+	tftp->max_window = 16;
+	tftp->reorder = true;
+	tftp->drop_block = 37;
+	ut_assertok(sb_tftp_get(uts, tftp, "16"));
+	ut_assert(tftp->data_sent > blocks);
+
+	/* Past the 16-bit block number wrap, with a small block size */
+	setenv("tftpblocksize", "8");
+	tftp->file_size = 0x10010 * 8 + 5;
+	tftp->drop_block = 0x10003;
+	ut_assertok(sb_tftp_get(uts, tftp, "16"));
+
+	return 0;
+}
+
+static int dm_test_eth_tftp_window(struct unit_test_state *uts)
+{
+	struct sandbox_eth_tftp tftp = { };
+	int retval;
+
+	net_server_ip = string_to_ip("1.1.2.2");
+	sandbox_eth_set_tftp(&tftp);
+	retval = _dm_test_eth_tftp_window(uts, &tftp);
+
+	/* Restore the env */
+	sandbox_eth_set_tftp(NULL);
+	setenv("tftpwindowsize", NULL);
+	setenv("tftpblocksize", NULL);
+	setenv("ethact", NULL);
+
+	return retval;
+}
+DM_TEST(dm_test_eth_tftp_window, DM_TESTF_SCAN_FDT);
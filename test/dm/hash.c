@@ -0,0 +1,200 @@
+/*
+ * Tests for the SHA-1 and SHA-256 implementations
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <dm/test.h>
+#include <test/ut.h>
+#include <u-boot/sha1.h>
+#include <u-boot/sha256.h>
+
+#define TEST_BLOCKS	40
+
+static u8 test_buf[TEST_BLOCKS * 64 + 8];
+
+/* Messages from FIPS 180-2 appendices A and B */
+static const char *const test_msg[] = {
+	"abc",
+	"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+	"",
+};
+
+static const uint8_t sha1_expect[][SHA1_SUM_LEN] = {
+	{ 0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81, 0x6a, 0xba, 0x3e,
+	  0x25, 0x71, 0x78, 0x50, 0xc2, 0x6c, 0x9c, 0xd0, 0xd8, 0x9d },
+	{ 0x84, 0x98, 0x3e, 0x44, 0x1c, 0x3b, 0xd2, 0x6e, 0xba, 0xae,
+	  0x4a, 0xa1, 0xf9, 0x51, 0x29, 0xe5, 0xe5, 0x46, 0x70, 0xf1 },
+	{ 0xda, 0x39, 0xa3, 0xee, 0x5e, 0x6b, 0x4b, 0x0d, 0x32, 0x55,
+	  0xbf, 0xef, 0x95, 0x60, 0x18, 0x90, 0xaf, 0xd8, 0x07, 0x09 },
+};
+
+static const uint8_t sha256_expect[][SHA256_SUM_LEN] = {
+	{ 0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40,
+	  0xde, 0x5d, 0xae, 0x22, 0x23, 0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17,
+	  0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad },
+	{ 0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26,
+	  0x93, 0x0c, 0x3e, 0x60, 0x39, 0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff,
+	  0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1 },
+	{ 0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14, 0x9a, 0xfb, 0xf4,
+	  0xc8, 0x99, 0x6f, 0xb9, 0x24, 0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b,
+	  0x93, 0x4c, 0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55 },
+};
+
+static const uint32_t sha1_iv[5] = {
+	0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0,
+};
+
+static const uint32_t sha256_iv[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+	0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+/* Pad a short message into one or two blocks, returning the block count */
+static int pad_msg(const char *msg, uint8_t block[128])
+{
+	int len = strlen(msg);
+	int blocks = len < 56 ? 1 : 2;
+	u64 bits = (u64)len * 8;
+	int i;
+
+	memset(block, '\0', 128);
+	memcpy(block, msg, len);
+	block[len] = 0x80;
+	for (i = 0; i < 8; i++)
+		block[blocks * 64 - 1 - i] = bits >> (i * 8);
+
+	return blocks;
+}
+
+static void put_be32(uint8_t *out, uint32_t val)
+{
+	out[0] = val >> 24;
+	out[1] = val >> 16;
+	out[2] = val >> 8;
+	out[3] = val;
+}
+
+/* Test each SHA-1 block function against FIPS 180-2 and the C code */
+static int dm_test_hash_sha1(struct unit_test_state *uts)
+{
+	const struct sha1_impl *impl, *ref = NULL;
+	unsigned long state[5], ref_state[5];
+	uint8_t block[128], digest[SHA1_SUM_LEN];
+	int i, j, k, n;
+
+	/* The last one is the C code */
+	for (i = 0; (impl = sha1_get_impl(i)); i++)
+		ref = impl;
+	ut_fill_random(test_buf, sizeof(test_buf), 2);
+
+	for (i = 0; (impl = sha1_get_impl(i)); i++) {
+		if (impl->available && !impl->available())
+			continue;
+		for (j = 0; j < ARRAY_SIZE(test_msg); j++) {
+			n = pad_msg(test_msg[j], block);
+			for (k = 0; k < 5; k++)
+				state[k] = sha1_iv[k];
+			impl->process(state, block, n);
+			for (k = 0; k < 5; k++)
+				put_be32(digest + k * 4, state[k]);
+			ut_assertf(!memcmp(digest, sha1_expect[j],
+					   SHA1_SUM_LEN),
+				   "%s: wrong digest for '%s'", impl->name,
+				   test_msg[j]);
+		}
+
+		/* Multi-block runs at odd alignments */
+		for (n = 1; n <= TEST_BLOCKS; n += 3) {
+			for (j = 0; j < 5; j++) {
+				state[j] = sha1_iv[j] + n;
+				ref_state[j] = state[j];
+			}
+			impl->process(state, test_buf + (n & 7), n);
+			ref->process(ref_state, test_buf + (n & 7), n);
+			for (j = 0; j < 5; j++)
+				ut_assertf((uint32_t)state[j] ==
+					   (uint32_t)ref_state[j],
+					   "%s: %d blocks: state mismatch",
+					   impl->name, n);
+		}
+	}
+
+	return 0;
+}
+DM_TEST(dm_test_hash_sha1, 0);
+
+/* Test each SHA-256 block function against FIPS 180-2 and the C code */
+static int dm_test_hash_sha256(struct unit_test_state *uts)
+{
+	const struct sha256_impl *impl, *ref = NULL;
+	uint32_t state[8], ref_state[8];
+	uint8_t block[128], digest[SHA256_SUM_LEN];
+	int i, j, k, n;
+
+	/* The last one is the C code */
+	for (i = 0; (impl = sha256_get_impl(i)); i++)
+		ref = impl;
+	ut_fill_random(test_buf, sizeof(test_buf), 2);
+
+	for (i = 0; (impl = sha256_get_impl(i)); i++) {
+		if (impl->available && !impl->available())
+			continue;
+		for (j = 0; j < ARRAY_SIZE(test_msg); j++) {
+			n = pad_msg(test_msg[j], block);
+			memcpy(state, sha256_iv, sizeof(state));
+			impl->process(state, block, n);
+			for (k = 0; k < 8; k++)
+				put_be32(digest + k * 4, state[k]);
+			ut_assertf(!memcmp(digest, sha256_expect[j],
+					   SHA256_SUM_LEN),
+				   "%s: wrong digest for '%s'", impl->name,
+				   test_msg[j]);
+		}
+
+		for (n = 1; n <= TEST_BLOCKS; n += 3) {
+			for (j = 0; j < 8; j++)
+				state[j] = sha256_iv[j] + n;
+			memcpy(ref_state, state, sizeof(state));
+			impl->process(state, test_buf + (n & 7), n);
+			ref->process(ref_state, test_buf + (n & 7), n);
+			ut_assertf(!memcmp(state, ref_state, sizeof(state)),
+				   "%s: %d blocks: state mismatch", impl->name,
+				   n);
+		}
+	}
+
+	return 0;
+}
+DM_TEST(dm_test_hash_sha256, 0);
+
+/* Test the digest functions, which pick an implementation themselves */
+static int dm_test_hash_digest(struct unit_test_state *uts)
+{
+	const int len = TEST_BLOCKS * 64 - 5;
+	uint8_t digest[SHA256_SUM_LEN], expect[SHA256_SUM_LEN];
+	sha256_context ctx;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(test_msg); i++) {
+		sha1_csum((const unsigned char *)test_msg[i],
+			  strlen(test_msg[i]), digest);
+		ut_assert(!memcmp(digest, sha1_expect[i], SHA1_SUM_LEN));
+		sha256_csum_wd((const unsigned char *)test_msg[i],
+			       strlen(test_msg[i]), digest, CHUNKSZ_SHA256);
+		ut_assert(!memcmp(digest, sha256_expect[i], SHA256_SUM_LEN));
+	}
+
+	/* Uneven updates must give the same result as a single one */
+	ut_fill_random(test_buf, sizeof(test_buf), 2);
+	sha256_csum_wd(test_buf, len, expect, CHUNKSZ_SHA256);
+	sha256_starts(&ctx);
+	for (i = 0; i < len; i += 37)
+		sha256_update(&ctx, test_buf + i, min(37, len - i));
+	sha256_finish(&ctx, digest);
+	ut_assert(!memcmp(digest, expect, SHA256_SUM_LEN));
+
+	return 0;
+}
+DM_TEST(dm_test_hash_digest, 0);
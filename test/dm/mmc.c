@@ -6,7 +6,9 @@
 
 #include <common.h>
 #include <dm.h>
+#include <malloc.h>
 #include <mmc.h>
+#include <asm/test.h>
 #include <dm/test.h>
 #include <test/ut.h>
 
@@ -25,3 +27,151 @@ static int dm_test_mmc_base(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_mmc_base, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Initialise the emulated eMMC again, after changing its settings */
+static int reinit_mmc(struct mmc *mmc)
+{
+	mmc->has_init = 0;
+
+	return mmc_init(mmc);
+}
+
+/* Test that the fastest mode supported by both host and device is used */
+static int dm_test_mmc_modes(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+	struct mmc *mmc;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	ut_assertnonnull(mmc);
+	ut_assertok(reinit_mmc(mmc));
+	ut_asserteq(MMC_HS_200, mmc->selected_mode);
+	ut_asserteq(8, mmc->bus_width);
+	ut_asserteq(0, mmc->ddr_mode);
+	ut_asserteq(200000000, mmc->clock);
+	ut_asserteq(1 << 20, mmc->capacity);
+
+	/* Without HS200, DDR52 is next best */
+	sandbox_mmc_set_card_type(dev, EXT_CSD_CARD_TYPE_26 |
+				  EXT_CSD_CARD_TYPE_52 |
+				  EXT_CSD_CARD_TYPE_DDR_1_8V);
+	ut_assertok(reinit_mmc(mmc));
+	ut_asserteq(MMC_DDR_52, mmc->selected_mode);
+	ut_asserteq(8, mmc->bus_width);
+	ut_asserteq(1, mmc->ddr_mode);
+	ut_asserteq(52000000, mmc->clock);
+
+	sandbox_mmc_set_card_type(dev, EXT_CSD_CARD_TYPE_26 |
+				  EXT_CSD_CARD_TYPE_52);
+	ut_assertok(reinit_mmc(mmc));
+	ut_asserteq(MMC_HS_52, mmc->selected_mode);
+	ut_asserteq(0, mmc->ddr_mode);
+
+	sandbox_mmc_set_card_type(dev, EXT_CSD_CARD_TYPE_26);
+	ut_assertok(reinit_mmc(mmc));
+	ut_asserteq(MMC_HS, mmc->selected_mode);
+	ut_asserteq(26000000, mmc->clock);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_modes, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test that tuning picks a working phase, or falls back to DDR52 */
+static int dm_test_mmc_tuning(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+	struct mmc *mmc;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	ut_assertnonnull(mmc);
+	sandbox_mmc_set_tuning_window(dev, 2, 5);
+	ut_assertok(reinit_mmc(mmc));
+	ut_asserteq(MMC_HS_200, mmc->selected_mode);
+	ut_asserteq(3, sandbox_mmc_get_phase(dev));
+
+	/* No phase works, so HS200 cannot be used */
+	sandbox_mmc_set_tuning_window(dev, 1, 0);
+	ut_assertok(reinit_mmc(mmc));
+	ut_asserteq(MMC_DDR_52, mmc->selected_mode);
+	ut_asserteq(1, mmc->ddr_mode);
+	ut_asserteq(52000000, mmc->clock);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_tuning, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test limiting the bus mode */
+static int dm_test_mmc_max_mode(struct unit_test_state *uts)
+{
+	struct udevice *dev;
+	struct mmc *mmc;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	ut_assertnonnull(mmc);
+
+	mmc_set_max_mode(mmc, MMC_DDR_52);
+	ut_assertok(reinit_mmc(mmc));
+	ut_asserteq(MMC_DDR_52, mmc->selected_mode);
+
+	mmc_set_max_mode(mmc, MMC_HS_52);
+	ut_assertok(reinit_mmc(mmc));
+	ut_asserteq(MMC_HS_52, mmc->selected_mode);
+	ut_asserteq(8, mmc->bus_width);
+	ut_asserteq(0, mmc->ddr_mode);
+
+	mmc_set_max_mode(mmc, MMC_LEGACY);
+	ut_assertok(reinit_mmc(mmc));
+	ut_asserteq(MMC_LEGACY, mmc->selected_mode);
+	ut_asserteq(25000000, mmc->clock);
+
+	mmc_set_max_mode(mmc, MMC_MODES_END);
+	ut_assertok(reinit_mmc(mmc));
+	ut_asserteq(MMC_HS_200, mmc->selected_mode);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_max_mode, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test that data written in one mode can be read back in another */
+static int dm_test_mmc_rw(struct unit_test_state *uts)
+{
+	const int blocks = 4;
+	struct blk_desc *desc;
+	struct udevice *dev;
+	struct mmc *mmc;
+	char *buf, *cmp;
+	int i;
+
+	buf = malloc(blocks * 512);
+	cmp = malloc(blocks * 512);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(cmp);
+	for (i = 0; i < blocks * 512; i++)
+		buf[i] = i * 7;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	mmc = mmc_get_mmc_dev(dev);
+	ut_assertnonnull(mmc);
+	ut_assertok(reinit_mmc(mmc));
+	desc = &mmc->block_dev;
+	ut_asserteq(blocks, blk_dwrite(desc, 10, blocks, buf));
+
+	mmc_set_max_mode(mmc, MMC_DDR_52);
+	ut_assertok(reinit_mmc(mmc));
+	ut_asserteq(blocks, blk_dread(desc, 10, blocks, cmp));
+	ut_assertok(memcmp(buf, cmp, blocks * 512));
+
+	ut_asserteq(blocks, blk_derase(desc, 10, blocks));
+	ut_asserteq(blocks, blk_dread(desc, 10, blocks, cmp));
+	memset(buf, '\0', blocks * 512);
+	ut_assertok(memcmp(buf, cmp, blocks * 512));
+
+	free(buf);
+	free(cmp);
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_rw, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
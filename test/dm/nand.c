@@ -0,0 +1,99 @@
+/*
+ * Tests for the sandbox NAND simulator
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <malloc.h>
+#include <nand.h>
+#include <asm/test.h>
+#include <dm/test.h>
+#include <test/ut.h>
+
+/* Block used for testing, clear of the factory bad block in test.dts */
+#define TEST_BLOCK	8
+
+/* Test erase, program and read, with bitflips and failing blocks */
+static int dm_test_nand_sandbox(struct unit_test_state *uts)
+{
+	struct mtd_info *mtd = &nand_info[0];
+	struct sandbox_nand_stats *stats;
+	loff_t off;
+	size_t len;
+	u8 *buf, *cmp;
+	int page, i;
+
+	ut_assertok(sandbox_nand_reset(mtd));
+	stats = sandbox_nand_get_stats(mtd);
+	ut_assertnonnull(stats);
+	ut_asserteq(2048, mtd->writesize);
+	ut_asserteq(1, nand_block_isbad(mtd, 5 * mtd->erasesize));
+
+	off = TEST_BLOCK * mtd->erasesize;
+	page = off / mtd->writesize;
+	len = mtd->writesize * 2;
+	buf = malloc(len);
+	cmp = malloc(len);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(cmp);
+
+	/* The chip starts out erased */
+	memset(buf, 0xff, len);
+	ut_assertok(nand_read(mtd, off, &len, cmp));
+	ut_assertok(memcmp(buf, cmp, len));
+	ut_assertok(nand_erase(mtd, off, mtd->erasesize));
+	ut_asserteq(1, stats->erases);
+	ut_assertok(nand_read(mtd, off, &len, cmp));
+	ut_assertok(memcmp(buf, cmp, len));
+
+	/* Program two pages and read them back */
+	for (i = 0; i < len; i++)
+		buf[i] = i * 7;
+	ut_assertok(nand_write(mtd, off, &len, buf));
+	ut_asserteq(2, stats->programs);
+	ut_asserteq(len, stats->bytes_in);
+	ut_assertok(nand_read(mtd, off, &len, cmp));
+	ut_assertok(memcmp(buf, cmp, len));
+	ut_assert(stats->busy_ns > 0);
+
+	/* A few bitflips are corrected silently */
+	ut_assertok(sandbox_nand_set_bitflips(mtd, page, 2));
+	ut_assertok(nand_read(mtd, off, &len, cmp));
+	ut_assertok(memcmp(buf, cmp, len));
+	ut_assert(stats->corrected >= 2);
+
+	/* Near the ECC strength the read asks for scrubbing */
+	ut_assertok(sandbox_nand_set_bitflips(mtd, page, 7));
+	ut_asserteq(-EUCLEAN, nand_read(mtd, off, &len, cmp));
+	ut_assertok(memcmp(buf, cmp, len));
+
+	/* Beyond it the read fails */
+	ut_assertok(sandbox_nand_set_bitflips(mtd, page + 1, 20));
+	ut_asserteq(-EBADMSG, nand_read(mtd, off, &len, cmp));
+	ut_assert(stats->failed > 0);
+
+	/* A failing block cannot be erased; erasing otherwise clears flips */
+	ut_assertok(sandbox_nand_set_failing(mtd, TEST_BLOCK, true));
+	ut_assert(nand_erase(mtd, off, mtd->erasesize) != 0);
+	ut_assertok(sandbox_nand_set_failing(mtd, TEST_BLOCK, false));
+	ut_assertok(nand_erase(mtd, off, mtd->erasesize));
+	ut_assertok(nand_read(mtd, off, &len, cmp));
+	memset(buf, 0xff, len);
+	ut_assertok(memcmp(buf, cmp, len));
+
+	/* A reset undoes injected failures */
+	ut_assertok(sandbox_nand_set_failing(mtd, TEST_BLOCK, true));
+	ut_assertok(sandbox_nand_reset(mtd));
+	ut_assertok(nand_erase(mtd, off, mtd->erasesize));
+	ut_asserteq(1, stats->erases);
+	ut_asserteq(1, nand_block_isbad(mtd, 5 * mtd->erasesize));
+
+	ut_asserteq(-EINVAL, sandbox_nand_set_failing(mtd, 1 << 20, true));
+	free(cmp);
+	free(buf);
+
+	return 0;
+}
+DM_TEST(dm_test_nand_sandbox, 0);
@@ -7,11 +7,16 @@
 #include <common.h>
 #include <dm.h>
 #include <fdtdec.h>
+#include <malloc.h>
+#include <os.h>
 #include <spi.h>
 #include <spi_flash.h>
 #include <asm/state.h>
+#include <asm/test.h>
+#include <dm/lists.h>
 #include <dm/test.h>
 #include <dm/util.h>
+#include <linux/sizes.h>
 #include <test/ut.h>
 
 /* Test that sandbox SPI flash works correctly */
@@ -41,3 +46,179 @@ static int dm_test_spi_flash(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_spi_flash, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/*
+ * Attach a flash to chip select 1 of bus 0, using @spec (<id>:<file>) for
+ * the emulator. The file is created with the given size.
+ */
+static int sf_attach(struct unit_test_state *uts, const char *spec,
+		     ulong size, uint mode, uint mode_rx, struct udevice **devp)
+{
+	struct sandbox_state *state = state_get_current();
+	struct dm_spi_slave_platdata *plat;
+	struct udevice *bus, *dev;
+	char cmd[80];
+
+	snprintf(cmd, sizeof(cmd), "sb save hostfs - 0 %s %lx",
+		 strchr(spec, ':') + 1, size);
+	ut_assertok(run_command(cmd, 0));
+	state->spi[0][1].spec = spec;
+	ut_assertok(uclass_get_device_by_seq(UCLASS_SPI, 0, &bus));
+	ut_assertok(device_bind_driver(bus, "spi_flash_std", "flash", &dev));
+	plat = dev_get_parent_platdata(dev);
+	plat->cs = 1;
+	plat->mode = mode;
+	plat->mode_rx = mode_rx;
+	ut_assertok(spi_flash_probe_bus_cs(0, 1, 1000000, mode, devp));
+
+	return 0;
+}
+
+static void sf_detach(void)
+{
+	struct sandbox_state *state = state_get_current();
+
+	sandbox_sf_unbind_emul(state, 0, 1);
+	state->spi[0][1].spec = NULL;
+}
+
+/* Test that SFDP sets up a large flash to use 4-byte addresses */
+static int dm_test_spi_flash_sfdp(struct unit_test_state *uts)
+{
+	const u32 offset = SZ_16M - 0x80;
+	struct spi_flash *flash;
+	u8 buf[0x100], cmp[0x100];
+	struct udevice *dev;
+	int fd, i;
+
+	/* A 32MiB flash with a quad bus */
+	ut_assertok(sf_attach(uts, "w25q256:spi4b.bin", SZ_32M, SPI_TX_QUAD,
+			      SPI_RX_QUAD, &dev));
+
+	/* 4-byte quad output read, quad page program and 4KiB erase */
+	flash = dev_get_uclass_priv(dev);
+	ut_asserteq(SZ_32M, flash->size);
+	ut_asserteq(4, flash->addr_width);
+	ut_asserteq(0x6c, flash->read_cmd);
+	ut_asserteq(1, flash->dummy_byte);
+	ut_asserteq(0x34, flash->write_cmd);
+	ut_asserteq(0x21, flash->erase_cmd);
+	ut_asserteq(SZ_4K, flash->erase_size);
+	ut_asserteq(SZ_64K, flash->erase_types[1].size);
+	ut_asserteq(0xdc, flash->erase_types[1].cmd);
+
+	/* Write across the 16MiB boundary and check where it ends up */
+	for (i = 0; i < sizeof(buf); i++)
+		buf[i] = i;
+	ut_assertok(spi_flash_erase_dm(dev, SZ_16M - SZ_4K, 2 * SZ_4K));
+	ut_assertok(spi_flash_write_dm(dev, offset, sizeof(buf), buf));
+	memset(cmp, '\0', sizeof(cmp));
+	ut_assertok(spi_flash_read_dm(dev, offset, sizeof(cmp), cmp));
+	ut_assertok(memcmp(buf, cmp, sizeof(buf)));
+
+	fd = os_open("spi4b.bin", OS_O_RDONLY);
+	ut_assert(fd >= 0);
+	ut_asserteq(offset, os_lseek(fd, offset, OS_SEEK_SET));
+	ut_asserteq(sizeof(cmp), os_read(fd, cmp, sizeof(cmp)));
+	os_close(fd);
+	ut_assertok(memcmp(buf, cmp, sizeof(buf)));
+
+	sf_detach();
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_sfdp, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test erasing with large blocks and updating only what has changed */
+static int dm_test_spi_flash_update(struct unit_test_state *uts)
+{
+	struct sandbox_state *state = state_get_current();
+	const u32 offset = 0x800, len = 0x20000;
+	struct spi_flash_update_stats stats;
+	struct udevice *dev, *emul;
+	struct spi_flash *flash;
+	u8 *buf, *cmp;
+	int i;
+
+	ut_assertok(sf_attach(uts, "w25q32bv:spi-update.bin", SZ_4M, 0, 0,
+			      &dev));
+	flash = dev_get_uclass_priv(dev);
+	emul = state->spi[0][1].emul;
+	buf = malloc(SZ_256K);
+	cmp = malloc(SZ_256K);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(cmp);
+
+	/* 4KiB sectors, but aligned 64KiB blocks are erased in one go */
+	ut_asserteq(SZ_4K, flash->erase_size);
+	ut_assertok(spi_flash_erase_dm(dev, 0, SZ_256K));
+	ut_asserteq(4, sandbox_sf_get_erase_count(emul));
+	ut_assertok(spi_flash_erase_dm(dev, SZ_64K - SZ_4K, SZ_64K + SZ_8K));
+	ut_asserteq(4 + 3, sandbox_sf_get_erase_count(emul));
+
+	/* Erased flash only needs programming */
+	for (i = 0; i < len; i++)
+		buf[offset + i] = i * 7;
+	ut_assertok(spi_flash_update(flash, offset, len, buf + offset,
+				     0, &stats));
+	ut_asserteq(0, stats.skipped);
+	ut_asserteq(0, stats.erased);
+	ut_asserteq(len, stats.programmed);
+	ut_asserteq(7, sandbox_sf_get_erase_count(emul));
+
+	/* Writing the same data again does nothing */
+	ut_assertok(spi_flash_update(flash, offset, len, buf + offset,
+				     0, &stats));
+	ut_asserteq(len, stats.skipped);
+	ut_asserteq(0, stats.erased);
+	ut_asserteq(0, stats.programmed);
+
+	/* Setting a bit needs one sector erased and written back */
+	buf[0x10005] |= 0x80;
+	buf[0x10006] &= 0x7f;
+	ut_assertok(spi_flash_update(flash, offset, len, buf + offset,
+				     0, &stats));
+	ut_asserteq(len - SZ_4K, stats.skipped);
+	ut_asserteq(SZ_4K, stats.erased);
+	ut_asserteq(SZ_4K, stats.programmed);
+	ut_asserteq(8, sandbox_sf_get_erase_count(emul));
+
+	/*
+	 * Clearing a bit erases the sector too, unless the caller knows that
+	 * the flash allows a page to be programmed again
+	 */
+	buf[0x20005] = 0;
+	ut_assertok(spi_flash_update(flash, offset, len, buf + offset,
+				     0, &stats));
+	ut_asserteq(SZ_4K, stats.erased);
+	ut_asserteq(offset, stats.programmed);
+	ut_asserteq(9, sandbox_sf_get_erase_count(emul));
+	buf[0x20006] = 0;
+	ut_assertok(spi_flash_update(flash, offset, len, buf + offset,
+				     SPI_FLASH_UPDATE_NO_ERASE, &stats));
+	ut_asserteq(0, stats.erased);
+	ut_asserteq(flash->page_size, stats.programmed);
+	ut_asserteq(9, sandbox_sf_get_erase_count(emul));
+
+	/* A changed 64KiB block is erased with a single command */
+	for (i = SZ_64K; i < 2 * SZ_64K; i++)
+		buf[i] = ~buf[i];
+	ut_assertok(spi_flash_update(flash, offset, len, buf + offset,
+				     0, &stats));
+	ut_asserteq(len - SZ_64K, stats.skipped);
+	ut_asserteq(SZ_64K, stats.erased);
+	ut_asserteq(10, sandbox_sf_get_erase_count(emul));
+
+	/* Data around the region is kept */
+	memset(buf, 0xff, offset);
+	memset(buf + offset + len, 0xff, SZ_256K - offset - len);
+	ut_assertok(spi_flash_read_dm(dev, 0, SZ_256K, cmp));
+	ut_assertok(memcmp(buf, cmp, SZ_256K));
+
+	free(buf);
+	free(cmp);
+	sf_detach();
+
+	return 0;
+}
+DM_TEST(dm_test_spi_flash_update, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
@@ -0,0 +1,254 @@
+/*
+ * Tests for writing Android sparse images as they arrive
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <image-sparse.h>
+#include <dm/test.h>
+#include <test/ut.h>
+
+#define DISK_BLK_SZ	512
+#define DISK_SIZE	(512 << 10)
+#define DISK_START	8
+#define SPARSE_BLK_SZ	4096
+#define ERASED		0xa5
+
+/* Chunks of a test image, with sizes in sparse blocks */
+struct test_chunk {
+	int type;
+	int blocks;
+};
+
+/* Don't-care chunks only at the end, so store_sparse_image() agrees */
+static const struct test_chunk tail_chunks[] = {
+	{ CHUNK_TYPE_RAW, 3 },
+	{ CHUNK_TYPE_FILL, 2 },
+	{ CHUNK_TYPE_CRC32, 0 },
+	{ CHUNK_TYPE_RAW, 1 },
+	{ CHUNK_TYPE_FILL, 40 },
+	{ CHUNK_TYPE_RAW, 20 },
+	{ CHUNK_TYPE_DONT_CARE, 4 },
+};
+
+/* Don't-care chunks in the middle, which must leave blocks untouched */
+static const struct test_chunk mid_chunks[] = {
+	{ CHUNK_TYPE_DONT_CARE, 1 },
+	{ CHUNK_TYPE_RAW, 2 },
+	{ CHUNK_TYPE_DONT_CARE, 5 },
+	{ CHUNK_TYPE_FILL, 3 },
+	{ CHUNK_TYPE_CRC32, 0 },
+	{ CHUNK_TYPE_DONT_CARE, 1 },
+	{ CHUNK_TYPE_RAW, 18 },
+	{ CHUNK_TYPE_FILL, 1 },
+};
+
+/* A don't-care chunk which is made too big by the test */
+static const struct test_chunk skip_chunks[] = {
+	{ CHUNK_TYPE_DONT_CARE, 1 },
+	{ CHUNK_TYPE_RAW, 1 },
+};
+
+static char disk[DISK_SIZE], expect[DISK_SIZE], image[DISK_SIZE];
+
+static int test_write(struct sparse_storage *storage, void *priv,
+		      unsigned int offset, unsigned int size, char *data)
+{
+	if ((offset + size) * DISK_BLK_SZ > DISK_SIZE)
+		return -EIO;
+	memcpy(disk + offset * DISK_BLK_SZ, data, size * DISK_BLK_SZ);
+
+	return size;
+}
+
+static sparse_storage_t test_storage = {
+	.block_sz	= DISK_BLK_SZ,
+	.start		= DISK_START,
+	.size		= DISK_SIZE / DISK_BLK_SZ - DISK_START,
+	.name		= "test",
+	.write		= test_write,
+};
+
+/*
+ * Build a sparse image from @chunks in @image, and what it should leave on
+ * a disk which starts out erased in @expect. Returns the image size.
+ */
+static int build_image(const struct test_chunk *chunks, int count)
+{
+	sparse_header_t *header = (sparse_header_t *)image;
+	char *out = expect + DISK_START * DISK_BLK_SZ;
+	char *p = image + sizeof(*header);
+	int i, j, size;
+	u32 fill;
+
+	memset(expect, ERASED, DISK_SIZE);
+	memset(header, '\0', sizeof(*header));
+	header->magic = SPARSE_HEADER_MAGIC;
+	header->major_version = 1;
+	header->file_hdr_sz = sizeof(*header);
+	header->chunk_hdr_sz = sizeof(chunk_header_t);
+	header->blk_sz = SPARSE_BLK_SZ;
+	header->total_chunks = count;
+
+	for (i = 0; i < count; i++) {
+		chunk_header_t *chunk = (chunk_header_t *)p;
+
+		size = chunks[i].blocks * SPARSE_BLK_SZ;
+		chunk->chunk_type = chunks[i].type;
+		chunk->reserved1 = 0;
+		chunk->chunk_sz = chunks[i].blocks;
+		chunk->total_sz = sizeof(*chunk);
+		p += sizeof(*chunk);
+		switch (chunks[i].type) {
+		case CHUNK_TYPE_RAW:
+			ut_fill_random(p, size, i);
+			memcpy(out, p, size);
+			chunk->total_sz += size;
+			break;
+		case CHUNK_TYPE_FILL:
+			fill = 0x12345678 * (i + 1);
+			memcpy(p, &fill, sizeof(fill));
+			for (j = 0; j < size; j += sizeof(fill))
+				memcpy(out + j, &fill, sizeof(fill));
+			chunk->total_sz += sizeof(fill);
+			break;
+		case CHUNK_TYPE_CRC32:
+			/* The checksum is not checked */
+			memset(p, '\0', sizeof(u32));
+			chunk->total_sz += sizeof(u32);
+			break;
+		}
+		p += chunk->total_sz - sizeof(*chunk);
+		out += size;
+		header->total_blks += chunks[i].blocks;
+	}
+
+	return p - image;
+}
+
+/* Write @len bytes of @image to an erased disk in pieces of @piece bytes */
+static int stream_image(struct unit_test_state *uts, int len, int piece)
+{
+	struct sparse_stream ss;
+	int pos, n;
+
+	memset(disk, ERASED, DISK_SIZE);
+	ut_assertok(sparse_stream_start(&ss, &test_storage, NULL));
+	for (pos = 0; pos < len; pos += n) {
+		n = min(piece, len - pos);
+		ut_assertok(sparse_stream_write(&ss, image + pos, n));
+	}
+	ut_assertok(sparse_stream_finish(&ss));
+
+	return 0;
+}
+
+static const int pieces[] = { 1, 7, 4096, 70000 };
+
+/* Test sparse images of each chunk type, arriving in pieces of any size */
+static int dm_test_sparse_stream(struct unit_test_state *uts)
+{
+	int i, len;
+
+	/* Both writers must give the same result */
+	len = build_image(tail_chunks, ARRAY_SIZE(tail_chunks));
+	memset(disk, ERASED, DISK_SIZE);
+	ut_assertok(store_sparse_image(&test_storage, NULL, 0, image));
+	ut_assertok(memcmp(disk, expect, DISK_SIZE));
+	for (i = 0; i < ARRAY_SIZE(pieces); i++) {
+		ut_assertok(stream_image(uts, len, pieces[i]));
+		ut_assertf(!memcmp(disk, expect, DISK_SIZE),
+			   "pieces of %d bytes", pieces[i]);
+	}
+
+	len = build_image(mid_chunks, ARRAY_SIZE(mid_chunks));
+	for (i = 0; i < ARRAY_SIZE(pieces); i++) {
+		ut_assertok(stream_image(uts, len, pieces[i]));
+		ut_assertf(!memcmp(disk, expect, DISK_SIZE),
+			   "pieces of %d bytes", pieces[i]);
+	}
+
+	return 0;
+}
+DM_TEST(dm_test_sparse_stream, 0);
+
+/* Test that an image which is not sparse is written as it is, padded */
+static int dm_test_sparse_stream_raw(struct unit_test_state *uts)
+{
+	int i, len = 300001;
+
+	ut_fill_random(image, len, 1);
+	memset(expect, ERASED, DISK_SIZE);
+	memcpy(expect + DISK_START * DISK_BLK_SZ, image, len);
+	memset(expect + DISK_START * DISK_BLK_SZ + len, '\0',
+	       -len & (DISK_BLK_SZ - 1));
+	for (i = 0; i < ARRAY_SIZE(pieces); i++) {
+		ut_assertok(stream_image(uts, len, pieces[i]));
+		ut_assertf(!memcmp(disk, expect, DISK_SIZE),
+			   "pieces of %d bytes", pieces[i]);
+	}
+
+	return 0;
+}
+DM_TEST(dm_test_sparse_stream_raw, 0);
+
+/* Test that incomplete images and images too big for the disk fail */
+static int dm_test_sparse_stream_bad(struct unit_test_state *uts)
+{
+	sparse_header_t *header = (sparse_header_t *)image;
+	struct sparse_stream ss;
+	int len, ret;
+
+	len = build_image(tail_chunks, ARRAY_SIZE(tail_chunks));
+	ut_assertok(sparse_stream_start(&ss, &test_storage, NULL));
+	ut_assertok(sparse_stream_write(&ss, image, len - 1));
+	ut_asserteq(-EIO, sparse_stream_finish(&ss));
+
+	/* The header claims more blocks than the chunks hold */
+	header->total_blks++;
+	ut_assertok(sparse_stream_start(&ss, &test_storage, NULL));
+	ut_assertok(sparse_stream_write(&ss, image, len));
+	ut_asserteq(-EIO, sparse_stream_finish(&ss));
+	header->total_blks--;
+
+	test_storage.size = 10;
+	ut_assertok(sparse_stream_start(&ss, &test_storage, NULL));
+	ret = sparse_stream_write(&ss, image, len);
+	test_storage.size = DISK_SIZE / DISK_BLK_SZ - DISK_START;
+	ut_asserteq(-EINVAL, ret);
+	ut_asserteq(-EIO, sparse_stream_finish(&ss));
+
+	return 0;
+}
+DM_TEST(dm_test_sparse_stream_bad, 0);
+
+/* Test that don't-care chunks cannot move writes outside the partition */
+static int dm_test_sparse_stream_skip(struct unit_test_state *uts)
+{
+	chunk_header_t *chunk;
+	struct sparse_stream ss;
+	int len;
+
+	len = build_image(skip_chunks, ARRAY_SIZE(skip_chunks));
+	chunk = (chunk_header_t *)(image + sizeof(sparse_header_t));
+	memset(expect, ERASED, DISK_SIZE);
+
+	/* Going one block past the end */
+	chunk->chunk_sz = test_storage.size * DISK_BLK_SZ / SPARSE_BLK_SZ + 1;
+	memset(disk, ERASED, DISK_SIZE);
+	ut_assertok(sparse_stream_start(&ss, &test_storage, NULL));
+	ut_asserteq(-EINVAL, sparse_stream_write(&ss, image, len));
+	ut_asserteq(-EIO, sparse_stream_finish(&ss));
+
+	/* Wrapping round to block 0, before the start, and writing there */
+	chunk->chunk_sz = (0x100000000ULL - DISK_START) * DISK_BLK_SZ /
+			  SPARSE_BLK_SZ;
+	ut_assertok(sparse_stream_start(&ss, &test_storage, NULL));
+	ut_asserteq(-EINVAL, sparse_stream_write(&ss, image, len));
+	ut_asserteq(-EIO, sparse_stream_finish(&ss));
+	ut_assertok(memcmp(disk, expect, DISK_SIZE));
+
+	return 0;
+}
+DM_TEST(dm_test_sparse_stream_skip, 0);
@@ -0,0 +1,150 @@
+/*
+ * Tests for the memory functions in lib/string.c
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <dm/test.h>
+#include <test/ut.h>
+
+#define MAX_ALIGN	16
+#define MAX_LEN		200
+#define GUARD		16
+#define BUF_SIZE	(GUARD + MAX_ALIGN + MAX_LEN + GUARD)
+
+static u8 buf[BUF_SIZE], orig[BUF_SIZE], expect[BUF_SIZE];
+
+/* Return the offset of the first byte which differs, or -1 if none */
+static int buf_diff(const u8 *a, const u8 *b)
+{
+	int i;
+
+	for (i = 0; i < BUF_SIZE; i++) {
+		if (a[i] != b[i])
+			return i;
+	}
+
+	return -1;
+}
+
+/* Test memcpy() for all source and destination alignments */
+static int dm_test_string_memcpy(struct unit_test_state *uts)
+{
+	int dalign, salign, len, i, diff;
+
+	ut_fill_random(orig, BUF_SIZE, 1);
+	for (dalign = 0; dalign < MAX_ALIGN; dalign++) {
+		for (salign = 0; salign < MAX_ALIGN; salign++) {
+			for (len = 0; len <= MAX_LEN; len++) {
+				ut_fill_random(buf, BUF_SIZE, 2);
+				memcpy(expect, buf, BUF_SIZE);
+				for (i = 0; i < len; i++)
+					expect[GUARD + dalign + i] =
+						orig[GUARD + salign + i];
+				memcpy(buf + GUARD + dalign,
+				       orig + GUARD + salign, len);
+				diff = buf_diff(buf, expect);
+				ut_assertf(diff == -1,
+					   "dest align %d, src align %d, len %d: byte %d",
+					   dalign, salign, len, diff);
+			}
+		}
+	}
+
+	return 0;
+}
+DM_TEST(dm_test_string_memcpy, 0);
+
+/* Test overlapping memmove() in both directions, within one buffer */
+static int dm_test_string_memmove(struct unit_test_state *uts)
+{
+	int dalign, salign, len, i, diff;
+
+	for (dalign = 0; dalign < MAX_ALIGN * 2; dalign++) {
+		for (salign = 0; salign < MAX_ALIGN * 2; salign++) {
+			for (len = 0; len <= MAX_LEN - MAX_ALIGN; len++) {
+				ut_fill_random(buf, BUF_SIZE, 3);
+				memcpy(orig, buf, BUF_SIZE);
+				memcpy(expect, buf, BUF_SIZE);
+				for (i = 0; i < len; i++)
+					expect[GUARD + dalign + i] =
+						orig[GUARD + salign + i];
+				memmove(buf + GUARD + dalign,
+					buf + GUARD + salign, len);
+				diff = buf_diff(buf, expect);
+				ut_assertf(diff == -1,
+					   "dest align %d, src align %d, len %d: byte %d",
+					   dalign, salign, len, diff);
+			}
+		}
+	}
+
+	return 0;
+}
+DM_TEST(dm_test_string_memmove, 0);
+
+/* Test memset() for all alignments, using only the low byte of the value */
+static int dm_test_string_memset(struct unit_test_state *uts)
+{
+	int dalign, len, i, diff;
+
+	for (dalign = 0; dalign < MAX_ALIGN; dalign++) {
+		for (len = 0; len <= MAX_LEN; len++) {
+			ut_fill_random(buf, BUF_SIZE, 4);
+			memcpy(expect, buf, BUF_SIZE);
+			for (i = 0; i < len; i++)
+				expect[GUARD + dalign + i] = 0xa5;
+			memset(buf + GUARD + dalign, 0x1a5, len);
+			diff = buf_diff(buf, expect);
+			ut_assertf(diff == -1, "align %d, len %d: byte %d",
+				   dalign, len, diff);
+		}
+	}
+
+	return 0;
+}
+DM_TEST(dm_test_string_memset, 0);
+
+static int sign(int val)
+{
+	return val < 0 ? -1 : val > 0;
+}
+
+/* Test memcmp() on equal areas and with each byte in turn differing */
+static int dm_test_string_memcmp(struct unit_test_state *uts)
+{
+	int aalign, balign, len, pos, ret;
+	u8 *a = orig, *b = buf;
+
+	ut_fill_random(a, BUF_SIZE, 5);
+	for (aalign = 0; aalign < MAX_ALIGN; aalign++) {
+		for (balign = 0; balign < MAX_ALIGN; balign++) {
+			for (len = 0; len <= MAX_LEN; len += 7) {
+				memcpy(b + GUARD + balign, a + GUARD + aalign,
+				       len);
+				ret = memcmp(a + GUARD + aalign,
+					     b + GUARD + balign, len);
+				ut_assertf(!ret, "align %d/%d, len %d: %d",
+					   aalign, balign, len, ret);
+
+				/* Flip the top bit of each byte in turn */
+				for (pos = 0; pos < len; pos++) {
+					b[GUARD + balign + pos] ^= 0x80;
+					ret = memcmp(a + GUARD + aalign,
+						     b + GUARD + balign, len);
+					b[GUARD + balign + pos] ^= 0x80;
+					ut_assertf(sign(ret) ==
+						   (a[GUARD + aalign + pos] &
+						    0x80 ? 1 : -1),
+						   "align %d/%d, len %d: difference at %d gives %d",
+						   aalign, balign, len, pos,
+						   ret);
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+DM_TEST(dm_test_string_memcmp, 0);
@@ -11,9 +11,12 @@
 #include <malloc.h>
 #include <asm/io.h>
 #include <dm/test.h>
+#include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/root.h>
 #include <dm/uclass-internal.h>
 #include <dm/util.h>
+#include <linux/err.h>
 #include <test/ut.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -266,3 +269,147 @@ static int dm_test_fdt_offset(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_fdt_offset, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test that the compatible-string index finds the same drivers as a scan */
+static int dm_test_fdt_compat_index(struct unit_test_state *uts)
+{
+	const struct udevice_id *id, *scan_id;
+	struct driver *drv, *scan_drv;
+	const void *blob = gd->fdt_blob;
+	int node, ret, found = 0;
+	void *idx;
+
+	for (node = fdt_next_node(blob, -1, NULL); node >= 0;
+	     node = fdt_next_node(blob, node, NULL)) {
+		drv = NULL;
+		id = NULL;
+		scan_drv = NULL;
+		scan_id = NULL;
+		ret = lists_find_fdt_driver(blob, node, false, &drv, &id);
+		ut_asserteq(lists_find_fdt_driver(blob, node, true, &scan_drv,
+						  &scan_id), ret);
+		ut_asserteq_ptr(scan_drv, drv);
+		ut_asserteq_ptr(scan_id, id);
+		if (!ret)
+			found++;
+	}
+	ut_assert(found > 0);
+	if (!CONFIG_IS_ENABLED(DM_COMPAT_INDEX))
+		return 0;
+	ut_assertnonnull(gd->compat_index);
+	ut_assert(!IS_ERR(gd->compat_index));
+
+	/* If the index could not be built, drivers are scanned instead */
+	idx = gd->compat_index;
+	gd->compat_index = ERR_PTR(-ENOMEM);
+	node = fdt_path_offset(blob, "/a-test");
+	ret = lists_find_fdt_driver(blob, node, false, &drv, &id);
+	gd->compat_index = idx;
+	ut_assertok(ret);
+	ut_asserteq_str("denx,u-boot-fdt-test", id->compatible);
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_compat_index, 0);
+
+/* Test that the uclass lookup maps follow probe, remove and unbind */
+static int dm_test_fdt_uclass_map(struct unit_test_state *uts)
+{
+	struct udevice *dev, *found;
+	struct uclass *uc;
+	int node, seq;
+
+	ut_assertok(uclass_get(UCLASS_TEST_FDT, &uc));
+	ut_asserteq_ptr(uc, uclass_find(UCLASS_TEST_FDT));
+
+	/* Every probed device can be found by seq and by node */
+	uclass_foreach_dev(dev, uc) {
+		ut_assertok(device_probe(dev));
+		ut_assertok(uclass_find_device_by_seq(UCLASS_TEST_FDT,
+						      dev->seq, false, &found));
+		ut_asserteq_ptr(dev, found);
+		ut_assertok(uclass_find_device_by_of_offset(UCLASS_TEST_FDT,
+							    dev->of_offset,
+							    &found));
+		ut_asserteq_ptr(dev, found);
+	}
+	ut_assert(uc->map[UCLASS_MAP_SEQ].size);
+	ut_assert(uc->map[UCLASS_MAP_OF_OFFSET].size);
+
+	/* Once removed, a device's sequence number is free again */
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_FDT, "e-test",
+					       &dev));
+	seq = dev->seq;
+	node = dev->of_offset;
+	ut_assertok(device_remove(dev));
+	ut_asserteq(-ENODEV, uclass_find_device_by_seq(UCLASS_TEST_FDT, seq,
+						       false, &found));
+	ut_assertok(uclass_find_device_by_of_offset(UCLASS_TEST_FDT, node,
+						    &found));
+	ut_asserteq_ptr(dev, found);
+
+	/* Once unbound it cannot be found at all */
+	ut_assertok(device_unbind(dev));
+	ut_asserteq(0, uc->map[UCLASS_MAP_OF_OFFSET].size);
+	ut_asserteq(-ENODEV, uclass_find_device_by_of_offset(UCLASS_TEST_FDT,
+							     node, &found));
+	ut_asserteq(-ENODEV, uclass_find_device_by_seq(UCLASS_TEST_FDT, 6,
+						       true, &found));
+
+	/* Binding it again makes it visible */
+	ut_assertok(lists_bind_fdt(gd->dm_root, gd->fdt_blob, node, &dev));
+	ut_assertok(uclass_find_device_by_of_offset(UCLASS_TEST_FDT, node,
+						    &found));
+	ut_asserteq_ptr(dev, found);
+	ut_assertok(uclass_get_device_by_seq(UCLASS_TEST_FDT, 6, &found));
+	ut_asserteq_ptr(dev, found);
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_uclass_map, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(DM_STATS)
+/* Test that lookups and map rebuilds are counted */
+static int dm_test_fdt_lookup_stats(struct unit_test_state *uts)
+{
+	struct dm_lookup_stats *stats = dm_get_lookup_stats();
+	struct dm_lookup_stats old;
+	struct udevice *dev, *found;
+	struct uclass *uc;
+	int node;
+
+	ut_assertnonnull(stats);
+	ut_assertok(uclass_get(UCLASS_TEST_FDT, &uc));
+	ut_assertok(uclass_first_device(UCLASS_TEST_FDT, &dev));
+	ut_assertnonnull(dev);
+	old = *stats;
+
+	ut_assertok(uclass_find_device_by_seq(UCLASS_TEST_FDT, dev->seq,
+					      false, &found));
+	ut_assertok(uclass_find_device_by_of_offset(UCLASS_TEST_FDT,
+						    dev->of_offset, &found));
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_FDT, dev->name,
+					       &found));
+	ut_asserteq(old.count[DM_LOOKUP_SEQ] + 1, stats->count[DM_LOOKUP_SEQ]);
+	ut_asserteq(old.count[DM_LOOKUP_OF_OFFSET] + 1,
+		    stats->count[DM_LOOKUP_OF_OFFSET]);
+	ut_asserteq(old.count[DM_LOOKUP_NAME] + 1,
+		    stats->count[DM_LOOKUP_NAME]);
+	ut_assert(stats->count[DM_LOOKUP_UCLASS] >
+		  old.count[DM_LOOKUP_UCLASS]);
+
+	/* Binding a device drops the maps, so the next lookup rebuilds one */
+	old = *stats;
+	node = dev->of_offset;
+	ut_assertok(device_remove(dev));
+	ut_assertok(device_unbind(dev));
+	ut_assertok(lists_bind_fdt(gd->dm_root, gd->fdt_blob, node, &dev));
+	ut_assertok(uclass_find_device_by_of_offset(UCLASS_TEST_FDT, node,
+						    &found));
+	ut_asserteq_ptr(dev, found);
+	ut_assert(stats->map_builds > old.map_builds);
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_lookup_stats, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
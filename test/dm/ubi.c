@@ -0,0 +1,123 @@
+/*
+ * Tests for UBI on the sandbox NAND simulator
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <command.h>
+#include <mapmem.h>
+#include <nand.h>
+#include <ubi_uboot.h>
+#include <asm/test.h>
+#include <dm/test.h>
+#include <test/ut.h>
+
+#define TEST_SIZE	0x40000
+#define TEST_ADDR	0x1000000
+#define CMP_ADDR	0x1100000
+
+/* PEB whose headers get bitflips, clear of the factory bad block */
+#define FLIP_PEB	10
+
+/*
+ * Attach UBI to a blank chip, create a volume and write it with random
+ * data. The number of good PEBs is returned in @goodp.
+ */
+static int ubi_setup(struct unit_test_state *uts, int *goodp)
+{
+	struct mtd_info *mtd = &nand_info[0];
+	struct ubi_device *ubi;
+	char cmd[80];
+
+	ut_assertok(sandbox_nand_reset(mtd));
+	ut_assertok(run_command("ubi part ubi", 0));
+	ubi = ubi_devices[0];
+	ut_assertnonnull(ubi);
+	ut_asserteq(mtd->size / mtd->erasesize, ubi->peb_count);
+	ut_asserteq(1, ubi->bad_peb_count);
+	*goodp = ubi->good_peb_count;
+
+	/* A blank PEB needs just the one read */
+	ut_asserteq(*goodp, ubi->attach_stats.hdr_reads);
+
+	ut_fill_random(map_sysmem(TEST_ADDR, TEST_SIZE), TEST_SIZE, 1);
+	ut_assertok(run_command("ubi create test 80000", 0));
+	snprintf(cmd, sizeof(cmd), "ubi write %x test %x", TEST_ADDR,
+		 TEST_SIZE);
+	ut_assertok(run_command(cmd, 0));
+
+	return 0;
+}
+
+/* Read the test volume back and check it against what was written */
+static int ubi_check_data(struct unit_test_state *uts)
+{
+	char cmd[80];
+
+	memset(map_sysmem(CMP_ADDR, TEST_SIZE), '\0', TEST_SIZE);
+	snprintf(cmd, sizeof(cmd), "ubi read %x test %x", CMP_ADDR,
+		 TEST_SIZE);
+	ut_assertok(run_command(cmd, 0));
+	snprintf(cmd, sizeof(cmd), "cmp.b %x %x %x", TEST_ADDR, CMP_ADDR,
+		 TEST_SIZE);
+	ut_assertok(run_command(cmd, 0));
+
+	return 0;
+}
+
+/* Test attaching, writing a volume and attaching again */
+static int dm_test_ubi_attach(struct unit_test_state *uts)
+{
+	struct ubi_device *ubi;
+	int good;
+
+	ut_assertok(ubi_setup(uts, &good));
+	ut_assertok(ubi_check_data(uts));
+
+	/* Each PEB now has both headers, which come in a single read */
+	ut_assertok(run_command("ubi part ubi", 0));
+	ubi = ubi_devices[0];
+	ut_asserteq(good, ubi->attach_stats.hdr_reads);
+	ut_assertok(run_command("ubi check test", 0));
+	ut_assertok(ubi_check_data(uts));
+
+	/* And again, to check that attaching changed nothing */
+	ut_assertok(run_command("ubi part ubi", 0));
+	ut_asserteq(good, ubi_devices[0]->attach_stats.hdr_reads);
+	ut_assertok(ubi_check_data(uts));
+
+	return 0;
+}
+DM_TEST(dm_test_ubi_attach, 0);
+
+/* Test that bitflips in the headers make attaching read them separately */
+static int dm_test_ubi_bitflip(struct unit_test_state *uts)
+{
+	struct mtd_info *mtd = &nand_info[0];
+	int page = FLIP_PEB * (mtd->erasesize / mtd->writesize);
+	int good;
+
+	ut_assertok(ubi_setup(uts, &good));
+
+	/*
+	 * Enough correctable bitflips for MTD to report them, in the page
+	 * holding the EC header, mean that the combined read is followed by
+	 * one read for each header
+	 */
+	ut_assertok(sandbox_nand_set_bitflips(mtd, page, 7));
+	ut_assertok(run_command("ubi part ubi", 0));
+	ut_asserteq(good + 2, ubi_devices[0]->attach_stats.hdr_reads);
+	ut_assertok(ubi_check_data(uts));
+
+	/* The same with an uncorrectable one in the VID header's page */
+	ut_assertok(sandbox_nand_set_bitflips(mtd, page, 0));
+	ut_assertok(sandbox_nand_set_bitflips(mtd, page + 1, 20));
+	ut_assertok(run_command("ubi part ubi", 0));
+	ut_asserteq(good + 2, ubi_devices[0]->attach_stats.hdr_reads);
+	ut_assertok(ubi_check_data(uts));
+	ut_assertok(sandbox_nand_set_bitflips(mtd, page + 1, 0));
+
+	return 0;
+}
+DM_TEST(dm_test_ubi_bitflip, 0);
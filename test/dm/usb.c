@@ -7,6 +7,8 @@
 #include <common.h>
 #include <console.h>
 #include <dm.h>
+#include <malloc.h>
+#include <os.h>
 #include <usb.h>
 #include <asm/io.h>
 #include <asm/state.h>
@@ -41,6 +43,8 @@ static int dm_test_usb_flash(struct unit_test_state *uts)
 	struct udevice *dev;
 	struct blk_desc *dev_desc;
 	char cmp[1024];
+	char *buf, *data;
+	int fd;
 
 	state_set_skip_delays(true);
 	ut_assertok(usb_init());
@@ -52,6 +56,20 @@ static int dm_test_usb_flash(struct unit_test_state *uts)
 	memset(cmp, '\0', sizeof(cmp));
 	ut_asserteq(2, blk_dread(dev_desc, 0, 2, cmp));
 	ut_assertok(strcmp(cmp, "this is a test"));
+
+	/* This needs several commands since sandbox allows 64KB per transfer */
+	buf = malloc(300 * 512);
+	data = malloc(300 * 512);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(data);
+	ut_asserteq(300, blk_dread(dev_desc, 0, 300, buf));
+	fd = os_open("testflash.bin", OS_O_RDONLY);
+	ut_assert(fd >= 0);
+	ut_asserteq(300 * 512, os_read(fd, data, 300 * 512));
+	os_close(fd);
+	ut_assertok(memcmp(buf, data, 300 * 512));
+	free(data);
+	free(buf);
 	ut_assertok(usb_stop());
 
 	return 0;
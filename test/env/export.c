@@ -0,0 +1,143 @@
+/*
+ * Tests for exporting and saving the environment
+ *
+ * SPDX-License-Identifier:	GPL-2.0+
+ */
+
+#include <common.h>
+#include <environment.h>
+#include <malloc.h>
+#include <search.h>
+#include <test/env.h>
+#include <test/ut.h>
+
+/* Test that an unchanged environment is exported without rebuilding it */
+static int env_test_export_unchanged(struct unit_test_state *uts)
+{
+	char value[32];
+	env_t *env1, *env2;
+
+	env1 = malloc(sizeof(*env1));
+	env2 = malloc(sizeof(*env2));
+	ut_assertnonnull(env1);
+	ut_assertnonnull(env2);
+
+	/* Load an exported copy back in, as if read from storage */
+	ut_assertok(env_export(env1));
+	ut_asserteq(1, env_import((char *)env1, 1));
+	ut_asserteq(0, env_htab.dirty);
+
+	/* Setting a variable to its current value does not mark it dirty */
+	strlcpy(value, getenv("bootdelay"), sizeof(value));
+	ut_assertok(setenv("bootdelay", value));
+	ut_asserteq(0, env_htab.dirty);
+	ut_assertok(env_export(env2));
+	ut_assertok(memcmp(env1, env2, sizeof(*env1)));
+
+	/* A new variable must be exported, and is then reused */
+	ut_assertok(setenv("ut_env_export", "1"));
+	ut_asserteq(1, env_htab.dirty);
+	ut_assertok(env_export(env2));
+	ut_assert(memcmp(env1, env2, sizeof(*env1)));
+	ut_asserteq(0, env_htab.dirty);
+
+	/* Deleting it makes the environment dirty again */
+	ut_assertok(setenv("ut_env_export", NULL));
+	ut_asserteq(1, env_htab.dirty);
+	ut_assertok(env_export(env2));
+	ut_assertok(memcmp(env1->data, env2->data, ENV_SIZE));
+
+	free(env1);
+	free(env2);
+
+	return 0;
+}
+ENV_TEST(env_test_export_unchanged, 0);
+
+#define TEST_UNIT	512
+
+/* Storage in memory, counting the bytes written to it */
+static char test_store[CONFIG_ENV_SIZE];
+static ulong test_written;
+static bool test_read_fails;
+
+static int test_read(struct env_storage *stor, ulong offset, ulong size,
+		     void *buf)
+{
+	if (test_read_fails)
+		return -EIO;
+	memcpy(buf, test_store + offset, size);
+
+	return 0;
+}
+
+static int test_write(struct env_storage *stor, ulong offset, ulong size,
+		      const void *buf)
+{
+	if (offset % TEST_UNIT)
+		return -EINVAL;
+	memcpy(test_store + offset, buf, size);
+	test_written += size;
+
+	return 0;
+}
+
+/* Save @env and check the number of bytes written and the result */
+static int test_save(struct unit_test_state *uts, struct env_storage *stor,
+		     const env_t *env, int expect)
+{
+	test_written = 0;
+	ut_asserteq(expect, env_write_changed(stor, env));
+	ut_asserteq(expect, test_written);
+	ut_assertok(memcmp(test_store, env, CONFIG_ENV_SIZE));
+
+	return 0;
+}
+
+/* Test that saving writes what differs from the storage, not the last save */
+static int env_test_save_changed(struct unit_test_state *uts)
+{
+	struct env_storage stor = {
+		.unit	= TEST_UNIT,
+		.read	= test_read,
+		.write	= test_write,
+	};
+	env_t *env;
+	int written;
+
+	env = malloc(sizeof(*env));
+	ut_assertnonnull(env);
+	ut_assertok(env_export(env));
+
+	memset(test_store, 0xff, CONFIG_ENV_SIZE);
+	ut_assertok(test_save(uts, &stor, env, CONFIG_ENV_SIZE));
+	ut_assertok(test_save(uts, &stor, env, 0));
+
+	/* A new variable changes only part of the image */
+	ut_assertok(setenv("ut_env_save", "1"));
+	ut_assertok(env_export(env));
+	test_written = 0;
+	written = env_write_changed(&stor, env);
+	ut_assert(written > 0 && written < CONFIG_ENV_SIZE);
+	ut_asserteq(written, test_written);
+	ut_assertok(memcmp(test_store, env, CONFIG_ENV_SIZE));
+
+	/* The storage is erased behind our back, so all of it is written */
+	memset(test_store, 0xff, CONFIG_ENV_SIZE);
+	ut_assertok(test_save(uts, &stor, env, CONFIG_ENV_SIZE));
+
+	/* Or partly overwritten */
+	memset(test_store + TEST_UNIT + 10, '\0', 1);
+	ut_assertok(test_save(uts, &stor, env, TEST_UNIT));
+
+	/* If it cannot be read, everything is written */
+	test_read_fails = true;
+	ut_assertok(test_save(uts, &stor, env, CONFIG_ENV_SIZE));
+	test_read_fails = false;
+
+	ut_assertok(setenv("ut_env_save", NULL));
+	free(env);
+
+	return 0;
+}
+ENV_TEST(env_test_save_changed, 0);
@@ -0,0 +1,112 @@
+#!/bin/bash
+
+# SPDX-License-Identifier:	GPL-2.0+
+
+# This script measures the throughput of U-Boot's ext4 file read path.
+#
+# ext4fs_read_file() used to resolve every filesystem block of an extent
+# mapped file separately, re-reading the extent tree for each block. It now
+# walks the extent tree once per read and issues one device read per
+# physical extent. This benchmark loads a large extent-mapped file and a
+# sparse file with a deep extent tree and reports the rate printed by the
+# load command, together with a CRC check of the data.
+#
+# To execute the benchmark, run it from the U-Boot source root directory:
+#
+#    cd u-boot
+#    ./test/fs/ext4-read-bench.sh
+#
+# To compare against another build (e.g. one without this change), point
+# BASELINE_UBOOT at its sandbox binary:
+#
+#    BASELINE_UBOOT=../u-boot-old/sandbox/u-boot ./test/fs/ext4-read-bench.sh
+#
+# Each load prints one line of the form below, followed by PASS or FAILURE
+# for the CRC check of the last load:
+#
+#    u-boot: contig.bin: 67108864 bytes read in <ms> ms (<rate>)
+#
+# All temporary files used by this script are created in ./sandbox, as for
+# the other scripts in test/fs.
+
+odir=sandbox
+img=${odir}/ext4-bench.img
+src=${odir}/ext4-bench
+loadaddr=1000
+crcaddr=0
+runs=3
+
+for prereq in mke2fs dd crc32 python3; do
+    if [ ! -x "`which $prereq`" ]; then
+        echo "Missing $prereq binary. Exiting!"
+        exit 1
+    fi
+done
+
+make O=${odir} -s sandbox_defconfig && make O=${odir} -s -j8
+
+if [ ! -f ${img} ]; then
+    rm -rf ${src}
+    mkdir -p ${src}
+
+    # One large file, allocated in a handful of extents
+    dd if=/dev/urandom of=${src}/contig.bin bs=1M count=64 >/dev/null 2>&1
+
+    # A sparse file with thousands of small extents separated by holes,
+    # enough to need a two-level extent tree with 1 KiB blocks
+    python3 - ${src}/sparse.bin << EOF
+import os, random, sys
+random.seed(1)
+with open(sys.argv[1], 'wb') as f:
+    pos = 0
+    for i in range(2500):
+        pos += random.randint(0, 3) * 1024
+        f.seek(pos)
+        n = random.randint(1, 5) * 1024
+        f.write(os.urandom(n))
+        pos += n
+    f.truncate(pos + 5000)
+EOF
+
+    mke2fs -q -t ext4 -b 1024 -d ${src} ${img} 128M
+    if [ $? -ne 0 ]; then
+        echo Could not create ext4 filesystem
+        exit $?
+    fi
+fi
+
+# Print the little-endian CRC32 of a file, as stored by the crc32 command
+function le_crc() {
+    local crc=0x`crc32 $1`
+
+    printf %02x%02x%02x%02x \
+        $((${crc} & 0xff)) \
+        $(((${crc} >> 8) & 0xff)) \
+        $(((${crc} >> 16) & 0xff)) \
+        $((${crc} >> 24))
+}
+
+# 1st parameter is the sandbox U-Boot binary, 2nd the file to load
+function bench() {
+    local crc=`le_crc ${src}/$2`
+    local cmds="host bind 0 ${img}"
+
+    for ((i = 0; i < ${runs}; i++)); do
+        cmds="${cmds}
+ext4load host 0:0 ${loadaddr} /$2"
+    done
+
+    $1 << EOF | grep -E "bytes read|PASS|FAILURE" | \
+        sed "s|^|$(basename $1): $2: |"
+${cmds}
+crc32 ${loadaddr} \$filesize ${crcaddr}
+if itest.l *${crcaddr} != ${crc}; then echo FAILURE; else echo PASS; fi
+reset
+EOF
+}
+
+for uboot in ./${odir}/u-boot ${BASELINE_UBOOT}; do
+    for fn in contig.bin sparse.bin; do
+        bench ${uboot} ${fn}
+    done
+done
@@ -9,14 +9,14 @@
 # It currently tests the fs/sb and native commands for ext4 and fat partitions
 # Expected results are as follows:
 # EXT4 tests:
-# fs-test.sb.ext4.out: Summary: PASS: 17 FAIL: 2
-# fs-test.ext4.out: Summary: PASS: 10 FAIL: 9
-# fs-test.fs.ext4.out: Summary: PASS: 10 FAIL: 9
+# fs-test.sb.ext4.out: Summary: PASS: 24 FAIL: 3
+# fs-test.ext4.out: Summary: PASS: 27 FAIL: 0
+# fs-test.fs.ext4.out: Summary: PASS: 27 FAIL: 0
 # FAT tests:
 # fs-test.sb.fat.out: Summary: PASS: 17 FAIL: 2
 # fs-test.fat.out: Summary: PASS: 19 FAIL: 0
 # fs-test.fs.fat.out: Summary: PASS: 19 FAIL: 0
-# Total Summary: TOTAL PASS: 92 TOTAL FAIL: 22
+# Total Summary: TOTAL PASS: 133 TOTAL FAIL: 5
 
 # pre-requisite binaries list.
 PREREQ_BINS="md5sum mkfs mount umount dd fallocate mkdir"
@@ -40,6 +40,9 @@ SMALL_FILE="1MB.file"
 # $BIG_FILE is the name of the 2.5GB file in the file system image
 BIG_FILE="2.5GB.file"
 
+# $HUGE_FILE is the name of the sparse 5GB file, only in the ext4 image
+HUGE_FILE="5GB.file"
+
 # $MD5_FILE will have the expected md5s when we do the test
 # They shall have a suffix which represents their file system (ext4/fat)
 MD5_FILE="${OUT_DIR}/md5s.list"
@@ -50,6 +53,7 @@ OUT="${OUT_DIR}/fs-test"
 # Full Path of the 1 MB file that shall be created in the fs image.
 MB1="${MOUNT_DIR}/${SMALL_FILE}"
 GB2p5="${MOUNT_DIR}/${BIG_FILE}"
+GB5="${MOUNT_DIR}/${HUGE_FILE}"
 
 # ************************
 # * Functions start here *
@@ -209,10 +213,45 @@ function test_image() {
 		FILE_WRITE=`fname_for_write $2 $3`
 		FILE_SMALL=$3
 		FILE_BIG=$4
+		FILE_HUGE=$HUGE_FILE
 	else
 		FILE_WRITE=$6/`fname_for_write $2 $3`
 		FILE_SMALL=$6/$3
 		FILE_BIG=$6/$4
+		FILE_HUGE=$6/$HUGE_FILE
+	fi
+
+	# Files of 4GB and more only exist on ext4
+	HUGE_TESTS=""
+	if [ "$2" = "ext4" ]; then
+		HUGE_TESTS="
+# 5GB (1024*1024*5120) is 0x1 4000 0000
+# Test Case 12 - size of huge file
+${PREFIX}size host${SUFFIX} $FILE_HUGE
+printenv filesize
+setenv filesize
+
+# Test Case 13a - First 1MB after 4GB of huge file
+${PREFIX}load host${SUFFIX} $addr $FILE_HUGE $length 0x100000000
+printenv filesize
+# Test Case 13b - First 1MB after 4GB of huge file
+md5sum $addr \$filesize
+setenv filesize
+
+# Test Case 14a - Last 1MB of huge file
+${PREFIX}load host${SUFFIX} $addr $FILE_HUGE $length 0x13FF00000
+printenv filesize
+# Test Case 14b - Last 1MB of huge file
+md5sum $addr \$filesize
+setenv filesize
+
+# Test Case 15a - One 1MB chunk crossing the 4GB boundary
+${PREFIX}load host${SUFFIX} $addr $FILE_HUGE $length 0xFFF80000
+printenv filesize
+# Test Case 15b - One 1MB chunk crossing the 4GB boundary
+md5sum $addr \$filesize
+setenv filesize
+"
 	fi
 
 	# In u-boot commands, <interface> stands for host or hostfs
@@ -290,6 +329,7 @@ printenv filesize
 md5sum $addr \$filesize
 setenv filesize
 
+$HUGE_TESTS
 # Generic failure case
 # Test Case 10 - 2MB chunk from the last 1MB of big file
 ${PREFIX}load host${SUFFIX} $addr $FILE_BIG 0x00200000 0x9C300000
@@ -337,6 +377,15 @@ function create_files() {
 			&> /dev/null
 	fi
 
+	# Create a sparse file larger than 4GB in the ext4 image, with data
+	# around the 4GB boundary and at its end.
+	if [ "$fs" = "ext4" -a ! -f "${GB5}" ]; then
+		sudo dd if=/dev/urandom of="${GB5}" bs=1M count=2 seek=4095 \
+			&> /dev/null
+		sudo dd if=/dev/urandom of="${GB5}" bs=1M count=1 seek=5119 \
+			&> /dev/null
+	fi
+
 	# Create a small file in this image.
 	if [ ! -f "${MB1}" ]; then
 		sudo dd if=/dev/urandom of="${MB1}" bs=1M count=1 \
@@ -371,6 +420,20 @@ function create_files() {
 	dd if="${GB2p5}" bs=512K skip=4095 count=2 \
 		2> /dev/null | md5sum >> "$2"
 
+	if [ "$fs" = "ext4" ]; then
+		# First 1MB after 4GB of the huge file
+		dd if="${GB5}" bs=1M skip=4096 count=1 \
+			2> /dev/null | md5sum >> "$2"
+
+		# Last 1MB of the huge file
+		dd if="${GB5}" bs=1M skip=5119 count=1 \
+			2> /dev/null | md5sum >> "$2"
+
+		# One 1MB chunk crossing the 4GB boundary
+		dd if="${GB5}" bs=512K skip=8191 count=2 \
+			2> /dev/null | md5sum >> "$2"
+	fi
+
 	sync
 	sudo umount "$MOUNT_DIR"
 	rmdir "$MOUNT_DIR"
@@ -429,11 +492,11 @@ function check_results() {
 	FAIL=0
 
 	# Check if the ls is showing correct results for 2.5 gb file
-	grep -A6 "Test Case 1 " "$1" | egrep -iq "2621440000 *$4"
+	grep -A7 "Test Case 1 " "$1" | egrep -iq "2621440000 *$4"
 	pass_fail "TC1: ls of $4"
 
 	# Check if the ls is showing correct results for 1 mb file
-	grep -A6 "Test Case 1 " "$1" | egrep -iq "1048576 *$3"
+	grep -A7 "Test Case 1 " "$1" | egrep -iq "1048576 *$3"
 	pass_fail "TC1: ls of $3"
 
 	# Check size command on 1MB.file
@@ -487,6 +550,36 @@ function check_results() {
 	pass_fail "TC11: 1MB write to $5 - write succeeded"
 	check_md5 "Test Case 11b " "$1" "$2" 1 \
 		"TC11: 1MB write to $5 - content verified"
+
+	if [ "$fs" = "ext4" ]; then
+		# Check if the ls is showing correct results for 5 gb file
+		grep -A7 "Test Case 1 " "$1" | \
+			egrep -iq "5368709120 *$HUGE_FILE"
+		pass_fail "TC1: ls of $HUGE_FILE"
+
+		# Check size command on 5GB.file
+		egrep -A3 "Test Case 12 " "$1" | \
+			grep -q "filesize=140000000"
+		pass_fail "TC12: size of $HUGE_FILE"
+
+		# Check first mb after 4gb from 5GB.file
+		grep -A6 "Test Case 13a " "$1" | grep -q "filesize=100000"
+		pass_fail "TC13: load 1st MB after 4GB from $HUGE_FILE size"
+		check_md5 "Test Case 13b " "$1" "$2" 7 \
+			"TC13: load 1st MB after 4GB from $HUGE_FILE"
+
+		# Check last mb of 5GB.file
+		grep -A6 "Test Case 14a " "$1" | grep -q "filesize=100000"
+		pass_fail "TC14: load of last MB from $HUGE_FILE size"
+		check_md5 "Test Case 14b " "$1" "$2" 8 \
+			"TC14: load of last MB from $HUGE_FILE"
+
+		# Check 1mb chunk crossing the 4gb boundary from 5GB.file
+		grep -A6 "Test Case 15a " "$1" | grep -q "filesize=100000"
+		pass_fail "TC15: load 1MB crossing 4GB from $HUGE_FILE size"
+		check_md5 "Test Case 15b " "$1" "$2" 9 \
+			"TC15: load 1MB crossing 4GB from $HUGE_FILE"
+	fi
 	echo "** End $1"
 }
 
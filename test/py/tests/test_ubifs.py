@@ -0,0 +1,206 @@
+# SPDX-License-Identifier: GPL-2.0
+
+# Test reading files from UBIFS on the sandbox NAND simulator. The test
+# makes an image with mkfs.ubifs, writes it to a UBI volume, mounts it and
+# checks what ubifsload reads back: whole and partial files, files smaller
+# than a block, and sparse files with holes in the middle and at the end.
+
+import os
+import random
+import struct
+import pytest
+import u_boot_utils
+
+# Geometry of the UBI volume holding the image: sandbox NAND has 2KiB pages
+# and 128KiB blocks, which leaves two pages per block for the UBI headers
+MIN_IO = 2048
+LEB_SIZE = 126976
+LEB_CNT = 40
+
+BLOCK = 4096
+
+# Node types and sizes, from fs/ubifs/ubifs-media.h
+MAGIC = 0x06101831
+DATA_NODE, DENT_NODE = 1, 2
+CH_SZ = 24
+
+def make_files():
+    """Return the files to put in the image, by name."""
+    r = random.Random(1)
+    def rand_bytes(size):
+        return bytearray(r.getrandbits(8) for i in range(size))
+
+    text = b''.join(b'line %06d of some text\n' % i for i in range(13100))
+    # Blocks 4-43 are a hole longer than a bulk-read (32 blocks) and the
+    # file ends with a hole which is not a whole number of blocks
+    sparse = bytearray(80 * BLOCK + 500)
+    for block in list(range(0, 4)) + list(range(44, 49)):
+        sparse[block * BLOCK:(block + 1) * BLOCK] = rand_bytes(BLOCK)
+
+    return {
+        'small': rand_bytes(100),
+        'text': bytearray(text),
+        'rand': rand_bytes(50 * BLOCK + 77),
+        'sparse': sparse,
+    }
+
+def find_data_nodes(data):
+    """Find the data nodes in an image.
+
+    Returns a dict giving (lnum, offs, len) of each node, keyed by
+    (file name, block number). Only files in the root directory are named.
+    """
+
+    names = {}
+    nodes = {}
+    for lnum in range(len(data) // LEB_SIZE):
+        offs = 0
+        while offs + CH_SZ <= LEB_SIZE:
+            pos = lnum * LEB_SIZE + offs
+            magic, crc, sqnum, size, node_type = struct.unpack_from(
+                '<IIQIB', data, pos)
+            if magic != MAGIC:
+                # Nodes are 8-byte aligned; skip free space and padding
+                offs += 8
+                continue
+            if node_type == DENT_NODE:
+                inum, nlen = struct.unpack_from('<Q2xH', data, pos + CH_SZ + 16)
+                name = data[pos + CH_SZ + 32:pos + CH_SZ + 32 + nlen]
+                names[inum] = bytes(name).decode()
+            elif node_type == DATA_NODE:
+                inum, block = struct.unpack_from('<II', data, pos + CH_SZ)
+                nodes[(inum, block & 0x1fffffff)] = (lnum, offs, size)
+            offs += (size + 7) & ~7
+
+    return dict(((names[inum], block), node)
+                for (inum, block), node in nodes.items() if inum in names)
+
+def find_tool(name):
+    for path in os.environ['PATH'].split(os.pathsep):
+        fn = os.path.join(path, name)
+        if os.path.isfile(fn) and os.access(fn, os.X_OK):
+            return fn
+    return None
+
+files = None
+def make_image(u_boot_console, corrupt=None):
+    """Build the image with mkfs.ubifs, with the magic number of the data
+    node of file block @corrupt damaged. Data node CRCs are not checked by
+    default.
+
+    Returns the image and the location of each data node, as
+    find_data_nodes() does.
+    """
+
+    global files
+    if not find_tool('mkfs.ubifs'):
+        pytest.skip('mkfs.ubifs not found')
+    if files is None:
+        files = make_files()
+    root = u_boot_console.config.result_dir + '/ubifs'
+    if not os.path.exists(root):
+        os.mkdir(root)
+    for name in files:
+        with open(root + '/' + name, 'wb') as fh:
+            fh.write(files[name])
+    fn = u_boot_console.config.result_dir + '/ubifs.img'
+    u_boot_utils.run_and_log(u_boot_console, [
+        'mkfs.ubifs', '-m', str(MIN_IO), '-e', str(LEB_SIZE), '-c',
+        str(LEB_CNT), '-x', 'zlib', '-r', root, '-o', fn])
+    with open(fn, 'rb') as fh:
+        data = bytearray(fh.read())
+    nodes = find_data_nodes(data)
+    if corrupt:
+        lnum, offs, size = nodes[corrupt]
+        data[lnum * LEB_SIZE + offs] ^= 0xff
+    return data, nodes
+
+def ubifs_setup(u_boot_console, data):
+    """Write an image to a new UBI volume on a blank chip and mount it."""
+
+    fn = u_boot_console.config.result_dir + '/ubifs.img'
+    with open(fn, 'wb') as fh:
+        fh.write(data)
+    addr = u_boot_utils.find_ram_base(u_boot_console) + 0x1000000
+    # Changing to another partition unmounts any earlier file system
+    u_boot_console.run_command('ubi part ubi')
+    u_boot_console.run_command('nand erase.chip')
+    u_boot_console.run_command('ubi part ubi')
+    u_boot_console.run_command('ubi create vol %x' % len(data))
+    u_boot_console.run_command('host load hostfs - %x %s' % (addr, fn))
+    output = u_boot_console.run_command('ubi write %x vol %x' %
+                                        (addr, len(data)))
+    assert '%d bytes written to volume vol' % len(data) in output
+    output = u_boot_console.run_command('ubifsmount ubi:vol')
+    assert 'Error' not in output
+
+def ubifs_load(u_boot_console, name, size=0):
+    """Load a file and return whether what was read matches the file."""
+
+    addr = u_boot_utils.find_ram_base(u_boot_console) + 0x2000000
+    output = u_boot_console.run_command('ubifsload %x %s %x' %
+                                        (addr, name, size))
+    if 'Error' in output:
+        return False
+    # Compare against the file loaded from the host, since the output of
+    # crc32 contains something which looks like a prompt
+    size = size or len(files[name])
+    fn = u_boot_console.config.result_dir + '/ubifs/' + name
+    u_boot_console.run_command('host load hostfs - %x %s' %
+                               (addr + 0x1000000, fn))
+    output = u_boot_console.run_command('cmp.b %x %x %x' %
+                                        (addr, addr + 0x1000000, size))
+    return 'Total of %d byte(s) were the same' % size in output
+
+def nand_reads(u_boot_console):
+    output = u_boot_console.run_command('nandsim stats')
+    return int(output.split()[1])
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_ubifs')
+def test_ubifs_load(u_boot_console):
+    """Test that whole and partial files read back as they were written."""
+
+    data, nodes = make_image(u_boot_console)
+    ubifs_setup(u_boot_console, data)
+    for name in sorted(files):
+        assert ubifs_load(u_boot_console, name)
+
+    # Partial loads ending in the middle of a block, a hole or a data node
+    # which is split across flash pages
+    for name, size in (('small', 10), ('text', 70000), ('rand', 2 * BLOCK),
+                       ('rand', BLOCK + 1), ('sparse', 5 * BLOCK + 100),
+                       ('sparse', 48 * BLOCK + 10)):
+        assert ubifs_load(u_boot_console, name, size)
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_ubifs')
+def test_ubifs_bulk_read(u_boot_console):
+    """Test that mounting turns on bulk-read, so that loading a file reads
+    each flash page holding its data only once."""
+
+    data, nodes = make_image(u_boot_console)
+    ubifs_setup(u_boot_console, data)
+    for name in ('text', 'rand'):
+        # The first load also reads the index nodes
+        ubifs_load(u_boot_console, name)
+        pages = set()
+        for (fname, block), (lnum, offs, size) in nodes.items():
+            if fname == name:
+                for page in range(offs // MIN_IO,
+                                  (offs + size - 1) // MIN_IO + 1):
+                    pages.add((lnum, page))
+        u_boot_console.run_command('nandsim stats -r')
+        assert ubifs_load(u_boot_console, name)
+        assert nand_reads(u_boot_console) == len(pages)
+
+@pytest.mark.boardspec('sandbox')
+@pytest.mark.buildconfigspec('cmd_ubifs')
+def test_ubifs_bad_node(u_boot_console):
+    """Test that a bad data node beyond a partial load, but within the same
+    bulk-read, does not stop the load; reading the bad node itself fails."""
+
+    data, nodes = make_image(u_boot_console, ('rand', 10))
+    ubifs_setup(u_boot_console, data)
+    assert ubifs_load(u_boot_console, 'rand', 2 * BLOCK)
+    assert not ubifs_load(u_boot_console, 'rand')
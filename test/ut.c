@@ -33,3 +33,14 @@ void ut_failf(struct unit_test_state *uts, const char *fname, int line,
 	putc('\n');
 	uts->fail_count++;
 }
+
+void ut_fill_random(void *buf, int size, uint seed)
+{
+	u8 *ptr = buf;
+	int i;
+
+	for (i = 0; i < size; i++) {
+		seed = seed * 1103515245 + 12345;
+		ptr[i] = seed >> 16;
+	}
+}